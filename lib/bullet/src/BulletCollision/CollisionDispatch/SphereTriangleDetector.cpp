@@ -57,13 +57,16 @@ void	SphereTriangleDetector::getClosestPoints(const ClosestPointInput& input,Res
         const btManifoldResult *mani = dynamic_cast<btManifoldResult*>(&output);
         if(mani)
         {
-            // Find the triangle:
+            // Find the object the triangle belongs to (usually a triangle
+            // mesh). Note that a triangle of a triangle mesh is not set as
+            // shape of the mesh object (so that several pairs can be
+            // processed in parallel).
+            const btTriangleShape *tri = m_triangle;
             const btCollisionObject *co = mani->getBody0Internal();
-            const btTriangleShape *tri = dynamic_cast<const btTriangleShape*>(co->getCollisionShape());
-            if(!tri)
+            if(!co->getCollisionShape()->isConcave() &&
+                co->getCollisionShape() != tri)
             {
-                co  = mani->getBody1Internal();
-                tri = dynamic_cast<const btTriangleShape*>(co->getCollisionShape());
+                co = mani->getBody1Internal();
             }
             // If we have a triangle and it is static, recompute the normal
             if(tri && co->isStaticOrKinematicObject())
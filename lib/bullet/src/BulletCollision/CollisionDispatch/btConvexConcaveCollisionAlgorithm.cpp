@@ -108,10 +108,12 @@ void btConvexTriangleCallback::processTriangle(btVector3* triangle,int partId, i
 		btTriangleShape tm(triangle[0],triangle[1],triangle[2]);	
 		tm.setMargin(m_collisionMarginTriangle);
 		
-		btCollisionShape* tmpShape = ob->getCollisionShape();
-		ob->internalSetTemporaryCollisionShape( &tm );
+		///do not set the triangle as temporary shape of the concave object,
+		///it can be used by other pairs which are processed in parallel
+		m_triangleProxy.setWorldTransform(ob->getWorldTransform());
+		m_triangleProxy.internalSetTemporaryCollisionShape( &tm );
 
-		btCollisionAlgorithm* colAlgo = ci.m_dispatcher1->findAlgorithm(m_convexBody,m_triBody,m_manifoldPtr);
+		btCollisionAlgorithm* colAlgo = ci.m_dispatcher1->findAlgorithm(m_convexBody,&m_triangleProxy,m_manifoldPtr);
 
 		if (m_resultOut->getBody0Internal() == m_triBody)
 		{
@@ -122,10 +124,10 @@ void btConvexTriangleCallback::processTriangle(btVector3* triangle,int partId, i
 			m_resultOut->setShapeIdentifiersB(partId,triangleIndex);
 		}
 	
-		colAlgo->processCollision(m_convexBody,m_triBody,*m_dispatchInfoPtr,m_resultOut);
+		colAlgo->processCollision(m_convexBody,&m_triangleProxy,*m_dispatchInfoPtr,m_resultOut);
 		colAlgo->~btCollisionAlgorithm();
 		ci.m_dispatcher1->freeCollisionAlgorithm(colAlgo);
-		ob->internalSetTemporaryCollisionShape( tmpShape);
+		m_triangleProxy.internalSetTemporaryCollisionShape( 0 );
 	}
 
 
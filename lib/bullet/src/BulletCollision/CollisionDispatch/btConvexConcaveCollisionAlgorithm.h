@@ -24,12 +24,16 @@ subject to the following restrictions:
 class btDispatcher;
 #include "BulletCollision/BroadphaseCollision/btBroadphaseProxy.h"
 #include "btCollisionCreateFunc.h"
+#include "btCollisionObject.h"
 
 ///For each triangle in the concave mesh that overlaps with the AABB of a convex (m_convexProxy), processTriangle is called.
 class btConvexTriangleCallback : public btTriangleCallback
 {
 	btCollisionObject* m_convexBody;
 	btCollisionObject* m_triBody;
+	///used instead of m_triBody when processing a triangle, so that
+	///the (shared) concave object is never modified
+	btCollisionObject  m_triangleProxy;
 
 	btVector3	m_aabbMin;
 	btVector3	m_aabbMax ;
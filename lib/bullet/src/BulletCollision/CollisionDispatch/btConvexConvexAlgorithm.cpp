@@ -350,7 +350,11 @@ void btConvexConvexAlgorithm ::processCollision (btCollisionObject* body0,btColl
 	
 	btGjkPairDetector::ClosestPointInput input;
 
-	btGjkPairDetector	gjkPairDetector(min0,min1,m_simplexSolver,m_pdSolver);
+	///use a local simplex solver (it is reset by gjk anyway), so that several
+	///pairs can be processed in parallel
+	btSimplexSolverInterface simplexSolver;
+	simplexSolver.setEqualVertexThreshold(m_simplexSolver->getEqualVertexThreshold());
+	btGjkPairDetector	gjkPairDetector(min0,min1,&simplexSolver,m_pdSolver);
 	//TODO: if (dispatchInfo.m_useContinuous)
 	gjkPairDetector.setMinkowskiA(min0);
 	gjkPairDetector.setMinkowskiB(min1);
@@ -454,13 +454,18 @@ void btGjkPairDetector::getClosestPointsNonVirtual(const ClosestPointInput& inpu
         const btManifoldResult *mani = dynamic_cast<btManifoldResult*>(&output);
         if(mani)
         {
-            // Find the triangle:
-            const btCollisionObject *co = mani->getBody0Internal();
-            const btTriangleShape *tri = dynamic_cast<const btTriangleShape*>(co->getCollisionShape());
+            // Find the triangle. Note that a triangle of a triangle mesh
+            // is not set as shape of the mesh object (so that several pairs
+            // can be processed in parallel), so use the shapes of gjk:
+            const btTriangleShape *tri = dynamic_cast<const btTriangleShape*>(m_minkowskiA);
             if(!tri)
+                tri = dynamic_cast<const btTriangleShape*>(m_minkowskiB);
+            // The object the triangle belongs to (usually a triangle mesh)
+            const btCollisionObject *co = mani->getBody0Internal();
+            if(!co->getCollisionShape()->isConcave() &&
+                co->getCollisionShape() != tri)
             {
-                co  = mani->getBody1Internal();
-                tri = dynamic_cast<const btTriangleShape*>(co->getCollisionShape());
+                co = mani->getBody1Internal();
             }
             // If we have a triangle and it is static, recompute the normal
             if(tri && co->isStaticOrKinematicObject())
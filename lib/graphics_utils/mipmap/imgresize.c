@@ -2047,10 +2047,11 @@ static void imStaticKernelPoT4Plant( unsigned char *dst, int pointx, int pointy,
 ////
 
 
-int imReduceImageKaiserDataDivisor( unsigned char *dstdata, unsigned char *srcdata, int width, int height, int bytesperpixel, int bytesperline, int sizedivisor, imReduceOptions *options )
+/* Altered for SuperTuxKart: the output rows can be restricted to a range, so that several threads can reduce one image */
+int imReduceImageKaiserDataDivisorRows( unsigned char *dstdata, unsigned char *srcdata, int width, int height, int bytesperpixel, int bytesperline, int sizedivisor, imReduceOptions *options, int firstrow, int rowcount )
 {
   int filter, x, y, pointx, pointy, basex, basey, pow2flag;
-  int newwidth, newheight;
+  int newwidth, newheight, endrow;
   unsigned char *dst;
   imStaticMatrixState state;
   void (*applykernel)( unsigned char *dst, int pointx, int pointy, imStaticMatrixState * CC_RESTRICT state );
@@ -2206,12 +2207,20 @@ int imReduceImageKaiserDataDivisor( unsigned char *dstdata, unsigned char *srcda
   while( basey < 0 )
     basey += height;
 
+  if( firstrow < 0 )
+    firstrow = 0;
+  endrow = firstrow + rowcount;
+  if( endrow > newheight )
+    endrow = newheight;
+  basey = (int)( ( basey + (long long)firstrow * sizedivisor ) % height );
+  dstdata += (size_t)firstrow * newwidth * bytesperpixel;
+
 #if CPU_SSE2_SUPPORT
   if( applykernelcore )
   {
     dst = dstdata;
     pointy = basey;
-    for( y = 0 ; y < newheight ; y++ )
+    for( y = firstrow ; y < endrow ; y++ )
     {
       pointx = basex;
       for( x = 0 ; x < newwidth ; x++, dst += bytesperpixel )
@@ -2231,7 +2240,7 @@ int imReduceImageKaiserDataDivisor( unsigned char *dstdata, unsigned char *srcda
   {
     dst = dstdata;
     pointy = basey;
-    for( y = 0 ; y < newheight ; y++ )
+    for( y = firstrow ; y < endrow ; y++ )
     {
       pointx = basex;
       for( x = 0 ; x < newwidth ; x++, dst += bytesperpixel )
@@ -2253,6 +2262,14 @@ int imReduceImageKaiserDataDivisor( unsigned char *dstdata, unsigned char *srcda
 }
 
 
+int imReduceImageKaiserDataDivisor( unsigned char *dstdata, unsigned char *srcdata, int width, int height, int bytesperpixel, int bytesperline, int sizedivisor, imReduceOptions *options )
+{
+  int newheight;
+  newheight = ( height < sizedivisor ) ? 1 : ( ( height + sizedivisor - 1 ) / sizedivisor );
+  return imReduceImageKaiserDataDivisorRows( dstdata, srcdata, width, height, bytesperpixel, bytesperline, sizedivisor, options, 0, newheight );
+}
+
+
 int imReduceImageKaiserDivisor( imgImage *imgdst, imgImage *imgsrc, int sizedivisor, imReduceOptions *options )
 {
   int width, height;
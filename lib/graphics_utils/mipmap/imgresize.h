@@ -56,6 +56,8 @@ static inline void imReduceSetOptions( imReduceOptions *options, int filter, int
 
 /* Reduce the image's dimensions by an integer divisor ~ this is fairly fast */
 int imReduceImageKaiserDataDivisor( unsigned char *dstdata, unsigned char *srcdata, int width, int height, int bytesperpixel, int bytesperline, int sizedivisor, imReduceOptions *options );
+/* Same as imReduceImageKaiserDataDivisor(), but only computes rowcount rows of dstdata starting at firstrow (altered for SuperTuxKart) */
+int imReduceImageKaiserDataDivisorRows( unsigned char *dstdata, unsigned char *srcdata, int width, int height, int bytesperpixel, int bytesperline, int sizedivisor, imReduceOptions *options, int firstrow, int rowcount );
 /* Same as imReduceImageKaiserDataDivisor(), but imgdst is allocated */
 int imReduceImageKaiserDivisor( imgImage *imgdst, imgImage *imgsrc, int sizedivisor, imReduceOptions *options );
 
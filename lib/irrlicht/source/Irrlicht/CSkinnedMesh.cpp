@@ -11,6 +11,11 @@
 #include "os.h"
 #include "irrMap.h"
 
+#if __SSE2__ || _M_X64 || _M_IX86_FP >= 2
+ #include <emmintrin.h>
+ #define SIMD_SSE2_SUPPORT (1)
+#endif
+
 namespace irr
 {
 namespace scene
@@ -519,6 +524,12 @@ void CSkinnedMesh::skinJoint(SJoint *joint, SJoint *parentJoint, f32 strength,
 			if (sc != NULL) sc(jointVertexPull, m_current_joint, offset);
 			m_current_joint++;
 		}
+#if SIMD_SSE2_SUPPORT
+		else if (strength == 1.f)
+		{
+			skinWeightsSSE(joint, jointVertexPull);
+		}
+#endif
 		else
 		{
 			core::vector3df thisVertexMove, thisNormalMove;
@@ -576,6 +587,62 @@ void CSkinnedMesh::skinJoint(SJoint *joint, SJoint *parentJoint, f32 strength,
 }
 
 
+#if SIMD_SSE2_SUPPORT
+//! Software skins all vertices influenced by a joint with SSE2, transforming
+//! the position and normal of each weight with one multiply-add per matrix
+//! column. Same result as the scalar path in skinJoint() with strength 1.
+void CSkinnedMesh::skinWeightsSSE(SJoint *joint, const core::matrix4 &pull)
+{
+	core::array<scene::SSkinMeshBuffer*> &buffersUsed=*SkinningBuffers;
+	const f32 *m = pull.pointer();
+	const __m128 c0 = _mm_loadu_ps(m);
+	const __m128 c1 = _mm_loadu_ps(m + 4);
+	const __m128 c2 = _mm_loadu_ps(m + 8);
+	const __m128 c3 = _mm_loadu_ps(m + 12);
+	f32 pos[4], normal[4];
+
+	for (u32 i=0; i<joint->Weights.size(); ++i)
+	{
+		SWeight& weight = joint->Weights[i];
+		const __m128 w = _mm_set1_ps(weight.strength);
+		const core::vector3df &sp = weight.StaticPos;
+		__m128 p = _mm_add_ps(_mm_add_ps(
+			_mm_mul_ps(c0, _mm_set1_ps(sp.X)),
+			_mm_mul_ps(c1, _mm_set1_ps(sp.Y))), _mm_add_ps(
+			_mm_mul_ps(c2, _mm_set1_ps(sp.Z)), c3));
+		_mm_storeu_ps(pos, _mm_mul_ps(p, w));
+
+		video::S3DVertex *v = buffersUsed[weight.buffer_id]->getVertex(weight.vertex_id);
+		if (AnimateNormals)
+		{
+			const core::vector3df &sn = weight.StaticNormal;
+			__m128 n = _mm_add_ps(_mm_add_ps(
+				_mm_mul_ps(c0, _mm_set1_ps(sn.X)),
+				_mm_mul_ps(c1, _mm_set1_ps(sn.Y))),
+				_mm_mul_ps(c2, _mm_set1_ps(sn.Z)));
+			_mm_storeu_ps(normal, _mm_mul_ps(n, w));
+		}
+
+		if (! (*(weight.Moved)) )
+		{
+			*(weight.Moved) = true;
+			v->Pos.set(pos[0], pos[1], pos[2]);
+			if (AnimateNormals)
+				v->Normal.set(normal[0], normal[1], normal[2]);
+		}
+		else
+		{
+			v->Pos += core::vector3df(pos[0], pos[1], pos[2]);
+			if (AnimateNormals)
+				v->Normal += core::vector3df(normal[0], normal[1], normal[2]);
+		}
+
+		buffersUsed[weight.buffer_id]->boundingBoxNeedsRecalculated();
+	}
+}
+#endif
+
+
 E_ANIMATED_MESH_TYPE CSkinnedMesh::getMeshType() const
 {
 	return EAMT_SKINNED;
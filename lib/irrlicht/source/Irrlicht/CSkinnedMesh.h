@@ -196,6 +196,8 @@ private:
 		void skinJoint(SJoint *Joint, SJoint *ParentJoint, f32 strength=1.f,
 						SkinningCallback sc = NULL, int offset = -1);
 
+		void skinWeightsSSE(SJoint *joint, const core::matrix4 &pull);
+
 		void calculateTangents(core::vector3df& normal,
 			core::vector3df& tangent, core::vector3df& binormal,
 			core::vector3df& vt1, core::vector3df& vt2, core::vector3df& vt3,
@@ -93,13 +93,8 @@ void AnimationBase::reset()
  */
 void AnimationBase::update(float dt, Vec3 *xyz, Vec3 *hpr, Vec3 *scale)
 {
-    assert(!std::isnan(m_current_time));
-
     // Don't do anything if the animation is disabled
-    if(!m_playing) return;
-    m_current_time += dt;
-
-    assert(!std::isnan(m_current_time));
+    if(!advanceTime(dt)) return;
 
     for_var_in (Ipo*, curr, m_all_ipos)
     {
@@ -107,6 +102,23 @@ void AnimationBase::update(float dt, Vec3 *xyz, Vec3 *hpr, Vec3 *scale)
     }
 }   // update
 
+// ----------------------------------------------------------------------------
+/** Advances the current time of the animation without evaluating the IPOs.
+ *  This is used by AnimationBatch, which evaluates the IPOs itself.
+ *  \param dt Time since last call.
+ *  \return False if the animation is disabled, in which case the time is
+ *          not changed.
+ */
+bool AnimationBase::advanceTime(float dt)
+{
+    assert(!std::isnan(m_current_time));
+    if (!m_playing) return false;
+    m_current_time += dt;
+
+    assert(!std::isnan(m_current_time));
+    return true;
+}   // advanceTime
+
 // ----------------------------------------------------------------------------
 /** Return the time, position and rotation at the specified time. It does not
  *  update the internal timer as update() does.
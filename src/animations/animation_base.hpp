@@ -80,9 +80,16 @@ public:
     void         setInitialTransform(const Vec3 &xyz,
                                      const Vec3 &hpr);
     void         reset();
+    bool         advanceTime(float dt);
     // ------------------------------------------------------------------------
     /** Disables or enables an animation. */
     void         setPlaying(bool playing) {m_playing = playing; }
+    // ------------------------------------------------------------------------
+    /** Returns the current time used in the IPOs. */
+    float        getCurrentTime() const { return m_current_time; }
+    // ------------------------------------------------------------------------
+    /** Returns all IPOs of this animation. */
+    const PtrVector<Ipo>& getAllIpos() const { return m_all_ipos; }
 
     // ------------------------------------------------------------------------
 
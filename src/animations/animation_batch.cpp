@@ -0,0 +1,297 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "animations/animation_batch.hpp"
+
+#include "animations/ipo.hpp"
+#include "animations/three_d_animation.hpp"
+#include "utils/job_system.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// ----------------------------------------------------------------------------
+/** Adds an animation to the batch. From now on the animation is only
+ *  updated by the batch.
+ *  \param animation The animation to add.
+ */
+void AnimationBatch::add(ThreeDAnimation *animation)
+{
+    const unsigned int index = (unsigned int)m_animations.size();
+    m_animations.push_back(animation);
+    m_times.push_back(0.0f);
+    m_active.push_back(0);
+    m_values.resize(m_values.size() + NUM_VALUES, 0.0f);
+
+    for (const Ipo *ipo : animation->getAllIpos())
+    {
+        const Ipo::IpoData *data = ipo->m_ipo_data;
+        // Invalid curves have no points
+        if (data->m_points.empty())
+            continue;
+        const unsigned int base = index * NUM_VALUES;
+        switch (data->m_channel)
+        {
+        case Ipo::IPO_LOCX   : addChannel(index, base + 0, ipo, 0); break;
+        case Ipo::IPO_LOCY   : addChannel(index, base + 1, ipo, 0); break;
+        case Ipo::IPO_LOCZ   : addChannel(index, base + 2, ipo, 0); break;
+        case Ipo::IPO_ROTX   : addChannel(index, base + 3, ipo, 0); break;
+        case Ipo::IPO_ROTY   : addChannel(index, base + 4, ipo, 0); break;
+        case Ipo::IPO_ROTZ   : addChannel(index, base + 5, ipo, 0); break;
+        case Ipo::IPO_SCALEX : addChannel(index, base + 6, ipo, 0); break;
+        case Ipo::IPO_SCALEY : addChannel(index, base + 7, ipo, 0); break;
+        case Ipo::IPO_SCALEZ : addChannel(index, base + 8, ipo, 0); break;
+        case Ipo::IPO_LOCXYZ :
+            for (unsigned int j = 0; j < 3; j++)
+                addChannel(index, base + j, ipo, j);
+            break;
+        default: break;
+        }   // switch
+    }
+    animation->setBatched(true);
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Adds one scalar channel of an IPO, converting all segments to cubic
+ *  polynomials.
+ *  \param animation Index of the animation.
+ *  \param target Index in m_values the result is written to.
+ *  \param ipo The IPO.
+ *  \param index Which component of the IPO data points to use.
+ */
+void AnimationBatch::addChannel(unsigned int animation, unsigned int target,
+                                const Ipo *ipo, unsigned int index)
+{
+    const Ipo::IpoData *data = ipo->m_ipo_data;
+    const std::vector<Vec3> &points = data->m_points;
+    m_channel_animation.push_back(animation);
+    m_channel_target.push_back(target);
+    m_channel_first_key.push_back((uint32_t)m_key_time.size());
+    m_channel_num_keys.push_back((uint32_t)points.size());
+    m_channel_cyclic.push_back(data->m_extend == Ipo::IpoData::ET_CYCLIC);
+    m_channel_start_time.push_back(data->m_start_time);
+    m_channel_end_time.push_back(data->m_end_time);
+    m_channel_next_key.push_back(1);
+    m_channel_result.push_back(0.0f);
+
+    for (unsigned int k = 0; k < points.size(); k++)
+    {
+        const float p0 = points[k][index];
+        float a = 0, b = 0, c = 0, inv_duration = 0;
+        // The last key (and the segments of constant IPOs) keep the value
+        if (k + 1 < points.size() &&
+            data->m_interpolation != Ipo::IpoData::IP_CONST)
+        {
+            const float p3 = points[k + 1][index];
+            const float duration = points[k + 1].getW() - points[k].getW();
+            if (duration > 0)
+                inv_duration = 1.0f / duration;
+            if (data->m_interpolation == Ipo::IpoData::IP_LINEAR)
+            {
+                c = p3 - p0;
+            }
+            else
+            {
+                // See Ipo::IpoData::getCubicBezier
+                const float p1 = data->m_handle2[k    ][index];
+                const float p2 = data->m_handle1[k + 1][index];
+                c = 3.0f * (p1 - p0);
+                b = 3.0f * (p2 - p1) - c;
+                a = p3 - p0 - c - b;
+            }
+        }
+        m_key_time.push_back(points[k].getW());
+        m_key_inv_duration.push_back(inv_duration);
+        m_key_a.push_back(a);
+        m_key_b.push_back(b);
+        m_key_c.push_back(c);
+        m_key_d.push_back(p0);
+    }
+}   // addChannel
+
+// ----------------------------------------------------------------------------
+/** Removes an animation from the batch (e.g. because its object is deleted).
+ *  Its channels are kept, but not evaluated anymore.
+ */
+void AnimationBatch::remove(ThreeDAnimation *animation)
+{
+    std::vector<ThreeDAnimation*>::iterator i =
+        std::find(m_animations.begin(), m_animations.end(), animation);
+    if (i == m_animations.end())
+        return;
+    animation->setBatched(false);
+    *i = NULL;
+}   // remove
+
+// ----------------------------------------------------------------------------
+/** Removes all animations. */
+void AnimationBatch::clear()
+{
+    for (ThreeDAnimation *animation : m_animations)
+    {
+        if (animation)
+            animation->setBatched(false);
+    }
+    m_animations.clear();
+    m_times.clear();
+    m_active.clear();
+    m_values.clear();
+    m_channel_animation.clear();
+    m_channel_target.clear();
+    m_channel_first_key.clear();
+    m_channel_num_keys.clear();
+    m_channel_cyclic.clear();
+    m_channel_start_time.clear();
+    m_channel_end_time.clear();
+    m_channel_next_key.clear();
+    m_channel_result.clear();
+    m_key_time.clear();
+    m_key_inv_duration.clear();
+    m_key_a.clear();
+    m_key_b.clear();
+    m_key_c.clear();
+    m_key_d.clear();
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Evaluates a range of channels and stores the results in
+ *  m_channel_result. Channels are independent of each other, so this can
+ *  be called in parallel for different ranges.
+ *  \param first First channel to evaluate.
+ *  \param last One after the last channel to evaluate.
+ */
+void AnimationBatch::evaluateChannels(unsigned int first, unsigned int last)
+{
+    float u[CHANNELS_PER_JOB], a[CHANNELS_PER_JOB], b[CHANNELS_PER_JOB];
+    float c[CHANNELS_PER_JOB], d[CHANNELS_PER_JOB];
+    for (unsigned int start = first; start < last; start += CHANNELS_PER_JOB)
+    {
+        const unsigned int n = std::min(last - start, CHANNELS_PER_JOB);
+
+        // Find the segment of each channel, this is the same as
+        // Ipo::updateNextN, and gather its coefficients.
+        for (unsigned int i = 0; i < n; i++)
+        {
+            const unsigned int ch = start + i;
+            const unsigned int anim = m_channel_animation[ch];
+            if (!m_active[anim])
+            {
+                u[i] = a[i] = b[i] = c[i] = d[i] = 0.0f;
+                continue;
+            }
+            float time = m_times[anim];
+            const float start_time = m_channel_start_time[ch];
+            const float end_time   = m_channel_end_time[ch];
+            if (time < start_time || time > end_time)
+            {
+                if (m_channel_cyclic[ch])
+                    time = start_time + fmodf(time, end_time - start_time);
+                else
+                    time = time < start_time ? start_time : end_time;
+            }
+
+            const float *key_time = &m_key_time[m_channel_first_key[ch]];
+            const unsigned int num_keys = m_channel_num_keys[ch];
+            unsigned int next = m_channel_next_key[ch];
+            if (time < key_time[next - 1])
+                next = 1;
+            while (next < num_keys - 1 && time >= key_time[next])
+                next++;
+            m_channel_next_key[ch] = next;
+
+            const unsigned int key = m_channel_first_key[ch] + next - 1;
+            u[i] = (time - m_key_time[key]) * m_key_inv_duration[key];
+            a[i] = m_key_a[key];
+            b[i] = m_key_b[key];
+            c[i] = m_key_c[key];
+            d[i] = m_key_d[key];
+        }
+
+        // Evaluate all polynomials, this loop is vectorised by the compiler
+        float *result = &m_channel_result[start];
+        for (unsigned int i = 0; i < n; i++)
+            result[i] = ((a[i] * u[i] + b[i]) * u[i] + c[i]) * u[i] + d[i];
+    }
+}   // evaluateChannels
+
+// ----------------------------------------------------------------------------
+/** Advances the time of all animations, evaluates all channels and moves
+ *  the track objects. Must be called on the main thread.
+ *  \param dt Time step.
+ */
+void AnimationBatch::update(float dt)
+{
+    if (m_animations.empty())
+        return;
+
+    // Start from the current transform, since the IPOs of an animation
+    // usually do not set all values.
+    for (unsigned int i = 0; i < m_animations.size(); i++)
+    {
+        ThreeDAnimation *animation = m_animations[i];
+        m_active[i] = animation &&
+                      animation->advanceTime(animation->isPaused() ? 0 : dt);
+        if (!m_active[i])
+            continue;
+        m_times[i] = animation->getCurrentTime();
+        Vec3 xyz, hpr, scale;
+        animation->getTransform(&xyz, &hpr, &scale);
+        float *values = &m_values[i * NUM_VALUES];
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            values[j    ] = xyz[j];
+            values[j + 3] = hpr[j];
+            values[j + 6] = scale[j];
+        }
+    }
+
+    const unsigned int num_channels = getNumChannels();
+    JobSystem *job_system = JobSystem::get();
+    if (num_channels >= MIN_PARALLEL_CHANNELS && job_system &&
+        job_system->getNumThreads() > 1)
+    {
+        const unsigned int num_jobs =
+            (num_channels + CHANNELS_PER_JOB - 1) / CHANNELS_PER_JOB;
+        job_system->parallelFor(num_jobs, [this, num_channels](unsigned int j)
+        {
+            evaluateChannels(j * CHANNELS_PER_JOB,
+                             std::min((j + 1) * CHANNELS_PER_JOB,
+                                      num_channels));
+        });
+    }
+    else
+        evaluateChannels(0, num_channels);
+
+    // Channels of an animation are in the order of its IPOs, so if two
+    // IPOs set the same value the last one wins, as in Ipo::update.
+    for (unsigned int ch = 0; ch < num_channels; ch++)
+    {
+        if (m_active[m_channel_animation[ch]])
+            m_values[m_channel_target[ch]] = m_channel_result[ch];
+    }
+
+    for (unsigned int i = 0; i < m_animations.size(); i++)
+    {
+        if (!m_active[i])
+            continue;
+        const float *values = &m_values[i * NUM_VALUES];
+        m_animations[i]->setTransform(Vec3(values[0], values[1], values[2]),
+                                      Vec3(values[3], values[4], values[5]),
+                                      Vec3(values[6], values[7], values[8]));
+    }
+}   // update
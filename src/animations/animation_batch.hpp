@@ -0,0 +1,127 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_ANIMATION_BATCH_HPP
+#define HEADER_ANIMATION_BATCH_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <vector>
+
+class Ipo;
+class ThreeDAnimation;
+
+/**
+  * \brief Evaluates the IPO curves of all track object animations in one
+  *  batch instead of one object at a time.
+  *  When the track is loaded, all curves are split into scalar channels
+  *  and converted to structure of arrays: each segment of a curve is stored
+  *  as a cubic polynomial in the normalised time of the segment (constant
+  *  and linear segments just have zero coefficients), so all interpolation
+  *  types are evaluated by the same branch free code. Each frame the time
+  *  of all animations is advanced, the segment of each channel is searched
+  *  (starting from the segment used in the last frame), all channels are
+  *  evaluated in one pass (in parallel jobs if there are many), and the
+  *  resulting transforms are written back to the track objects.
+  *  Objects which are added later (e.g. by scripts) are not part of the
+  *  batch and are updated individually.
+  * \ingroup animations
+  */
+class AnimationBatch : public NoCopy
+{
+private:
+    /** Number of channels evaluated in one job. */
+    static const unsigned int CHANNELS_PER_JOB = 256;
+
+    /** Minimum number of channels for which parallel jobs are used. */
+    static const unsigned int MIN_PARALLEL_CHANNELS = 2048;
+
+    /** Number of floats of the transform of an animation: position,
+     *  rotation and scale. */
+    static const unsigned int NUM_VALUES = 9;
+
+    // ---- Per animation
+    /** All animations of the batch, NULL if an animation was removed. */
+    std::vector<ThreeDAnimation*> m_animations;
+
+    /** The current time of each animation. */
+    std::vector<float>            m_times;
+
+    /** 1 if an animation is playing and needs to be evaluated. */
+    std::vector<uint8_t>          m_active;
+
+    /** Position, rotation and scale of each animation. */
+    std::vector<float>            m_values;
+
+    // ---- Per channel
+    /** Index of the animation of each channel. */
+    std::vector<uint32_t>         m_channel_animation;
+
+    /** Index in m_values to which the result of a channel is written. */
+    std::vector<uint32_t>         m_channel_target;
+
+    /** Index of the first key of each channel. */
+    std::vector<uint32_t>         m_channel_first_key;
+
+    /** Number of keys of each channel. */
+    std::vector<uint32_t>         m_channel_num_keys;
+
+    /** 1 if a channel is cyclic, 0 if it is constant outside of its time
+     *  range. */
+    std::vector<uint8_t>          m_channel_cyclic;
+
+    /** Time of the first and last key of each channel. */
+    std::vector<float>            m_channel_start_time;
+    std::vector<float>            m_channel_end_time;
+
+    /** Index (relative to the first key) of the key following the segment
+     *  used in the last frame, the same as Ipo::m_next_n. */
+    std::vector<uint32_t>         m_channel_next_key;
+
+    /** The result of each channel. */
+    std::vector<float>            m_channel_result;
+
+    // ---- Per key, each key starts a segment which ends at the next key
+    std::vector<float>            m_key_time;
+
+    /** 1 / duration of the segment, 0 for constant segments. */
+    std::vector<float>            m_key_inv_duration;
+
+    /** The value in a segment is ((a*u+b)*u+c)*u+d with u in [0,1]. */
+    std::vector<float>            m_key_a, m_key_b, m_key_c, m_key_d;
+
+    void addChannel(unsigned int animation, unsigned int target,
+                    const Ipo *ipo, unsigned int index);
+    void evaluateChannels(unsigned int first, unsigned int last);
+
+public:
+         AnimationBatch() {}
+    void add(ThreeDAnimation *animation);
+    void remove(ThreeDAnimation *animation);
+    void clear();
+    void update(float dt);
+    // ------------------------------------------------------------------------
+    /** Returns the number of scalar channels in this batch. */
+    unsigned int getNumChannels() const
+    {
+        return (unsigned int)m_channel_animation.size();
+    }   // getNumChannels
+};   // AnimationBatch
+
+#endif
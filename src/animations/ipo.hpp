@@ -36,6 +36,7 @@ class XMLNode;
   */
 class Ipo : public NoCopy
 {
+    friend class AnimationBatch;
 public:
     /** All supported ipo types. LOCXYZ is basically a curve, the
      *  IPO is actually a 3d curve, without a time axis, only the
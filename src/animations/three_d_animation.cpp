@@ -41,6 +41,7 @@ ThreeDAnimation::ThreeDAnimation(const XMLNode &node, TrackObject* object) : Ani
     m_object = object;
 
     m_is_paused = false;
+    m_batched   = false;
     m_crash_reset  = false;
     m_explode_kart = false;
     m_flatten_kart = false;
@@ -69,47 +70,76 @@ ThreeDAnimation::~ThreeDAnimation()
 
 // ----------------------------------------------------------------------------
 /** Updates position and rotation of this model. Called once per time step.
+ *  Does nothing if this animation is updated by an AnimationBatch.
  *  \param dt Time since last call.
  */
 void ThreeDAnimation::update(float dt)
 {
+    if (m_batched) return;
+
     //if (UserConfigParams::m_graphical_effects > 1 || 
     //    (UserConfigParams::m_graphical_effects > 0 && m_important_animation))
     {
-        Vec3 xyz   = m_object->getPosition();
-        Vec3 scale = m_object->getScale();
+        Vec3 xyz, hpr, scale;
+        getTransform(&xyz, &hpr, &scale);
 
         //make the object think no time has passed to pause it's animation
         if (m_is_paused)dt = 0;
 
-        AnimationBase::update(dt, &xyz, &m_hpr, &scale);     //updates all IPOs
-        //m_node->setPosition(xyz.toIrrVector());
-        //m_node->setScale(scale.toIrrVector());
+        AnimationBase::update(dt, &xyz, &hpr, &scale);     //updates all IPOs
 
         if (!m_playing) return;
 
-        // Note that the rotation order of irrlicht is different from the one
-        // in blender. So in order to reproduce the blender IPO rotations
-        // correctly, we have to get the rotations around each axis and combine
-        // them in the right order for irrlicht
-        core::matrix4 m;
-        m.makeIdentity();
-        core::matrix4 mx;
-        assert(!std::isnan(m_hpr.getX()));
-        assert(!std::isnan(m_hpr.getY()));
-        assert(!std::isnan(m_hpr.getZ()));
-        mx.setRotationDegrees(core::vector3df(m_hpr.getX(), 0, 0));
-        core::matrix4 my;
-        my.setRotationDegrees(core::vector3df(0, m_hpr.getY(), 0));
-        core::matrix4 mz;
-        mz.setRotationDegrees(core::vector3df(0, 0, m_hpr.getZ()));
-        m = my*mz*mx;
-        core::vector3df hpr = m.getRotationDegrees();
-        //m_node->setRotation(hpr);
-
-        if (m_object)
-        {
-            m_object->move(xyz.toIrrVector(), hpr, scale.toIrrVector(), true, false);
-        }
+        setTransform(xyz, hpr, scale);
     }
 }   // update
+
+// ----------------------------------------------------------------------------
+/** Returns the current transform of the animated object, which is the
+ *  start value for the IPOs.
+ *  \param xyz On return the position of the object.
+ *  \param hpr On return the rotation as computed by the IPOs.
+ *  \param scale On return the scale of the object.
+ */
+void ThreeDAnimation::getTransform(Vec3 *xyz, Vec3 *hpr, Vec3 *scale) const
+{
+    *xyz   = m_object->getPosition();
+    *hpr   = m_hpr;
+    *scale = m_object->getScale();
+}   // getTransform
+
+// ----------------------------------------------------------------------------
+/** Moves the animated object to the transform computed by the IPOs.
+ *  \param xyz The new position.
+ *  \param hpr The new rotation in blender's rotation order.
+ *  \param scale The new scale.
+ */
+void ThreeDAnimation::setTransform(const Vec3 &xyz, const Vec3 &hpr,
+                                   const Vec3 &scale)
+{
+    m_hpr = hpr;
+
+    // Note that the rotation order of irrlicht is different from the one
+    // in blender. So in order to reproduce the blender IPO rotations
+    // correctly, we have to get the rotations around each axis and combine
+    // them in the right order for irrlicht
+    core::matrix4 m;
+    m.makeIdentity();
+    core::matrix4 mx;
+    assert(!std::isnan(m_hpr.getX()));
+    assert(!std::isnan(m_hpr.getY()));
+    assert(!std::isnan(m_hpr.getZ()));
+    mx.setRotationDegrees(core::vector3df(m_hpr.getX(), 0, 0));
+    core::matrix4 my;
+    my.setRotationDegrees(core::vector3df(0, m_hpr.getY(), 0));
+    core::matrix4 mz;
+    mz.setRotationDegrees(core::vector3df(0, 0, m_hpr.getZ()));
+    m = my*mz*mx;
+    core::vector3df irr_hpr = m.getRotationDegrees();
+
+    if (m_object)
+    {
+        m_object->move(xyz.toIrrVector(), irr_hpr, scale.toIrrVector(),
+                       true, false);
+    }
+}   // setTransform
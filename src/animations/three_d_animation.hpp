@@ -68,12 +68,19 @@ private:
       */
     bool                  m_important_animation;
 
+    /** True if this animation is updated by an AnimationBatch, in which
+     *  case update() does nothing. */
+    bool                  m_batched;
+
     //scene::ISceneNode*    m_node;
 
 public:
                  ThreeDAnimation(const XMLNode &node, TrackObject* object);
     virtual     ~ThreeDAnimation();
     virtual void update(float dt);
+    void         getTransform(Vec3 *xyz, Vec3 *hpr, Vec3 *scale) const;
+    void         setTransform(const Vec3 &xyz, const Vec3 &hpr,
+                              const Vec3 &scale);
     // ------------------------------------------------------------------------
     /** Returns true if a collision with this object should
      * trigger a rescue. */
@@ -81,6 +88,11 @@ public:
     bool isExplodeKartObject() const { return m_explode_kart; }
     bool isFlattenKartObject() const { return m_flatten_kart; }
     void setPaused(bool mode){ m_is_paused = mode; }
+    bool isPaused() const { return m_is_paused; }
+    // ------------------------------------------------------------------------
+    /** Called by AnimationBatch when this animation is added to or removed
+     *  from the batch. */
+    void setBatched(bool batched) { m_batched = batched; }
 };   // ThreeDAnimation
 #endif
 
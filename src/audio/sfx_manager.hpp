@@ -21,6 +21,7 @@
 
 #include "utils/can_be_deleted.hpp"
 #include "utils/leak_check.hpp"
+#include "utils/memory_pool.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/synchronised.hpp"
 #include "utils/vec3.hpp"
@@ -119,6 +120,8 @@ private:
     private:
         LEAK_CHECK()
     public:
+        POOL_ALLOCATED("SFXCommand")
+
         /** The sound effect for which the command should be executed. */
         SFXBase *m_sfx;
 
@@ -545,6 +545,18 @@ namespace UserConfigParams
     PARAM_PREFIX BoolUserConfigParam        m_azdo
         PARAM_DEFAULT(BoolUserConfigParam(false, "enable_azdo",
         &m_video_group, "Enable 'Approaching Zero Driver Overhead' mode (very experimental !)"));
+    PARAM_PREFIX BoolUserConfigParam        m_instance_batching
+        PARAM_DEFAULT(BoolUserConfigParam(true, "instance_batching",
+        &m_video_group, "Draw identical meshes with one instanced draw call "
+                        "if indirect rendering is not available"));
+    PARAM_PREFIX BoolUserConfigParam        m_packed_vertices
+        PARAM_DEFAULT(BoolUserConfigParam(true, "packed_vertices",
+        &m_video_group, "Store normals and tangents of the shared vertex "
+                        "buffers as packed 10 bit integers"));
+    PARAM_PREFIX BoolUserConfigParam        m_free_track_mesh_data
+        PARAM_DEFAULT(BoolUserConfigParam(true, "free_track_mesh_data",
+        &m_video_group, "Free the CPU copy of the main track mesh once it "
+                        "is uploaded to the GPU"));
     PARAM_PREFIX BoolUserConfigParam        m_sdsm
         PARAM_DEFAULT(BoolUserConfigParam(false, "enable_sdsm",
         &m_video_group, "Enable Sampled Distribued Shadow Map (buggy atm)"));
@@ -567,6 +579,36 @@ namespace UserConfigParams
         PARAM_DEFAULT(BoolUserConfigParam(false, "hq_mipmap",
         &m_video_group, "Generate mipmap for textures using "
                         "high quality method with SSE"));
+
+    PARAM_PREFIX BoolUserConfigParam        m_mipmap_cache
+        PARAM_DEFAULT(BoolUserConfigParam(true, "mipmap_cache",
+        &m_video_group, "Cache high quality mipmaps on disk to speed up "
+                        "loading textures the next time"));
+
+    PARAM_PREFIX BoolUserConfigParam        m_glyph_cache
+        PARAM_DEFAULT(BoolUserConfigParam(true, "glyph_cache",
+        &m_video_group, "Cache rendered font glyphs on disk to speed up "
+                        "the next start"));
+
+    PARAM_PREFIX BoolUserConfigParam        m_shader_program_cache
+        PARAM_DEFAULT(BoolUserConfigParam(true, "shader_program_cache",
+        &m_video_group, "Cache linked shader programs on disk to speed up "
+                        "the next start"));
+
+    PARAM_PREFIX BoolUserConfigParam        m_sh_cache
+        PARAM_DEFAULT(BoolUserConfigParam(true, "sh_cache",
+        &m_video_group, "Cache the spherical harmonics coefficients of "
+                        "skyboxes on disk to speed up loading tracks"));
+
+    PARAM_PREFIX BoolUserConfigParam        m_texture_streaming
+        PARAM_DEFAULT(BoolUserConfigParam(false, "texture_streaming",
+        &m_video_group, "Load mesh textures at a low resolution, and stream "
+                        "in higher resolutions when they are needed"));
+
+    PARAM_PREFIX IntUserConfigParam         m_texture_budget
+        PARAM_DEFAULT(IntUserConfigParam(512, "texture_budget",
+        &m_video_group, "Memory (in MB) which streamed mesh textures can "
+                        "use"));
                         
     // ---- Recording
     PARAM_PREFIX GroupUserConfigParam        m_recording_group
@@ -601,6 +643,21 @@ namespace UserConfigParams
         PARAM_DEFAULT(IntUserConfigParam(30, "record_fps",
         &m_recording_group, "Specify the fps of recording video"));
 
+    PARAM_PREFIX IntUserConfigParam         m_frame_capture_threads
+        PARAM_DEFAULT(IntUserConfigParam(0, "frame_capture_threads",
+        &m_recording_group, "Number of threads used to encode screenshots "
+                            "and captured frames, 0 to select automatically"));
+
+    PARAM_PREFIX IntUserConfigParam         m_frame_capture_queue_size
+        PARAM_DEFAULT(IntUserConfigParam(8, "frame_capture_queue_size",
+        &m_recording_group, "Maximum number of captured frames waiting to be "
+                            "encoded before rendering is blocked"));
+
+    PARAM_PREFIX BoolUserConfigParam        m_frame_capture_raw
+        PARAM_DEFAULT(BoolUserConfigParam(false, "frame_capture_raw",
+        &m_recording_group, "Save frame sequences as uncompressed PPM "
+                            "instead of PNG"));
+
     // ---- Debug - not saved to config file
     /** If gamepad debugging is enabled. */
     PARAM_PREFIX bool m_unit_testing PARAM_DEFAULT(false);
@@ -633,6 +690,18 @@ namespace UserConfigParams
     /** True if physics debugging should be enabled. */
     PARAM_PREFIX bool m_physics_debug PARAM_DEFAULT( false );
 
+    /** Capture every n-th frame of a race to the screenshot directory,
+     *  0 to disable. */
+    PARAM_PREFIX int m_capture_frame_interval PARAM_DEFAULT(0);
+
+    /** Number of job threads set on the command line, which is used
+     *  instead of m_job_threads (without saving it). -1 if not set. */
+    PARAM_PREFIX int m_job_threads_override PARAM_DEFAULT(-1);
+
+    /** Broadphase set on the command line, which is used instead of
+     *  m_physics_broadphase (without saving it). Empty if not set. */
+    PARAM_PREFIX std::string m_physics_broadphase_override PARAM_DEFAULT("");
+
     /** True if fps should be printed each frame. */
     PARAM_PREFIX bool m_fps_debug PARAM_DEFAULT(false);
 
@@ -710,6 +779,43 @@ namespace UserConfigParams
             PARAM_DEFAULT( BoolUserConfigParam(false, "log-network-packets",
                                                  "If all network packets should be logged") );
 
+    PARAM_PREFIX IntUserConfigParam         m_network_input_delay
+            PARAM_DEFAULT(  IntUserConfigParam(50, "network_input_delay",
+                            "Playout delay in ms of the inputs of remote "
+                            "karts, which hides network jitter.") );
+
+    PARAM_PREFIX IntUserConfigParam         m_server_peer_bandwidth
+            PARAM_DEFAULT(  IntUserConfigParam(16384, "server_peer_bandwidth",
+                            "Maximum number of bytes per second a server "
+                            "sends to each client. Distant karts are updated "
+                            "less often to stay within this limit.") );
+
+    // ---- Physics and parallel jobs
+    PARAM_PREFIX IntUserConfigParam         m_job_threads
+            PARAM_DEFAULT(  IntUserConfigParam(0, "job_threads",
+                            "Number of threads (including the main thread) "
+                            "used for parallel jobs like collision detection, "
+                            "0 to select automatically.") );
+
+    PARAM_PREFIX StringUserConfigParam      m_physics_broadphase
+            PARAM_DEFAULT(  StringUserConfigParam("axis-sweep",
+                            "physics_broadphase",
+                            "Broadphase of the physics: 'axis-sweep' or "
+                            "'dbvt' (dynamic AABB tree).") );
+
+    PARAM_PREFIX BoolUserConfigParam        m_physics_parallel_narrowphase
+            PARAM_DEFAULT(  BoolUserConfigParam(false,
+                            "physics_parallel_narrowphase",
+                            "If the contacts of the physics are computed "
+                            "in parallel using all job threads. Disabled "
+                            "until --history-check shows that replays give "
+                            "the same result as the serial narrowphase.") );
+
+    PARAM_PREFIX BoolUserConfigParam        m_batched_animations
+            PARAM_DEFAULT(  BoolUserConfigParam(true, "batched_animations",
+                            "If the animations of all track objects are "
+                            "evaluated together in one batch.") );
+
     // ---- Graphic Quality
     PARAM_PREFIX GroupUserConfigParam        m_graphics_quality
             PARAM_DEFAULT( GroupUserConfigParam("GFX",
@@ -21,12 +21,15 @@
 #include "font/font_manager.hpp"
 #include "io/file_manager.hpp"
 
+#include <fstream>
+
 // ----------------------------------------------------------------------------
 /** Constructor. Load all TTFs from a list.
  *  \param ttf_list List of TTFs to be loaded.
  */
 FaceTTF::FaceTTF(const std::vector<std::string>& ttf_list)
 {
+    m_hash = 0;
     for (const std::string& font : ttf_list)
     {
         FT_Face face = NULL;
@@ -35,6 +38,7 @@ FaceTTF::FaceTTF(const std::vector<std::string>& ttf_list)
         font_manager->checkFTError(FT_New_Face(font_manager->getFTLibrary(),
             loc.c_str(), 0, &face), loc + " is loaded");
         m_faces.push_back(face);
+        m_files.push_back(loc);
     }
 }   // FaceTTF
 
@@ -57,3 +61,30 @@ FT_Face FaceTTF::getFace(unsigned int i) const
     assert(i < m_faces.size());
     return m_faces[i];
 }   // getFace
+
+// ----------------------------------------------------------------------------
+/** Return a 64-bit FNV-1a hash of the content of all TTF files. The files
+ *  are only read the first time this is called.
+ */
+uint64_t FaceTTF::getHash() const
+{
+    if (m_hash != 0) return m_hash;
+    uint64_t hash = 14695981039346656037ULL;
+    std::vector<char> buffer(64 * 1024);
+    for (const std::string& file : m_files)
+    {
+        std::ifstream ifs(file.c_str(), std::ios::in | std::ios::binary);
+        while (ifs.good())
+        {
+            ifs.read(buffer.data(), buffer.size());
+            const std::streamsize n = ifs.gcount();
+            for (std::streamsize i = 0; i < n; i++)
+            {
+                hash ^= (uint8_t)buffer[i];
+                hash *= 1099511628211ULL;
+            }
+        }
+    }
+    m_hash = hash;
+    return m_hash;
+}   // getHash
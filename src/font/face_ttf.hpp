@@ -22,6 +22,7 @@
 #include "utils/leak_check.hpp"
 #include "utils/no_copy.hpp"
 
+#include <stdint.h>
 #include <string>
 #include <vector>
 
@@ -41,6 +42,13 @@ private:
     /** Contains all TTF files loaded. */
     std::vector<FT_Face> m_faces;
 
+    /** Full path of each TTF file in \ref m_faces. */
+    std::vector<std::string> m_files;
+
+    /** Hash of the content of all TTF files, used to validate cached glyphs.
+     *  Computed on first use. */
+    mutable uint64_t m_hash;
+
 public:
     LEAK_CHECK()
     // ------------------------------------------------------------------------
@@ -52,6 +60,11 @@ public:
     // ------------------------------------------------------------------------
     /** Return the total TTF files loaded. */
     unsigned int getTotalFaces() const               { return m_faces.size(); }
+    // ------------------------------------------------------------------------
+    /** Return the full path of all TTF files loaded. */
+    const std::vector<std::string>& getFiles() const        { return m_files; }
+    // ------------------------------------------------------------------------
+    uint64_t getHash() const;
 
 };   // FaceTTF
 
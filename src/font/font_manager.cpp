@@ -80,6 +80,17 @@ void FontManager::loadFonts()
     m_font_type_map[std::type_index(typeid(DigitFace))] = font_loaded++;
 }   // loadFonts
 
+// ----------------------------------------------------------------------------
+/** Start rasterizing all characters used by the current translation in the
+ *  background, so that they are (mostly) ready when first displayed.
+ */
+void FontManager::prewarmFonts()
+{
+    std::set<wchar_t> used_chars = translations->getCurrentAllChar();
+    getFont<RegularFace>()->prewarm(used_chars);
+    getFont<BoldFace>()->prewarm(used_chars);
+}   // prewarmFonts
+
 // ----------------------------------------------------------------------------
 /** Unit testing that will try to load all translations in STK, and discover if
  *  there is any characters required by it are not supported in \ref
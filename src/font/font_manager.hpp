@@ -96,6 +96,8 @@ public:
     // ------------------------------------------------------------------------
     void loadFonts();
     // ------------------------------------------------------------------------
+    void prewarmFonts();
+    // ------------------------------------------------------------------------
     void unitTesting();
     // ------------------------------------------------------------------------
     /** Return the \ref m_ft_library. */
@@ -18,6 +18,7 @@
 
 #include "font/font_with_face.hpp"
 
+#include "config/user_config.hpp"
 #include "font/face_ttf.hpp"
 #include "font/font_manager.hpp"
 #include "font/font_settings.hpp"
@@ -28,7 +29,20 @@
 #include "graphics/stk_tex_manager.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/skin.hpp"
+#include "io/file_manager.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/vs.hpp"
+
+#include <algorithm>
+#include <fstream>
+#include <zlib.h>
+
+/** Version of the glyph cache format, increase if the format changes. */
+static const uint8_t GLYPH_CACHE_VERSION = 1;
+
+/** At most this many glyph pages are saved in a glyph cache, to avoid that
+ *  a cache grows without limit when switching between many languages. */
+static const unsigned int MAX_CACHED_PAGES = 4;
 
 // ----------------------------------------------------------------------------
 /** Constructor. It will initialize the \ref m_spritebank and TTF files to use.
@@ -45,7 +59,12 @@ FontWithFace::FontWithFace(const std::string& name, FaceTTF* ttf)
     m_fallback_font = NULL;
     m_fallback_font_scale = 1.0f;
     m_glyph_max_height = 0;
+    m_name = name;
     m_face_ttf = ttf;
+    m_cached_atlas = NULL;
+    m_cache_dirty = false;
+    m_prewarm_finished = true;
+    m_prewarm_abort = false;
 
 }   // FontWithFace
 // ----------------------------------------------------------------------------
@@ -53,6 +72,11 @@ FontWithFace::FontWithFace(const std::string& name, FaceTTF* ttf)
  */
 FontWithFace::~FontWithFace()
 {
+    stopPrewarm();
+    if (m_cache_dirty)
+        saveGlyphCache();
+    delete m_cached_atlas;
+
     for (unsigned int i = 0; i < m_spritebank->getTextureCount(); i++)
     {
         STKTexManager::getInstance()->removeTexture(
@@ -72,23 +96,28 @@ FontWithFace::~FontWithFace()
 void FontWithFace::init()
 {
     setDPI();
-    // Get the max height for this face
-    assert(m_face_ttf->getTotalFaces() > 0);
-    FT_Face cur_face = m_face_ttf->getFace(0);
-    font_manager->checkFTError(FT_Set_Pixel_Sizes(cur_face, 0, getDPI()),
-        "setting DPI");
-
-    for (int i = 32; i < 128; i++)
+    // A valid glyph cache already contains the max height and all glyphs
+    // rendered in the previous run, so FreeType is not needed at all
+    if (!loadGlyphCache())
     {
-        // Test all basic latin characters
-        const int idx = FT_Get_Char_Index(cur_face, (wchar_t)i);
-        if (idx == 0) continue;
-        font_manager->checkFTError(FT_Load_Glyph(cur_face, idx,
-            FT_LOAD_DEFAULT), "setting max height");
+        // Get the max height for this face
+        assert(m_face_ttf->getTotalFaces() > 0);
+        FT_Face cur_face = m_face_ttf->getFace(0);
+        font_manager->checkFTError(FT_Set_Pixel_Sizes(cur_face, 0, getDPI()),
+            "setting DPI");
 
-        const int height = cur_face->glyph->metrics.height / BEARING;
-        if (height > m_glyph_max_height)
-            m_glyph_max_height = height;
+        for (int i = 32; i < 128; i++)
+        {
+            // Test all basic latin characters
+            const int idx = FT_Get_Char_Index(cur_face, (wchar_t)i);
+            if (idx == 0) continue;
+            font_manager->checkFTError(FT_Load_Glyph(cur_face, idx,
+                FT_LOAD_DEFAULT), "setting max height");
+
+            const int height = cur_face->glyph->metrics.height / BEARING;
+            if (height > m_glyph_max_height)
+                m_glyph_max_height = height;
+        }
     }
 
     reset();
@@ -100,6 +129,8 @@ void FontWithFace::init()
  */
 void FontWithFace::reset()
 {
+    // Glyphs rasterized for the old glyph pages can't be used anymore
+    stopPrewarm();
     m_new_char_holder.clear();
     m_character_area_map.clear();
     m_character_glyph_info_map.clear();
@@ -109,6 +140,14 @@ void FontWithFace::reset()
             static_cast<STKTexture*>(m_spritebank->getTexture(i)));
     }
     m_spritebank->clear();
+    m_page_data.clear();
+    if (m_cached_atlas)
+    {
+        restoreGlyphCache();
+        return;
+    }
+    // The cache file no longer matches the glyph pages
+    m_cache_dirty = true;
     createNewGlyphPage();
 }   // reset
 
@@ -135,11 +174,27 @@ void FontWithFace::loadGlyphInfo(wchar_t c)
 // ----------------------------------------------------------------------------
 /** Create a new glyph page by filling it with transparent content.
  */
-void FontWithFace::createNewGlyphPage()
+void FontWithFace::createNewGlyphPage(const uint8_t* coverage)
 {
+    const unsigned int page_pixels = getGlyphPageSize() * getGlyphPageSize();
+    if (coverage)
+        m_page_data.emplace_back(coverage, coverage + page_pixels);
+    else
+        m_page_data.emplace_back(page_pixels, 0);
 #ifndef SERVER_ONLY
-    uint8_t* data = new uint8_t[getGlyphPageSize() * getGlyphPageSize() *
-    (CVS->isARBTextureSwizzleUsable() ? 1 : 4)]();
+    uint8_t* data = NULL;
+    if (CVS->isARBTextureSwizzleUsable())
+    {
+        data = new uint8_t[page_pixels];
+        memcpy(data, m_page_data.back().data(), page_pixels);
+    }
+    else
+    {
+        data = new uint8_t[page_pixels * 4];
+        memset(data, 255, page_pixels * 4);
+        for (unsigned int i = 0; i < page_pixels; i++)
+            data[4 * i + 3] = m_page_data.back()[i];
+    }
 #else
     uint8_t* data = NULL;
 #endif
@@ -159,23 +214,23 @@ void FontWithFace::createNewGlyphPage()
 }   // createNewGlyphPage
 
 // ----------------------------------------------------------------------------
-/** Render a glyph for a character into bitmap and save it into the glyph page.
- *  \param c The character to be loaded.
- *  \param c \ref GlyphInfo for the character.
+/** Render a glyph into a coverage bitmap. This only uses the given face, so
+ *  it can be called from the prewarm thread with a face of its own.
+ *  \param face The face to render with.
+ *  \param glyph_index Index of the glyph in the face.
+ *  \param bitmap The result.
  */
-void FontWithFace::insertGlyph(wchar_t c, const GlyphInfo& gi)
+void FontWithFace::rasterizeGlyph(FT_Face face, unsigned int glyph_index,
+                                  GlyphBitmap* bitmap) const
 {
-    assert(gi.glyph_index > 0);
-    assert(gi.font_number < m_face_ttf->getTotalFaces());
-    FT_Face cur_face = m_face_ttf->getFace(gi.font_number);
-    FT_GlyphSlot slot = cur_face->glyph;
+    FT_GlyphSlot slot = face->glyph;
 
     // Same face may be shared across the different FontWithFace,
     // so reset dpi each time
-    font_manager->checkFTError(FT_Set_Pixel_Sizes(cur_face, 0, getDPI()),
+    font_manager->checkFTError(FT_Set_Pixel_Sizes(face, 0, getDPI()),
         "setting DPI");
 
-    font_manager->checkFTError(FT_Load_Glyph(cur_face, gi.glyph_index,
+    font_manager->checkFTError(FT_Load_Glyph(face, glyph_index,
         FT_LOAD_DEFAULT), "loading a glyph");
 
     font_manager->checkFTError(shapeOutline(&(slot->outline)),
@@ -184,9 +239,53 @@ void FontWithFace::insertGlyph(wchar_t c, const GlyphInfo& gi)
     font_manager->checkFTError(FT_Render_Glyph(slot, FT_RENDER_MODE_NORMAL),
         "rendering a glyph to bitmap");
 
-    // Convert to an anti-aliased bitmap
+    // Copy the anti-aliased bitmap
     FT_Bitmap* bits = &(slot->bitmap);
-    core::dimension2du texture_size(bits->width + 1, bits->rows + 1);
+    assert(bits->buffer == NULL || bits->pixel_mode == FT_PIXEL_MODE_GRAY);
+    bitmap->width = bits->width;
+    bitmap->rows = bits->rows;
+    bitmap->buffer.clear();
+    if (bits->buffer != NULL)
+    {
+        bitmap->buffer.resize(bits->width * bits->rows);
+        const int pitch = bits->pitch < 0 ? -bits->pitch : bits->pitch;
+        for (unsigned int y = 0; y < bits->rows; y++)
+        {
+            memcpy(bitmap->buffer.data() + y * bits->width,
+                bits->buffer + y * pitch, bits->width);
+        }
+    }
+    bitmap->advance_x = slot->advance.x / BEARING;
+    bitmap->bearing_x = slot->metrics.horiBearingX / BEARING;
+    bitmap->height = slot->metrics.height / BEARING;
+    bitmap->bearing_y = slot->metrics.horiBearingY / BEARING;
+}   // rasterizeGlyph
+
+// ----------------------------------------------------------------------------
+/** Render a glyph for a character into bitmap and save it into the glyph page.
+ *  \param c The character to be loaded.
+ *  \param c \ref GlyphInfo for the character.
+ */
+void FontWithFace::insertGlyph(wchar_t c, const GlyphInfo& gi)
+{
+    assert(gi.glyph_index > 0);
+    assert(gi.font_number < m_face_ttf->getTotalFaces());
+    GlyphBitmap bitmap;
+    rasterizeGlyph(m_face_ttf->getFace(gi.font_number), gi.glyph_index,
+        &bitmap);
+    insertGlyph(c, gi, bitmap);
+}   // insertGlyph
+
+// ----------------------------------------------------------------------------
+/** Save a rendered glyph into the glyph page.
+ *  \param c The character to be loaded.
+ *  \param gi \ref GlyphInfo for the character.
+ *  \param bitmap The rendered glyph.
+ */
+void FontWithFace::insertGlyph(wchar_t c, const GlyphInfo& gi,
+                               const GlyphBitmap& bitmap)
+{
+    core::dimension2du texture_size(bitmap.width + 1, bitmap.rows + 1);
     if ((m_used_width + texture_size.Width > getGlyphPageSize() &&
         m_used_height + m_current_height + texture_size.Height >
         getGlyphPageSize())                                     ||
@@ -205,41 +304,48 @@ void FontWithFace::insertGlyph(wchar_t c, const GlyphInfo& gi)
     }
 
     const unsigned int cur_tex = m_spritebank->getTextureCount() -1;
-#ifndef SERVER_ONLY
-    if (bits->buffer != NULL)
+    if (!bitmap.buffer.empty())
     {
+        // Keep a copy for the glyph cache
+        std::vector<uint8_t>& page = m_page_data[cur_tex];
+        for (unsigned int y = 0; y < bitmap.rows; y++)
+        {
+            memcpy(page.data() + (m_used_height + y) * getGlyphPageSize() +
+                m_used_width, bitmap.buffer.data() + y * bitmap.width,
+                bitmap.width);
+        }
+#ifndef SERVER_ONLY
         video::ITexture* tex = m_spritebank->getTexture(cur_tex);
         glBindTexture(GL_TEXTURE_2D, tex->getOpenGLTextureName());
-        assert(bits->pixel_mode == FT_PIXEL_MODE_GRAY);
         if (CVS->isARBTextureSwizzleUsable())
         {
             glTexSubImage2D(GL_TEXTURE_2D, 0, m_used_width, m_used_height,
-                bits->width, bits->rows, GL_RED, GL_UNSIGNED_BYTE,
-                bits->buffer);
+                bitmap.width, bitmap.rows, GL_RED, GL_UNSIGNED_BYTE,
+                bitmap.buffer.data());
         }
         else
         {
-            const unsigned int size = bits->width * bits->rows;
+            const unsigned int size = bitmap.width * bitmap.rows;
             uint8_t* image_data = new uint8_t[size * 4];
             memset(image_data, 255, size * 4);
             for (unsigned int i = 0; i < size; i++)
-                image_data[4 * i + 3] = bits->buffer[i];
+                image_data[4 * i + 3] = bitmap.buffer[i];
             glTexSubImage2D(GL_TEXTURE_2D, 0, m_used_width, m_used_height,
-                bits->width, bits->rows, GL_RGBA, GL_UNSIGNED_BYTE,
+                bitmap.width, bitmap.rows, GL_RGBA, GL_UNSIGNED_BYTE,
                 image_data);
             delete[] image_data;
         }
         if (tex->hasMipMaps())
             glGenerateMipmap(GL_TEXTURE_2D);
         glBindTexture(GL_TEXTURE_2D, 0);
-    }
 #endif
+    }
 
     // Store the rectangle of current glyph
     gui::SGUISpriteFrame f;
     gui::SGUISprite s;
     core::rect<s32> rectangle(m_used_width, m_used_height,
-        m_used_width + bits->width, m_used_height + bits->rows);
+        m_used_width + bitmap.width, m_used_height + bitmap.rows);
     f.rectNumber = m_spritebank->getPositions().size();
     f.textureNumber = cur_tex;
 
@@ -251,15 +357,15 @@ void FontWithFace::insertGlyph(wchar_t c, const GlyphInfo& gi)
 
     // Save glyph metrics
     FontArea a;
-    a.advance_x = cur_face->glyph->advance.x / BEARING;
-    a.bearing_x = cur_face->glyph->metrics.horiBearingX / BEARING;
-    const int cur_height = (cur_face->glyph->metrics.height / BEARING);
-    const int cur_offset_y = cur_height -
-        (cur_face->glyph->metrics.horiBearingY / BEARING);
+    a.advance_x = bitmap.advance_x;
+    a.bearing_x = bitmap.bearing_x;
+    const int cur_height = bitmap.height;
+    const int cur_offset_y = cur_height - bitmap.bearing_y;
     a.offset_y = m_glyph_max_height - cur_height + cur_offset_y;
     a.offset_y_bt = -cur_offset_y;
     a.spriteno = f.rectNumber;
     m_character_area_map[c] = a;
+    m_cache_dirty = true;
 
     // Store used area
     m_used_width += texture_size.Width;
@@ -275,9 +381,15 @@ void FontWithFace::updateCharactersList()
     if (m_fallback_font != NULL)
         m_fallback_font->updateCharactersList();
 
+    if (m_prewarm_thread.joinable())
+        collectPrewarmedGlyphs();
+
     if (m_new_char_holder.empty()) return;
     for (const wchar_t& c : m_new_char_holder)
     {
+        // Might have been rasterized by the prewarm thread in the meantime
+        if (m_character_area_map.find(c) != m_character_area_map.end())
+            continue;
         const GlyphInfo& gi = getGlyphInfo(c);
         insertGlyph(c, gi);
     }
@@ -285,6 +397,401 @@ void FontWithFace::updateCharactersList()
 
 }   // updateCharactersList
 
+// ----------------------------------------------------------------------------
+/** Return the glyph cache file name of this face. It contains the face name,
+ *  the dpi and the hash of the TTF files, so a resolution change or an
+ *  updated TTF file uses a different cache.
+ */
+std::string FontWithFace::getGlyphCacheFile() const
+{
+    char hash[32];
+    sprintf(hash, "%016llx", (unsigned long long)m_face_ttf->getHash());
+    return file_manager->getCachedTexturesDir() + "glyphs/" + m_name + "-" +
+        StringUtils::toString(getDPI()) + "-" + hash + ".stkglyph";
+}   // getGlyphCacheFile
+
+// ----------------------------------------------------------------------------
+/** Read the glyph cache of this face into \ref m_cached_atlas. The glyph
+ *  pages are stored zlib compressed, followed by the sprite rectangles and
+ *  the glyph metrics:<br>
+ *  <version><dpi><max-height><page-size><used-w><used-h><current-h>
+ *  <num-pages>{<compressed-size><data>}<num-positions>{<page><rect>}
+ *  <num-glyphs>{<char><font-number><glyph-index><has-area>[<FontArea>]}
+ *  \return True if a valid cache was loaded.
+ */
+bool FontWithFace::loadGlyphCache()
+{
+    if (!UserConfigParams::m_glyph_cache) return false;
+    const std::string file_name = getGlyphCacheFile();
+    std::ifstream ifs(file_name.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+
+    uint8_t version = 0;
+    unsigned int dpi = 0, page_size = 0, num = 0;
+    int max_height = 0;
+    CachedAtlas* atlas = new CachedAtlas();
+    ifs.read((char*)&version, sizeof(uint8_t));
+    ifs.read((char*)&dpi, sizeof(unsigned int));
+    ifs.read((char*)&max_height, sizeof(int));
+    ifs.read((char*)&page_size, sizeof(unsigned int));
+    ifs.read((char*)&atlas->used_width, sizeof(unsigned int));
+    ifs.read((char*)&atlas->used_height, sizeof(unsigned int));
+    ifs.read((char*)&atlas->current_height, sizeof(unsigned int));
+    ifs.read((char*)&num, sizeof(unsigned int));
+    bool valid = !ifs.fail() && version == GLYPH_CACHE_VERSION &&
+        dpi == getDPI() && page_size == getGlyphPageSize() && num > 0 &&
+        num <= MAX_CACHED_PAGES;
+
+    const unsigned int page_pixels = page_size * page_size;
+    std::vector<uint8_t> compressed;
+    for (unsigned int i = 0; valid && i < num; i++)
+    {
+        unsigned int size = 0;
+        ifs.read((char*)&size, sizeof(unsigned int));
+        if (ifs.fail() || size > compressBound(page_pixels))
+        {
+            valid = false;
+            break;
+        }
+        compressed.resize(size);
+        ifs.read((char*)compressed.data(), size);
+        atlas->pages.emplace_back(page_pixels);
+        uLongf dest_size = page_pixels;
+        valid = !ifs.fail() && uncompress(atlas->pages.back().data(),
+            &dest_size, compressed.data(), size) == Z_OK &&
+            dest_size == page_pixels;
+    }
+
+    if (valid)
+    {
+        ifs.read((char*)&num, sizeof(unsigned int));
+        for (unsigned int i = 0; !ifs.fail() && i < num; i++)
+        {
+            unsigned int page = 0;
+            core::rect<s32> r;
+            ifs.read((char*)&page, sizeof(unsigned int));
+            ifs.read((char*)&r.UpperLeftCorner.X, sizeof(s32));
+            ifs.read((char*)&r.UpperLeftCorner.Y, sizeof(s32));
+            ifs.read((char*)&r.LowerRightCorner.X, sizeof(s32));
+            ifs.read((char*)&r.LowerRightCorner.Y, sizeof(s32));
+            valid = valid && page < atlas->pages.size();
+            atlas->position_pages.push_back(page);
+            atlas->positions.push_back(r);
+        }
+        ifs.read((char*)&num, sizeof(unsigned int));
+        for (unsigned int i = 0; !ifs.fail() && i < num; i++)
+        {
+            uint32_t c = 0;
+            uint8_t has_area = 0;
+            GlyphInfo gi;
+            ifs.read((char*)&c, sizeof(uint32_t));
+            ifs.read((char*)&gi.font_number, sizeof(unsigned int));
+            ifs.read((char*)&gi.glyph_index, sizeof(unsigned int));
+            ifs.read((char*)&has_area, sizeof(uint8_t));
+            atlas->glyph_info[(wchar_t)c] = gi;
+            if (!has_area) continue;
+            FontArea a;
+            ifs.read((char*)&a.advance_x, sizeof(int));
+            ifs.read((char*)&a.bearing_x, sizeof(int));
+            ifs.read((char*)&a.offset_y, sizeof(int));
+            ifs.read((char*)&a.offset_y_bt, sizeof(int));
+            ifs.read((char*)&a.spriteno, sizeof(int));
+            valid = valid && a.spriteno >= 0 &&
+                a.spriteno < (int)atlas->positions.size();
+            atlas->area[(wchar_t)c] = a;
+        }
+        valid = valid && !ifs.fail() && !atlas->area.empty();
+    }
+
+    if (!valid)
+    {
+        Log::warn("FontWithFace", "Glyph cache %s is invalid, removing it.",
+            file_name.c_str());
+        delete atlas;
+        ifs.close();
+        std::remove(file_name.c_str());
+        return false;
+    }
+    m_glyph_max_height = max_height;
+    m_cached_atlas = atlas;
+    return true;
+}   // loadGlyphCache
+
+// ----------------------------------------------------------------------------
+/** Create the glyph pages, sprites and metrics from \ref m_cached_atlas,
+ *  which is freed afterwards.
+ */
+void FontWithFace::restoreGlyphCache()
+{
+    assert(m_cached_atlas);
+    for (unsigned int i = 0; i < m_cached_atlas->pages.size(); i++)
+        createNewGlyphPage(m_cached_atlas->pages[i].data());
+    for (unsigned int i = 0; i < m_cached_atlas->positions.size(); i++)
+    {
+        gui::SGUISpriteFrame f;
+        gui::SGUISprite s;
+        f.rectNumber = i;
+        f.textureNumber = m_cached_atlas->position_pages[i];
+        s.Frames.push_back(f);
+        s.frameTime = 0;
+        m_spritebank->getPositions().push_back(m_cached_atlas->positions[i]);
+        m_spritebank->getSprites().push_back(s);
+    }
+    m_character_glyph_info_map = m_cached_atlas->glyph_info;
+    m_character_area_map = m_cached_atlas->area;
+    // createNewGlyphPage resets the used area
+    m_used_width = m_cached_atlas->used_width;
+    m_used_height = m_cached_atlas->used_height;
+    m_current_height = m_cached_atlas->current_height;
+    Log::debug("FontWithFace", "%s: %d glyphs restored from glyph cache.",
+        m_name.c_str(), (int)m_character_area_map.size());
+    delete m_cached_atlas;
+    m_cached_atlas = NULL;
+    m_cache_dirty = false;
+}   // restoreGlyphCache
+
+// ----------------------------------------------------------------------------
+/** Write the glyph pages (at most \ref MAX_CACHED_PAGES), and the sprites
+ *  and metrics of the glyphs on them to the glyph cache file.
+ *  \see loadGlyphCache
+ */
+void FontWithFace::saveGlyphCache()
+{
+    if (!UserConfigParams::m_glyph_cache || m_character_area_map.empty())
+        return;
+    // Large fonts (e.g. CJK) only cache their first pages. The glyphs on
+    // the other pages are rendered again when they are used.
+    const unsigned int num_pages =
+        std::min((unsigned int)m_page_data.size(), MAX_CACHED_PAGES);
+    const bool all_pages = num_pages == m_page_data.size();
+    if (!all_pages)
+    {
+        Log::info("FontWithFace", "%s uses %d glyph pages, caching the "
+            "first %d.", m_name.c_str(), (int)m_page_data.size(), num_pages);
+    }
+    file_manager->checkAndCreateDirectoryP(
+        file_manager->getCachedTexturesDir() + "glyphs/");
+    const std::string file_name = getGlyphCacheFile();
+    std::ofstream ofs(file_name.c_str(), std::ios::out | std::ios::binary);
+    if (!ofs.is_open())
+        return;
+
+    const unsigned int dpi = getDPI();
+    const unsigned int page_size = getGlyphPageSize();
+    // If pages are left out, the last cached page is full, so the next
+    // glyph inserted after loading the cache starts a new page
+    const unsigned int used_width = all_pages ? m_used_width : page_size;
+    const unsigned int used_height = all_pages ? m_used_height : page_size;
+    const unsigned int current_height = all_pages ? m_current_height : 0;
+    unsigned int num = num_pages;
+    ofs.write((char*)&GLYPH_CACHE_VERSION, sizeof(uint8_t));
+    ofs.write((char*)&dpi, sizeof(unsigned int));
+    ofs.write((char*)&m_glyph_max_height, sizeof(int));
+    ofs.write((char*)&page_size, sizeof(unsigned int));
+    ofs.write((char*)&used_width, sizeof(unsigned int));
+    ofs.write((char*)&used_height, sizeof(unsigned int));
+    ofs.write((char*)&current_height, sizeof(unsigned int));
+    ofs.write((char*)&num, sizeof(unsigned int));
+
+    std::vector<uint8_t> compressed;
+    for (unsigned int i = 0; i < num_pages; i++)
+    {
+        uLongf size = compressBound(m_page_data[i].size());
+        compressed.resize(size);
+        if (compress2(compressed.data(), &size, m_page_data[i].data(),
+            m_page_data[i].size(), Z_BEST_SPEED) != Z_OK)
+        {
+            ofs.close();
+            std::remove(file_name.c_str());
+            return;
+        }
+        const unsigned int compressed_size = size;
+        ofs.write((char*)&compressed_size, sizeof(unsigned int));
+        ofs.write((char*)compressed.data(), compressed_size);
+    }
+
+    const core::array<core::rect<s32> >& positions =
+        m_spritebank->getPositions();
+    core::array<gui::SGUISprite>& sprites = m_spritebank->getSprites();
+    // Pages are filled in order, so the sprites on the cached pages come
+    // first
+    unsigned int num_sprites = 0;
+    while (num_sprites < positions.size() &&
+           sprites[num_sprites].Frames[0].textureNumber < num_pages)
+        num_sprites++;
+    num = num_sprites;
+    ofs.write((char*)&num, sizeof(unsigned int));
+    for (unsigned int i = 0; i < num_sprites; i++)
+    {
+        const unsigned int page = sprites[i].Frames[0].textureNumber;
+        ofs.write((char*)&page, sizeof(unsigned int));
+        ofs.write((char*)&positions[i].UpperLeftCorner.X, sizeof(s32));
+        ofs.write((char*)&positions[i].UpperLeftCorner.Y, sizeof(s32));
+        ofs.write((char*)&positions[i].LowerRightCorner.X, sizeof(s32));
+        ofs.write((char*)&positions[i].LowerRightCorner.Y, sizeof(s32));
+    }
+
+    // Characters whose glyph is not cached are left out completely, so
+    // they are loaded again when they are used
+    auto is_cached = [this, num_sprites](wchar_t c)
+    {
+        std::map<wchar_t, FontArea>::const_iterator n =
+            m_character_area_map.find(c);
+        return n == m_character_area_map.end() ||
+               n->second.spriteno < (int)num_sprites;
+    };
+    num = 0;
+    for (auto& p : m_character_glyph_info_map)
+    {
+        if (is_cached(p.first))
+            num++;
+    }
+    ofs.write((char*)&num, sizeof(unsigned int));
+    for (auto& p : m_character_glyph_info_map)
+    {
+        if (!is_cached(p.first))
+            continue;
+        const uint32_t c = p.first;
+        std::map<wchar_t, FontArea>::const_iterator n =
+            m_character_area_map.find(p.first);
+        const uint8_t has_area = n != m_character_area_map.end() ? 1 : 0;
+        ofs.write((char*)&c, sizeof(uint32_t));
+        ofs.write((char*)&p.second.font_number, sizeof(unsigned int));
+        ofs.write((char*)&p.second.glyph_index, sizeof(unsigned int));
+        ofs.write((char*)&has_area, sizeof(uint8_t));
+        if (!has_area) continue;
+        ofs.write((char*)&n->second.advance_x, sizeof(int));
+        ofs.write((char*)&n->second.bearing_x, sizeof(int));
+        ofs.write((char*)&n->second.offset_y, sizeof(int));
+        ofs.write((char*)&n->second.offset_y_bt, sizeof(int));
+        ofs.write((char*)&n->second.spriteno, sizeof(int));
+    }
+    if (ofs.fail())
+    {
+        ofs.close();
+        std::remove(file_name.c_str());
+        return;
+    }
+    m_cache_dirty = false;
+}   // saveGlyphCache
+
+// ----------------------------------------------------------------------------
+/** Rasterize the given characters in a separate thread, so they don't need
+ *  to be rendered with FreeType when they are first displayed. The rendered
+ *  glyphs are added to the glyph pages in \ref updateCharactersList.
+ *  \param chars All characters to prewarm, usually all characters of the
+ *  current translation.
+ */
+void FontWithFace::prewarm(const std::set<wchar_t>& chars)
+{
+    if (!supportLazyLoadChar() || m_prewarm_thread.joinable()) return;
+    std::vector<wchar_t> todo;
+    for (const wchar_t& c : chars)
+    {
+        if (c >= (wchar_t)32 && !loadedChar(c))
+            todo.push_back(c);
+    }
+    if (todo.empty()) return;
+    Log::debug("FontWithFace", "%s: prewarming %d characters.",
+        m_name.c_str(), (int)todo.size());
+    m_prewarm_abort = false;
+    m_prewarm_finished = false;
+    m_prewarm_thread = std::thread(&FontWithFace::prewarmThread, this, todo);
+}   // prewarm
+
+// ----------------------------------------------------------------------------
+/** The prewarm thread. It opens the TTF files with its own FreeType library,
+ *  since FreeType faces must not be used by two threads at the same time.
+ */
+void FontWithFace::prewarmThread(std::vector<wchar_t> chars)
+{
+    VS::setThreadName("FontPrewarm");
+    FT_Library library;
+    if (FT_Init_FreeType(&library) != 0)
+    {
+        m_prewarm_finished = true;
+        return;
+    }
+    std::vector<FT_Face> faces;
+    for (const std::string& file : m_face_ttf->getFiles())
+    {
+        FT_Face face = NULL;
+        if (FT_New_Face(library, file.c_str(), 0, &face) != 0)
+            break;
+        faces.push_back(face);
+    }
+
+    std::vector<PrewarmedGlyph> done;
+    for (unsigned int i = 0; i < chars.size() && !m_prewarm_abort &&
+        faces.size() == m_face_ttf->getTotalFaces(); i++)
+    {
+        PrewarmedGlyph pg;
+        pg.c = chars[i];
+        while (pg.gi.font_number < faces.size())
+        {
+            pg.gi.glyph_index =
+                FT_Get_Char_Index(faces[pg.gi.font_number], pg.c);
+            if (pg.gi.glyph_index > 0) break;
+            pg.gi.font_number++;
+        }
+        if (pg.gi.glyph_index > 0)
+            rasterizeGlyph(faces[pg.gi.font_number], pg.gi.glyph_index,
+                &pg.bitmap);
+        done.push_back(pg);
+        if (done.size() == 64 || i + 1 == chars.size())
+        {
+            std::lock_guard<std::mutex> lock(m_prewarm_mutex);
+            for (PrewarmedGlyph& g : done)
+                m_prewarmed_glyphs.push_back(std::move(g));
+            done.clear();
+        }
+    }
+
+    for (FT_Face face : faces)
+        FT_Done_Face(face);
+    FT_Done_FreeType(library);
+    m_prewarm_finished = true;
+}   // prewarmThread
+
+// ----------------------------------------------------------------------------
+/** Upload the glyphs rendered by the prewarm thread so far into the glyph
+ *  pages. Characters which were loaded in the meantime are skipped.
+ */
+void FontWithFace::collectPrewarmedGlyphs()
+{
+    const bool finished = m_prewarm_finished;
+    std::vector<PrewarmedGlyph> glyphs;
+    {
+        std::lock_guard<std::mutex> lock(m_prewarm_mutex);
+        std::swap(glyphs, m_prewarmed_glyphs);
+    }
+    for (const PrewarmedGlyph& pg : glyphs)
+    {
+        if (m_character_area_map.find(pg.c) != m_character_area_map.end())
+            continue;
+        m_character_glyph_info_map[pg.c] = pg.gi;
+        if (pg.gi.glyph_index > 0)
+            insertGlyph(pg.c, pg.gi, pg.bitmap);
+    }
+    // The thread adds all its glyphs before it sets the finished flag, so
+    // nothing can be left if it was set before the swap
+    if (finished)
+        m_prewarm_thread.join();
+}   // collectPrewarmedGlyphs
+
+// ----------------------------------------------------------------------------
+/** Stop the prewarm thread if it is running, and drop its results.
+ */
+void FontWithFace::stopPrewarm()
+{
+    if (!m_prewarm_thread.joinable()) return;
+    m_prewarm_abort = true;
+    m_prewarm_thread.join();
+    m_prewarm_abort = false;
+    m_prewarmed_glyphs.clear();
+}   // stopPrewarm
+
 // ----------------------------------------------------------------------------
 /** Write the current glyph page in png inside current running directory.
  *  Mainly for debug use.
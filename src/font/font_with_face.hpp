@@ -24,10 +24,14 @@
 #include "utils/no_copy.hpp"
 
 #include <algorithm>
+#include <atomic>
 #include <cassert>
 #include <map>
+#include <mutex>
 #include <set>
 #include <string>
+#include <thread>
+#include <vector>
 
 #include <ft2build.h>
 #include FT_FREETYPE_H
@@ -147,9 +151,74 @@ private:
         unsigned int glyph_index;
     };
 
+    /** A glyph rendered into an 8-bit coverage bitmap, together with the
+     *  metrics needed to create a \ref FontArea. */
+    struct GlyphBitmap
+    {
+        unsigned int         width;
+        unsigned int         rows;
+        /** Tightly packed coverage values, \ref width * \ref rows. */
+        std::vector<uint8_t> buffer;
+        int                  advance_x;
+        int                  bearing_x;
+        int                  height;
+        int                  bearing_y;
+    };
+
+    /** A glyph rasterized by the prewarm thread. */
+    struct PrewarmedGlyph
+    {
+        wchar_t     c;
+        GlyphInfo   gi;
+        GlyphBitmap bitmap;
+    };
+
+    /** The glyph pages, sprites and metrics read from the glyph cache file,
+     *  used by the first \ref reset after \ref init. */
+    struct CachedAtlas
+    {
+        unsigned int                       used_width;
+        unsigned int                       used_height;
+        unsigned int                       current_height;
+        std::vector<std::vector<uint8_t> > pages;
+        std::vector<core::rect<s32> >      positions;
+        std::vector<unsigned int>          position_pages;
+        std::map<wchar_t, GlyphInfo>       glyph_info;
+        std::map<wchar_t, FontArea>        area;
+    };
+
+    /** Name of this face, used for the sprite bank and glyph cache file. */
+    std::string                  m_name;
+
     /** \ref FaceTTF to load glyph from. */
     FaceTTF*                     m_face_ttf;
 
+    /** A copy of the coverage values of each glyph page, which is written
+     *  to the glyph cache. */
+    std::vector<std::vector<uint8_t> > m_page_data;
+
+    /** Atlas loaded from the glyph cache, NULL if none was loaded or it was
+     *  already restored. */
+    CachedAtlas*                 m_cached_atlas;
+
+    /** True if glyphs were added which are not in the glyph cache file. */
+    bool                         m_cache_dirty;
+
+    /** Thread which rasterizes characters in the background. */
+    std::thread                  m_prewarm_thread;
+
+    /** Protects \ref m_prewarmed_glyphs. */
+    std::mutex                   m_prewarm_mutex;
+
+    /** Glyphs rasterized by the prewarm thread, waiting to be uploaded. */
+    std::vector<PrewarmedGlyph>  m_prewarmed_glyphs;
+
+    /** Set by the prewarm thread when it has finished. */
+    std::atomic<bool>            m_prewarm_finished;
+
+    /** Set to stop the prewarm thread early. */
+    std::atomic<bool>            m_prewarm_abort;
+
     /** Fallback font to use if some character isn't supported by this font. */
     FontWithFace*                m_fallback_font;
 
@@ -236,13 +305,33 @@ private:
     // ------------------------------------------------------------------------
     void loadGlyphInfo(wchar_t c);
     // ------------------------------------------------------------------------
-    void createNewGlyphPage();
+    void createNewGlyphPage(const uint8_t* coverage = NULL);
     // ------------------------------------------------------------------------
     /** Add a character into \ref m_new_char_holder for lazy loading later. */
     void addLazyLoadChar(wchar_t c)            { m_new_char_holder.insert(c); }
     // ------------------------------------------------------------------------
     void insertGlyph(wchar_t c, const GlyphInfo& gi);
     // ------------------------------------------------------------------------
+    void insertGlyph(wchar_t c, const GlyphInfo& gi,
+                     const GlyphBitmap& bitmap);
+    // ------------------------------------------------------------------------
+    void rasterizeGlyph(FT_Face face, unsigned int glyph_index,
+                        GlyphBitmap* bitmap) const;
+    // ------------------------------------------------------------------------
+    std::string getGlyphCacheFile() const;
+    // ------------------------------------------------------------------------
+    bool loadGlyphCache();
+    // ------------------------------------------------------------------------
+    void restoreGlyphCache();
+    // ------------------------------------------------------------------------
+    void saveGlyphCache();
+    // ------------------------------------------------------------------------
+    void prewarmThread(std::vector<wchar_t> chars);
+    // ------------------------------------------------------------------------
+    void collectPrewarmedGlyphs();
+    // ------------------------------------------------------------------------
+    void stopPrewarm();
+    // ------------------------------------------------------------------------
     void setDPI();
     // ------------------------------------------------------------------------
     /** Override it if sub-class should not do lazy loading characters. */
@@ -289,6 +378,8 @@ public:
                 FontSettings* font_settings,
                 FontCharCollector* char_collector = NULL);
     // ------------------------------------------------------------------------
+    void prewarm(const std::set<wchar_t>& chars);
+    // ------------------------------------------------------------------------
     void dumpGlyphPage(const std::string& name);
     // ------------------------------------------------------------------------
     void dumpGlyphPage();
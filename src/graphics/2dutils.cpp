@@ -24,6 +24,7 @@
 #include "graphics/shader.hpp"
 #include "graphics/shaders.hpp"
 #include "graphics/shared_gpu_objects.hpp"
+#include "graphics/sprite_batch.hpp"
 #include "graphics/texture_shader.hpp"
 #include "utils/cpp2011.hpp"
 
@@ -283,6 +284,15 @@ void draw2DImage(const video::ITexture* texture,
         return;
     }
 
+    if (SpriteBatch::getActive())
+    {
+        video::SColor duplicatedArray[4] = { colors, colors, colors, colors };
+        SpriteBatch::getActive()->add(texture, destRect, sourceRect, clip_rect,
+            duplicatedArray, use_alpha_channel_of_texture ?
+            SpriteBatch::BM_ALPHA : SpriteBatch::BM_NONE);
+        return;
+    }
+
     float width, height, center_pos_x, center_pos_y;
     float tex_width, tex_height, tex_center_pos_x, tex_center_pos_y;
 
@@ -358,6 +368,15 @@ void draw2DImage(const video::ITexture* texture,
         return;
     }
 
+    if (SpriteBatch::getActive())
+    {
+        video::SColor duplicatedArray[4] = { colors, colors, colors, colors };
+        SpriteBatch::getActive()->add(texture, destRect, sourceRect, clip_rect,
+            duplicatedArray, use_alpha_channel_of_texture ?
+            SpriteBatch::BM_ALPHA : SpriteBatch::BM_NONE);
+        return;
+    }
+
     float width, height, center_pos_x, center_pos_y;
     float tex_width, tex_height, tex_center_pos_x, tex_center_pos_y;
 
@@ -419,6 +438,7 @@ void draw2DImageFromRTT(GLuint texture, size_t texture_w, size_t texture_h,
                         const video::SColor &colors,
                         bool use_alpha_channel_of_texture)
 {
+    SpriteBatch::flushActive();
     if (use_alpha_channel_of_texture)
     {
         glEnable(GL_BLEND);
@@ -465,6 +485,15 @@ void draw2DImage(const video::ITexture* texture,
         return;
     }
 
+    if (SpriteBatch::getActive())
+    {
+        SpriteBatch::getActive()->add(texture, destRect, sourceRect, clip_rect,
+            colors, draw_translucently ? SpriteBatch::BM_ADDITIVE :
+            use_alpha_channel_of_texture ? SpriteBatch::BM_ALPHA :
+                                           SpriteBatch::BM_NONE);
+        return;
+    }
+
     float width, height, center_pos_x, center_pos_y, tex_width, tex_height;
     float tex_center_pos_x, tex_center_pos_y;
 
@@ -541,6 +570,15 @@ void draw2DImage(const video::ITexture* texture,
         return;
     }
 
+    if (SpriteBatch::getActive())
+    {
+        SpriteBatch::getActive()->add(texture, destRect, sourceRect, clip_rect,
+            colors, draw_translucently ? SpriteBatch::BM_ADDITIVE :
+            use_alpha_channel_of_texture ? SpriteBatch::BM_ALPHA :
+                                           SpriteBatch::BM_NONE);
+        return;
+    }
+
     float width, height, center_pos_x, center_pos_y, tex_width, tex_height;
     float tex_center_pos_x, tex_center_pos_y;
 
@@ -609,6 +647,7 @@ void draw2DVertexPrimitiveList(video::ITexture *tex, const void* vertices,
         return;
     }
 
+    SpriteBatch::flushActive();
     GLuint tmpvao, tmpvbo, tmpibo;
     primitiveCount += 2;
     glGenVertexArrays(1, &tmpvao);
@@ -645,6 +684,7 @@ void GL32_draw2DRectangle(video::SColor color, const core::rect<s32>& position,
         irr_driver->getVideoDriver()->draw2DRectangle(color, position, clip);
         return;
     }
+    SpriteBatch::flushActive();
 
     core::dimension2d<u32> frame_size = irr_driver->getActualScreenSize();
     const int screen_w = frame_size.Width;
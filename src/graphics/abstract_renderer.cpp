@@ -199,6 +199,8 @@ AbstractRenderer::AbstractRenderer()
 {
     resetObjectCount();
     resetPolyCount();
+    resetCullingStats();
+    resetBatchingStats();
 }
 
 
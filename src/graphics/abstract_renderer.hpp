@@ -59,6 +59,11 @@ protected:
     /** Performance stats */
     unsigned             m_object_count[PASS_COUNT];
     unsigned             m_poly_count  [PASS_COUNT];
+    unsigned             m_culling_nodes_tested;
+    float                m_culling_time;
+    float                m_prepare_time;
+    unsigned             m_batched_objects;
+    unsigned             m_batched_draws;
 
 #ifdef DEBUG
     void drawDebugMeshes() const;
@@ -117,10 +122,28 @@ public:
     
     void resetObjectCount()                     { memset(m_object_count, 0, sizeof(m_object_count));}
     void resetPolyCount()                       { memset(m_poly_count, 0, sizeof(m_poly_count));    }
+    void resetCullingStats()
+    {
+        m_culling_nodes_tested = 0;
+        m_culling_time = 0;
+        m_prepare_time = 0;
+    }
+    void resetBatchingStats()               { m_batched_objects = 0; m_batched_draws = 0;           }
     void incObjectCount(STKRenderingPass phase) {  m_object_count[phase]++;                         }
     
     unsigned getObjectCount(STKRenderingPass pass) const { return m_object_count[pass];             }
     unsigned getPolyCount(STKRenderingPass pass) const   { return m_poly_count  [pass];             }
+    /** Number of static BVH nodes tested and CPU time (in s) used for
+     *  culling, summed over all cameras of the last frame. */
+    unsigned getCullingNodesTested() const               { return m_culling_nodes_tested;           }
+    float getCullingTime() const                         { return m_culling_time;                   }
+    /** CPU time (in s) used to prepare the draw calls (including culling),
+     *  summed over all cameras of the last frame. */
+    float getPrepareTime() const                         { return m_prepare_time;                   }
+    /** Number of objects drawn with instance batching and the number of
+     *  instanced draw calls used for them in the last frame. */
+    unsigned getBatchedObjects() const                   { return m_batched_objects;                }
+    unsigned getBatchedDraws() const                     { return m_batched_draws;                  }
     
 };
 
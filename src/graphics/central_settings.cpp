@@ -53,6 +53,9 @@ void CentralVideoSettings::init()
     hasTextureFilterAnisotropic = false;
     hasTextureSwizzle = false;
     hasPixelBufferObject = false;
+    hasProgramBinary = false;
+    hasInstancedArrays = false;
+    hasVertexType2101010Rev = false;
 
 #if defined(USE_GLES2)
     hasBGRA = false;
@@ -280,6 +283,54 @@ void CentralVideoSettings::init()
             m_need_vertex_id_workaround = true;
         }
 #endif
+
+#if !defined(USE_GLES2)
+        const bool program_binary_core = m_gl_major_version > 4 ||
+            (m_gl_major_version == 4 && m_gl_minor_version >= 1) ||
+            hasGLExtension("GL_ARB_get_program_binary");
+#else
+        const bool program_binary_core = m_glsl;
+#endif
+        if (!GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_PROGRAM_BINARY) &&
+            program_binary_core)
+        {
+            // Some drivers support the extension without any binary format
+            GLint num_formats = 0;
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &num_formats);
+            if (num_formats > 0)
+            {
+                hasProgramBinary = true;
+                Log::info("GLDriver", "ARB Get Program Binary Present");
+            }
+        }
+
+#if !defined(USE_GLES2)
+        const bool instanced_arrays_core = m_gl_major_version > 3 ||
+            (m_gl_major_version == 3 && m_gl_minor_version >= 3) ||
+            hasGLExtension("GL_ARB_instanced_arrays");
+#else
+        const bool instanced_arrays_core = m_glsl;
+#endif
+        if (!GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_INSTANCED_ARRAYS) &&
+            instanced_arrays_core)
+        {
+            hasInstancedArrays = true;
+            Log::info("GLDriver", "ARB Instanced Arrays Present");
+        }
+
+#if !defined(USE_GLES2)
+        const bool vertex_type_2101010_core = m_gl_major_version > 3 ||
+            (m_gl_major_version == 3 && m_gl_minor_version >= 3) ||
+            hasGLExtension("GL_ARB_vertex_type_2_10_10_10_rev");
+#else
+        const bool vertex_type_2101010_core = m_glsl;
+#endif
+        if (!GraphicsRestrictions::isDisabled(GraphicsRestrictions::GR_VERTEX_TYPE_2101010_REV) &&
+            vertex_type_2101010_core)
+        {
+            hasVertexType2101010Rev = true;
+            Log::info("GLDriver", "ARB Vertex Type 2_10_10_10_rev Present");
+        }
     }
 }
 
@@ -360,6 +411,21 @@ bool CentralVideoSettings::isAMDVertexShaderLayerUsable() const
     return hasVSLayer;
 }
 
+bool CentralVideoSettings::isARBGetProgramBinaryUsable() const
+{
+    return hasProgramBinary;
+}
+
+bool CentralVideoSettings::isARBInstancedArraysUsable() const
+{
+    return m_glsl && hasInstancedArrays;
+}
+
+bool CentralVideoSettings::isARBVertexType2101010RevUsable() const
+{
+    return m_glsl && hasVertexType2101010Rev;
+}
+
 bool CentralVideoSettings::isARBBufferStorageUsable() const
 {
     return hasBufferStorage;
@@ -510,4 +576,20 @@ bool CentralVideoSettings::supportsThreadedTextureLoading() const
     return isARBPixelBufferObjectUsable() && isARBBufferStorageUsable() && isARBTextureStorageUsable();
 }
 
+/** Identical meshes are batched into instanced draws on the CPU when the
+ *  command buffers (indirect instancing) are not available. */
+bool CentralVideoSettings::supportsInstanceBatching() const
+{
+    return isARBInstancedArraysUsable() && !supportsIndirectInstancingRendering() &&
+           UserConfigParams::m_instance_batching;
+}
+
+/** Normals and tangents of the shared vertex buffers (see VAOManager) are
+ *  stored as signed normalized 2_10_10_10 integers. */
+bool CentralVideoSettings::supportsPackedVertices() const
+{
+    return isARBVertexType2101010RevUsable() &&
+           UserConfigParams::m_packed_vertices;
+}
+
 #endif   // !SERVER_ONLY
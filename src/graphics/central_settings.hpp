@@ -45,6 +45,9 @@ private:
     bool hasTextureFilterAnisotropic;
     bool hasTextureSwizzle;
     bool hasPixelBufferObject;
+    bool hasProgramBinary;
+    bool hasInstancedArrays;
+    bool hasVertexType2101010Rev;
 
 #if defined(USE_GLES2)
     bool hasBGRA;
@@ -88,6 +91,9 @@ public:
     bool isEXTTextureFilterAnisotropicUsable() const;
     bool isARBTextureSwizzleUsable() const;
     bool isARBPixelBufferObjectUsable() const;
+    bool isARBGetProgramBinaryUsable() const;
+    bool isARBInstancedArraysUsable() const;
+    bool isARBVertexType2101010RevUsable() const;
 
 #if defined(USE_GLES2)
     bool isEXTTextureFormatBGRA8888Usable() const;
@@ -103,6 +109,8 @@ public:
     bool supportsAsyncInstanceUpload() const;
     bool supportsHardwareSkinning() const;
     bool supportsThreadedTextureLoading() const;
+    bool supportsInstanceBatching() const;
+    bool supportsPackedVertices() const;
 
     // "Macro" around feature support and user config
     bool isShadowEnabled() const;
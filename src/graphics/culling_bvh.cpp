@@ -0,0 +1,426 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "graphics/culling_bvh.hpp"
+
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+#if __SSE2__ || _M_X64 || _M_IX86_FP >= 2
+ #include <emmintrin.h>
+ #define SIMD_SSE2_SUPPORT (1)
+#endif
+
+using namespace irr;
+
+/** A box is culled if all its corners are further than this in front of a
+ *  plane, the same tolerance as plane3d::classifyPointRelation uses. */
+static const float CULL_EPSILON = core::ROUNDING_ERROR_f32;
+
+// ----------------------------------------------------------------------------
+/** Removes all frusta. Unused planes never cull anything. */
+void CullingBVH::Frusta::clear()
+{
+    for (unsigned int i = 0; i < MAX_FRUSTA * 8; i++)
+    {
+        m_nx[i] = m_ny[i] = m_nz[i] = 0;
+        m_ax[i] = m_ay[i] = m_az[i] = 0;
+        m_d[i]  = -1.0f;
+    }
+    m_mask = 0;
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Sets the planes of one frustum.
+ *  \param index Index of the frustum, which is the bit used for it in the
+ *         visibility masks computed by cull().
+ *  \param frustum The view frustum.
+ */
+void CullingBVH::Frusta::set(unsigned int index,
+                             const scene::SViewFrustum &frustum)
+{
+    assert(index < MAX_FRUSTA);
+    for (unsigned int i = 0; i < scene::SViewFrustum::VF_PLANE_COUNT; i++)
+    {
+        const core::plane3df &plane = frustum.planes[i];
+        const unsigned int j = index * 8 + i;
+        m_nx[j] = plane.Normal.X;
+        m_ny[j] = plane.Normal.Y;
+        m_nz[j] = plane.Normal.Z;
+        m_d [j] = plane.D;
+        m_ax[j] = fabsf(plane.Normal.X);
+        m_ay[j] = fabsf(plane.Normal.Y);
+        m_az[j] = fabsf(plane.Normal.Z);
+    }
+    m_mask |= 1 << index;
+}   // set
+
+// ============================================================================
+CullingBVH::CullingBVH()
+{
+    m_num_nodes_tested = 0;
+}   // CullingBVH
+
+// ----------------------------------------------------------------------------
+/** Removes all objects. */
+void CullingBVH::clear()
+{
+    m_min_x.clear(); m_min_y.clear(); m_min_z.clear();
+    m_max_x.clear(); m_max_y.clear(); m_max_z.clear();
+    m_child_or_object.clear();
+    m_num_nodes_tested = 0;
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Builds the tree.
+ *  \param boxes The world space bounding box of each object. The index of
+ *         a box is the index of the object in the results of cull().
+ */
+void CullingBVH::build(const std::vector<core::aabbox3df> &boxes)
+{
+    clear();
+    if (boxes.empty())
+        return;
+    std::vector<uint32_t> objects(boxes.size());
+    for (unsigned int i = 0; i < boxes.size(); i++)
+        objects[i] = i;
+    const size_t num_nodes = 2 * boxes.size() - 1;
+    m_min_x.reserve(num_nodes); m_min_y.reserve(num_nodes);
+    m_min_z.reserve(num_nodes); m_max_x.reserve(num_nodes);
+    m_max_y.reserve(num_nodes); m_max_z.reserve(num_nodes);
+    m_child_or_object.reserve(num_nodes);
+    buildNode(boxes, &objects, 0, (unsigned int)boxes.size());
+}   // build
+
+// ----------------------------------------------------------------------------
+/** Adds the node for the objects [first, last) and (recursively) its
+ *  children, splitting the objects at the median of the longest axis.
+ *  \return The index of the node.
+ */
+int CullingBVH::buildNode(const std::vector<core::aabbox3df> &boxes,
+                          std::vector<uint32_t> *objects, unsigned int first,
+                          unsigned int last)
+{
+    core::aabbox3df box = boxes[(*objects)[first]];
+    core::aabbox3df centers(boxes[(*objects)[first]].getCenter());
+    for (unsigned int i = first + 1; i < last; i++)
+    {
+        box.addInternalBox(boxes[(*objects)[i]]);
+        centers.addInternalPoint(boxes[(*objects)[i]].getCenter());
+    }
+    const int node = (int)m_child_or_object.size();
+    m_min_x.push_back(box.MinEdge.X);
+    m_min_y.push_back(box.MinEdge.Y);
+    m_min_z.push_back(box.MinEdge.Z);
+    m_max_x.push_back(box.MaxEdge.X);
+    m_max_y.push_back(box.MaxEdge.Y);
+    m_max_z.push_back(box.MaxEdge.Z);
+    m_child_or_object.push_back(0);
+
+    if (last - first == 1)
+    {
+        m_child_or_object[node] = ~(int32_t)(*objects)[first];
+        return node;
+    }
+
+    const core::vector3df extent = centers.getExtent();
+    int axis = 0;
+    if (extent.Y > extent.X) axis = 1;
+    if (extent.Z > (axis == 0 ? extent.X : extent.Y)) axis = 2;
+    const unsigned int mid = (first + last) / 2;
+    std::nth_element(objects->begin() + first, objects->begin() + mid,
+                     objects->begin() + last,
+                     [&boxes, axis](uint32_t a, uint32_t b)
+                     {
+                         const core::vector3df ca = boxes[a].getCenter();
+                         const core::vector3df cb = boxes[b].getCenter();
+                         if (axis == 0) return ca.X < cb.X;
+                         if (axis == 1) return ca.Y < cb.Y;
+                         return ca.Z < cb.Z;
+                     });
+    buildNode(boxes, objects, first, mid);
+    m_child_or_object[node] = buildNode(boxes, objects, mid, last);
+    return node;
+}   // buildNode
+
+// ----------------------------------------------------------------------------
+/** Tests the box of a node against the frusta in test_mask. Frusta which
+ *  cull the box are removed from test_mask, frusta which contain the whole
+ *  box are moved from test_mask to inside_mask.
+ */
+void CullingBVH::testNode(const Frusta &frusta, unsigned int node,
+                          unsigned int *test_mask,
+                          unsigned int *inside_mask) const
+{
+    const float cx = (m_min_x[node] + m_max_x[node]) * 0.5f;
+    const float cy = (m_min_y[node] + m_max_y[node]) * 0.5f;
+    const float cz = (m_min_z[node] + m_max_z[node]) * 0.5f;
+    const float ex = (m_max_x[node] - m_min_x[node]) * 0.5f;
+    const float ey = (m_max_y[node] - m_min_y[node]) * 0.5f;
+    const float ez = (m_max_z[node] - m_min_z[node]) * 0.5f;
+#if SIMD_SSE2_SUPPORT
+    const __m128 vcx = _mm_set1_ps(cx), vcy = _mm_set1_ps(cy),
+                 vcz = _mm_set1_ps(cz);
+    const __m128 vex = _mm_set1_ps(ex), vey = _mm_set1_ps(ey),
+                 vez = _mm_set1_ps(ez);
+    const __m128 eps = _mm_set1_ps(CULL_EPSILON);
+#endif
+    for (unsigned int f = 0; f < MAX_FRUSTA; f++)
+    {
+        if ((*test_mask & (1 << f)) == 0)
+            continue;
+        bool culled = false, inside = true;
+#if SIMD_SSE2_SUPPORT
+        for (unsigned int i = f * 8; i < f * 8 + 8; i += 4)
+        {
+            // Distance of the center, and the largest distance of a corner
+            // from the center along the normal
+            const __m128 center = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_loadu_ps(frusta.m_nx + i), vcx),
+                _mm_mul_ps(_mm_loadu_ps(frusta.m_ny + i), vcy)), _mm_add_ps(
+                _mm_mul_ps(_mm_loadu_ps(frusta.m_nz + i), vcz),
+                _mm_loadu_ps(frusta.m_d + i)));
+            const __m128 radius = _mm_add_ps(_mm_add_ps(
+                _mm_mul_ps(_mm_loadu_ps(frusta.m_ax + i), vex),
+                _mm_mul_ps(_mm_loadu_ps(frusta.m_ay + i), vey)),
+                _mm_mul_ps(_mm_loadu_ps(frusta.m_az + i), vez));
+            if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_sub_ps(center, radius),
+                                             eps)))
+            {
+                culled = true;
+                break;
+            }
+            if (_mm_movemask_ps(_mm_cmpgt_ps(_mm_add_ps(center, radius),
+                                             eps)))
+                inside = false;
+        }
+#else
+        for (unsigned int i = f * 8; i < f * 8 + 8; i++)
+        {
+            const float center = frusta.m_nx[i] * cx + frusta.m_ny[i] * cy
+                               + frusta.m_nz[i] * cz + frusta.m_d[i];
+            const float radius = frusta.m_ax[i] * ex + frusta.m_ay[i] * ey
+                               + frusta.m_az[i] * ez;
+            if (center - radius > CULL_EPSILON)
+            {
+                culled = true;
+                break;
+            }
+            if (center + radius > CULL_EPSILON)
+                inside = false;
+        }
+#endif
+        if (culled)
+        {
+            *test_mask &= ~(1 << f);
+        }
+        else if (inside)
+        {
+            *test_mask  &= ~(1 << f);
+            *inside_mask |= 1 << f;
+        }
+    }   // for f < MAX_FRUSTA
+}   // testNode
+
+// ----------------------------------------------------------------------------
+/** Culls all objects against all frusta.
+ *  \param frusta The frusta.
+ *  \param visibility On return for each object the mask of the frusta in
+ *         which the object is (possibly) visible. An object is culled if
+ *         its bounding box is outside of one of the planes of a frustum,
+ *         the same test as DrawCalls::isCulledPrecise does.
+ */
+void CullingBVH::cull(const Frusta &frusta,
+                      std::vector<uint8_t> *visibility) const
+{
+    m_num_nodes_tested = 0;
+    visibility->assign((m_child_or_object.size() + 1) / 2, 0);
+    if (m_child_or_object.empty() || frusta.getMask() == 0)
+        return;
+
+    struct StackEntry
+    {
+        unsigned int m_node, m_test_mask, m_inside_mask;
+    };
+    // The tree is balanced, so its depth is about log2 of the number of
+    // objects
+    StackEntry stack[64];
+    unsigned int stack_size = 1;
+    stack[0].m_node        = 0;
+    stack[0].m_test_mask   = frusta.getMask();
+    stack[0].m_inside_mask = 0;
+    while (stack_size > 0)
+    {
+        StackEntry e = stack[--stack_size];
+        if (e.m_test_mask)
+        {
+            testNode(frusta, e.m_node, &e.m_test_mask, &e.m_inside_mask);
+            m_num_nodes_tested++;
+        }
+        const unsigned int mask = e.m_test_mask | e.m_inside_mask;
+        if (mask == 0)
+            continue;
+        const int32_t child = m_child_or_object[e.m_node];
+        if (child < 0)
+        {
+            (*visibility)[~child] = (uint8_t)mask;
+            continue;
+        }
+        assert(stack_size + 2 <= 64);
+        stack[stack_size]          = e;
+        stack[stack_size++].m_node = child;
+        stack[stack_size]          = e;
+        stack[stack_size++].m_node = e.m_node + 1;
+    }
+}   // cull
+
+// ----------------------------------------------------------------------------
+/** Compares the culling with testing each box against each frustum, for a
+ *  scene with 2000 boxes along a circular track and the main camera plus
+ *  five shadow frusta following a lap around the track, and prints the
+ *  time used by both.
+ */
+void CullingBVH::unitTesting()
+{
+    uint32_t seed = 4321;
+    // Returns a random number in [0,1)
+    auto random = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return ((seed >> 8) & 0xffff) / 65536.0f;
+    };
+
+    const float RADIUS = 300.0f;
+    std::vector<core::aabbox3df> boxes;
+    for (unsigned int i = 0; i < 2000; i++)
+    {
+        const float angle = random() * 6.2831853f;
+        const float r     = RADIUS + 60.0f * random() - 30.0f;
+        const core::vector3df p(r * cosf(angle), 10.0f * random(),
+                                r * sinf(angle));
+        const core::vector3df size(1.0f + 10.0f * random(),
+                                   1.0f + 5.0f * random(),
+                                   1.0f + 10.0f * random());
+        boxes.push_back(core::aabbox3df(p - size, p + size));
+    }
+    CullingBVH bvh;
+    bvh.build(boxes);
+
+    // The camera path: a lap around the track, looking ahead
+    const unsigned int NUM_FRAMES = 360;
+    std::vector<Frusta> frames(NUM_FRAMES);
+    std::vector<scene::SViewFrustum> views(NUM_FRAMES * MAX_FRUSTA);
+    const float far_planes[MAX_FRUSTA] = { 1000.0f, 400.0f, 20.0f, 50.0f,
+                                           150.0f, 1000.0f };
+    for (unsigned int n = 0; n < NUM_FRAMES; n++)
+    {
+        const float angle = n * 6.2831853f / NUM_FRAMES;
+        const core::vector3df pos(RADIUS * cosf(angle), 3.0f,
+                                  RADIUS * sinf(angle));
+        const core::vector3df dir(-sinf(angle), -0.05f, cosf(angle));
+        for (unsigned int f = 0; f < MAX_FRUSTA; f++)
+        {
+            core::matrix4 proj, view;
+            proj.buildProjectionMatrixPerspectiveFovLH(
+                f == 1 ? 1.5f : 1.0f, 16.0f / 9.0f, 1.0f, far_planes[f]);
+            view.buildCameraLookAtMatrixLH(pos, pos + dir,
+                                           core::vector3df(0, 1, 0));
+            scene::SViewFrustum &frustum = views[n * MAX_FRUSTA + f];
+            frustum.setFrom(proj * view);
+            frames[n].set(f, frustum);
+        }
+    }
+
+    std::vector<uint8_t> visibility;
+    unsigned int bvh_visible = 0, nodes_tested = 0;
+    const double start_bvh = StkTime::getRealTime();
+    for (unsigned int n = 0; n < NUM_FRAMES; n++)
+    {
+        bvh.cull(frames[n], &visibility);
+        for (uint8_t v : visibility)
+            bvh_visible += v;
+        nodes_tested += bvh.getNumNodesTested();
+    }
+    const double end_bvh = StkTime::getRealTime();
+
+    // Test all corners of each box like DrawCalls::isCulledPrecise
+    unsigned int linear_visible = 0;
+    for (unsigned int n = 0; n < NUM_FRAMES; n++)
+    {
+        for (const core::aabbox3df &box : boxes)
+        {
+            core::vector3df edges[8];
+            box.getEdges(edges);
+            uint8_t mask = 0;
+            for (unsigned int f = 0; f < MAX_FRUSTA; f++)
+            {
+                const scene::SViewFrustum &frustum = views[n * MAX_FRUSTA + f];
+                bool culled = false;
+                for (unsigned int p = 0; p < 6 && !culled; p++)
+                {
+                    unsigned int in_front = 0;
+                    for (unsigned int e = 0; e < 8; e++)
+                    {
+                        if (frustum.planes[p].classifyPointRelation(edges[e])
+                            == core::ISREL3D_FRONT)
+                            in_front++;
+                    }
+                    culled = in_front == 8;
+                }
+                if (!culled)
+                    mask |= 1 << f;
+            }
+            linear_visible += mask;
+        }
+    }
+    const double end_linear = StkTime::getRealTime();
+    assert(bvh_visible == linear_visible);
+
+    // Compare single results
+    bvh.cull(frames[17], &visibility);
+    for (unsigned int i = 0; i < boxes.size(); i++)
+    {
+        const core::vector3df c = boxes[i].getCenter();
+        const scene::SViewFrustum &main_view = views[17 * MAX_FRUSTA];
+        bool outside = false;
+        for (unsigned int p = 0; p < 6; p++)
+        {
+            if (main_view.planes[p].classifyPointRelation(c) ==
+                core::ISREL3D_FRONT)
+                outside = true;
+        }
+        // A box whose center is in the frustum is visible
+        assert(outside || (visibility[i] & 1) != 0);
+        (void)outside;
+    }
+
+    Log::info("CullingBVH", "2000 boxes, 6 frusta: bvh %.3f ms (%d nodes "
+              "tested), linear %.3f ms per frame.",
+              (end_bvh - start_bvh) * 1000.0 / NUM_FRAMES,
+              nodes_tested / NUM_FRAMES,
+              (end_linear - end_bvh) * 1000.0 / NUM_FRAMES);
+
+    bvh.clear();
+    assert(bvh.empty());
+    bvh.cull(frames[0], &visibility);
+    assert(visibility.empty());
+}   // unitTesting
@@ -0,0 +1,105 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_CULLING_BVH_HPP
+#define HEADER_CULLING_BVH_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <aabbox3d.h>
+#include <SViewFrustum.h>
+
+#include <vector>
+
+/**
+  * \brief A bounding volume hierarchy over the world space bounding boxes
+  *  of objects which never move (e.g. the meshes of the main track), used
+  *  to cull them against the frusta of all cameras at once (the main
+  *  camera, the RSM sun camera and the shadow cascades).
+  *  The boxes of the tree nodes are stored as structure of arrays, and the
+  *  planes of all frusta are tested with SIMD instructions, four planes at
+  *  a time. A frustum which fully contains a node is not tested again for
+  *  the children of that node.
+  * \ingroup graphics
+  */
+class CullingBVH : public NoCopy
+{
+public:
+    /** Maximum number of frusta that are tested at once. */
+    static const unsigned int MAX_FRUSTA = 6;
+
+    /** The planes of up to MAX_FRUSTA frusta, in the layout used for
+     *  culling. */
+    class Frusta
+    {
+    private:
+        friend class CullingBVH;
+        /** Each frustum uses 8 planes (the 6 planes of the frustum and 2
+         *  planes which never cull). The absolute values of the normals
+         *  are stored as well. */
+        float m_nx[MAX_FRUSTA * 8], m_ny[MAX_FRUSTA * 8],
+              m_nz[MAX_FRUSTA * 8], m_d [MAX_FRUSTA * 8];
+        float m_ax[MAX_FRUSTA * 8], m_ay[MAX_FRUSTA * 8],
+              m_az[MAX_FRUSTA * 8];
+        /** Bit i is set if frustum i is used. */
+        unsigned int m_mask;
+
+    public:
+             Frusta() { clear(); }
+        void clear();
+        void set(unsigned int index, const irr::scene::SViewFrustum &frustum);
+        // --------------------------------------------------------------------
+        /** Returns the mask of all frusta which are set. */
+        unsigned int getMask() const { return m_mask; }
+    };   // Frusta
+
+private:
+    /** Bounding boxes of all tree nodes. */
+    std::vector<float>   m_min_x, m_min_y, m_min_z, m_max_x, m_max_y, m_max_z;
+
+    /** For inner nodes the index of the second child (the first child is
+     *  the next node), for leaves the bitwise negated index of the
+     *  object. */
+    std::vector<int32_t> m_child_or_object;
+
+    /** Number of tree nodes tested in the last call to cull(). */
+    mutable unsigned int m_num_nodes_tested;
+
+    int  buildNode(const std::vector<irr::core::aabbox3df> &boxes,
+                   std::vector<uint32_t> *objects, unsigned int first,
+                   unsigned int last);
+    void testNode(const Frusta &frusta, unsigned int node,
+                  unsigned int *test_mask, unsigned int *inside_mask) const;
+
+public:
+         CullingBVH();
+    void build(const std::vector<irr::core::aabbox3df> &boxes);
+    void clear();
+    void cull(const Frusta &frusta, std::vector<uint8_t> *visibility) const;
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns true if the tree contains no objects. */
+    bool empty() const { return m_child_or_object.empty(); }
+    // ------------------------------------------------------------------------
+    /** Returns the number of tree nodes tested in the last call to
+     *  cull(). */
+    unsigned int getNumNodesTested() const { return m_num_nodes_tested; }
+};   // CullingBVH
+
+#endif
@@ -22,6 +22,7 @@
 #include "graphics/command_buffer.hpp"
 #include "graphics/draw_tools.hpp"
 #include "graphics/gpu_particles.hpp"
+#include "graphics/instance_batcher.hpp"
 #include "graphics/lod_node.hpp"
 #include "graphics/materials.hpp"
 #include "graphics/render_info.hpp"
@@ -30,8 +31,12 @@
 #include "graphics/stk_animated_mesh.hpp"
 #include "graphics/stk_billboard.hpp"
 #include "graphics/stk_mesh.hpp"
+#include "graphics/stk_tex_manager.hpp"
+#include "graphics/texture_residency.hpp"
 #include "tracks/track.hpp"
+#include "utils/job_system.hpp"
 #include "utils/profiler.hpp"
+#include "utils/time.hpp"
 
 #include <numeric>
 
@@ -168,39 +173,57 @@ void DrawCalls::renderBoundingBoxes()
 }   // renderBoundingBoxes
 
 // ----------------------------------------------------------------------------
+/** Adds the meshes of a node to the draw lists. updateNoGL() must have been
+ *  called on the node in this frame.
+ *  \param culling_mask If not negative, bit i is set if the node is visible
+ *         in camera i (main camera, sun camera, 4 shadow cameras), as
+ *         computed by the static BVH. Otherwise the node is culled here.
+ */
 void DrawCalls::handleSTKCommon(scene::ISceneNode *Node,
                                 std::vector<scene::ISceneNode *> *ImmediateDraw,
                                 const scene::ICameraSceneNode *cam,
-                                ShadowMatrices& shadow_matrices)
+                                ShadowMatrices& shadow_matrices,
+                                int culling_mask)
 {
     STKMeshCommon* node = dynamic_cast<STKMeshCommon*>(Node);
     if (!node)
         return;
-    node->updateNoGL();
     m_deferred_update.push_back(node);
 
     if (node->isImmediateDraw())
     {
-        if (!isCulledPrecise(cam, Node, irr_driver->getBoundingBoxesViz()))
+        const bool culled = culling_mask >= 0 ? (culling_mask & 1) == 0
+            : isCulledPrecise(cam, Node, irr_driver->getBoundingBoxesViz());
+        if (!culled)
             ImmediateDraw->push_back(Node);
         return;
     }
 
     bool culled_for_cams[6] = { true, true, true, true, true, true };
-    culled_for_cams[0] = isCulledPrecise(cam, Node,
-        irr_driver->getBoundingBoxesViz());
-
-    if (UserConfigParams::m_gi && !shadow_matrices.isRSMMapAvail())
+    if (culling_mask >= 0)
     {
-        culled_for_cams[1] = isCulledPrecise(shadow_matrices.getSunCam(), Node);
+        for (unsigned i = 0; i < 6; i++)
+            culled_for_cams[i] = (culling_mask & (1 << i)) == 0;
     }
-
-    if (CVS->isShadowEnabled())
+    else
     {
-        for (unsigned i = 0; i < 4; i++)
+        culled_for_cams[0] = isCulledPrecise(cam, Node,
+            irr_driver->getBoundingBoxesViz());
+
+        if (UserConfigParams::m_gi && !shadow_matrices.isRSMMapAvail())
         {
-            culled_for_cams[i + 2] =
-                isCulledPrecise(shadow_matrices.getShadowCamNodes()[i], Node);
+            culled_for_cams[1] = isCulledPrecise(shadow_matrices.getSunCam(),
+                                                 Node);
+        }
+
+        if (CVS->isShadowEnabled())
+        {
+            for (unsigned i = 0; i < 4; i++)
+            {
+                culled_for_cams[i + 2] =
+                    isCulledPrecise(shadow_matrices.getShadowCamNodes()[i],
+                                    Node);
+            }
         }
     }
 
@@ -275,6 +298,14 @@ void DrawCalls::handleSTKCommon(scene::ISceneNode *Node,
 
     if (!culled_for_cams[0])
     {
+        TextureResidency *residency =
+            STKTexManager::getInstance()->getTextureResidency();
+        if (residency)
+        {
+            residency->markVisible(node, Node->getTransformedBoundingBox(),
+                                   cam);
+        }
+
         for (GLMesh *mesh : node->TransparentMesh[TM_TRANSLUCENT_SKN])
         {
             pushVector(ListTranslucentSkinned::getInstance(), mesh, Node->getAbsoluteTransformation(), mesh->texture_trans,
@@ -313,6 +344,20 @@ void DrawCalls::handleSTKCommon(scene::ISceneNode *Node,
             }
             else
             {
+                if (m_instance_batcher &&
+                    m_instance_batcher->canBatch(0, (Material::ShaderType)Mat))
+                {
+                    for (GLMesh *mesh : node->MeshSolidMaterial[Mat])
+                    {
+                        m_instance_batcher->add(0, (Material::ShaderType)Mat,
+                            mesh, Node, mesh->texture_trans,
+                            (mesh->m_render_info && mesh->m_material ?
+                            core::vector2df(mesh->m_render_info->getHue(), mesh->m_material->getColorizationFactor()) :
+                            core::vector2df(0.0f, 0.0f)));
+                    }
+                    continue;
+                }
+
                 core::matrix4 ModelMatrix = Node->getAbsoluteTransformation(), InvModelMatrix;
                 ModelMatrix.getInverse(InvModelMatrix);
 
@@ -410,6 +455,17 @@ void DrawCalls::handleSTKCommon(scene::ISceneNode *Node,
             }
             else
             {
+                if (m_instance_batcher &&
+                    m_instance_batcher->canBatch(cascade + 1, (Material::ShaderType)Mat))
+                {
+                    for (GLMesh *mesh : node->MeshSolidMaterial[Mat])
+                    {
+                        m_instance_batcher->add(cascade + 1, (Material::ShaderType)Mat,
+                            mesh, Node, mesh->texture_trans, core::vector2df(0.0f, 0.0f));
+                    }
+                    continue;
+                }
+
                 core::matrix4 ModelMatrix = Node->getAbsoluteTransformation(), InvModelMatrix;
                 ModelMatrix.getInverse(InvModelMatrix);
 
@@ -548,14 +604,20 @@ void DrawCalls::handleSTKCommon(scene::ISceneNode *Node,
 }
 
 // ----------------------------------------------------------------------------
+/** Walks the scene graph: culls particles and billboards, and collects the
+ *  mesh nodes (except static nodes) in m_dynamic_nodes, which are culled
+ *  later in cullNodes().
+ */
 void DrawCalls::parseSceneManager(core::list<scene::ISceneNode*> &List,
-                                  std::vector<scene::ISceneNode *> *ImmediateDraw,
-                                  const scene::ICameraSceneNode *cam,
-                                  ShadowMatrices& shadow_matrices)
+                                  const scene::ICameraSceneNode *cam)
 {
     core::list<scene::ISceneNode*>::Iterator I = List.begin(), E = List.end();
     for (; I != E; ++I)
     {
+        // Static nodes are culled separately, see cullNodes
+        if (!m_static_node_set.empty() &&
+            m_static_node_set.find(*I) != m_static_node_set.end())
+            continue;
         if (LODNode *node = dynamic_cast<LODNode *>(*I))
             node->updateVisibility();
         (*I)->updateAbsolutePosition();
@@ -576,9 +638,9 @@ void DrawCalls::parseSceneManager(core::list<scene::ISceneNode*> &List,
             continue;
         }
 
-        handleSTKCommon((*I), ImmediateDraw, cam, shadow_matrices);
-        parseSceneManager((*I)->getChildren(), ImmediateDraw, cam,
-            shadow_matrices);
+        if (dynamic_cast<STKMeshCommon *>(*I))
+            m_dynamic_nodes.push_back(*I);
+        parseSceneManager((*I)->getChildren(), cam);
     }
 }
 
@@ -586,6 +648,12 @@ void DrawCalls::parseSceneManager(core::list<scene::ISceneNode*> &List,
 DrawCalls::DrawCalls()
 {
     m_sync = 0;
+    m_culling_nodes_tested = 0;
+    m_culling_time = 0;
+    m_prepare_time = 0;
+    m_instance_batcher = NULL;
+    if (CVS->supportsInstanceBatching())
+        m_instance_batcher = new InstanceBatcher();
 #if !defined(USE_GLES2)
     m_solid_cmd_buffer = NULL;
     m_shadow_cmd_buffer = NULL;
@@ -604,7 +672,7 @@ DrawCalls::DrawCalls()
 
 DrawCalls::~DrawCalls()
 {
-
+    delete m_instance_batcher;
 #if !defined(USE_GLES2)
     delete m_solid_cmd_buffer;
     delete m_shadow_cmd_buffer;
@@ -613,6 +681,138 @@ DrawCalls::~DrawCalls()
 #endif // !defined(USE_GLES2)
 } //~DrawCalls
 
+// ----------------------------------------------------------------------------
+/** Sets the scene nodes which never move (e.g. the main track), which are
+ *  then culled with a BVH built here instead of walking the scene graph.
+ *  Only mesh nodes directly below the root without children are used, all
+ *  other nodes are handled like dynamic nodes.
+ */
+void DrawCalls::setStaticNodes(const std::vector<scene::ISceneNode *> &nodes)
+{
+    clearStaticNodes();
+    scene::ISceneNode *root = irr_driver->getSceneManager()->getRootSceneNode();
+    std::vector<core::aabbox3df> boxes;
+    for (scene::ISceneNode *node : nodes)
+    {
+        if (!node || node->getParent() != root ||
+            !node->getChildren().empty() ||
+            !dynamic_cast<STKMeshCommon*>(node) ||
+            dynamic_cast<STKAnimatedMesh*>(node))
+            continue;
+        node->updateAbsolutePosition();
+        if (node->getAutomaticCulling())
+        {
+            boxes.push_back(node->getTransformedBoundingBox());
+        }
+        else
+        {
+            // Never culled
+            boxes.push_back(core::aabbox3df(-1e30f, -1e30f, -1e30f,
+                                            1e30f, 1e30f, 1e30f));
+        }
+        m_static_nodes.push_back(node);
+        m_static_node_set.insert(node);
+    }
+    m_static_bvh.build(boxes);
+}   // setStaticNodes
+
+// ----------------------------------------------------------------------------
+/** Removes all static nodes, which are then culled like all other nodes. */
+void DrawCalls::clearStaticNodes()
+{
+    m_static_nodes.clear();
+    m_static_node_set.clear();
+    m_static_bvh.clear();
+}   // clearStaticNodes
+
+// ----------------------------------------------------------------------------
+/** Culls the static nodes (with the BVH) and the nodes collected by
+ *  parseSceneManager() for all cameras (main camera, RSM and the shadow
+ *  cascades), and adds the visible nodes to the draw lists. The BVH and
+ *  each camera are culled in their own job.
+ */
+void DrawCalls::cullNodes(const scene::ICameraSceneNode *cam,
+                          ShadowMatrices& shadow_matrices)
+{
+    const scene::ICameraSceneNode *cameras[6] =
+        { cam, NULL, NULL, NULL, NULL, NULL };
+    if (UserConfigParams::m_gi && !shadow_matrices.isRSMMapAvail())
+        cameras[1] = shadow_matrices.getSunCam();
+    if (CVS->isShadowEnabled())
+    {
+        for (unsigned i = 0; i < 4; i++)
+            cameras[i + 2] = shadow_matrices.getShadowCamNodes()[i];
+    }
+
+    const bool cull_static = !m_static_node_set.empty();
+    m_frusta.clear();
+    for (unsigned i = 0; i < 6; i++)
+    {
+        if (cameras[i])
+            m_frusta.set(i, *cameras[i]->getViewFrustum());
+    }
+
+    // Animated and skinned nodes update their bounding box here, so this
+    // must be done before they are culled
+    for (unsigned int n = 0; n < m_dynamic_nodes.size(); n++)
+        dynamic_cast<STKMeshCommon*>(m_dynamic_nodes[n])->updateNoGL();
+
+    const bool visualization = irr_driver->getBoundingBoxesViz();
+    // Job 0 culls the static nodes, job i + 1 the other nodes for camera i
+    auto cull = [this, &cameras, cull_static, visualization](unsigned int job)
+    {
+        if (job == 0)
+        {
+            if (cull_static)
+                m_static_bvh.cull(m_frusta, &m_static_visibility);
+            return;
+        }
+        const unsigned int i = job - 1;
+        m_dynamic_visibility[i].assign(m_dynamic_nodes.size(), 0);
+        if (!cameras[i])
+            return;
+        for (unsigned int n = 0; n < m_dynamic_nodes.size(); n++)
+        {
+            // Only the job of the main camera adds the boxes to visualize
+            m_dynamic_visibility[i][n] =
+                !isCulledPrecise(cameras[i], m_dynamic_nodes[n],
+                                 visualization && i == 0);
+        }
+    };
+    JobSystem *job_system = JobSystem::get();
+    if (job_system)
+    {
+        job_system->parallelFor(7, cull);
+    }
+    else
+    {
+        for (unsigned int job = 0; job < 7; job++)
+            cull(job);
+    }
+
+    if (cull_static)
+    {
+        m_culling_nodes_tested = m_static_bvh.getNumNodesTested();
+        for (unsigned int i = 0; i < m_static_nodes.size(); i++)
+        {
+            if (m_static_visibility[i] == 0 ||
+                !m_static_nodes[i]->isVisible())
+                continue;
+            dynamic_cast<STKMeshCommon*>(m_static_nodes[i])->updateNoGL();
+            handleSTKCommon(m_static_nodes[i], &m_immediate_draw_list, cam,
+                            shadow_matrices, m_static_visibility[i]);
+        }
+    }
+    for (unsigned int n = 0; n < m_dynamic_nodes.size(); n++)
+    {
+        int culling_mask = 0;
+        for (unsigned int i = 0; i < 6; i++)
+            culling_mask |= m_dynamic_visibility[i][n] << i;
+        handleSTKCommon(m_dynamic_nodes[n], &m_immediate_draw_list, cam,
+                        shadow_matrices, culling_mask);
+    }
+}   // cullNodes
+
 // ----------------------------------------------------------------------------
  /** Prepare draw calls before scene rendering
  * \param[out] solid_poly_count Total number of polygons in objects 
@@ -625,6 +825,7 @@ void DrawCalls::prepareDrawCalls( ShadowMatrices& shadow_matrices,
                                   unsigned &solid_poly_count,
                                   unsigned &shadow_poly_count)
 {
+    const double prepare_start = StkTime::getRealTime();
     m_wind_dir = getWindDir();
     clearLists();
     m_mesh_for_skinning.clear();
@@ -638,18 +839,52 @@ void DrawCalls::prepareDrawCalls( ShadowMatrices& shadow_matrices,
 
     m_glow_pass_mesh.clear();
     m_deferred_update.clear();
+    m_dynamic_nodes.clear();
+    if (m_instance_batcher)
+        m_instance_batcher->clear();
 
     PROFILER_PUSH_CPU_MARKER("- culling", 0xFF, 0xFF, 0x0);
+    const double culling_start = StkTime::getRealTime();
+    m_culling_nodes_tested = 0;
+    // The bounding box visualization needs the boxes of all nodes
+    if (irr_driver->getBoundingBoxesViz())
+        m_static_node_set.clear();
+    else if (!m_static_nodes.empty() && m_static_node_set.empty())
+        m_static_node_set.insert(m_static_nodes.begin(), m_static_nodes.end());
     parseSceneManager(
         irr_driver->getSceneManager()->getRootSceneNode()->getChildren(),
-        &m_immediate_draw_list, camnode, shadow_matrices);
+        camnode);
+    cullNodes(camnode, shadow_matrices);
+    m_culling_time = StkTime::getRealTime() - culling_start;
+    PROFILER_POP_CPU_MARKER();
+
+    // While the joints are computed by the job system, this thread streams
+    // textures
+    TextureResidency *residency =
+        STKTexManager::getInstance()->getTextureResidency();
+    auto stream_textures = [residency]()
+    {
+        if (!residency)
+            return;
+        PROFILER_PUSH_CPU_MARKER("- Texture streaming", 0x0, 0x80, 0x80);
+        residency->update();
+        PROFILER_POP_CPU_MARKER();
+    };
+
+    const int32_t num_joints = getSkinningOffset();
+    irr_driver->setSkinningJoint(num_joints);
+    PROFILER_PUSH_CPU_MARKER("- Skinning", 0x80, 0x0, 0x80);
+    m_skinning_batch.animate(m_mesh_for_skinning, num_joints, stream_textures);
     PROFILER_POP_CPU_MARKER();
 
-    irr_driver->setSkinningJoint(getSkinningOffset());
+    // Wait for the GPU to release the buffers which are written below. This
+    // is not done while the joints are computed, since parallelFor() calls
+    // of other threads would wait for the GPU too.
     // Add a 1 s timeout
     if (!m_sync)
         m_sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
     PROFILER_PUSH_CPU_MARKER("- Sync Stall", 0xFF, 0x0, 0x0);
+    const double stall_start = StkTime::getRealTime();
     GLenum reason = glClientWaitSync(m_sync, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
 
     if (reason != GL_ALREADY_SIGNALED)
@@ -661,42 +896,67 @@ void DrawCalls::prepareDrawCalls( ShadowMatrices& shadow_matrices,
         while (reason == GL_TIMEOUT_EXPIRED);
     }
     glDeleteSync(m_sync);
+    m_sync = 0;
+    const double stall_time = StkTime::getRealTime() - stall_start;
     PROFILER_POP_CPU_MARKER();
 
-    /*    switch (reason)
-    {
-    case GL_ALREADY_SIGNALED:
-    printf("Already Signaled\n");
-    break;
-    case GL_TIMEOUT_EXPIRED:
-    printf("Timeout Expired\n");
-    break;
-    case GL_CONDITION_SATISFIED:
-    printf("Condition Satisfied\n");
-    break;
-    case GL_WAIT_FAILED:
-    printf("Wait Failed\n");
-    break;
-    }*/
-
     PROFILER_PUSH_CPU_MARKER("- Animations/Buffer upload", 0x0, 0x0, 0x0);
     for (unsigned i = 0; i < m_deferred_update.size(); i++)
         m_deferred_update[i]->updateGL();
     PROFILER_POP_CPU_MARKER();
 
+    if (m_instance_batcher)
+    {
+        PROFILER_PUSH_CPU_MARKER("- Instance batch upload", 0xFF, 0x0, 0xFF);
+        m_instance_batcher->upload();
+        PROFILER_POP_CPU_MARKER();
+    }
+
     if (!CVS->supportsIndirectInstancingRendering())
+    {
+        m_skinning_batch.upload();
+        m_prepare_time = StkTime::getRealTime() - prepare_start - stall_time;
         return;
+    }
 
 #if !defined(USE_GLES2)
     PROFILER_PUSH_CPU_MARKER("- Draw Command upload", 0xFF, 0x0, 0xFF);
-    m_solid_cmd_buffer->fill(m_solid_pass_mesh);
-    m_glow_cmd_buffer->fill(&m_glow_pass_mesh);
-
     irr_driver->setPhase(SHADOW_PASS);
-    m_shadow_cmd_buffer->fill(m_shadow_pass_mesh);
-    if (!shadow_matrices.isRSMMapAvail())
+    const bool fill_rsm = !shadow_matrices.isRSMMapAvail();
+    // Each command buffer has its own instance buffer, so they can be
+    // filled by different jobs
+    auto fill = [this, fill_rsm](unsigned int buffer)
+    {
+        switch (buffer)
+        {
+        case 0:
+            m_shadow_cmd_buffer->fill(m_shadow_pass_mesh);
+            break;
+        case 1:
+            m_solid_cmd_buffer->fill(m_solid_pass_mesh);
+            break;
+        case 2:
+            m_glow_cmd_buffer->fill(&m_glow_pass_mesh);
+            break;
+        case 3:
+            if (fill_rsm)
+                m_reflective_shadow_map_cmd_buffer->fill(m_reflective_shadow_map_mesh);
+            break;
+        }
+    };
+    auto upload_skinning = [this]() { m_skinning_batch.upload(); };
+    JobSystem *job_system = JobSystem::get();
+    // Without persistent mapping the buffers are mapped with OpenGL calls,
+    // so they must be filled by this thread
+    if (job_system && CVS->supportsAsyncInstanceUpload())
     {
-        m_reflective_shadow_map_cmd_buffer->fill(m_reflective_shadow_map_mesh);
+        job_system->parallelFor(4, fill, upload_skinning);
+    }
+    else
+    {
+        upload_skinning();
+        for (unsigned int buffer = 0; buffer < 4; buffer++)
+            fill(buffer);
     }
     PROFILER_POP_CPU_MARKER();
     solid_poly_count = m_solid_cmd_buffer->getPolyCount();
@@ -705,6 +965,7 @@ void DrawCalls::prepareDrawCalls( ShadowMatrices& shadow_matrices,
     if (CVS->supportsAsyncInstanceUpload())
         glMemoryBarrier(GL_CLIENT_MAPPED_BUFFER_BARRIER_BIT);
 #endif // !defined(USE_GLES2)
+    m_prepare_time = StkTime::getRealTime() - prepare_start - stall_time;
 }
 
 // ----------------------------------------------------------------------------
@@ -961,6 +1222,77 @@ void DrawCalls::multidrawGlow() const
 }
 #endif // !defined(USE_GLES2)
 
+// ----------------------------------------------------------------------------
+/** Render the solid first pass (depth and normals) of the meshes batched
+ *  into instanced draws. Requires instanced arrays.
+ */
+void DrawCalls::drawBatchedSolidFirstPass() const
+{
+    if (!m_instance_batcher)
+        return;
+    m_instance_batcher->drawFirstPass<DefaultMaterial>();
+    m_instance_batcher->drawFirstPass<AlphaRef>();
+    m_instance_batcher->drawFirstPass<UnlitMat>();
+    m_instance_batcher->drawFirstPass<SphereMap>();
+    m_instance_batcher->drawFirstPass<GrassMat>(m_wind_dir);
+    m_instance_batcher->drawFirstPass<DetailMat>();
+    m_instance_batcher->drawFirstPass<NormalMat>();
+}   // drawBatchedSolidFirstPass
+
+// ----------------------------------------------------------------------------
+/** Render the solid second pass (apply lighting on materials) of the meshes
+ *  batched into instanced draws. Requires instanced arrays.
+ *  \param prefilled_tex The textures which have been drawn
+ *                       during previous rendering passes.
+ */
+void DrawCalls::drawBatchedSolidSecondPass(const std::vector<GLuint> &prefilled_tex) const
+{
+    if (!m_instance_batcher)
+        return;
+    m_instance_batcher->drawSecondPass<DefaultMaterial>(prefilled_tex);
+    m_instance_batcher->drawSecondPass<AlphaRef>(prefilled_tex);
+    m_instance_batcher->drawSecondPass<UnlitMat>(prefilled_tex);
+    m_instance_batcher->drawSecondPass<SphereMap>(prefilled_tex);
+    m_instance_batcher->drawSecondPass<GrassMat>(prefilled_tex, m_wind_dir);
+    m_instance_batcher->drawSecondPass<DetailMat>(prefilled_tex);
+    m_instance_batcher->drawSecondPass<NormalMat>(prefilled_tex);
+}   // drawBatchedSolidSecondPass
+
+// ----------------------------------------------------------------------------
+/** Render the shadow map of the meshes batched into instanced draws.
+ *  \param cascade The id of the cascading shadow map.
+ */
+void DrawCalls::drawBatchedShadows(unsigned cascade) const
+{
+    if (!m_instance_batcher)
+        return;
+    m_instance_batcher->drawShadows<DefaultMaterial>(cascade);
+    m_instance_batcher->drawShadows<DetailMat>(cascade);
+    m_instance_batcher->drawShadows<AlphaRef>(cascade);
+    m_instance_batcher->drawShadows<UnlitMat>(cascade);
+    m_instance_batcher->drawShadows<GrassMat>(cascade, m_wind_dir);
+    m_instance_batcher->drawShadows<NormalMat>(cascade);
+    m_instance_batcher->drawShadows<SphereMap>(cascade);
+}   // drawBatchedShadows
+
+// ----------------------------------------------------------------------------
+/** Returns the number of objects drawn with instance batching in the last
+ *  frame, i.e. the number of draw calls needed without batching.
+ */
+unsigned int DrawCalls::getBatchedObjects() const
+{
+    return m_instance_batcher ? m_instance_batcher->getNumObjects() : 0;
+}   // getBatchedObjects
+
+// ----------------------------------------------------------------------------
+/** Returns the number of instanced draw calls used for the batched objects
+ *  in the last frame.
+ */
+unsigned int DrawCalls::getBatchedDraws() const
+{
+    return m_instance_batcher ? m_instance_batcher->getNumDraws() : 0;
+}   // getBatchedDraws
+
 // ----------------------------------------------------------------------------
 int32_t DrawCalls::getSkinningOffset() const
 {
@@ -19,13 +19,17 @@
 #define HEADER_DRAW_CALLS_HPP
 
 #ifndef SERVER_ONLY
+#include "graphics/culling_bvh.hpp"
 #include "graphics/material.hpp"
+#include "graphics/skinning_batch.hpp"
 #include "graphics/vao_manager.hpp"
 #include <irrlicht.h>
 #include <set>
 #include <unordered_map>
+#include <unordered_set>
 
 class GlowCommandBuffer;
+class InstanceBatcher;
 class ParticleSystemProxy;
 class ReflectiveShadowMapCommandBuffer;
 class ShadowMatrices;
@@ -46,9 +50,36 @@ private:
     std::vector<STKBillboard *>           m_billboard_list;
     std::vector<ParticleSystemProxy *>    m_particles_list;
     std::set<STKAnimatedMesh*>            m_mesh_for_skinning;
+    SkinningBatch                         m_skinning_batch;
 
     std::vector<float>                    m_bounding_boxes;
 
+    /** Scene nodes which never move (the main track meshes). They are
+     *  culled with m_static_bvh instead of walking the scene graph. */
+    std::vector<scene::ISceneNode *>        m_static_nodes;
+    std::unordered_set<scene::ISceneNode *> m_static_node_set;
+    CullingBVH                            m_static_bvh;
+    CullingBVH::Frusta                    m_frusta;
+    std::vector<uint8_t>                  m_static_visibility;
+
+    /** The other mesh nodes, collected while parsing the scene graph, and
+     *  their visibility for each of the 6 cameras (see cullNodes). */
+    std::vector<scene::ISceneNode *>      m_dynamic_nodes;
+    std::vector<uint8_t>                  m_dynamic_visibility[6];
+
+    /** Culling stats of the last frame: number of BVH nodes tested and
+     *  CPU time (in s) used for culling. */
+    unsigned int                          m_culling_nodes_tested;
+    double                                m_culling_time;
+
+    /** CPU time (in s) used by prepareDrawCalls in the last frame, without
+     *  waiting for the GPU. */
+    double                                m_prepare_time;
+
+    /** Batches identical meshes into instanced draws if the command
+     *  buffers are not available, NULL otherwise. */
+    InstanceBatcher                      *m_instance_batcher;
+
     /** meshes to draw */
     MeshMap m_solid_pass_mesh            [    Material::SHADERTYPE_COUNT];
     MeshMap m_shadow_pass_mesh           [4 * Material::SHADERTYPE_COUNT];
@@ -68,12 +99,14 @@ private:
     void handleSTKCommon(scene::ISceneNode *Node,
                          std::vector<scene::ISceneNode *> *ImmediateDraw,
                          const scene::ICameraSceneNode *cam,
-                         ShadowMatrices& shadow_matrices);
+                         ShadowMatrices& shadow_matrices,
+                         int culling_mask = -1);
+
+    void cullNodes(const scene::ICameraSceneNode *cam,
+                   ShadowMatrices& shadow_matrices);
 
     void parseSceneManager(core::list<scene::ISceneNode*> &List,
-                           std::vector<scene::ISceneNode *> *ImmediateDraw,
-                           const scene::ICameraSceneNode *cam,
-                           ShadowMatrices& shadow_matrices);
+                           const scene::ICameraSceneNode *cam);
 
     bool isCulledPrecise(const scene::ICameraSceneNode *cam,
                          const scene::ISceneNode* node,
@@ -92,6 +125,9 @@ public:
                           irr::scene::ICameraSceneNode *camnode,
                           unsigned &solid_poly_count,
                           unsigned &shadow_poly_count);
+
+    void setStaticNodes(const std::vector<scene::ISceneNode *> &nodes);
+    void clearStaticNodes();
                           
     void setFenceSync() { m_sync = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0); }
 
@@ -114,8 +150,26 @@ public:
     
     void drawIndirectGlow() const;
     void multidrawGlow() const;
+
+    void drawBatchedSolidFirstPass() const;
+    void drawBatchedSolidSecondPass(const std::vector<GLuint> &prefilled_tex) const;
+    void drawBatchedShadows(unsigned cascade) const;
     void renderBoundingBoxes();
     int32_t getSkinningOffset() const;
+    // ------------------------------------------------------------------------
+    /** Returns the number of BVH nodes tested in the last frame. */
+    unsigned int getCullingNodesTested() const { return m_culling_nodes_tested; }
+    // ------------------------------------------------------------------------
+    /** Returns the CPU time (in s) used for culling in the last frame. */
+    double getCullingTime() const { return m_culling_time; }
+    // ------------------------------------------------------------------------
+    /** Returns the CPU time (in s) used to prepare the draw calls in the last
+     *  frame, without the time waiting for the GPU. */
+    double getPrepareTime() const { return m_prepare_time; }
+    // ------------------------------------------------------------------------
+    unsigned int getBatchedObjects() const;
+    // ------------------------------------------------------------------------
+    unsigned int getBatchedDraws() const;
 };
 
 #endif   // !SERVER_ONLY
@@ -143,6 +143,7 @@ void GL3DrawPolicy::drawSolidFirstPass(const DrawCalls& draw_calls) const
     renderMeshes1stPass<NormalMat, 2, 1>();
     renderMeshes1stPass<SphereMap, 2, 1>();
     renderMeshes1stPass<DetailMat, 2, 1>();
+    draw_calls.drawBatchedSolidFirstPass();
 
     if (!CVS->supportsHardwareSkinning()) return;
     renderMeshes1stPass<SkinnedSolid, 5, 2, 1>();
@@ -164,6 +165,7 @@ void GL3DrawPolicy::drawSolidSecondPass (const DrawCalls& draw_calls,
     renderMeshes2ndPass<DetailMat,       1      > (handles, prefilled_tex);
     renderMeshes2ndPass<GrassMat,        4, 3, 1> (handles, prefilled_tex);
     renderMeshes2ndPass<NormalMat,       4, 3, 1> (handles, prefilled_tex);
+    draw_calls.drawBatchedSolidSecondPass(prefilled_tex);
 
     if (!CVS->supportsHardwareSkinning()) return;
     renderMeshes2ndPass<SkinnedSolid,     5, 4, 3, 1> (handles, prefilled_tex);
@@ -192,6 +194,7 @@ void GL3DrawPolicy::drawShadows(const DrawCalls& draw_calls, unsigned cascade) c
     renderShadow<AlphaRef, 1>(cascade);
     renderShadow<UnlitMat, 1>(cascade);
     renderShadow<GrassMat, 3, 1>(cascade);    
+    draw_calls.drawBatchedShadows(cascade);
 
     if (!CVS->supportsHardwareSkinning()) return;
     renderShadow<SkinnedSolid, 5, 1>(cascade);
@@ -0,0 +1,436 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef SERVER_ONLY
+
+#include "graphics/frame_capture.hpp"
+
+#include "config/user_config.hpp"
+#include "graphics/central_settings.hpp"
+#include "graphics/irr_driver.hpp"
+#include "modes/world.hpp"
+#include "states_screens/race_gui_base.hpp"
+#include "utils/log.hpp"
+#include "utils/profiler.hpp"
+#include "utils/string_utils.hpp"
+#include "utils/time.hpp"
+#include "utils/vs.hpp"
+
+#include <IImage.h>
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+/** Number of pixel buffer objects used for read back. A frame is read back
+ *  into the CPU only when its slot is reused, i.e. RING_SIZE-1 frames after
+ *  the read was issued, at which point the GPU has long finished it. */
+static const unsigned int RING_SIZE = 3;
+
+// ----------------------------------------------------------------------------
+FrameCapture::FrameCapture()
+{
+    m_ring_index       = 0;
+    m_pbo_size         = 0;
+    m_jobs_in_progress = 0;
+    m_abort            = false;
+    m_capture_interval = 0;
+    m_frame_count      = 0;
+    m_frame_number     = 0;
+    m_sequence_format  = CF_PNG;
+    m_stat_frames      = 0;
+    m_stat_main_thread_time = 0.0;
+    m_stat_wait_time   = 0.0;
+    m_use_pbo = CVS->isGLSL() && CVS->isARBPixelBufferObjectUsable();
+
+    m_max_queue_size =
+        std::max(1, (int)UserConfigParams::m_frame_capture_queue_size);
+}   // FrameCapture
+
+// ----------------------------------------------------------------------------
+/** Starts the encoder threads. This is only done when the first frame is
+ *  captured, so no threads are running if capture is never used.
+ */
+void FrameCapture::startEncoders()
+{
+    int threads = UserConfigParams::m_frame_capture_threads;
+    if (threads <= 0)
+    {
+        threads = std::max(1, (int)std::thread::hardware_concurrency() - 1);
+        threads = std::min(threads, 4);
+    }
+    for (int i = 0; i < threads; i++)
+        m_encoders.push_back(std::thread(&FrameCapture::encoderThread, this,
+                                         i));
+    Log::info("FrameCapture", "%d encoder thread(s), %s read back.",
+              threads, m_use_pbo ? "asynchronous" : "synchronous");
+}   // startEncoders
+
+// ----------------------------------------------------------------------------
+/** Writes all pending frames and stops the encoder threads (if they were
+ *  started).
+ */
+FrameCapture::~FrameCapture()
+{
+    flush();
+    std::unique_lock<std::mutex> ul(m_queue_mutex);
+    m_abort = true;
+    m_cv_job_added.notify_all();
+    ul.unlock();
+    for (unsigned int i = 0; i < m_encoders.size(); i++)
+        m_encoders[i].join();
+    destroyRing();
+}   // ~FrameCapture
+
+// ----------------------------------------------------------------------------
+void FrameCapture::createRing(unsigned int width, unsigned int height)
+{
+    destroyRing();
+    m_pbo_size = width * height * 4;
+    m_ring.resize(RING_SIZE);
+    for (unsigned int i = 0; i < RING_SIZE; i++)
+    {
+        PBOSlot &slot = m_ring[i];
+        slot.m_in_use = false;
+        glGenBuffers(1, &slot.m_pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.m_pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, m_pbo_size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    m_ring_index = 0;
+}   // createRing
+
+// ----------------------------------------------------------------------------
+void FrameCapture::destroyRing()
+{
+    for (unsigned int i = 0; i < m_ring.size(); i++)
+        glDeleteBuffers(1, &m_ring[i].m_pbo);
+    m_ring.clear();
+    m_pbo_size = 0;
+}   // destroyRing
+
+// ----------------------------------------------------------------------------
+/** Requests a single screenshot which is saved to the given path. The path
+ *  extension is ignored, the image is always written as PNG.
+ */
+void FrameCapture::requestScreenshot(const std::string &path)
+{
+    startReadback(path, CF_PNG, /*notify*/true);
+}   // requestScreenshot
+
+// ----------------------------------------------------------------------------
+/** Starts capturing every n-th frame into a numbered sequence of files.
+ *  \param name Base name of the files, including the directory.
+ *  \param interval Capture every interval-th frame.
+ *  \param format Output format.
+ */
+void FrameCapture::startSequence(const std::string &name,
+                                 unsigned int interval, CaptureFormat format)
+{
+    m_sequence_name         = name;
+    m_capture_interval      = std::max(1u, interval);
+    m_sequence_format       = format;
+    m_frame_count           = 0;
+    m_stat_frames           = 0;
+    m_stat_main_thread_time = 0.0;
+    m_stat_wait_time        = 0.0;
+    Log::info("FrameCapture", "Capturing every %d. frame to '%s'.",
+              m_capture_interval, name.c_str());
+}   // startSequence
+
+// ----------------------------------------------------------------------------
+/** Stops capturing a frame sequence and prints the main thread costs.
+ */
+void FrameCapture::stopSequence()
+{
+    if (m_capture_interval == 0) return;
+    m_capture_interval = 0;
+    flush();
+    if (m_stat_frames == 0) return;
+    Log::info("FrameCapture", "Captured %d frames, main thread %.3f ms per "
+              "frame, of which %.3f ms waiting for encoders.", m_stat_frames,
+              m_stat_main_thread_time / m_stat_frames,
+              m_stat_wait_time / m_stat_frames);
+}   // stopSequence
+
+// ----------------------------------------------------------------------------
+/** Called once per frame after the scene was rendered. Starts a read back
+ *  if a sequence frame is due, and reports finished screenshots.
+ */
+void FrameCapture::update()
+{
+    if (m_capture_interval > 0)
+    {
+        if (m_frame_count % m_capture_interval == 0)
+        {
+            PROFILER_PUSH_CPU_MARKER("- Frame capture", 0x0, 0x50, 0x40);
+            double start = StkTime::getRealTime();
+            char number[16];
+            snprintf(number, 16, "-%06u", m_frame_count / m_capture_interval);
+            std::string path = m_sequence_name + number
+                             + getExtension(m_sequence_format);
+            startReadback(path, m_sequence_format, /*notify*/false);
+            m_stat_main_thread_time += (StkTime::getRealTime()-start)*1000.0;
+            m_stat_frames++;
+            PROFILER_POP_CPU_MARKER();
+        }
+        m_frame_count++;
+    }
+
+    // Collect read backs which were not picked up by reusing their slot,
+    // e.g. single screenshots.
+    for (unsigned int i = 0; i < m_ring.size(); i++)
+    {
+        PBOSlot &slot = m_ring[(m_ring_index + i) % m_ring.size()];
+        if (slot.m_in_use && m_frame_number - slot.m_frame >= RING_SIZE - 1)
+            finishReadback(&slot);
+    }
+    m_frame_number++;
+    reportResults();
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Issues the read back of the current frame buffer. With PBOs the pixels
+ *  of the oldest slot in the ring are collected first (if that slot is in
+ *  use), before the slot is reused for the current frame.
+ */
+void FrameCapture::startReadback(const std::string &path,
+                                 CaptureFormat format, bool notify)
+{
+    const core::dimension2du &size =
+        irr_driver->getVideoDriver()->getScreenSize();
+
+    CaptureJob job;
+    job.m_path   = path;
+    job.m_width  = size.Width;
+    job.m_height = size.Height;
+    job.m_format = format;
+    job.m_notify = notify;
+
+    if (!m_use_pbo)
+    {
+        job.m_pixels.resize(size.Width * size.Height * 4);
+        glPixelStorei(GL_PACK_ALIGNMENT, 1);
+        glReadPixels(0, 0, size.Width, size.Height, GL_RGBA,
+                     GL_UNSIGNED_BYTE, job.m_pixels.data());
+        glPixelStorei(GL_PACK_ALIGNMENT, 4);
+        enqueue(job);
+        return;
+    }
+
+    if (m_pbo_size != size.Width * size.Height * 4)
+    {
+        // Resolution was changed, collect outstanding frames first
+        flush();
+        createRing(size.Width, size.Height);
+    }
+
+    PBOSlot &slot = m_ring[m_ring_index];
+    if (slot.m_in_use)
+        finishReadback(&slot);
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.m_pbo);
+    glReadPixels(0, 0, size.Width, size.Height, GL_RGBA, GL_UNSIGNED_BYTE,
+                 0);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    slot.m_job    = job;
+    slot.m_frame  = m_frame_number;
+    slot.m_in_use = true;
+    m_ring_index  = (m_ring_index + 1) % RING_SIZE;
+}   // startReadback
+
+// ----------------------------------------------------------------------------
+/** Maps the pixel buffer object of a slot, copies the pixels into the job
+ *  and hands the job to the encoder threads.
+ */
+void FrameCapture::finishReadback(PBOSlot *slot)
+{
+    CaptureJob &job = slot->m_job;
+    const unsigned int size = job.m_width * job.m_height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->m_pbo);
+    const uint8_t *ptr = (const uint8_t*)glMapBufferRange(GL_PIXEL_PACK_BUFFER,
+        0, size, GL_MAP_READ_BIT);
+    if (ptr)
+    {
+        job.m_pixels.assign(ptr, ptr + size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    slot->m_in_use = false;
+    if (!ptr)
+    {
+        Log::error("FrameCapture", "Could not map read back buffer for '%s'.",
+                   job.m_path.c_str());
+        return;
+    }
+    enqueue(job);
+}   // finishReadback
+
+// ----------------------------------------------------------------------------
+/** Adds a job to the encoder queue, and starts the encoder threads with
+ *  the first job. If the queue is full this blocks until an encoder thread
+ *  takes a job.
+ */
+void FrameCapture::enqueue(CaptureJob &job)
+{
+    if (m_encoders.empty())
+        startEncoders();
+    std::unique_lock<std::mutex> ul(m_queue_mutex);
+    if (m_queue.size() >= m_max_queue_size)
+    {
+        double start = StkTime::getRealTime();
+        m_cv_job_done.wait(ul, [this]()
+            { return m_queue.size() < m_max_queue_size; });
+        m_stat_wait_time += (StkTime::getRealTime() - start) * 1000.0;
+    }
+    m_queue.push_back(CaptureJob());
+    std::swap(m_queue.back(), job);
+    m_cv_job_added.notify_one();
+}   // enqueue
+
+// ----------------------------------------------------------------------------
+/** Collects all frames still in the read back ring, and waits until all
+ *  queued frames are written. Must be called before the video driver is
+ *  destroyed.
+ */
+void FrameCapture::flush()
+{
+    for (unsigned int i = 0; i < m_ring.size(); i++)
+    {
+        // Oldest slot first to keep the order of a sequence
+        PBOSlot &slot = m_ring[(m_ring_index + i) % m_ring.size()];
+        if (slot.m_in_use)
+            finishReadback(&slot);
+    }
+    std::unique_lock<std::mutex> ul(m_queue_mutex);
+    m_cv_job_done.wait(ul, [this]()
+        { return m_queue.empty() && m_jobs_in_progress == 0; });
+    ul.unlock();
+    reportResults();
+}   // flush
+
+// ----------------------------------------------------------------------------
+void FrameCapture::encoderThread(int index)
+{
+    VS::setThreadName((std::string("FrameCapture") +
+                       StringUtils::toString(index)).c_str());
+    while (true)
+    {
+        std::unique_lock<std::mutex> ul(m_queue_mutex);
+        m_cv_job_added.wait(ul, [this]()
+            { return m_abort || !m_queue.empty(); });
+        if (m_queue.empty())
+            return;
+        CaptureJob job;
+        std::swap(job, m_queue.front());
+        m_queue.pop_front();
+        m_jobs_in_progress++;
+        ul.unlock();
+        m_cv_job_done.notify_all();
+
+        CaptureResult result;
+        result.m_path    = job.m_path;
+        result.m_notify  = job.m_notify;
+        result.m_success = encode(job);
+
+        ul.lock();
+        m_jobs_in_progress--;
+        m_results.push_back(result);
+        ul.unlock();
+        m_cv_job_done.notify_all();
+    }
+}   // encoderThread
+
+// ----------------------------------------------------------------------------
+/** Converts the RGBA bottom-up pixels of a job into top-down RGB and writes
+ *  them to disk. Called on an encoder thread.
+ */
+bool FrameCapture::encode(CaptureJob &job)
+{
+    const unsigned int w = job.m_width;
+    const unsigned int h = job.m_height;
+    std::vector<uint8_t> rgb(w * h * 3);
+    for (unsigned int y = 0; y < h; y++)
+    {
+        const uint8_t *src = job.m_pixels.data() + (h - 1 - y) * w * 4;
+        uint8_t *dst = rgb.data() + y * w * 3;
+        for (unsigned int x = 0; x < w; x++)
+        {
+            dst[0] = src[0];
+            dst[1] = src[1];
+            dst[2] = src[2];
+            dst += 3;
+            src += 4;
+        }
+    }
+    // Free the read back memory as early as possible
+    std::vector<uint8_t>().swap(job.m_pixels);
+
+    if (job.m_format == CF_RAW)
+    {
+        FILE *f = fopen(job.m_path.c_str(), "wb");
+        if (!f) return false;
+        fprintf(f, "P6\n%u %u\n255\n", w, h);
+        bool ok = fwrite(rgb.data(), 1, rgb.size(), f) == rgb.size();
+        return fclose(f) == 0 && ok;
+    }
+
+    // The image only references the pixels, irrlicht's image writers are
+    // stateless so they can be used from this thread.
+    video::IVideoDriver *driver = irr_driver->getVideoDriver();
+    video::IImage *image = driver->createImageFromData(video::ECF_R8G8B8,
+        core::dimension2du(w, h), rgb.data(), /*ownForeignMemory*/true,
+        /*deleteMemory*/false);
+    if (!image) return false;
+    bool ok = driver->writeImageToFile(image, job.m_path.c_str(), 0);
+    image->drop();
+    return ok;
+}   // encode
+
+// ----------------------------------------------------------------------------
+/** Shows the result of finished screenshots in the race gui. Called on the
+ *  main thread.
+ */
+void FrameCapture::reportResults()
+{
+    std::unique_lock<std::mutex> ul(m_queue_mutex);
+    if (m_results.empty()) return;
+    std::vector<CaptureResult> results;
+    std::swap(results, m_results);
+    ul.unlock();
+
+    RaceGUIBase* base = World::getWorld()
+                      ? World::getWorld()->getRaceGUI() : NULL;
+    for (unsigned int i = 0; i < results.size(); i++)
+    {
+        const CaptureResult &r = results[i];
+        if (!r.m_success)
+        {
+            Log::error("FrameCapture", "Could not write '%s'.",
+                       r.m_path.c_str());
+        }
+        if (!r.m_notify || !base) continue;
+        std::string msg = r.m_success
+                        ? "Screenshot saved to\n" + r.m_path
+                        : "FAILED saving screenshot to\n" + r.m_path + "\n:(";
+        base->addMessage(core::stringw(msg.c_str()), NULL, 2.0f,
+                         video::SColor(255,255,255,255), true, false);
+    }
+}   // reportResults
+
+#endif   // !SERVER_ONLY
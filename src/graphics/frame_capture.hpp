@@ -0,0 +1,183 @@
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_FRAME_CAPTURE_HPP
+#define HEADER_FRAME_CAPTURE_HPP
+
+#ifndef SERVER_ONLY
+
+#include "graphics/gl_headers.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+  * \brief Asynchronous screenshot and frame sequence writer.
+  *  The frame buffer is read back into a ring of pixel buffer objects, so
+  *  the main thread never waits for the GPU. The pixels of a completed read
+  *  back are handed to a pool of encoder threads through a bounded queue.
+  *  If the encoders can not keep up the main thread blocks when adding a new
+  *  frame (back-pressure), so no frame of a sequence is ever dropped.
+  *  If pixel buffer objects are not usable the read back is done
+  *  synchronously, but encoding still happens in the background.
+  * \ingroup graphics
+  */
+class FrameCapture : public NoCopy
+{
+public:
+    /** Output format of captured frames. */
+    enum CaptureFormat
+    {
+        CF_PNG,
+        /** Uncompressed binary PPM, much cheaper to write than PNG. */
+        CF_RAW
+    };
+
+private:
+    /** One frame which is waiting to be encoded, or which is waiting in a
+     *  pixel buffer object to be read back. */
+    struct CaptureJob
+    {
+        /** Tightly packed RGBA pixels, bottom row first (as OpenGL). */
+        std::vector<uint8_t> m_pixels;
+        std::string          m_path;
+        unsigned int         m_width;
+        unsigned int         m_height;
+        CaptureFormat        m_format;
+        /** True if this is a user screenshot, i.e. the result is shown
+         *  in the race gui. */
+        bool                 m_notify;
+    };
+
+    /** Result of an encoding job, reported on the main thread. */
+    struct CaptureResult
+    {
+        std::string m_path;
+        bool        m_success;
+        bool        m_notify;
+    };
+
+    /** A slot of the read back ring. */
+    struct PBOSlot
+    {
+        GLuint       m_pbo;
+        /** Frame number at which the read back was issued. */
+        unsigned int m_frame;
+        CaptureJob   m_job;
+        bool         m_in_use;
+    };
+
+    /** Ring of pixel buffer objects used for asynchronous read back. */
+    std::vector<PBOSlot>     m_ring;
+
+    /** Index of the next ring slot to use. */
+    unsigned int             m_ring_index;
+
+    /** Size in bytes each pixel buffer object was allocated with. */
+    unsigned int             m_pbo_size;
+
+    /** True if the PBO based read back path is used. */
+    bool                     m_use_pbo;
+
+    /** All encoder threads, empty until the first frame is captured. */
+    std::vector<std::thread> m_encoders;
+
+    /** Frames waiting to be encoded. */
+    std::deque<CaptureJob>   m_queue;
+
+    /** Maximum number of frames in m_queue. */
+    unsigned int             m_max_queue_size;
+
+    /** Number of jobs that are currently encoded. */
+    unsigned int             m_jobs_in_progress;
+
+    /** Protects m_queue, m_results, m_jobs_in_progress and m_abort. */
+    std::mutex               m_queue_mutex;
+
+    /** Signalled when a job was added to the queue (or on abort). */
+    std::condition_variable  m_cv_job_added;
+
+    /** Signalled when an encoder took a job or finished it. */
+    std::condition_variable  m_cv_job_done;
+
+    /** Results which have not been reported yet. */
+    std::vector<CaptureResult> m_results;
+
+    /** Set to tell the encoder threads to exit. */
+    bool                     m_abort;
+
+    /** Capture every n-th frame if > 0. */
+    unsigned int             m_capture_interval;
+
+    /** Counts all frames, used to decide when a read back is complete. */
+    unsigned int             m_frame_number;
+
+    /** Frames counted since sequence capture was started. */
+    unsigned int             m_frame_count;
+
+    /** Base name (including directory) of a frame sequence. */
+    std::string              m_sequence_name;
+
+    /** Format used for a frame sequence. */
+    CaptureFormat            m_sequence_format;
+
+    /** Statistics: frames captured since the sequence started, time (in ms)
+     *  spent on the main thread, and time spent waiting for the encoders. */
+    unsigned int             m_stat_frames;
+    double                   m_stat_main_thread_time;
+    double                   m_stat_wait_time;
+
+    void     startReadback(const std::string &path, CaptureFormat format,
+                           bool notify);
+    void     finishReadback(PBOSlot *slot);
+    void     startEncoders();
+    void     enqueue(CaptureJob &job);
+    void     encoderThread(int index);
+    bool     encode(CaptureJob &job);
+    void     reportResults();
+    void     createRing(unsigned int width, unsigned int height);
+    void     destroyRing();
+
+public:
+             FrameCapture();
+            ~FrameCapture();
+    void     requestScreenshot(const std::string &path);
+    void     startSequence(const std::string &name, unsigned int interval,
+                           CaptureFormat format);
+    void     stopSequence();
+    void     update();
+    void     flush();
+    // ------------------------------------------------------------------------
+    /** Returns true if a frame sequence is currently captured. */
+    bool     isCapturingSequence() const    { return m_capture_interval > 0; }
+    // ------------------------------------------------------------------------
+    /** Returns the file extension used for the given format. */
+    static const char* getExtension(CaptureFormat format)
+    {
+        return format == CF_PNG ? ".png" : ".ppm";
+    }   // getExtension
+};   // FrameCapture
+
+#endif   // !SERVER_ONLY
+
+#endif
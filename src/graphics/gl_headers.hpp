@@ -73,6 +73,15 @@ inline void glDrawElementsBaseVertex(GLenum mode, GLsizei count, GLenum type,
 {
     glDrawElements(mode, count, type, indices);
 }
+
+inline void glDrawElementsInstancedBaseVertex(GLenum mode, GLsizei count,
+                                              GLenum type,
+                                              const GLvoid *indices,
+                                              GLsizei instancecount,
+                                              GLint basevertex)
+{
+    glDrawElementsInstanced(mode, count, type, indices, instancecount);
+}
 #endif
 
 struct DrawElementsIndirectCommand{
@@ -44,7 +44,7 @@ namespace GraphicsRestrictions
         /** The list of names used in the XML file for the graphics
          *  restriction types. They must be in the same order as the types. */
 
-        std::array<std::string, 28> m_names_of_restrictions = {
+        std::array<std::string, 31> m_names_of_restrictions = {
             "UniformBufferObject",
             "GeometryShader",
             "DrawIndirect",
@@ -72,7 +72,10 @@ namespace GraphicsRestrictions
             "FramebufferSRGBCapable",
             "GI",
             "ForceLegacyDevice",
-            "VertexIdWorking"
+            "VertexIdWorking",
+            "ProgramBinary",
+            "InstancedArrays",
+            "VertexType2101010Rev"
         };
     }   // namespace Private
     using namespace Private;
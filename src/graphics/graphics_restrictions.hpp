@@ -62,6 +62,9 @@ namespace GraphicsRestrictions
         GR_GI,
         GR_FORCE_LEGACY_DEVICE,
         GR_VERTEX_ID_WORKING,
+        GR_PROGRAM_BINARY,
+        GR_INSTANCED_ARRAYS,
+        GR_VERTEX_TYPE_2101010_REV,
         GR_COUNT  /** MUST be last entry. */
     } ;
 
@@ -19,6 +19,7 @@
 #ifndef HEADER_HIT_EFFECT_HPP
 #define HEADER_HIT_EFFECT_HPP
 
+#include "utils/memory_pool.hpp"
 #include "utils/no_copy.hpp"
 
 class Vec3;
@@ -37,6 +38,8 @@ private:
     bool m_local_player_kart_hit;
 
 public:
+    POOL_ALLOCATED("HitEffect")
+
                  /** Constructor for a hit effect. */
                  HitEffect() {m_local_player_kart_hit = false; }
     virtual     ~HitEffect() {}
@@ -19,12 +19,20 @@
 
 #include "graphics/hq_mipmap_generator.hpp"
 #include "graphics/stk_tex_manager.hpp"
+#include "utils/job_system.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
 #undef DUMP_MIPMAP
 #ifdef DUMP_MIPMAP
 #include "graphics/irr_driver.hpp"
 #include "utils/string_utils.hpp"
 #endif
+#include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 
 extern "C"
 {
@@ -32,13 +40,25 @@ extern "C"
     #include <mipmap/imgresize.h>
 }
 
+namespace
+{
+    /** Identifies a file of the mipmap cache ("STKM"). */
+    const uint32_t MIPMAP_CACHE_MAGIC   = 0x4d4b5453;
+    /** Must be increased if the file format or the filters change. */
+    const uint32_t MIPMAP_CACHE_VERSION = 1;
+    /** Number of output rows filtered by one job. */
+    const int      TILE_ROWS            = 32;
+    /** Smallest mipmap level (in pixels) which is split into jobs. */
+    const int      MIN_PARALLEL_PIXELS  = 128 * 128;
+}   // namespace
+
 // ----------------------------------------------------------------------------
 HQMipmapGenerator::HQMipmapGenerator(const io::path& name, uint8_t* data,
                                      const core::dimension2d<u32>& size,
                                      GLuint texture_name, TexConfig* tc)
                  : video::ITexture(name), m_orig_data(data), m_size(size),
                    m_texture_name(texture_name), m_texture_size(0),
-                   m_mipmap_data(NULL), m_tex_config(tc)
+                   m_tex_config(tc)
 {
     assert(m_tex_config != NULL);
     unsigned width = m_size.Width;
@@ -54,43 +74,251 @@ HQMipmapGenerator::HQMipmapGenerator(const io::path& name, uint8_t* data,
             break;
     }
     m_texture_size = unsigned(m_mipmap_sizes.back().second) + 4;
-    m_mipmap_data = malloc(sizeof(imMipmapCascade));
 }   // HQMipmapGenerator
 
 // ----------------------------------------------------------------------------
-void HQMipmapGenerator::threadedReload(void* ptr, void* param) const
+/** Returns the image reduction filter (IM_REDUCE_FILTER_*) to use for this
+ *  texture. */
+int HQMipmapGenerator::getFilter() const
+{
+    return m_tex_config->m_normal_map ? IM_REDUCE_FILTER_NORMALMAP :
+        m_tex_config->m_srgb ? IM_REDUCE_FILTER_SRGB : IM_REDUCE_FILTER_LINEAR;
+}   // getFilter
+
+// ----------------------------------------------------------------------------
+/** Creates all mipmap levels. This uses the same source level and method for
+ *  each level as imBuildMipmapCascade(), but the levels are written directly
+ *  into one buffer, and levels reduced by the Kaiser filter are split into
+ *  tiles of rows which are filtered in parallel.
+ *  \param mipmaps Buffer for all levels (see m_mipmap_sizes), which is also
+ *         read from, so it must not be the write only pixel buffer.
+ *  \return False if the filter does not support the texture.
+ */
+bool HQMipmapGenerator::generateMipmaps(uint8_t* mipmaps) const
 {
     imReduceOptions options;
-    imReduceSetOptions(&options,
-        m_tex_config->m_normal_map ?
-        IM_REDUCE_FILTER_NORMALMAP: m_tex_config->m_srgb ?
-        IM_REDUCE_FILTER_SRGB : IM_REDUCE_FILTER_LINEAR/*filter*/,
-        2/*hopcount*/, 2.0f/*alpha*/, 1.0f/*amplifynormal*/,
-        0.0f/*normalsustainfactor*/);
-    imMipmapCascade* mm_cascade = (imMipmapCascade*)m_mipmap_data;
-#ifdef DEBUG
-    int ret = imBuildMipmapCascade(mm_cascade, m_orig_data, m_size.Width,
-        m_size.Height, 1/*layercount*/, 4, m_size.Width * 4, &options, 0);
-    assert(ret == 1);
-#else
-    imBuildMipmapCascade(mm_cascade, m_orig_data, m_size.Width,
-        m_size.Height, 1/*layercount*/, 4, m_size.Width * 4, &options, 0);
-#endif
-    for (unsigned int i = 0; i < m_mipmap_sizes.size(); i++)
+    imReduceSetOptions(&options, getFilter(), 2/*hopcount*/, 2.0f/*alpha*/,
+        1.0f/*amplifynormal*/, 0.0f/*normalsustainfactor*/);
+    const int width = m_size.Width;
+    const int height = m_size.Height;
+    JobSystem* job_system = JobSystem::get();
+    for (int level = 1; level <= (int)m_mipmap_sizes.size(); level++)
+    {
+        const int level_width = m_mipmap_sizes[level - 1].first.Width;
+        const int level_height = m_mipmap_sizes[level - 1].first.Height;
+        uint8_t* dst = mipmaps + m_mipmap_sizes[level - 1].second;
+
+        // Larger levels are reduced by the Kaiser filter from two levels
+        // above, the smallest ones with a box filter from the level above
+        int src_level = level - 1;
+        int method = 0;
+        if ((level_width | level_height) >= 16)
+        {
+            src_level = std::max(level - 2, 0);
+            method = 1;
+        }
+        const int src_width = std::max(width >> src_level, 1);
+        const int src_height = std::max(height >> src_level, 1);
+        uint8_t* src = src_level == 0 ? m_orig_data :
+            mipmaps + m_mipmap_sizes[src_level - 1].second;
+        const int divisor = 1 << (level - src_level);
+        if (level_width * divisor != src_width ||
+            level_height * divisor != src_height)
+            method = 2;
+
+        if (method == 2)
+        {
+            if (!imReduceImageKaiserData(dst, src, src_width, src_height, 4,
+                src_width * 4, level_width, level_height, &options))
+                return false;
+        }
+        else if (method == 1)
+        {
+            const int tiles = (level_height + TILE_ROWS - 1) / TILE_ROWS;
+            if (level_width * level_height < MIN_PARALLEL_PIXELS ||
+                tiles < 2 || !job_system || job_system->getNumThreads() < 2)
+            {
+                if (!imReduceImageKaiserDataDivisor(dst, src, src_width,
+                    src_height, 4, src_width * 4, divisor, &options))
+                    return false;
+                continue;
+            }
+            std::atomic<bool> ok(true);
+            job_system->parallelFor(tiles, [&](unsigned int tile)
+                {
+                    if (!imReduceImageKaiserDataDivisorRows(dst, src,
+                        src_width, src_height, 4, src_width * 4, divisor,
+                        &options, tile * TILE_ROWS, TILE_ROWS))
+                        ok = false;
+                });
+            if (!ok)
+                return false;
+        }
+        else
+        {
+            if (!imReduceImageHalfBoxData(dst, src, src_width, src_height, 4,
+                src_width * 4, &options))
+                return false;
+        }
+    }
+    return true;
+}   // generateMipmaps
+
+// ----------------------------------------------------------------------------
+/** Returns the key of this texture in the mipmap cache: a hash of the size,
+ *  the filter and the texture data. */
+uint64_t HQMipmapGenerator::getCacheHash() const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    const uint64_t key[4] = { MIPMAP_CACHE_VERSION, m_size.Width,
+                              m_size.Height, (uint64_t)getFilter() };
+    for (uint64_t k : key)
+    {
+        hash ^= k;
+        hash *= 1099511628211ULL;
+    }
+    // Hash 8 bytes at once. Level 0 has 4 bytes per texel, so if the
+    // number of texels is odd the last 4 bytes are hashed separately.
+    const size_t bytes = size_t(m_size.Width) * m_size.Height * 4;
+    const size_t words = bytes / 8;
+    for (size_t i = 0; i < words; i++)
+    {
+        uint64_t word;
+        memcpy(&word, m_orig_data + i * 8, 8);
+        hash ^= word;
+        hash *= 1099511628211ULL;
+    }
+    for (size_t i = words * 8; i < bytes; i++)
+    {
+        hash ^= m_orig_data[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}   // getCacheHash
+
+// ----------------------------------------------------------------------------
+/** Reads all mipmap levels from the mipmap cache. The file format is:<br>
+ *  <magic><version><hash><width><height><filter><size><all levels>
+ *  \param ptr Buffer for all levels.
+ *  \param file Name of the cache file.
+ *  \param hash Key of the texture.
+ *  \return False if the file does not exist or is invalid.
+ */
+bool HQMipmapGenerator::loadCachedMipmaps(uint8_t* ptr,
+                                          const std::string& file,
+                                          uint64_t hash) const
+{
+    std::ifstream ifs(file.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return false;
+
+    uint32_t magic = 0, version = 0, width = 0, height = 0, filter = 0;
+    uint32_t size = 0;
+    uint64_t file_hash = 0;
+    ifs.read((char*)&magic,     sizeof(uint32_t));
+    ifs.read((char*)&version,   sizeof(uint32_t));
+    ifs.read((char*)&file_hash, sizeof(uint64_t));
+    ifs.read((char*)&width,     sizeof(uint32_t));
+    ifs.read((char*)&height,    sizeof(uint32_t));
+    ifs.read((char*)&filter,    sizeof(uint32_t));
+    ifs.read((char*)&size,      sizeof(uint32_t));
+    if (!ifs.good() || magic != MIPMAP_CACHE_MAGIC ||
+        version != MIPMAP_CACHE_VERSION || file_hash != hash ||
+        width != m_size.Width || height != m_size.Height ||
+        filter != (uint32_t)getFilter() || size != m_texture_size)
+        return false;
+    ifs.read((char*)ptr, size);
+    return ifs.good();
+}   // loadCachedMipmaps
+
+// ----------------------------------------------------------------------------
+/** Saves all mipmap levels in the mipmap cache, see loadCachedMipmaps().
+ *  The file is written under a temporary name first, so that other loader
+ *  threads never read a partial file.
+ */
+void HQMipmapGenerator::saveCachedMipmaps(const uint8_t* mipmaps,
+                                          const std::string& file,
+                                          uint64_t hash) const
+{
+    char suffix[32];
+    sprintf(suffix, ".%p.tmp", (const void*)this);
+    const std::string tmp_file = file + suffix;
     {
-        const unsigned size = m_mipmap_sizes[i].first.getArea() *  4;
-        memcpy((uint8_t*)ptr + m_mipmap_sizes[i].second,
-            mm_cascade->mipmap[i + 1], size);
+        std::ofstream ofs(tmp_file.c_str(), std::ios::out | std::ios::binary);
+        if (!ofs.is_open())
+            return;
+        const uint32_t width = m_size.Width;
+        const uint32_t height = m_size.Height;
+        const uint32_t filter = getFilter();
+        const uint32_t size = m_texture_size;
+        ofs.write((char*)&MIPMAP_CACHE_MAGIC,   sizeof(uint32_t));
+        ofs.write((char*)&MIPMAP_CACHE_VERSION, sizeof(uint32_t));
+        ofs.write((char*)&hash,                 sizeof(uint64_t));
+        ofs.write((char*)&width,                sizeof(uint32_t));
+        ofs.write((char*)&height,               sizeof(uint32_t));
+        ofs.write((char*)&filter,               sizeof(uint32_t));
+        ofs.write((char*)&size,                 sizeof(uint32_t));
+        ofs.write((const char*)mipmaps, size);
+        if (!ofs.good())
+        {
+            ofs.close();
+            remove(tmp_file.c_str());
+            return;
+        }
+    }
+    // Fails on windows if another thread saved the same texture meanwhile
+    if (rename(tmp_file.c_str(), file.c_str()) != 0)
+        remove(tmp_file.c_str());
+}   // saveCachedMipmaps
+
+// ----------------------------------------------------------------------------
+void HQMipmapGenerator::threadedReload(void* ptr, void* param) const
+{
+    STKTexManager* stm = (STKTexManager*)param;
+    const double start = StkTime::getRealTime();
+    const std::string& cache_dir = stm->getMipmapCacheDir();
+    std::string cache_file;
+    uint64_t hash = 0;
+    if (!cache_dir.empty())
+    {
+        hash = getCacheHash();
+        char name[32];
+        sprintf(name, "%016llx.mip", (unsigned long long)hash);
+        cache_file = cache_dir + name;
+        if (loadCachedMipmaps((uint8_t*)ptr, cache_file, hash))
+        {
+            stm->addMipmapTime(true/*cached*/,
+                StkTime::getRealTime() - start);
+            return;
+        }
+    }
+
+    // The pixel buffer is mapped write only, so the levels are created in
+    // memory first, because smaller levels are reduced from larger ones
+    uint8_t* mipmaps = new uint8_t[m_texture_size];
+    if (!generateMipmaps(mipmaps))
+    {
+        Log::warn("HQMipmapGenerator", "Failed to create the mipmaps of %s.",
+            NamedPath.getPtr());
+        cache_file = "";
+    }
+    memcpy(ptr, mipmaps, m_texture_size);
+    if (!cache_file.empty())
+        saveCachedMipmaps(mipmaps, cache_file, hash);
 #ifdef DUMP_MIPMAP
+    for (unsigned int i = 0; i < m_mipmap_sizes.size(); i++)
+    {
         video::IImage* image = irr_driver->getVideoDriver()
             ->createImageFromData(video::ECF_A8R8G8B8, m_mipmap_sizes[i].first,
-            mm_cascade->mipmap[i + 1], false/*ownForeignMemory*/);
+            mipmaps + m_mipmap_sizes[i].second, false/*ownForeignMemory*/);
         irr_driver->getVideoDriver()->writeImageToFile(image, std::string
             (StringUtils::toString(i) + "_" +
             StringUtils::getBasename(NamedPath.getPtr())).c_str());
         image->drop();
-#endif
     }
+#endif
+    delete[] mipmaps;
+    stm->addMipmapTime(false/*cached*/, StkTime::getRealTime() - start);
 }   // threadedReload
 
 // ----------------------------------------------------------------------------
@@ -113,8 +341,6 @@ void HQMipmapGenerator::threadedSubImage(void* ptr) const
 void HQMipmapGenerator::cleanThreadedLoader()
 {
     delete[] m_orig_data;
-    imFreeMipmapCascade((imMipmapCascade*)m_mipmap_data);
-    free(m_mipmap_data);
 }   // cleanThreadedLoader
 
 #endif
@@ -24,12 +24,22 @@
 #include "utils/no_copy.hpp"
 #include "utils/types.hpp"
 
+#include <string>
 #include <vector>
 #include <ITexture.h>
 
 using namespace irr;
 struct TexConfig;
 
+/**
+  * \brief Creates the mipmaps of a texture with a high quality filter in a
+  *  threaded texture loader.
+  *  Large mipmap levels are split into tiles of rows which are filtered by
+  *  the job system. The mipmaps are stored in the mipmap cache (see
+  *  STKTexManager::getMipmapCacheDir()), keyed by a hash of the texture
+  *  data, so they are only created once.
+  * \ingroup graphics
+  */
 class HQMipmapGenerator : public video::ITexture, NoCopy
 {
 private:
@@ -41,12 +51,23 @@ private:
 
     unsigned int m_texture_size;
 
-    void* m_mipmap_data;
-
     TexConfig* m_tex_config;
 
     std::vector<std::pair<core::dimension2d<u32>, size_t> > m_mipmap_sizes;
 
+    // ------------------------------------------------------------------------
+    int      getFilter() const;
+    // ------------------------------------------------------------------------
+    bool     generateMipmaps(uint8_t* mipmaps) const;
+    // ------------------------------------------------------------------------
+    uint64_t getCacheHash() const;
+    // ------------------------------------------------------------------------
+    bool     loadCachedMipmaps(uint8_t* ptr, const std::string& file,
+                               uint64_t hash) const;
+    // ------------------------------------------------------------------------
+    void     saveCachedMipmaps(const uint8_t* mipmaps, const std::string& file,
+                               uint64_t hash) const;
+
 public:
     // ------------------------------------------------------------------------
     HQMipmapGenerator(const io::path& name, uint8_t* data,
@@ -0,0 +1,236 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef SERVER_ONLY
+
+#include "graphics/instance_batcher.hpp"
+
+#include "graphics/central_settings.hpp"
+#include "graphics/irr_driver.hpp"
+#include "graphics/stk_mesh.hpp"
+#include "graphics/vao_manager.hpp"
+#include "utils/log.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+// ----------------------------------------------------------------------------
+bool InstanceBatcher::BatchKey::operator==(const BatchKey &other) const
+{
+    return m_mb == other.m_mb &&
+           memcmp(m_textures, other.m_textures, sizeof(m_textures)) == 0;
+}   // operator==
+
+// ----------------------------------------------------------------------------
+size_t InstanceBatcher::BatchKeyHasher::operator()(const BatchKey &key) const
+{
+    std::hash<void*> hasher;
+    size_t hash = hasher(key.m_mb);
+    for (unsigned int i = 0; i < 8; i++)
+        hash = hash * 31 + hasher(key.m_textures[i]);
+    return hash;
+}   // operator()
+
+// ----------------------------------------------------------------------------
+InstanceBatcher::InstanceBatcher()
+{
+    glGenBuffers(1, &m_instance_buffer);
+    m_buffer_size = 0;
+#if defined(USE_GLES2)
+    m_batch_shadows = false;
+#else
+    // The instanced shadow shaders need a geometry shader
+    m_batch_shadows = CVS->getGLSLVersion() >= 150;
+#endif
+    m_num_objects = 0;
+    m_num_draws = 0;
+}   // InstanceBatcher
+
+// ----------------------------------------------------------------------------
+InstanceBatcher::~InstanceBatcher()
+{
+    glDeleteBuffers(1, &m_instance_buffer);
+}   // ~InstanceBatcher
+
+// ----------------------------------------------------------------------------
+/** Returns true if meshes of the given material can be batched, i.e. if the
+ *  material has instanced shaders which do not need skinning.
+ */
+bool InstanceBatcher::canBatch(Material::ShaderType type)
+{
+    switch (type)
+    {
+    case Material::SHADERTYPE_SOLID:
+    case Material::SHADERTYPE_ALPHA_TEST:
+    case Material::SHADERTYPE_SOLID_UNLIT:
+    case Material::SHADERTYPE_SPHERE_MAP:
+    case Material::SHADERTYPE_NORMAL_MAP:
+    case Material::SHADERTYPE_DETAIL_MAP:
+    case Material::SHADERTYPE_VEGETATION:
+        return true;
+    default:
+        return false;
+    }
+}   // canBatch
+
+// ----------------------------------------------------------------------------
+/** Removes all batches of the last frame. */
+void InstanceBatcher::clear()
+{
+    for (unsigned int pass = 0; pass < PASS_COUNT; pass++)
+    {
+        for (unsigned int type = 0; type < Material::SHADERTYPE_COUNT; type++)
+        {
+            m_batch_index[pass][type].clear();
+            m_batches[pass][type].clear();
+        }
+    }
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Adds a mesh to the batch of its mesh buffer and textures.
+ *  \param pass 0 for the solid pass, 1 + cascade for shadows.
+ *  \param type The material of the mesh, see canBatch().
+ *  \param mesh The mesh to draw.
+ *  \param node The scene node of the mesh.
+ *  \param texture_trans Texture translation of the mesh.
+ *  \param color_change Hue and colorization factor of the mesh.
+ */
+void InstanceBatcher::add(unsigned int pass, Material::ShaderType type,
+                          GLMesh *mesh, scene::ISceneNode *node,
+                          const core::vector2df &texture_trans,
+                          const core::vector2df &color_change)
+{
+    assert(pass < PASS_COUNT && canBatch(type));
+    BatchKey key;
+    key.m_mb = mesh->mb;
+    memcpy(key.m_textures, mesh->textures, sizeof(key.m_textures));
+
+    std::vector<Batch> &batches = m_batches[pass][type];
+    auto it = m_batch_index[pass][type].emplace(key,
+                                                (unsigned int)batches.size());
+    if (it.second)
+    {
+        batches.emplace_back();
+        batches.back().m_mesh = mesh;
+        batches.back().m_first = 0;
+    }
+
+    Batch &batch = batches[it.first->second];
+    batch.m_instances.emplace_back();
+    InstanceData &instance = batch.m_instances.back();
+    fillOriginOrientationScale<InstanceData>(node, instance);
+    instance.MiscData[0] = texture_trans.X;
+    instance.MiscData[1] = texture_trans.Y;
+    instance.MiscData[2] = color_change.X;
+    instance.MiscData[3] = color_change.Y;
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Uploads the instance data of all batches into the instance buffer. */
+void InstanceBatcher::upload()
+{
+    m_instance_data.clear();
+    m_num_objects = 0;
+    m_num_draws = 0;
+    for (unsigned int pass = 0; pass < PASS_COUNT; pass++)
+    {
+        for (unsigned int type = 0; type < Material::SHADERTYPE_COUNT; type++)
+        {
+            for (Batch &batch : m_batches[pass][type])
+            {
+                batch.m_first = (unsigned int)m_instance_data.size();
+                m_instance_data.insert(m_instance_data.end(),
+                                       batch.m_instances.begin(),
+                                       batch.m_instances.end());
+                m_num_objects += (unsigned int)batch.m_instances.size();
+                m_num_draws++;
+            }
+        }
+    }
+    if (m_instance_data.empty())
+        return;
+
+    const size_t size = m_instance_data.size() * sizeof(InstanceData);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+    if (size > m_buffer_size)
+        m_buffer_size = size * 2;
+    // Orphan the buffer of the last frame, which might still be in use
+    glBufferData(GL_ARRAY_BUFFER, m_buffer_size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_instance_data.data());
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}   // upload
+
+// ----------------------------------------------------------------------------
+/** Draws all instances of a batch. The shader and textures must be set.
+ *  \param batch The batch to draw.
+ *  \param vertex_type The vertex type of the material.
+ */
+void InstanceBatcher::drawBatch(const Batch &batch,
+                                video::E_VERTEX_TYPE vertex_type) const
+{
+    GLMesh *mesh = batch.m_mesh;
+    if (mesh->VAOType != vertex_type)
+    {
+#ifdef DEBUG
+        Log::error("InstanceBatcher", "Wrong vertex type of batched mesh "
+                   "(hint texture : %s)",
+                   mesh->textures[0]->getName().getPath().c_str());
+#endif
+        return;
+    }
+
+    if (CVS->isARBBaseInstanceUsable())
+        glBindVertexArray(VAOManager::getInstance()->getVAO(vertex_type));
+    else
+        glBindVertexArray(mesh->vao);
+
+    // Point the instance attributes (see VAOInstanceUtil) at the instances
+    // of this batch
+    const size_t first = batch.m_first * sizeof(InstanceData);
+    glBindBuffer(GL_ARRAY_BUFFER, m_instance_buffer);
+    glEnableVertexAttribArray(7);
+    glVertexAttribPointer(7, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+        (GLvoid*)(first + offsetof(InstanceData, Origin)));
+    glVertexAttribDivisorARB(7, 1);
+    glEnableVertexAttribArray(8);
+    glVertexAttribPointer(8, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+        (GLvoid*)(first + offsetof(InstanceData, Orientation)));
+    glVertexAttribDivisorARB(8, 1);
+    glEnableVertexAttribArray(9);
+    glVertexAttribPointer(9, 3, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+        (GLvoid*)(first + offsetof(InstanceData, Scale)));
+    glVertexAttribDivisorARB(9, 1);
+    glEnableVertexAttribArray(10);
+    glVertexAttribPointer(10, 4, GL_FLOAT, GL_FALSE, sizeof(InstanceData),
+        (GLvoid*)(first + offsetof(InstanceData, MiscData)));
+    glVertexAttribDivisorARB(10, 1);
+
+    irr_driver->increaseObjectCount();
+    if (!mesh->mb->getMaterial().BackfaceCulling)
+        glDisable(GL_CULL_FACE);
+    glDrawElementsInstancedBaseVertex(mesh->PrimitiveType,
+                                      (int)mesh->IndexCount, mesh->IndexType,
+                                      (GLvoid *)mesh->vaoOffset,
+                                      (int)batch.m_instances.size(),
+                                      (int)mesh->vaoBaseVertex);
+    if (!mesh->mb->getMaterial().BackfaceCulling)
+        glEnable(GL_CULL_FACE);
+}   // drawBatch
+
+#endif   // !SERVER_ONLY
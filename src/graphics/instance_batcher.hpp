@@ -0,0 +1,202 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_INSTANCE_BATCHER_HPP
+#define HEADER_INSTANCE_BATCHER_HPP
+
+#ifndef SERVER_ONLY
+
+#include "graphics/command_buffer.hpp"
+#include "graphics/gl_headers.hpp"
+#include "graphics/material.hpp"
+#include "utils/no_copy.hpp"
+
+#include <irrlicht.h>
+#include <unordered_map>
+#include <vector>
+
+struct GLMesh;
+
+/**
+  * \brief Draws identical meshes with one instanced draw call on the GL3
+  *  path, i.e. if the command buffers (which need indirect rendering) are
+  *  not available.
+  *  Meshes using the same mesh buffer, textures and material are grouped
+  *  on the CPU into one batch per rendering pass. The instance data
+  *  (transformation, texture translation and colorization) of all batches
+  *  is uploaded into one buffer per frame, and each batch is drawn with
+  *  the instanced shaders of its material, using attribute divisors.
+  *  Skinned meshes, splatting, reflective shadow maps and glow are not
+  *  batched.
+  * \ingroup graphics
+  */
+class InstanceBatcher : public NoCopy
+{
+public:
+    /** Data of one instance, read with the attribute locations of the
+     *  instanced shaders (Origin, Orientation, Scale and misc_data). */
+    struct InstanceData
+    {
+        struct
+        {
+            float X;
+            float Y;
+            float Z;
+        } Origin, Orientation, Scale;
+        /** Texture translation, hue and colorization factor. */
+        float MiscData[4];
+    };   // InstanceData
+
+    /** Solid pass, followed by the 4 shadow cascades. */
+    static const unsigned int PASS_COUNT = 5;
+
+private:
+    /** Meshes which can be drawn with one instanced draw call. */
+    struct BatchKey
+    {
+        irr::scene::IMeshBuffer *m_mb;
+        irr::video::ITexture    *m_textures[8];
+        bool operator==(const BatchKey &other) const;
+    };   // BatchKey
+
+    struct BatchKeyHasher
+    {
+        size_t operator()(const BatchKey &key) const;
+    };   // BatchKeyHasher
+
+    struct Batch
+    {
+        /** The first mesh added, its buffers and textures are used for
+         *  all instances. */
+        GLMesh                   *m_mesh;
+        std::vector<InstanceData> m_instances;
+        /** Index of the first instance in the instance buffer. */
+        unsigned int              m_first;
+    };   // Batch
+
+    std::unordered_map<BatchKey, unsigned int, BatchKeyHasher>
+        m_batch_index[PASS_COUNT][Material::SHADERTYPE_COUNT];
+    std::vector<Batch> m_batches[PASS_COUNT][Material::SHADERTYPE_COUNT];
+
+    /** Instance data of all batches, uploaded at once. */
+    std::vector<InstanceData> m_instance_data;
+    GLuint       m_instance_buffer;
+    size_t       m_buffer_size;
+
+    /** True if the instanced shadow shaders are available. */
+    bool         m_batch_shadows;
+
+    /** Number of objects batched and of draw calls used for them in the
+     *  last frame. */
+    unsigned int m_num_objects;
+    unsigned int m_num_draws;
+
+    // ------------------------------------------------------------------------
+    void drawBatch(const Batch &batch,
+                   irr::video::E_VERTEX_TYPE vertex_type) const;
+
+public:
+         InstanceBatcher();
+        ~InstanceBatcher();
+    static bool canBatch(Material::ShaderType type);
+    void clear();
+    void add(unsigned int pass, Material::ShaderType type, GLMesh *mesh,
+             irr::scene::ISceneNode *node,
+             const irr::core::vector2df &texture_trans,
+             const irr::core::vector2df &color_change);
+    void upload();
+    // ------------------------------------------------------------------------
+    /** Returns true if meshes of this material can be batched in the
+     *  given pass. */
+    bool canBatch(unsigned int pass, Material::ShaderType type) const
+    {
+        return (pass == 0 || m_batch_shadows) && canBatch(type);
+    }   // canBatch
+    // ------------------------------------------------------------------------
+    /** Draws the batches of material T in the first (normal and depth)
+     *  pass.
+     *  \param uniforms Uniforms needed by the instanced shader of T.
+     */
+    template<typename T, typename...Uniforms>
+    void drawFirstPass(Uniforms...uniforms) const
+    {
+        const std::vector<Batch> &batches = m_batches[0][T::MaterialType];
+        if (batches.empty())
+            return;
+        T::InstancedFirstPassShader::getInstance()->use();
+        T::InstancedFirstPassShader::getInstance()->setUniforms(uniforms...);
+        for (const Batch &batch : batches)
+        {
+            TexExpander<typename T::InstancedFirstPassShader>::template
+                expandTex(*batch.m_mesh, T::FirstPassTextures);
+            drawBatch(batch, T::VertexType);
+        }
+    }   // drawFirstPass
+    // ------------------------------------------------------------------------
+    /** Draws the batches of material T in the second (lighting) pass.
+     *  \param prefilled_tex Textures filled during the previous passes.
+     *  \param uniforms Uniforms needed by the instanced shader of T.
+     */
+    template<typename T, typename...Uniforms>
+    void drawSecondPass(const std::vector<GLuint> &prefilled_tex,
+                        Uniforms...uniforms) const
+    {
+        const std::vector<Batch> &batches = m_batches[0][T::MaterialType];
+        if (batches.empty())
+            return;
+        T::InstancedSecondPassShader::getInstance()->use();
+        T::InstancedSecondPassShader::getInstance()->setUniforms(uniforms...);
+        for (const Batch &batch : batches)
+        {
+            expandTexSecondPass<T>(*batch.m_mesh, prefilled_tex);
+            drawBatch(batch, T::VertexType);
+        }
+    }   // drawSecondPass
+    // ------------------------------------------------------------------------
+    /** Draws the batches of material T into a shadow map.
+     *  \param cascade The cascade of the shadow map.
+     *  \param uniforms Uniforms needed by the instanced shader of T.
+     */
+    template<typename T, typename...Uniforms>
+    void drawShadows(unsigned int cascade, Uniforms...uniforms) const
+    {
+        const std::vector<Batch> &batches =
+            m_batches[cascade + 1][T::MaterialType];
+        if (batches.empty())
+            return;
+        T::InstancedShadowPassShader::getInstance()->use();
+        T::InstancedShadowPassShader::getInstance()
+            ->setUniforms(cascade, uniforms...);
+        for (const Batch &batch : batches)
+        {
+            TexExpander<typename T::InstancedShadowPassShader>::template
+                expandTex(*batch.m_mesh, T::ShadowTextures);
+            drawBatch(batch, T::VertexType);
+        }
+    }   // drawShadows
+    // ------------------------------------------------------------------------
+    /** Returns the number of objects batched in the last frame, i.e. the
+     *  number of draw calls needed without batching. */
+    unsigned int getNumObjects() const                { return m_num_objects; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of instanced draw calls of the last frame. */
+    unsigned int getNumDraws() const                    { return m_num_draws; }
+};   // InstanceBatcher
+
+#endif   // !SERVER_ONLY
+#endif
@@ -24,6 +24,7 @@
 #include "graphics/central_settings.hpp"
 #include "graphics/2dutils.hpp"
 #include "graphics/fixed_pipeline_renderer.hpp"
+#include "graphics/frame_capture.hpp"
 #include "graphics/glwrap.hpp"
 #include "graphics/graphics_restrictions.hpp"
 #include "graphics/light.hpp"
@@ -34,6 +35,7 @@
 #include "graphics/render_target.hpp"
 #include "graphics/shader_based_renderer.hpp"
 #include "graphics/shaders.hpp"
+#include "graphics/sprite_batch.hpp"
 #include "graphics/stk_animated_mesh.hpp"
 #include "graphics/stk_billboard.hpp"
 #include "graphics/stk_mesh_loader.hpp"
@@ -139,6 +141,7 @@ IrrDriver::IrrDriver()
     m_device = createDeviceEx(p);
 
     m_request_screenshot = false;
+    m_frame_capture      = NULL;
     m_renderer            = NULL;
     m_wind                = new Wind();
 
@@ -159,6 +162,9 @@ IrrDriver::~IrrDriver()
 {
 #ifdef ENABLE_RECORDER
     ogrDestroy();
+#endif
+#ifndef SERVER_ONLY
+    delete m_frame_capture;
 #endif
     assert(m_device != NULL);
     m_device->drop();
@@ -664,6 +670,7 @@ void IrrDriver::initDevice()
         m_renderer = new ShaderBasedRenderer();
     else
         m_renderer = new FixedPipelineRenderer();
+    m_frame_capture = new FrameCapture();
 #endif
 
     if (UserConfigParams::m_shadows_resolution != 0 &&
@@ -979,6 +986,9 @@ void IrrDriver::applyResolutionSettings()
     ogrDestroy();
     m_recording = false;
 #endif
+    // Pending screenshots must be written before the device is dropped
+    delete m_frame_capture;
+    m_frame_capture = NULL;
     // initDevice will drop the current device.
     if (CVS->isGLSL())
     {
@@ -990,6 +1000,7 @@ void IrrDriver::applyResolutionSettings()
 
     font_manager = new FontManager();
     font_manager->loadFonts();
+    font_manager->prewarmFonts();
     // Re-init GUI engine
     GUIEngine::init(m_device, m_video_driver, StateManager::get());
 
@@ -1792,10 +1803,19 @@ void IrrDriver::displayFPS()
     {
         fps_string = StringUtils::insertValues
                     (L"FPS: %d/%d/%d  - PolyCount: %d Solid, "
-                      "%d Shadows - LightDist : %d, Total skinning joints: %d",
+                      "%d Shadows - LightDist : %d, Total skinning joints: %d"
+                      " - Culling: %d nodes, %d us - Draw calls: %d us"
+                      " - Batching: %d objects in %d draws"
+                      " - 2D: %d sprites in %d draws",
                     min, fps, max, m_renderer->getPolyCount(SOLID_NORMAL_AND_DEPTH_PASS),
                     m_renderer->getPolyCount(SHADOW_PASS), m_last_light_bucket_distance,
-                    m_skinning_joint);
+                    m_skinning_joint, m_renderer->getCullingNodesTested(),
+                    (int)(m_renderer->getCullingTime() * 1000000.0f),
+                    (int)(m_renderer->getPrepareTime() * 1000000.0f),
+                    m_renderer->getBatchedObjects(),
+                    m_renderer->getBatchedDraws(),
+                    SpriteBatch::getNumSprites(),
+                    SpriteBatch::getNumDraws());
     }
     else
         fps_string = _("FPS: %d/%d/%d - %d KTris", min, fps, max, (int)roundf(kilotris)); 
@@ -1807,20 +1827,11 @@ void IrrDriver::displayFPS()
 }   // updateFPS
 
 // ----------------------------------------------------------------------------
-/** Requess a screenshot from irrlicht, and save it in a file.
+/** Returns a name for a screenshot or frame sequence, consisting of the
+ *  screenshot directory, the track name and the current time.
  */
-void IrrDriver::doScreenShot()
+std::string IrrDriver::getScreenshotBaseName() const
 {
-    m_request_screenshot = false;
-
-    video::IImage* image = m_video_driver->createScreenShot();
-    if(!image)
-    {
-        Log::error("irr_driver", "Could not create screen shot.");
-        return;
-    }
-
-    // Screenshot was successful.
     time_t rawtime;
     time ( &rawtime );
     tm* timeInfo = localtime( &rawtime );
@@ -1832,34 +1843,20 @@ void IrrDriver::doScreenShot()
 
     std::string track_name = race_manager->getTrackName();
     if (World::getWorld() == NULL) track_name = "menu";
-    std::string path = file_manager->getScreenshotDir()+track_name+"-"
-                     + time_buffer+".png";
+    return file_manager->getScreenshotDir()+track_name+"-"+time_buffer;
+}   // getScreenshotBaseName
 
-    if (irr_driver->getVideoDriver()->writeImageToFile(image, path.c_str(), 0))
-    {
-        RaceGUIBase* base = World::getWorld()
-                          ? World::getWorld()->getRaceGUI()
-                          : NULL;
-        if (base)
-        {
-            base->addMessage(
-                      core::stringw(("Screenshot saved to\n" + path).c_str()),
-                      NULL, 2.0f, video::SColor(255,255,255,255), true, false);
-        }   // if base
-    }
-    else
-    {
-        RaceGUIBase* base = World::getWorld()->getRaceGUI();
-        if (base)
-        {
-            base->addMessage(
-                core::stringw(("FAILED saving screenshot to\n" + path +
-                              "\n:(").c_str()),
-                NULL, 2.0f, video::SColor(255,255,255,255),
-                true, false);
-        }   // if base
-    }   // if failed writing screenshot file
-    image->drop();
+// ----------------------------------------------------------------------------
+/** Requests a screenshot of the current frame. The frame buffer is read back
+ *  and encoded asynchronously by the FrameCapture object, which shows the
+ *  result in the race gui once the file is written.
+ */
+void IrrDriver::doScreenShot()
+{
+    m_request_screenshot = false;
+#ifndef SERVER_ONLY
+    m_frame_capture->requestScreenshot(getScreenshotBaseName() + ".png");
+#endif
 }   // doScreenShot
 
 // ----------------------------------------------------------------------------
@@ -1936,6 +1933,24 @@ void IrrDriver::update(float dt)
 
     if (m_request_screenshot) doScreenShot();
 
+#ifndef SERVER_ONLY
+    // Capture frame sequences of races only, e.g. to analyse a replay
+    if (UserConfigParams::m_capture_frame_interval > 0 &&
+        (world != NULL) != m_frame_capture->isCapturingSequence())
+    {
+        if (world)
+        {
+            m_frame_capture->startSequence(getScreenshotBaseName(),
+                UserConfigParams::m_capture_frame_interval,
+                UserConfigParams::m_frame_capture_raw
+                ? FrameCapture::CF_RAW : FrameCapture::CF_PNG);
+        }
+        else
+            m_frame_capture->stopSequence();
+    }
+    m_frame_capture->update();
+#endif
+
     // Enable this next print statement to get render information printed
     // E.g. number of triangles rendered, culled etc. The stats is only
     // printed while the race is running and not while the in-game menu
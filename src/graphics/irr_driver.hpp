@@ -64,6 +64,7 @@ class AbstractKart;
 class AbstractRenderer;
 class Camera;
 class FrameBuffer;
+class FrameCapture;
 class LightNode;
 class PerCameraNode;
 class RenderInfo;
@@ -150,6 +151,11 @@ private:
 
     bool                 m_request_screenshot;
 
+    /** Reads back and writes screenshots and frame sequences. */
+    FrameCapture        *m_frame_capture;
+
+    std::string          getScreenshotBaseName() const;
+
     bool                 m_wireframe;
     bool                 m_mipviz;
     bool                 m_normals;
@@ -22,6 +22,7 @@
 #include "graphics/irr_driver.hpp"
 #include "graphics/spherical_harmonics.hpp"
 #include "utils/log.hpp"
+#include "utils/time.hpp"
 
 #include <fstream>
 #include <sstream>
@@ -31,13 +32,40 @@ std::vector<void(*)()>  ShaderBase::m_all_kill_functions;
 
 // ----------------------------------------------------------------------------
 /** Loads a transform feedback buffer shader with a given number of varying
- *  parameters.
+ *  parameters. Like in Shader::loadProgram the program cache is used if
+ *  possible.
 */
 int ShaderBase::loadTFBProgram(const std::string &shader_name,
                                const char **varyings,
                                unsigned varying_count)
 {
+    const double start = StkTime::getRealTime();
+    ShaderFilesManager *sfm = ShaderFilesManager::getInstance();
+    std::string key;
+    if (sfm->usesProgramCache())
+    {
+        key = "tfb\n";
+        for (unsigned i = 0; i < varying_count; i++)
+            key += std::string(varyings[i]) + "\n";
+        appendShaderSources(&key, GL_VERTEX_SHADER, shader_name);
+#ifdef USE_GLES2
+        appendShaderSources(&key, GL_FRAGMENT_SHADER, "tfb_dummy.frag");
+#endif
+        m_program = sfm->loadProgramBinary(key);
+        if (m_program != 0)
+        {
+            sfm->addProgramTime(/*cached*/true,
+                                StkTime::getRealTime() - start);
+            return m_program;
+        }
+    }
+
     m_program = glCreateProgram();
+    if (!key.empty())
+    {
+        glProgramParameteri(m_program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT,
+                            GL_TRUE);
+    }
     loadAndAttachShader(GL_VERTEX_SHADER, shader_name);
 #ifdef USE_GLES2
     loadAndAttachShader(GL_FRAGMENT_SHADER, "tfb_dummy.frag");
@@ -60,6 +88,11 @@ int ShaderBase::loadTFBProgram(const std::string &shader_name,
         Log::error("ShaderBase", error_message);
         delete[] error_message;
     }
+    else if (!key.empty())
+    {
+        sfm->saveProgramBinary(m_program, key);
+    }
+    sfm->addProgramTime(/*cached*/false, StkTime::getRealTime() - start);
 
     glGetError();
 
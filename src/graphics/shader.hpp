@@ -25,6 +25,7 @@
 #include "graphics/shader_files_manager.hpp"
 #include "graphics/shared_gpu_objects.hpp"
 #include "utils/singleton.hpp"
+#include "utils/time.hpp"
 
 #include <matrix4.h>
 #include <SColor.h>
@@ -88,6 +89,33 @@ protected:
         loadAndAttachShader(shader_type, std::string(name), args...);
     }   // loadAndAttachShader
     // ------------------------------------------------------------------------
+    /** Ends recursion. */
+    template<typename ... Types>
+    void appendShaderSources(std::string *key)
+    {
+        return;
+    }   // appendShaderSources
+    // ------------------------------------------------------------------------
+    /** Appends the types and sources of a list of shaders to the key of a
+     *  program in the program cache. */
+    template<typename ... Types>
+    void appendShaderSources(std::string *key, GLint shader_type,
+                             const std::string &name, Types ... args)
+    {
+        *key += std::to_string(shader_type) + "\n";
+        *key += ShaderFilesManager::getInstance()
+            ->getShaderSource(name, shader_type);
+        appendShaderSources(key, args...);
+    }   // appendShaderSources
+    // ------------------------------------------------------------------------
+    /** Convenience interface using const char. */
+    template<typename ... Types>
+    void appendShaderSources(std::string *key, GLint shader_type,
+                             const char *name, Types ... args)
+    {
+        appendShaderSources(key, shader_type, std::string(name), args...);
+    }   // appendShaderSources
+    // ------------------------------------------------------------------------
     void setAttribute(AttributeType type);
 
 public:
@@ -342,12 +370,35 @@ public:
     }   // Shader
 
     // ------------------------------------------------------------------------
-    /** Load a list of shaders and links them all together.
+    /** Load a list of shaders and links them all together. If the program
+     *  cache is used, the linked program is loaded from the cache if
+     *  possible, otherwise it is saved to the cache after linking.
      */
     template<typename ... Types>
     void loadProgram(AttributeType type, Types ... args)
     {
+        const double start = StkTime::getRealTime();
+        ShaderFilesManager *sfm = ShaderFilesManager::getInstance();
+        std::string key;
+        if (sfm->usesProgramCache())
+        {
+            key = std::to_string(type) + "\n";
+            appendShaderSources(&key, args...);
+            m_program = sfm->loadProgramBinary(key);
+            if (m_program != 0)
+            {
+                sfm->addProgramTime(/*cached*/true,
+                                    StkTime::getRealTime() - start);
+                return;
+            }
+        }
+
         m_program = glCreateProgram();
+        if (!key.empty())
+        {
+            glProgramParameteri(m_program,
+                                GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
         loadAndAttachShader(args...);
         if (!CVS->isARBExplicitAttribLocationUsable())
             setAttribute(type);
@@ -355,6 +406,9 @@ public:
 
         GLint Result = GL_FALSE;
         glGetProgramiv(m_program, GL_LINK_STATUS, &Result);
+        if (Result == GL_TRUE && !key.empty())
+            sfm->saveProgramBinary(m_program, key);
+        sfm->addProgramTime(/*cached*/false, StkTime::getRealTime() - start);
         if (Result == GL_FALSE) {
             int info_length;
             Log::error("Shader", "Error when linking these shaders :");
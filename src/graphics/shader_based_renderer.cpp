@@ -36,6 +36,7 @@
 #include "graphics/stk_billboard.hpp"
 #include "graphics/stk_mesh_scene_node.hpp"
 #include "graphics/spherical_harmonics.hpp"
+#include "graphics/sprite_batch.hpp"
 #include "items/item_manager.hpp"
 #include "items/powerup_manager.hpp"
 #include "modes/world.hpp"
@@ -256,6 +257,11 @@ void ShaderBasedRenderer::renderScene(scene::ICameraSceneNode * const camnode,
     m_draw_calls.prepareDrawCalls(m_shadow_matrices, camnode, solid_poly_count, shadow_poly_count);
     m_poly_count[SOLID_NORMAL_AND_DEPTH_PASS] += solid_poly_count;
     m_poly_count[SHADOW_PASS] += shadow_poly_count;
+    m_culling_nodes_tested += m_draw_calls.getCullingNodesTested();
+    m_culling_time += (float)m_draw_calls.getCullingTime();
+    m_prepare_time += (float)m_draw_calls.getPrepareTime();
+    m_batched_objects += m_draw_calls.getBatchedObjects();
+    m_batched_draws += m_draw_calls.getBatchedDraws();
     PROFILER_POP_CPU_MARKER();
 
 #if !defined(USE_GLES2)    
@@ -669,6 +675,7 @@ void ShaderBasedRenderer::onLoadWorld()
     RTT* rtts = new RTT(width, height, CVS->isDefferedEnabled() ?
                         UserConfigParams::m_scale_rtts_factor : 1.0f);
     setRTT(rtts);
+    m_draw_calls.setStaticNodes(Track::getCurrentTrack()->getMainTrackNodes());
 }
 
 // ----------------------------------------------------------------------------
@@ -677,6 +684,7 @@ void ShaderBasedRenderer::onUnloadWorld()
     delete m_rtts;
     m_rtts = NULL;
     removeSkyBox();
+    m_draw_calls.clearStaticNodes();
 }
 
 // ----------------------------------------------------------------------------
@@ -769,6 +777,9 @@ void ShaderBasedRenderer::render(float dt)
 {
     resetObjectCount();
     resetPolyCount();
+    resetCullingStats();
+    resetBatchingStats();
+    SpriteBatch::resetStats();
 
     setOverrideMaterial();
     
@@ -915,6 +926,8 @@ void ShaderBasedRenderer::renderToTexture(GL3RenderTarget *render_target,
 {
     resetObjectCount();
     resetPolyCount();
+    resetCullingStats();
+    resetBatchingStats();
     assert(m_rtts != NULL);
 
     irr_driver->getSceneManager()->setActiveCamera(camera);
@@ -992,6 +1005,20 @@ void ShaderBasedRenderer::preloadShaderFiles()
         sfm->addShaderFile("grass_pass2.frag", GL_FRAGMENT_SHADER);
         sfm->addShaderFile("objectpass_spheremap.frag", GL_FRAGMENT_SHADER);
         sfm->addShaderFile("detailed_object_pass2.frag", GL_FRAGMENT_SHADER);
+        if (CVS->supportsInstanceBatching())
+        {
+            sfm->addShaderFile("instanced_object_pass.vert", GL_VERTEX_SHADER);
+            sfm->addShaderFile("instanced_object_pass1.frag", GL_FRAGMENT_SHADER);
+            sfm->addShaderFile("instanced_object_pass2.frag", GL_FRAGMENT_SHADER);
+            sfm->addShaderFile("instanced_objectref_pass1.frag", GL_FRAGMENT_SHADER);
+            sfm->addShaderFile("instanced_objectref_pass2.frag", GL_FRAGMENT_SHADER);
+            sfm->addShaderFile("instanced_object_unlit.frag", GL_FRAGMENT_SHADER);
+            sfm->addShaderFile("instanced_normalmap.frag", GL_FRAGMENT_SHADER);
+            sfm->addShaderFile("instanced_grass.vert", GL_VERTEX_SHADER);
+            sfm->addShaderFile("instanced_grass_pass2.frag", GL_FRAGMENT_SHADER);
+            sfm->addShaderFile("instanced_objectpass_spheremap.frag", GL_FRAGMENT_SHADER);
+            sfm->addShaderFile("instanced_detailed_object_pass2.frag", GL_FRAGMENT_SHADER);
+        }
     }
 
 } //preloadShaderFiles
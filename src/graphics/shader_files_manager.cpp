@@ -18,13 +18,54 @@
 #ifndef SERVER_ONLY
 
 #include "graphics/shader_files_manager.hpp"
+#include "config/user_config.hpp"
 #include "graphics/central_settings.hpp"
+#include "graphics/irr_driver.hpp"
 #include "graphics/shared_gpu_objects.hpp"
 #include "io/file_manager.hpp"
 #include "utils/log.hpp"
 
 #include <fstream>
 #include <sstream>
+#include <stdio.h>
+#include <vector>
+
+/** Identifies a program cache file, and its version. */
+static const uint32_t PROGRAM_CACHE_MAGIC   = 0x50544b53; // "STKP"
+static const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+// ----------------------------------------------------------------------------
+ShaderFilesManager::ShaderFilesManager()
+{
+    m_num_cached_programs  = 0;
+    m_num_linked_programs  = 0;
+    m_cached_programs_time = 0;
+    m_linked_programs_time = 0;
+    if (UserConfigParams::m_shader_program_cache &&
+        CVS->isARBGetProgramBinaryUsable())
+    {
+        std::string vendor, renderer, version;
+        irr_driver->getOpenGLData(&vendor, &renderer, &version);
+        m_driver_id = vendor + "\n" + renderer + "\n" + version + "\n";
+        m_program_cache_dir = file_manager->getCachedTexturesDir() +
+                              "shaders/";
+        if (!file_manager->checkAndCreateDirectoryP(m_program_cache_dir))
+            m_program_cache_dir = "";
+    }
+}   // ShaderFilesManager
+
+// ----------------------------------------------------------------------------
+ShaderFilesManager::~ShaderFilesManager()
+{
+    if (m_num_cached_programs + m_num_linked_programs > 0)
+    {
+        Log::info("ShaderFilesManager", "Shader programs: %d loaded from the "
+            "program cache in %.0f ms, %d compiled and linked in %.0f ms.",
+            m_num_cached_programs, m_cached_programs_time * 1000.0,
+            m_num_linked_programs, m_linked_programs_time * 1000.0);
+    }
+    clean();
+}   // ~ShaderFilesManager
 
 // ----------------------------------------------------------------------------
 /** Returns a string with the content of header.txt (which contains basic
@@ -108,13 +149,18 @@ void ShaderFilesManager::readFile(const std::string& file,
 }
 
 // ----------------------------------------------------------------------------
-/** Loads a single shader. This is NOT cached, use addShaderFile for that.
- *  \param file Filename of the shader to load.
+/** Returns the complete source of a shader, i.e. the content of the file
+ *  with the version, extensions and defines for the current driver, and the
+ *  common header. The source is only read once.
+ *  \param file Filename of the shader.
  *  \param type Type of the shader.
  */
-GLuint ShaderFilesManager::loadShader(const std::string &file, unsigned type)
+const std::string& ShaderFilesManager::getShaderSource(const std::string &file,
+                                                       unsigned type)
 {
-    const GLuint id = glCreateShader(type);
+    auto it = m_shader_sources.find(file);
+    if (it != m_shader_sources.end())
+        return it->second;
 
     std::ostringstream code;
 #if !defined(USE_GLES2)
@@ -190,8 +236,20 @@ GLuint ShaderFilesManager::loadShader(const std::string &file, unsigned type)
 
     readFile(file, code);
 
+    return m_shader_sources[file] = code.str();
+}   // getShaderSource
+
+// ----------------------------------------------------------------------------
+/** Loads a single shader. This is NOT cached, use getShaderFile for that.
+ *  \param file Filename of the shader to load.
+ *  \param type Type of the shader.
+ */
+GLuint ShaderFilesManager::loadShader(const std::string &file, unsigned type)
+{
+    const GLuint id = glCreateShader(type);
+
     Log::info("ShaderFilesManager", "Compiling shader : %s", file.c_str());
-    const std::string &source  = code.str();
+    const std::string &source  = getShaderSource(file, type);
     char const *source_pointer = source.c_str();
     int len                    = source.size();
     glShaderSource(id, 1, &source_pointer, &len);
@@ -219,11 +277,14 @@ GLuint ShaderFilesManager::loadShader(const std::string &file, unsigned type)
 } // loadShader
 
 // ----------------------------------------------------------------------------
-/** Loads a single shader file, and add it to the loaded (cached) list
+/** Preloads a single shader file. If the program cache is used, only the
+ *  source is read, since the shader is only compiled if a program using it
+ *  is not in the cache. Otherwise the shader is compiled and added to the
+ *  loaded (cached) list.
  *  \param file Filename of the shader to load.
  *  \param type Type of the shader.
  */
-GLuint ShaderFilesManager::addShaderFile(const std::string &file, unsigned type)
+void ShaderFilesManager::addShaderFile(const std::string &file, unsigned type)
 {
 #ifdef DEBUG
     // Make sure no duplicated shader is added somewhere else
@@ -232,9 +293,10 @@ GLuint ShaderFilesManager::addShaderFile(const std::string &file, unsigned type)
     assert(i == m_shader_files_loaded.end());
 #endif
 
-    const GLuint id = loadShader(file, type);
-    m_shader_files_loaded[file] = id;
-    return id;
+    if (usesProgramCache())
+        getShaderSource(file, type);
+    else
+        m_shader_files_loaded[file] = loadShader(file, type);
 }   // addShaderFile
 
 // ----------------------------------------------------------------------------
@@ -249,8 +311,162 @@ GLuint ShaderFilesManager::getShaderFile(const std::string &file, unsigned type)
     if (it != m_shader_files_loaded.end())
         return it->second;
 
-   // add to the cache now
-   return addShaderFile(file, type);
+    // add to the cache now
+    const GLuint id = loadShader(file, type);
+    m_shader_files_loaded[file] = id;
+    return id;
 }   // getShaderFile
 
+// ----------------------------------------------------------------------------
+/** Returns the FNV-1a hash of the driver and a program key. */
+uint64_t ShaderFilesManager::getProgramHash(const std::string &key) const
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (const std::string *s : { &m_driver_id, &key })
+    {
+        for (char c : *s)
+        {
+            hash ^= (uint8_t)c;
+            hash *= 1099511628211ULL;
+        }
+    }
+    return hash;
+}   // getProgramHash
+
+// ----------------------------------------------------------------------------
+std::string ShaderFilesManager::getProgramCacheFile(uint64_t hash) const
+{
+    char name[32];
+    sprintf(name, "%016llx.bin", (unsigned long long)hash);
+    return m_program_cache_dir + name;
+}   // getProgramCacheFile
+
+// ----------------------------------------------------------------------------
+/** Creates a program from the program cache. The file format is:<br>
+ *  <magic><version><hash><key-size><binary-format><binary-size><binary>
+ *  \param key The key of the program, which must contain everything that
+ *         influences the linked program (e.g. the sources of all shaders).
+ *  \return The program, or 0 if it is not in the cache or the driver
+ *          rejected the cached binary (e.g. after a driver update which did
+ *          not change the version string).
+ */
+GLuint ShaderFilesManager::loadProgramBinary(const std::string &key)
+{
+    if (!usesProgramCache())
+        return 0;
+    const uint64_t hash = getProgramHash(key);
+    const std::string file_name = getProgramCacheFile(hash);
+    std::ifstream ifs(file_name.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return 0;
+
+    uint32_t magic = 0, version = 0, key_size = 0, format = 0, size = 0;
+    uint64_t file_hash = 0;
+    ifs.read((char*)&magic,     sizeof(uint32_t));
+    ifs.read((char*)&version,   sizeof(uint32_t));
+    ifs.read((char*)&file_hash, sizeof(uint64_t));
+    ifs.read((char*)&key_size,  sizeof(uint32_t));
+    ifs.read((char*)&format,    sizeof(uint32_t));
+    ifs.read((char*)&size,      sizeof(uint32_t));
+    if (!ifs.good() || magic != PROGRAM_CACHE_MAGIC ||
+        version != PROGRAM_CACHE_VERSION || file_hash != hash ||
+        key_size != key.size() || size == 0)
+        return 0;
+    std::vector<char> binary(size);
+    ifs.read(binary.data(), size);
+    if (!ifs.good())
+        return 0;
+
+    const GLuint program = glCreateProgram();
+    glProgramBinary(program, format, binary.data(), size);
+    GLint result = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &result);
+    if (result == GL_FALSE)
+    {
+        Log::info("ShaderFilesManager", "Cached program '%s' was rejected "
+            "by the driver, recompiling it.", file_name.c_str());
+        glDeleteProgram(program);
+        glGetError();
+        ifs.close();
+        file_manager->removeFile(file_name);
+        return 0;
+    }
+    return program;
+}   // loadProgramBinary
+
+// ----------------------------------------------------------------------------
+/** Saves a linked program to the program cache. The program must have been
+ *  linked with GL_PROGRAM_BINARY_RETRIEVABLE_HINT set. The file is written
+ *  under a temporary name first, so that a crash or another instance never
+ *  leaves a partial binary which the next run would load.
+ *  \param program The program.
+ *  \param key The key of the program, see loadProgramBinary.
+ */
+void ShaderFilesManager::saveProgramBinary(GLuint program,
+                                           const std::string &key)
+{
+    if (!usesProgramCache())
+        return;
+    GLint size = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &size);
+    if (size <= 0)
+        return;
+    std::vector<char> binary(size);
+    GLenum format = 0;
+    GLsizei length = 0;
+    glGetProgramBinary(program, size, &length, &format, binary.data());
+    if (glGetError() != GL_NO_ERROR || length <= 0)
+        return;
+
+    const uint64_t hash = getProgramHash(key);
+    const std::string file_name = getProgramCacheFile(hash);
+    char suffix[32];
+    sprintf(suffix, ".%p.tmp", (const void*)binary.data());
+    const std::string tmp_file = file_name + suffix;
+    {
+        std::ofstream ofs(tmp_file.c_str(), std::ios::out | std::ios::binary);
+        if (!ofs.is_open())
+            return;
+        const uint32_t key_size = (uint32_t)key.size();
+        const uint32_t binary_format = format;
+        const uint32_t binary_size = length;
+        ofs.write((char*)&PROGRAM_CACHE_MAGIC,   sizeof(uint32_t));
+        ofs.write((char*)&PROGRAM_CACHE_VERSION, sizeof(uint32_t));
+        ofs.write((char*)&hash,                  sizeof(uint64_t));
+        ofs.write((char*)&key_size,              sizeof(uint32_t));
+        ofs.write((char*)&binary_format,         sizeof(uint32_t));
+        ofs.write((char*)&binary_size,           sizeof(uint32_t));
+        ofs.write(binary.data(), length);
+        if (!ofs.good())
+        {
+            ofs.close();
+            remove(tmp_file.c_str());
+            return;
+        }
+    }
+    // Fails on windows if another instance saved the same program meanwhile
+    if (rename(tmp_file.c_str(), file_name.c_str()) != 0)
+        remove(tmp_file.c_str());
+}   // saveProgramBinary
+
+// ----------------------------------------------------------------------------
+/** Adds the time used to create a program to the statistics printed when
+ *  the shaders are unloaded.
+ *  \param cached True if the program was loaded from the program cache.
+ *  \param time Time in s.
+ */
+void ShaderFilesManager::addProgramTime(bool cached, double time)
+{
+    if (cached)
+    {
+        m_num_cached_programs++;
+        m_cached_programs_time += time;
+    }
+    else
+    {
+        m_num_linked_programs++;
+        m_linked_programs_time += time;
+    }
+}   // addProgramTime
+
 #endif   // !SERVER_ONLY
@@ -36,23 +36,58 @@ private:
      */
     std::unordered_map<std::string, GLuint> m_shader_files_loaded;
 
+    /** Map from a filename to the complete source of the shader (including
+     *  the version, the defines and the header). */
+    std::unordered_map<std::string, std::string> m_shader_sources;
+
+    /** Vendor, renderer and version of the OpenGL driver. A program binary
+     *  is only valid for the same driver, so this is part of the key of
+     *  each cached program. */
+    std::string m_driver_id;
+
+    /** Directory of the program binary cache, empty if the cache is not
+     *  used. */
+    std::string m_program_cache_dir;
+
+    /** Number of programs loaded from the program cache and number of
+     *  programs compiled and linked, and the time (in s) used for each. */
+    unsigned int m_num_cached_programs, m_num_linked_programs;
+    double       m_cached_programs_time, m_linked_programs_time;
+
     // ------------------------------------------------------------------------
     const std::string& getHeader();
     void readFile(const std::string& file, std::ostringstream& code);
+    uint64_t getProgramHash(const std::string &key) const;
+    std::string getProgramCacheFile(uint64_t hash) const;
 
 public:
     // ------------------------------------------------------------------------
-    ShaderFilesManager() {}
+    ShaderFilesManager();
+    // ------------------------------------------------------------------------
+    ~ShaderFilesManager();
     // ------------------------------------------------------------------------
-    ~ShaderFilesManager()                                          { clean(); }
+    void clean()
+    {
+        m_shader_files_loaded.clear();
+        m_shader_sources.clear();
+    }   // clean
     // ------------------------------------------------------------------------
-    void clean()                             { m_shader_files_loaded.clear(); }
+    const std::string& getShaderSource(const std::string &file, unsigned type);
     // ------------------------------------------------------------------------
     GLuint loadShader(const std::string &file, unsigned type);
     // ------------------------------------------------------------------------
-    GLuint addShaderFile(const std::string &file, unsigned type);
+    void addShaderFile(const std::string &file, unsigned type);
     // ------------------------------------------------------------------------
     GLuint getShaderFile(const std::string &file, unsigned type);
+    // ------------------------------------------------------------------------
+    GLuint loadProgramBinary(const std::string &key);
+    // ------------------------------------------------------------------------
+    void saveProgramBinary(GLuint program, const std::string &key);
+    // ------------------------------------------------------------------------
+    void addProgramTime(bool cached, double time);
+    // ------------------------------------------------------------------------
+    /** Returns true if linked programs are cached on disk. */
+    bool usesProgramCache() const     { return !m_program_cache_dir.empty(); }
 
 };   // ShaderFilesManager
 
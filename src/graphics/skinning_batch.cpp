@@ -0,0 +1,112 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef SERVER_ONLY
+
+#include "graphics/skinning_batch.hpp"
+
+#include "graphics/central_settings.hpp"
+#include "graphics/shared_gpu_objects.hpp"
+#include "graphics/stk_animated_mesh.hpp"
+#include "utils/job_system.hpp"
+
+#include <algorithm>
+
+// ----------------------------------------------------------------------------
+SkinningBatch::SkinningBatch()
+{
+    m_num_joints = 0;
+}   // SkinningBatch
+
+// ----------------------------------------------------------------------------
+/** Computes the joint matrices of all nodes. The skinning offset of each
+ *  node must be set.
+ *  \param nodes The nodes to animate.
+ *  \param num_joints Total number of joints of all nodes.
+ *  \param caller_job Optional function executed by the calling thread
+ *         while the joints are computed (see JobSystem::parallelFor).
+ */
+void SkinningBatch::animate(const std::set<STKAnimatedMesh*> &nodes,
+                            unsigned int num_joints,
+                            const std::function<void()> &caller_job)
+{
+    m_num_joints = num_joints;
+    m_nodes.clear();
+    for (STKAnimatedMesh *node : nodes)
+    {
+        if (node->getTotalJoints() > 0)
+            m_nodes.push_back(node);
+    }
+    m_mesh_start.clear();
+    if (m_nodes.empty())
+    {
+        if (caller_job)
+            caller_job();
+        return;
+    }
+
+    std::sort(m_nodes.begin(), m_nodes.end(),
+              [](STKAnimatedMesh *a, STKAnimatedMesh *b)
+              {
+                  return a->getMesh() < b->getMesh();
+              });
+    for (unsigned int i = 0; i < m_nodes.size(); i++)
+    {
+        if (i == 0 || m_nodes[i]->getMesh() != m_nodes[i - 1]->getMesh())
+            m_mesh_start.push_back(i);
+    }
+    m_mesh_start.push_back((unsigned int)m_nodes.size());
+
+    // One more for the reserved identity matrix
+    m_joints.resize((m_num_joints + 1) * 16);
+    STKAnimatedMesh::setJointBuffer(m_joints.data());
+
+    const unsigned int num_meshes = (unsigned int)m_mesh_start.size() - 1;
+    auto animate_mesh = [this](unsigned int mesh)
+    {
+        for (unsigned int i = m_mesh_start[mesh]; i < m_mesh_start[mesh + 1];
+             i++)
+            m_nodes[i]->animateJoints();
+    };
+    JobSystem *job_system = JobSystem::get();
+    if (num_meshes > 1 && job_system && job_system->getNumThreads() > 1)
+    {
+        job_system->parallelFor(num_meshes, animate_mesh, caller_job);
+    }
+    else
+    {
+        if (caller_job)
+            caller_job();
+        for (unsigned int i = 0; i < num_meshes; i++)
+            animate_mesh(i);
+    }
+}   // animate
+
+// ----------------------------------------------------------------------------
+/** Uploads the joint matrices computed in animate() to the skinning UBO. */
+void SkinningBatch::upload() const
+{
+    if (m_nodes.empty() || m_num_joints == 0)
+        return;
+    glBindBuffer(GL_UNIFORM_BUFFER, SharedGPUObjects::getSkinningUBO());
+    glBufferSubData(GL_UNIFORM_BUFFER, 16 * sizeof(float),
+                    m_num_joints * 16 * sizeof(float), m_joints.data() + 16);
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}   // upload
+
+#endif   // !SERVER_ONLY
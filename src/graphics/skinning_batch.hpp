@@ -0,0 +1,69 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SKINNING_BATCH_HPP
+#define HEADER_SKINNING_BATCH_HPP
+
+#ifndef SERVER_ONLY
+
+#include "utils/no_copy.hpp"
+
+#include <functional>
+#include <set>
+#include <vector>
+
+class STKAnimatedMesh;
+
+/**
+  * \brief Computes the joint matrices of all hardware skinned meshes of a
+  *  frame in parallel, and uploads them with one call.
+  *  Meshes of the same kart type share one animated mesh, whose joints
+  *  are animated for each node in turn, so all nodes using the same mesh
+  *  are handled by one job, and different meshes by different jobs of the
+  *  JobSystem. The joint matrices are written into one contiguous buffer
+  *  with the layout of the skinning UBO (at the skinning offset of each
+  *  node), which is then uploaded at once instead of one matrix at a time.
+  * \ingroup graphics
+  */
+class SkinningBatch : public NoCopy
+{
+private:
+    /** The nodes to animate, sorted by mesh. */
+    std::vector<STKAnimatedMesh*> m_nodes;
+
+    /** Index of the first node of each mesh in m_nodes, followed by the
+     *  number of nodes. */
+    std::vector<unsigned int>     m_mesh_start;
+
+    /** The joint matrices (16 floats each). The first matrix is the
+     *  identity matrix reserved in the UBO and is not uploaded. */
+    std::vector<float>            m_joints;
+
+    /** Number of joints of all nodes. */
+    unsigned int                  m_num_joints;
+
+public:
+         SkinningBatch();
+    void animate(const std::set<STKAnimatedMesh*> &nodes,
+                 unsigned int num_joints,
+                 const std::function<void()> &caller_job = nullptr);
+    void upload() const;
+};   // SkinningBatch
+
+#endif   // !SERVER_ONLY
+#endif
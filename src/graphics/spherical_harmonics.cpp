@@ -18,15 +18,23 @@
 #ifndef SERVER_ONLY
 
 #include "graphics/spherical_harmonics.hpp"
+#include "config/user_config.hpp"
 #if defined(USE_GLES2)
 #include "graphics/central_settings.hpp"
 #endif
 #include "graphics/irr_driver.hpp"
 #include "graphics/stk_texture.hpp"
+#include "io/file_manager.hpp"
+#include "utils/job_system.hpp"
 #include "utils/log.hpp"
+#include "utils/time.hpp"
 
 #include <algorithm> 
 #include <cassert>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
 #include <irrlicht.h>
 
 #if __SSE2__ || _M_X64 || _M_IX86_FP >= 2
@@ -224,293 +232,492 @@ namespace
         return;
     }   // getXYZ
 
-    
-} //namespace
-
-// ----------------------------------------------------------------------------
-/** Compute m_SH_coeff->red_SH_coeff, m_SH_coeff->green_SH_coeff 
- *  and m_SH_coeff->blue_SH_coeff from Yml values
- *  \param sh_rgba The 6 cubemap faces (sRGB byte textures)
- *  \param edge_size Size of the cubemap face
- */
-void SphericalHarmonics::generateSphericalHarmonics(unsigned char *sh_rgba[6], size_t edge_size)
-{
+    // ------------------------------------------------------------------------
+    /** Identifies a file of the spherical harmonics cache ("STKH"). */
+    const uint32_t SH_CACHE_MAGIC   = 0x484b5453;
+    /** Must be increased if the file format or the projection changes. */
+    const uint32_t SH_CACHE_VERSION = 1;
+
+    /** Constant part of Ylm, in the order of the coefficients (L00, L1-1,
+     *  L10, L11, L2-2, L2-1, L20, L21, L22). */
+    const float SH_CONSTANTS[9] = { 0.282095f, 0.488603f, 0.488603f,
+                                    0.488603f, 1.092548f, 1.092548f,
+                                    0.315392f, 1.092548f, 0.546274f };
+
+    /** For each face, the component of the texel direction (u, v or w, see
+     *  TexelTable) used as x, y and z, and its sign. This is the mapping of
+     *  getXYZ(). */
+    const int   FACE_AXES[6][3]  = { { 2, 0, 1 }, { 2, 0, 1 }, { 1, 2, 0 },
+                                     { 1, 2, 0 }, { 1, 0, 2 }, { 1, 0, 2 } };
+    const float FACE_SIGNS[6][3] = { {  1.0f, -1.0f, -1.0f },
+                                     { -1.0f, -1.0f,  1.0f },
+                                     {  1.0f,  1.0f,  1.0f },
+                                     {  1.0f, -1.0f, -1.0f },
+                                     {  1.0f, -1.0f,  1.0f },
+                                     { -1.0f, -1.0f, -1.0f } };
 
-#if SIMD_SSE2_SUPPORT
+    // ------------------------------------------------------------------------
+    /** Direction and solid angle of the texels of a cubemap face, which only
+     *  depend on the size of the face. The direction (u, v, w) of texel
+     *  (i, j) is (fi, fj, 1) normalized, which is permuted for each face.
+     *  Each quantity is stored in its own array, so that 4 texels can be
+     *  loaded at once, and rows are padded to a multiple of 4 texels with a
+     *  solid angle of 0.
+     */
+    struct TexelTable
+    {
+        size_t             m_edge_size;
+        size_t             m_stride;
+        std::vector<float> m_u;
+        std::vector<float> m_v;
+        std::vector<float> m_w;
+        std::vector<float> m_solid_angle;
+    };   // TexelTable
 
-    float wh = float(edge_size * edge_size);
-    float edge_size_inv;
-    float fi, fj, fi2p1;
-    unsigned char *shface;
-    __m128 sh0, sh1, sh2, sh3, sh4, sh5, sh6, sh7, sh8;
-
-    // constant part of Ylm
-    const float c00 = 0.282095f;
-    const float c1minus1 = 0.488603f;
-    const float c10 = 0.488603f;
-    const float c11 = 0.488603f;
-    const float c2minus2 = 1.092548f;
-    const float c2minus1 = 1.092548f;
-    const float c21 = 1.092548f;
-    const float c20 = 0.315392f;
-    const float c22 = 0.546274f;
-
-    sh0 = _mm_setzero_ps();
-    sh1 = _mm_setzero_ps();
-    sh2 = _mm_setzero_ps();
-    sh3 = _mm_setzero_ps();
-    sh4 = _mm_setzero_ps();
-    sh5 = _mm_setzero_ps();
-    sh6 = _mm_setzero_ps();
-    sh7 = _mm_setzero_ps();
-    sh8 = _mm_setzero_ps();
-
-    edge_size_inv = 2.0f / edge_size;
-    for (unsigned face = 0; face < 6; face++)
+    // ------------------------------------------------------------------------
+    /** Returns the texel table of a face size. The last table is kept, since
+     *  all faces of a cubemap and usually all skyboxes have the same size.
+     *  Must only be called from the main thread.
+     *  \param edge_size Size of the cubemap face.
+     */
+    const TexelTable& getTexelTable(size_t edge_size)
     {
-        shface = sh_rgba[face];
-        for (int i = 0; i < int(edge_size); i++)
+        static TexelTable table = TexelTable();
+        if (table.m_edge_size == edge_size)
+            return table;
+
+        table.m_edge_size = edge_size;
+        table.m_stride = (edge_size + 3) & ~size_t(3);
+        const size_t count = table.m_stride * edge_size;
+        table.m_u.assign(count, 0.0f);
+        table.m_v.assign(count, 0.0f);
+        table.m_w.assign(count, 0.0f);
+        table.m_solid_angle.assign(count, 0.0f);
+
+        const float wh = float(edge_size * edge_size);
+        const float edge_size_inv = 2.0f / edge_size;
+        for (size_t i = 0; i < edge_size; i++)
         {
-            int shidx = ( i * edge_size ) * 4;
-            fi = (float(i) * edge_size_inv) - 1.0f;
-            fi2p1 = (fi * fi) + 1.0f;
-            for (unsigned j = 0; j < edge_size; j++, shidx += 4)
+            const float fi = (float(i) * edge_size_inv) - 1.0f;
+            const float fi2p1 = (fi * fi) + 1.0f;
+            for (size_t j = 0; j < edge_size; j++)
             {
-                float d, solidangle, dinv;
-                float shx, shy, shz;
-                __m128 vrgb;
-
-                fj = (float(j) * edge_size_inv) - 1.0f;
-                d = sqrtf(fi2p1 + (fj * fj));
-                dinv = 1.0f / d;
+                const float fj = (float(j) * edge_size_inv) - 1.0f;
+                const float d = sqrtf(fi2p1 + (fj * fj));
+                const float dinv = 1.0f / d;
+                const size_t idx = i * table.m_stride + j;
+                table.m_u[idx] = fi * dinv;
+                table.m_v[idx] = fj * dinv;
+                table.m_w[idx] = dinv;
                 // Constant obtained by projecting unprojected ref values
-                solidangle = 2.75f / (wh * sqrtf(d*d*d));
- #if SIMD_SSE4_1_SUPPORT
-                vrgb = _mm_cvtepi32_ps( _mm_cvtepu8_epi32( _mm_castps_si128( _mm_load_ss( (float *)&shface[shidx+0] ) ) ) );
- #else
-                vrgb = _mm_cvtepi32_ps( _mm_unpacklo_epi16( _mm_unpacklo_epi8( _mm_castps_si128( _mm_load_ss( (float *)&shface[shidx+0] ) ), _mm_setzero_si128() ), _mm_setzero_si128() ) );
- #endif
-                vrgb = _mm_mul_ps( srgb2linear4( vrgb ), _mm_set1_ps( solidangle ) );
-
-                // TODO: This is very suboptimal, and a pity to break such a streamlined loop
-                // I think people will disapprove if I unroll the 'face' loop 6 times...
-                // What about some branchless vblendps masking?
-                switch (face)
+                table.m_solid_angle[idx] = 2.75f / (wh * sqrtf(d * d * d));
+            }
+        }
+        return table;
+    }   // getTexelTable
+
+    // ------------------------------------------------------------------------
+    /** Projects one cubemap face on the 9 first spherical harmonics.
+     *  \param face The face of the cubemap.
+     *  \param shface The texels of the face (sRGB BGRA bytes).
+     *  \param table The texel table of the face size.
+     *  \param[out] sums The blue, green and red sums of the texel values
+     *              times the solid angle and the Ylm functions without their
+     *              constant part (see SH_CONSTANTS).
+     */
+    void projectFace(unsigned face, const unsigned char *shface,
+                     const TexelTable &table, float sums[3][9])
+    {
+        const float *components[3] = { table.m_u.data(), table.m_v.data(),
+                                       table.m_w.data() };
+        const float *ax = components[FACE_AXES[face][0]];
+        const float *ay = components[FACE_AXES[face][1]];
+        const float *az = components[FACE_AXES[face][2]];
+        const float *solid_angles = table.m_solid_angle.data();
+        const size_t edge_size = table.m_edge_size;
+
+#if SIMD_SSE2_SUPPORT
+
+        // 4 texels of a row are projected at once
+        const __m128 sx = _mm_set1_ps(FACE_SIGNS[face][0]);
+        const __m128 sy = _mm_set1_ps(FACE_SIGNS[face][1]);
+        const __m128 sz = _mm_set1_ps(FACE_SIGNS[face][2]);
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 three = _mm_set1_ps(3.0f);
+        const __m128i byte_mask = _mm_set1_epi32(0xff);
+        __m128 acc[3][9];
+        for (unsigned c = 0; c < 3; c++)
+        {
+            for (unsigned k = 0; k < 9; k++)
+                acc[c][k] = _mm_setzero_ps();
+        }
+
+        for (size_t i = 0; i < edge_size; i++)
+        {
+            const unsigned char *row = shface + i * edge_size * 4;
+            for (size_t j = 0; j < edge_size; j += 4)
+            {
+                __m128i texels;
+                if (j + 4 <= edge_size)
+                {
+                    texels = _mm_loadu_si128((const __m128i*)(row + j * 4));
+                }
+                else
+                {
+                    // The padding of the texel table has a solid angle of 0
+                    uint32_t tail[4] = { 0, 0, 0, 0 };
+                    memcpy(tail, row + j * 4, (edge_size - j) * 4);
+                    texels = _mm_loadu_si128((const __m128i*)tail);
+                }
+                const size_t idx = i * table.m_stride + j;
+                const __m128 solid_angle = _mm_loadu_ps(solid_angles + idx);
+                const __m128 x = _mm_mul_ps(_mm_loadu_ps(ax + idx), sx);
+                const __m128 y = _mm_mul_ps(_mm_loadu_ps(ay + idx), sy);
+                const __m128 z = _mm_mul_ps(_mm_loadu_ps(az + idx), sz);
+
+                __m128 ylm[9];
+                ylm[0] = one;
+                ylm[1] = y;
+                ylm[2] = z;
+                ylm[3] = x;
+                ylm[4] = _mm_mul_ps(x, y);
+                ylm[5] = _mm_mul_ps(y, z);
+                ylm[6] = _mm_sub_ps(_mm_mul_ps(three, _mm_mul_ps(z, z)), one);
+                ylm[7] = _mm_mul_ps(x, z);
+                ylm[8] = _mm_sub_ps(_mm_mul_ps(x, x), _mm_mul_ps(y, y));
+
+                for (unsigned c = 0; c < 3; c++)
                 {
-                case 0: // PosX
-                    shx = 1.0f;
-                    shy = -fi;
-                    shz = -fj;
-                    break;
-                case 1: // NegX
-                    shx = -1.0f;
-                    shy = -fi;
-                    shz = fj;
-                    break;
-                case 2: // PosY
-                    shx = fj;
-                    shy = 1.0f;
-                    shz = fi;
-                    break;
-                case 3: // NegY
-                    shx = fj;
-                    shy = -1.0f;
-                    shz = -fi;
-                    break;
-                case 4: // PosZ
-                    shx = fj;
-                    shy = -fi;
-                    shz = 1.0f;
-                    break;
-                case 5: // NegZ
-                    shx = -fj;
-                    shy = -fi;
-                    shz = -1.0f;
-                    break;
+                    __m128 color = _mm_cvtepi32_ps(_mm_and_si128(
+                        _mm_srli_epi32(texels, 8 * c), byte_mask));
+                    color = _mm_mul_ps(srgb2linear4(color), solid_angle);
+                    for (unsigned k = 0; k < 9; k++)
+                    {
+                        acc[c][k] = _mm_add_ps(acc[c][k],
+                                               _mm_mul_ps(color, ylm[k]));
+                    }
                 }
-                shx *= dinv;
-                shy *= dinv;
-                shz *= dinv;
-
-                sh0 = _mm_add_ps( sh0, vrgb );
-                sh1 = _mm_add_ps( sh1, _mm_mul_ps( vrgb, _mm_set1_ps( shy ) ) );
-                sh2 = _mm_add_ps( sh2, _mm_mul_ps( vrgb, _mm_set1_ps( shz ) ) );
-                sh3 = _mm_add_ps( sh3, _mm_mul_ps( vrgb, _mm_set1_ps( shx ) ) );
-                sh4 = _mm_add_ps( sh4, _mm_mul_ps( vrgb, _mm_set1_ps( shx * shy ) ) );
-                sh5 = _mm_add_ps( sh5, _mm_mul_ps( vrgb, _mm_set1_ps( shy * shz ) ) );
-                sh6 = _mm_add_ps( sh6, _mm_mul_ps( vrgb, _mm_set1_ps( shx * shz ) ) );
-                sh7 = _mm_add_ps( sh7, _mm_mul_ps( vrgb, _mm_set1_ps( ((3.0f * shz * shz) - 1.0f) ) ) );
-                sh8 = _mm_add_ps( sh8, _mm_mul_ps( vrgb, _mm_set1_ps( ((shx * shx) - (shy * shy)) ) ) );
             }
         }
-    }
 
-    sh0 = _mm_mul_ps( sh0, _mm_set1_ps( c00 ) );
-    sh1 = _mm_mul_ps( sh1, _mm_set1_ps( c1minus1 ) );
-    sh2 = _mm_mul_ps( sh2, _mm_set1_ps( c10 ) );
-    sh3 = _mm_mul_ps( sh3, _mm_set1_ps( c11 ) );
-    sh4 = _mm_mul_ps( sh4, _mm_set1_ps( c2minus2 ) );
-    sh5 = _mm_mul_ps( sh5, _mm_set1_ps( c2minus1 ) );
-    sh6 = _mm_mul_ps( sh6, _mm_set1_ps( c21 ) );
-    sh7 = _mm_mul_ps( sh7, _mm_set1_ps( c20 ) );
-    sh8 = _mm_mul_ps( sh8, _mm_set1_ps( c22 ) );
-
-    m_SH_coeff->blue_SH_coeff[0] = _mm_cvtss_f32( sh0 );
-    m_SH_coeff->blue_SH_coeff[1] = _mm_cvtss_f32( sh1 );
-    m_SH_coeff->blue_SH_coeff[2] = _mm_cvtss_f32( sh2 );
-    m_SH_coeff->blue_SH_coeff[3] = _mm_cvtss_f32( sh3 );
-    m_SH_coeff->blue_SH_coeff[4] = _mm_cvtss_f32( sh4 );
-    m_SH_coeff->blue_SH_coeff[5] = _mm_cvtss_f32( sh5 );
-    m_SH_coeff->blue_SH_coeff[6] = _mm_cvtss_f32( sh6 );
-    m_SH_coeff->blue_SH_coeff[7] = _mm_cvtss_f32( sh7 );
-    m_SH_coeff->blue_SH_coeff[8] = _mm_cvtss_f32( sh8 );
-
-    m_SH_coeff->green_SH_coeff[0] = _mm_cvtss_f32( _mm_shuffle_ps( sh0, sh0, 0x55 ) );
-    m_SH_coeff->green_SH_coeff[1] = _mm_cvtss_f32( _mm_shuffle_ps( sh1, sh1, 0x55 ) );
-    m_SH_coeff->green_SH_coeff[2] = _mm_cvtss_f32( _mm_shuffle_ps( sh2, sh2, 0x55 ) );
-    m_SH_coeff->green_SH_coeff[3] = _mm_cvtss_f32( _mm_shuffle_ps( sh3, sh3, 0x55 ) );
-    m_SH_coeff->green_SH_coeff[4] = _mm_cvtss_f32( _mm_shuffle_ps( sh4, sh4, 0x55 ) );
-    m_SH_coeff->green_SH_coeff[5] = _mm_cvtss_f32( _mm_shuffle_ps( sh5, sh5, 0x55 ) );
-    m_SH_coeff->green_SH_coeff[6] = _mm_cvtss_f32( _mm_shuffle_ps( sh6, sh6, 0x55 ) );
-    m_SH_coeff->green_SH_coeff[7] = _mm_cvtss_f32( _mm_shuffle_ps( sh7, sh7, 0x55 ) );
-    m_SH_coeff->green_SH_coeff[8] = _mm_cvtss_f32( _mm_shuffle_ps( sh8, sh8, 0x55 ) );
-
-    m_SH_coeff->red_SH_coeff[0] = _mm_cvtss_f32( _mm_movehl_ps( sh0, sh0 ) );
-    m_SH_coeff->red_SH_coeff[1] = _mm_cvtss_f32( _mm_movehl_ps( sh1, sh1 ) );
-    m_SH_coeff->red_SH_coeff[2] = _mm_cvtss_f32( _mm_movehl_ps( sh2, sh2 ) );
-    m_SH_coeff->red_SH_coeff[3] = _mm_cvtss_f32( _mm_movehl_ps( sh3, sh3 ) );
-    m_SH_coeff->red_SH_coeff[4] = _mm_cvtss_f32( _mm_movehl_ps( sh4, sh4 ) );
-    m_SH_coeff->red_SH_coeff[5] = _mm_cvtss_f32( _mm_movehl_ps( sh5, sh5 ) );
-    m_SH_coeff->red_SH_coeff[6] = _mm_cvtss_f32( _mm_movehl_ps( sh6, sh6 ) );
-    m_SH_coeff->red_SH_coeff[7] = _mm_cvtss_f32( _mm_movehl_ps( sh7, sh7 ) );
-    m_SH_coeff->red_SH_coeff[8] = _mm_cvtss_f32( _mm_movehl_ps( sh8, sh8 ) );
+        for (unsigned c = 0; c < 3; c++)
+        {
+            for (unsigned k = 0; k < 9; k++)
+            {
+                float SIMD_ALIGN16 lanes[4];
+                _mm_store_ps(lanes, acc[c][k]);
+                sums[c][k] = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+            }
+        }
 
 #else
 
-    float wh = float(edge_size * edge_size);
-    float b0 = 0., b1 = 0., b2 = 0., b3 = 0., b4 = 0., b5 = 0., b6 = 0., b7 = 0., b8 = 0.;
-    float g0 = 0., g1 = 0., g2 = 0., g3 = 0., g4 = 0., g5 = 0., g6 = 0., g7 = 0., g8 = 0.;
-    float r0 = 0., r1 = 0., r2 = 0., r3 = 0., r4 = 0., r5 = 0., r6 = 0., r7 = 0., r8 = 0.;
-    float edge_size_inv;
-    float fi, fj, fi2p1;
-    unsigned char *shface;
-
-    // constant part of Ylm
-    const float c00 = 0.282095f;
-    const float c1minus1 = 0.488603f;
-    const float c10 = 0.488603f;
-    const float c11 = 0.488603f;
-    const float c2minus2 = 1.092548f;
-    const float c2minus1 = 1.092548f;
-    const float c21 = 1.092548f;
-    const float c20 = 0.315392f;
-    const float c22 = 0.546274f;
-
-    edge_size_inv = 2.0f / edge_size;
-    for (unsigned face = 0; face < 6; face++)
-    {
-        shface = sh_rgba[face];
-        for (int i = 0; i < int(edge_size); i++)
+        for (unsigned c = 0; c < 3; c++)
+        {
+            for (unsigned k = 0; k < 9; k++)
+                sums[c][k] = 0.0f;
+        }
+
+        for (size_t i = 0; i < edge_size; i++)
         {
-            int shidx = ( i * edge_size ) * 4;
-            fi = (float(i) * edge_size_inv) - 1.0f;
-            fi2p1 = (fi * fi) + 1.0f;
-            for (unsigned j = 0; j < edge_size; j++, shidx += 4)
+            const unsigned char *row = shface + i * edge_size * 4;
+            for (size_t j = 0; j < edge_size; j++)
             {
-                fj = (float(j) * edge_size_inv) - 1.0f;
+                const size_t idx = i * table.m_stride + j;
+                const float x = ax[idx] * FACE_SIGNS[face][0];
+                const float y = ay[idx] * FACE_SIGNS[face][1];
+                const float z = az[idx] * FACE_SIGNS[face][2];
+                const float ylm[9] = { 1.0f, y, z, x, x * y, y * z,
+                                       (3.0f * z * z) - 1.0f, x * z,
+                                       (x * x) - (y * y) };
+                for (unsigned c = 0; c < 3; c++)
+                {
+                    const float color = srgb2linear(float(row[j * 4 + c]))
+                                      * solid_angles[idx];
+                    for (unsigned k = 0; k < 9; k++)
+                        sums[c][k] += color * ylm[k];
+                }
+            }
+        }
 
-                float d = sqrtf(fi2p1 + (fj * fj));
-                // Constant obtained by projecting unprojected ref values
-                float solidangle = 2.75f / (wh * sqrtf(d*d*d));
-                float r, g, b;
-                float y00, y1m1, y10, y11, y2m2, y2m1, y21, y20, y22;
-                float shx, shy, shz;
-
-                b = srgb2linear( float(shface[shidx+0]) ) * solidangle;
-                g = srgb2linear( float(shface[shidx+1]) ) * solidangle;
-                r = srgb2linear( float(shface[shidx+2]) ) * solidangle;
-
-                getXYZ(face, fi, fj, shx, shy, shz);
-                y00 = c00;
-                y1m1 = c1minus1 * shy;
-                y10 = c10 * shz;
-                y11 = c11 * shx;
-                y2m2 = c2minus2 * shx * shy;
-                y2m1 = c2minus1 * shy * shz;
-                y21 = c21 * shx * shz;
-                y20 = c20 * ((3.0f * shz * shz) - 1.0f);
-                y22 = c22 * ((shx * shx) - (shy * shy));
-
-                b0 += b * y00;
-                b1 += b * y1m1;
-                b2 += b * y10;
-                b3 += b * y11;
-                b4 += b * y2m2;
-                b5 += b * y2m1;
-                b6 += b * y20;
-                b7 += b * y21;
-                b8 += b * y22;
-
-                g0 += g * y00;
-                g1 += g * y1m1;
-                g2 += g * y10;
-                g3 += g * y11;
-                g4 += g * y2m2;
-                g5 += g * y2m1;
-                g6 += g * y20;
-                g7 += g * y21;
-                g8 += g * y22;
-
-                r0 += r * y00;
-                r1 += r * y1m1;
-                r2 += r * y10;
-                r3 += r * y11;
-                r4 += r * y2m2;
-                r5 += r * y2m1;
-                r6 += r * y20;
-                r7 += r * y21;
-                r8 += r * y22;
+#endif
+    }   // projectFace
+
+    // ------------------------------------------------------------------------
+    /** Reference implementation of the projection, which computes the
+     *  direction and solid angle of each texel. Only used to check
+     *  SphericalHarmonics::generateSphericalHarmonics() in unit testing.
+     *  \param sh_rgba The 6 cubemap faces (sRGB byte textures)
+     *  \param edge_size Size of the cubemap face
+     *  \param[out] sh_coeff The spherical harmonics coefficients
+     */
+    void projectSHReference(unsigned char *sh_rgba[6], size_t edge_size,
+                            SHCoefficients *sh_coeff)
+    {
+        float wh = float(edge_size * edge_size);
+        float b0 = 0., b1 = 0., b2 = 0., b3 = 0., b4 = 0., b5 = 0., b6 = 0., b7 = 0., b8 = 0.;
+        float g0 = 0., g1 = 0., g2 = 0., g3 = 0., g4 = 0., g5 = 0., g6 = 0., g7 = 0., g8 = 0.;
+        float r0 = 0., r1 = 0., r2 = 0., r3 = 0., r4 = 0., r5 = 0., r6 = 0., r7 = 0., r8 = 0.;
+        float edge_size_inv;
+        float fi, fj, fi2p1;
+        unsigned char *shface;
+
+        // constant part of Ylm
+        const float c00 = 0.282095f;
+        const float c1minus1 = 0.488603f;
+        const float c10 = 0.488603f;
+        const float c11 = 0.488603f;
+        const float c2minus2 = 1.092548f;
+        const float c2minus1 = 1.092548f;
+        const float c21 = 1.092548f;
+        const float c20 = 0.315392f;
+        const float c22 = 0.546274f;
+
+        edge_size_inv = 2.0f / edge_size;
+        for (unsigned face = 0; face < 6; face++)
+        {
+            shface = sh_rgba[face];
+            for (int i = 0; i < int(edge_size); i++)
+            {
+                int shidx = ( i * edge_size ) * 4;
+                fi = (float(i) * edge_size_inv) - 1.0f;
+                fi2p1 = (fi * fi) + 1.0f;
+                for (unsigned j = 0; j < edge_size; j++, shidx += 4)
+                {
+                    fj = (float(j) * edge_size_inv) - 1.0f;
+
+                    float d = sqrtf(fi2p1 + (fj * fj));
+                    // Constant obtained by projecting unprojected ref values
+                    float solidangle = 2.75f / (wh * sqrtf(d*d*d));
+                    float r, g, b;
+                    float y00, y1m1, y10, y11, y2m2, y2m1, y21, y20, y22;
+                    float shx, shy, shz;
+
+                    b = srgb2linear( float(shface[shidx+0]) ) * solidangle;
+                    g = srgb2linear( float(shface[shidx+1]) ) * solidangle;
+                    r = srgb2linear( float(shface[shidx+2]) ) * solidangle;
+
+                    getXYZ(face, fi, fj, shx, shy, shz);
+                    y00 = c00;
+                    y1m1 = c1minus1 * shy;
+                    y10 = c10 * shz;
+                    y11 = c11 * shx;
+                    y2m2 = c2minus2 * shx * shy;
+                    y2m1 = c2minus1 * shy * shz;
+                    y21 = c21 * shx * shz;
+                    y20 = c20 * ((3.0f * shz * shz) - 1.0f);
+                    y22 = c22 * ((shx * shx) - (shy * shy));
+
+                    b0 += b * y00;
+                    b1 += b * y1m1;
+                    b2 += b * y10;
+                    b3 += b * y11;
+                    b4 += b * y2m2;
+                    b5 += b * y2m1;
+                    b6 += b * y20;
+                    b7 += b * y21;
+                    b8 += b * y22;
+
+                    g0 += g * y00;
+                    g1 += g * y1m1;
+                    g2 += g * y10;
+                    g3 += g * y11;
+                    g4 += g * y2m2;
+                    g5 += g * y2m1;
+                    g6 += g * y20;
+                    g7 += g * y21;
+                    g8 += g * y22;
+
+                    r0 += r * y00;
+                    r1 += r * y1m1;
+                    r2 += r * y10;
+                    r3 += r * y11;
+                    r4 += r * y2m2;
+                    r5 += r * y2m1;
+                    r6 += r * y20;
+                    r7 += r * y21;
+                    r8 += r * y22;
+                }
             }
         }
-    }
 
-    m_SH_coeff->blue_SH_coeff[0] = b0;
-    m_SH_coeff->blue_SH_coeff[1] = b1;
-    m_SH_coeff->blue_SH_coeff[2] = b2;
-    m_SH_coeff->blue_SH_coeff[3] = b3;
-    m_SH_coeff->blue_SH_coeff[4] = b4;
-    m_SH_coeff->blue_SH_coeff[5] = b5;
-    m_SH_coeff->blue_SH_coeff[6] = b6;
-    m_SH_coeff->blue_SH_coeff[7] = b7;
-    m_SH_coeff->blue_SH_coeff[8] = b8;
-
-    m_SH_coeff->red_SH_coeff[0] = r0;
-    m_SH_coeff->red_SH_coeff[1] = r1;
-    m_SH_coeff->red_SH_coeff[2] = r2;
-    m_SH_coeff->red_SH_coeff[3] = r3;
-    m_SH_coeff->red_SH_coeff[4] = r4;
-    m_SH_coeff->red_SH_coeff[5] = r5;
-    m_SH_coeff->red_SH_coeff[6] = r6;
-    m_SH_coeff->red_SH_coeff[7] = r7;
-    m_SH_coeff->red_SH_coeff[8] = r8;
-
-    m_SH_coeff->green_SH_coeff[0] = g0;
-    m_SH_coeff->green_SH_coeff[1] = g1;
-    m_SH_coeff->green_SH_coeff[2] = g2;
-    m_SH_coeff->green_SH_coeff[3] = g3;
-    m_SH_coeff->green_SH_coeff[4] = g4;
-    m_SH_coeff->green_SH_coeff[5] = g5;
-    m_SH_coeff->green_SH_coeff[6] = g6;
-    m_SH_coeff->green_SH_coeff[7] = g7;
-    m_SH_coeff->green_SH_coeff[8] = g8;
+        sh_coeff->blue_SH_coeff[0] = b0;
+        sh_coeff->blue_SH_coeff[1] = b1;
+        sh_coeff->blue_SH_coeff[2] = b2;
+        sh_coeff->blue_SH_coeff[3] = b3;
+        sh_coeff->blue_SH_coeff[4] = b4;
+        sh_coeff->blue_SH_coeff[5] = b5;
+        sh_coeff->blue_SH_coeff[6] = b6;
+        sh_coeff->blue_SH_coeff[7] = b7;
+        sh_coeff->blue_SH_coeff[8] = b8;
+
+        sh_coeff->red_SH_coeff[0] = r0;
+        sh_coeff->red_SH_coeff[1] = r1;
+        sh_coeff->red_SH_coeff[2] = r2;
+        sh_coeff->red_SH_coeff[3] = r3;
+        sh_coeff->red_SH_coeff[4] = r4;
+        sh_coeff->red_SH_coeff[5] = r5;
+        sh_coeff->red_SH_coeff[6] = r6;
+        sh_coeff->red_SH_coeff[7] = r7;
+        sh_coeff->red_SH_coeff[8] = r8;
+
+        sh_coeff->green_SH_coeff[0] = g0;
+        sh_coeff->green_SH_coeff[1] = g1;
+        sh_coeff->green_SH_coeff[2] = g2;
+        sh_coeff->green_SH_coeff[3] = g3;
+        sh_coeff->green_SH_coeff[4] = g4;
+        sh_coeff->green_SH_coeff[5] = g5;
+        sh_coeff->green_SH_coeff[6] = g6;
+        sh_coeff->green_SH_coeff[7] = g7;
+        sh_coeff->green_SH_coeff[8] = g8;
+    }   // projectSHReference
 
+    // ------------------------------------------------------------------------
+    /** Returns the key of a set of spherical harmonics textures in the cache:
+     *  a hash of the size, color format and data of each image.
+     *  \param images The 6 images, in the order of the cubemap faces.
+     */
+    uint64_t getCacheHash(video::IImage *images[6])
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        auto add = [&hash](uint64_t value)
+        {
+            hash ^= value;
+            hash *= 1099511628211ULL;
+        };
+        add(SH_CACHE_VERSION);
+#if defined(USE_GLES2)
+        // The red and blue channels are swapped before the projection
+        add(1);
 #endif
-/*
-printf( "#### SH ; Coeffs R ; %f %f %f %f %f %f %f %f\n", m_SH_coeff->red_SH_coeff[0], m_SH_coeff->red_SH_coeff[1], m_SH_coeff->red_SH_coeff[2], m_SH_coeff->red_SH_coeff[3], m_SH_coeff->red_SH_coeff[4], m_SH_coeff->red_SH_coeff[5], m_SH_coeff->red_SH_coeff[6], m_SH_coeff->red_SH_coeff[7] );
-printf( "#### SH ; Coeffs G ; %f %f %f %f %f %f %f %f\n", m_SH_coeff->green_SH_coeff[0], m_SH_coeff->green_SH_coeff[1], m_SH_coeff->green_SH_coeff[2], m_SH_coeff->green_SH_coeff[3], m_SH_coeff->green_SH_coeff[4], m_SH_coeff->green_SH_coeff[5], m_SH_coeff->green_SH_coeff[6], m_SH_coeff->green_SH_coeff[7] );
-printf( "#### SH ; Coeffs B ; %f %f %f %f %f %f %f %f\n", m_SH_coeff->blue_SH_coeff[0], m_SH_coeff->blue_SH_coeff[1], m_SH_coeff->blue_SH_coeff[2], m_SH_coeff->blue_SH_coeff[3], m_SH_coeff->blue_SH_coeff[4], m_SH_coeff->blue_SH_coeff[5], m_SH_coeff->blue_SH_coeff[6], m_SH_coeff->blue_SH_coeff[7] );
-*/
-}   // projectSH
+        for (unsigned i = 0; i < 6; i++)
+        {
+            add(images[i]->getDimension().Width);
+            add(images[i]->getDimension().Height);
+            add(images[i]->getColorFormat());
+            const uint8_t *data = (const uint8_t*)images[i]->lock();
+            const size_t size = images[i]->getImageDataSizeInBytes();
+            // Hash 8 bytes at once
+            size_t n = 0;
+            for (; n + 8 <= size; n += 8)
+            {
+                uint64_t word;
+                memcpy(&word, data + n, 8);
+                add(word);
+            }
+            for (; n < size; n++)
+                add(data[n]);
+            images[i]->unlock();
+        }
+        return hash;
+    }   // getCacheHash
+
+    // ------------------------------------------------------------------------
+    /** Reads spherical harmonics coefficients from the cache. The file
+     *  format is: <magic><version><hash><coefficients>
+     *  \param file Name of the cache file.
+     *  \param hash Key of the textures.
+     *  \param[out] sh_coeff The spherical harmonics coefficients.
+     *  \return False if the file does not exist or is invalid.
+     */
+    bool loadCachedCoefficients(const std::string &file, uint64_t hash,
+                                SHCoefficients *sh_coeff)
+    {
+        std::ifstream ifs(file.c_str(), std::ios::in | std::ios::binary);
+        if (!ifs.is_open())
+            return false;
+
+        uint32_t magic = 0, version = 0;
+        uint64_t file_hash = 0;
+        SHCoefficients coeff;
+        ifs.read((char*)&magic,     sizeof(uint32_t));
+        ifs.read((char*)&version,   sizeof(uint32_t));
+        ifs.read((char*)&file_hash, sizeof(uint64_t));
+        ifs.read((char*)&coeff,     sizeof(SHCoefficients));
+        if (!ifs.good() || magic != SH_CACHE_MAGIC ||
+            version != SH_CACHE_VERSION || file_hash != hash)
+            return false;
+        *sh_coeff = coeff;
+        return true;
+    }   // loadCachedCoefficients
+
+    // ------------------------------------------------------------------------
+    /** Saves spherical harmonics coefficients in the cache, see
+     *  loadCachedCoefficients(). The file is written under a temporary name
+     *  first, so that a partial file is never read.
+     */
+    void saveCachedCoefficients(const std::string &file, uint64_t hash,
+                                const SHCoefficients *sh_coeff)
+    {
+        const std::string tmp_file = file + ".tmp";
+        {
+            std::ofstream ofs(tmp_file.c_str(),
+                              std::ios::out | std::ios::binary);
+            if (!ofs.is_open())
+                return;
+            ofs.write((char*)&SH_CACHE_MAGIC,   sizeof(uint32_t));
+            ofs.write((char*)&SH_CACHE_VERSION, sizeof(uint32_t));
+            ofs.write((char*)&hash,             sizeof(uint64_t));
+            ofs.write((const char*)sh_coeff,    sizeof(SHCoefficients));
+            if (!ofs.good())
+            {
+                ofs.close();
+                remove(tmp_file.c_str());
+                return;
+            }
+        }
+        // Fails on windows if the file exists already
+        if (rename(tmp_file.c_str(), file.c_str()) != 0)
+            remove(tmp_file.c_str());
+    }   // saveCachedCoefficients
+
+    
+} //namespace
+
+// ----------------------------------------------------------------------------
+/** Compute the red, green and blue spherical harmonics coefficients of a
+ *  cubemap. The faces are projected in parallel with the job system, 4 texels
+ *  at once with SSE2, using the precomputed direction and solid angle of each
+ *  texel (see getTexelTable()).
+ *  \param sh_rgba The 6 cubemap faces (sRGB byte textures)
+ *  \param edge_size Size of the cubemap face
+ *  \param[out] sh_coeff The spherical harmonics coefficients
+ */
+void SphericalHarmonics::generateSphericalHarmonics(unsigned char *sh_rgba[6],
+                                                    size_t edge_size,
+                                                    SHCoefficients *sh_coeff)
+{
+    const TexelTable &table = getTexelTable(edge_size);
+    float sums[6][3][9];
+    auto project = [&](unsigned int face)
+    {
+        projectFace(face, sh_rgba[face], table, sums[face]);
+    };
+    // Not worth it for the small faces used for the ambient light
+    JobSystem *job_system = JobSystem::get();
+    if (job_system && edge_size >= 64)
+        job_system->parallelFor(6, project);
+    else
+    {
+        for (unsigned face = 0; face < 6; face++)
+            project(face);
+    }
+
+    // Add the faces in a fixed order, so the result does not depend on the
+    // number of threads
+    float *channels[3] = { sh_coeff->blue_SH_coeff, sh_coeff->green_SH_coeff,
+                           sh_coeff->red_SH_coeff };
+    for (unsigned c = 0; c < 3; c++)
+    {
+        for (unsigned k = 0; k < 9; k++)
+        {
+            float sum = 0.0f;
+            for (unsigned face = 0; face < 6; face++)
+                sum += sums[face][c][k];
+            channels[c][k] = sum * SH_CONSTANTS[k];
+        }
+    }
+}   // generateSphericalHarmonics
 
 // ----------------------------------------------------------------------------
 SphericalHarmonics::SphericalHarmonics(const std::vector<video::ITexture *> &spherical_harmonics_textures)
@@ -537,7 +744,10 @@ SphericalHarmonics::~SphericalHarmonics()
 }
 
 
-/** Compute spherical harmonics coefficients from 6 textures */
+/** Compute spherical harmonics coefficients from 6 textures. The
+ *  coefficients are cached on disk, using a hash of the textures as key, so
+ *  they are only computed the first time a skybox is used.
+ */
 void SphericalHarmonics::setTextures(const std::vector<video::ITexture *> &spherical_harmonics_textures)
 {
     assert(spherical_harmonics_textures.size() == 6);
@@ -545,25 +755,49 @@ void SphericalHarmonics::setTextures(const std::vector<video::ITexture *> &spher
     m_spherical_harmonics_textures = spherical_harmonics_textures;
 
     const unsigned texture_permutation[] = { 2, 3, 0, 1, 5, 4 };
-    unsigned char *sh_rgba[6];
+    video::IImage *images[6];
     unsigned sh_w = 0, sh_h = 0;
 
     for (unsigned i = 0; i < 6; i++)
     {
         sh_w = std::max(sh_w, m_spherical_harmonics_textures[i]->getSize().Width);
         sh_h = std::max(sh_h, m_spherical_harmonics_textures[i]->getSize().Height);
+        images[i] = static_cast<STKTexture*>
+            (m_spherical_harmonics_textures[texture_permutation[i]])
+            ->getTextureImage();
+        assert(images[i] != NULL);
+    }
+
+    const double start = StkTime::getRealTime();
+    std::string cache_file;
+    uint64_t hash = 0;
+    if (UserConfigParams::m_sh_cache)
+    {
+        const std::string cache_dir =
+            file_manager->getCachedTexturesDir() + "sh/";
+        if (file_manager->checkAndCreateDirectoryP(cache_dir))
+        {
+            hash = getCacheHash(images);
+            char name[32];
+            sprintf(name, "%016llx.sh", (unsigned long long)hash);
+            cache_file = cache_dir + name;
+            if (loadCachedCoefficients(cache_file, hash, m_SH_coeff))
+            {
+                Log::debug("SphericalHarmonics", "Read coefficients from "
+                           "the cache in %.2f ms.",
+                           (StkTime::getRealTime() - start) * 1000.0);
+                return;
+            }
+        }
     }
 
+    unsigned char *sh_rgba[6];
     for (unsigned i = 0; i < 6; i++)
         sh_rgba[i] = new unsigned char[sh_w * sh_h * 4];
     
     for (unsigned i = 0; i < 6; i++)
     {
-        unsigned idx = texture_permutation[i];
-        video::IImage* img = static_cast<STKTexture*>
-            (m_spherical_harmonics_textures[idx])->getTextureImage();
-        assert(img != NULL);
-        img->copyToScaling(sh_rgba[i], sh_w, sh_h);
+        images[i]->copyToScaling(sh_rgba[i], sh_w, sh_h);
 #if defined(USE_GLES2)
         // Code here assume color format is BGRA
         for (unsigned int j = 0; j < sh_w * sh_h; j++)
@@ -575,10 +809,15 @@ void SphericalHarmonics::setTextures(const std::vector<video::ITexture *> &spher
 #endif
     } //for (unsigned i = 0; i < 6; i++)
 
-    generateSphericalHarmonics(sh_rgba, sh_w);
+    generateSphericalHarmonics(sh_rgba, sh_w, m_SH_coeff);
 
     for (unsigned i = 0; i < 6; i++)
         delete[] sh_rgba[i];
+
+    if (!cache_file.empty())
+        saveCachedCoefficients(cache_file, hash, m_SH_coeff);
+    Log::debug("SphericalHarmonics", "Projected %ux%u textures in %.2f ms.",
+               sh_w, sh_h, (StkTime::getRealTime() - start) * 1000.0);
 } //setSphericalHarmonicsTextures
 
 /** Compute spherical harmonics coefficients from ambient light */
@@ -612,7 +851,7 @@ void SphericalHarmonics::setAmbientLight(const video::SColor &ambient)
         }
     }    
 
-    generateSphericalHarmonics(sh_rgba, sh_w);
+    generateSphericalHarmonics(sh_rgba, sh_w, m_SH_coeff);
 
     for (unsigned i = 0; i < 6; i++)
         delete[] sh_rgba[i];
@@ -650,16 +889,12 @@ void SphericalHarmonics::unprojectSH(size_t width, size_t height,
                                      float *Y20[], float *Y21[], float *Y22[],
                                      float *output[])
 {
-    for (unsigned face = 0; face < 6; face++)
+    auto unproject_face = [&](unsigned int face)
     {
         for (unsigned i = 0; i < width; i++)
         {
             for (unsigned j = 0; j < height; j++)
             {
-                float fi = float(i), fj = float(j);
-                fi /= width, fj /= height;
-                fi = 2 * fi - 1, fj = 2 * fj - 1;
-
                 output[face][4 * height * i + 4 * j + 2] =
                     getTexelValue(i, j, width, height, m_SH_coeff->red_SH_coeff, Y00[face],
                                 Y1minus1[face], Y10[face], Y11[face],
@@ -677,8 +912,77 @@ void SphericalHarmonics::unprojectSH(size_t width, size_t height,
                                 Y21[face], Y22[face]);
             }
         }
+    };
+    JobSystem *job_system = JobSystem::get();
+    if (job_system)
+        job_system->parallelFor(6, unproject_face);
+    else
+    {
+        for (unsigned face = 0; face < 6; face++)
+            unproject_face(face);
     }
 }   // unprojectSH
 
+// ----------------------------------------------------------------------------
+/** Checks that generateSphericalHarmonics() computes the same coefficients as
+ *  the reference implementation, for random faces of different sizes.
+ */
+void SphericalHarmonics::unitTesting()
+{
+    uint32_t seed = 1234;
+    // Returns a random byte
+    auto random = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return (unsigned char)((seed >> 16) & 0xff);
+    };
+
+    // Sizes which are not a multiple of 4 test the padding of the table
+    const size_t sizes[] = { 16, 13, 128, 130 };
+    for (size_t edge_size : sizes)
+    {
+        std::vector<unsigned char> faces[6];
+        unsigned char *sh_rgba[6];
+        for (unsigned face = 0; face < 6; face++)
+        {
+            // Different brightness per face, so that the higher order
+            // coefficients are not 0
+            faces[face].resize(edge_size * edge_size * 4);
+            for (size_t n = 0; n < faces[face].size(); n++)
+                faces[face][n] = random() / (face + 1);
+            sh_rgba[face] = faces[face].data();
+        }
+
+        SHCoefficients reference, coeff;
+        projectSHReference(sh_rgba, edge_size, &reference);
+        const double start = StkTime::getRealTime();
+        generateSphericalHarmonics(sh_rgba, edge_size, &coeff);
+        const double end = StkTime::getRealTime();
+
+        const float *ref_channels[3] = { reference.blue_SH_coeff,
+                                         reference.green_SH_coeff,
+                                         reference.red_SH_coeff };
+        const float *channels[3] = { coeff.blue_SH_coeff,
+                                     coeff.green_SH_coeff,
+                                     coeff.red_SH_coeff };
+        // Largest error relative to L00, the SSE2 sRGB conversion is less
+        // accurate than the scalar one
+        float max_error = 0.0f;
+        for (unsigned c = 0; c < 3; c++)
+        {
+            for (unsigned k = 0; k < 9; k++)
+            {
+                max_error = std::max(max_error,
+                    fabsf(channels[c][k] - ref_channels[c][k]) /
+                    fabsf(ref_channels[c][0]));
+            }
+        }
+        assert(max_error < 0.005f);
+        Log::info("SphericalHarmonics", "%dx%d faces projected in %.3f ms, "
+                  "relative error %f.", (int)edge_size, (int)edge_size,
+                  (end - start) * 1000.0, max_error);
+    }
+}   // unitTesting
+
 #endif   // !SERVER_ONLY
 
@@ -49,7 +49,9 @@ private:
     /** The spherical harmonics coefficients */
     SHCoefficients *m_SH_coeff;
 
-    void generateSphericalHarmonics(unsigned char *sh_rgba[6], size_t edge_size);
+    static void generateSphericalHarmonics(unsigned char *sh_rgba[6],
+                                           size_t edge_size,
+                                           SHCoefficients *sh_coeff);
     
 public:
     SphericalHarmonics(const std::vector<irr::video::ITexture *> &spherical_harmonics_textures);
@@ -70,6 +72,8 @@ public:
                       float *Y11[], float *Y2minus2[], float *Y2minus1[],
                       float * Y20[], float *Y21[], float *Y22[],
                       float *output[]);
+
+    static void unitTesting();
 };
 
 #endif //HEADER_SPHERICAL_HARMONICS_HPP
@@ -0,0 +1,386 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef SERVER_ONLY
+
+#include "graphics/sprite_batch.hpp"
+
+#include "graphics/irr_driver.hpp"
+#include "graphics/texture_shader.hpp"
+
+#include <ITexture.h>
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+
+SpriteBatch  *SpriteBatch::m_active           = NULL;
+unsigned int  SpriteBatch::m_num_sprites      = 0;
+unsigned int  SpriteBatch::m_num_draws        = 0;
+unsigned int  SpriteBatch::m_last_num_sprites = 0;
+unsigned int  SpriteBatch::m_last_num_draws   = 0;
+
+// ============================================================================
+class SpriteBatchShader : public TextureShader<SpriteBatchShader, 1>
+{
+public:
+    SpriteBatchShader()
+    {
+        loadProgram(OBJECT, GL_VERTEX_SHADER, "spritebatch.vert",
+                            GL_FRAGMENT_SHADER, "colortexturedquad.frag");
+        assignUniforms();
+        assignSamplerNames(0, "tex", ST_BILINEAR_FILTERED);
+    }   // SpriteBatchShader
+};   // SpriteBatchShader
+
+// ============================================================================
+SpriteBatch::SpriteBatch()
+{
+    m_vao = 0;
+    m_vbo = 0;
+    m_ibo = 0;
+    m_vbo_size = 0;
+    m_ibo_quads = 0;
+    m_depth = 0;
+}   // SpriteBatch
+
+// ----------------------------------------------------------------------------
+SpriteBatch::~SpriteBatch()
+{
+    if (m_active == this)
+        m_active = NULL;
+    if (m_vao == 0)
+        return;
+    glDeleteVertexArrays(1, &m_vao);
+    glDeleteBuffers(1, &m_vbo);
+    glDeleteBuffers(1, &m_ibo);
+}   // ~SpriteBatch
+
+// ----------------------------------------------------------------------------
+/** Creates the buffers and the vertex array object when the batch is drawn
+ *  for the first time. */
+void SpriteBatch::createBuffers()
+{
+    glGenBuffers(1, &m_vbo);
+    glGenBuffers(1, &m_ibo);
+    glGenVertexArrays(1, &m_vao);
+    glBindVertexArray(m_vao);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          (GLvoid*)offsetof(Vertex, m_position));
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, sizeof(Vertex),
+                          (GLvoid*)offsetof(Vertex, m_tcoords));
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(Vertex),
+                          (GLvoid*)offsetof(Vertex, m_color));
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+}   // createBuffers
+
+// ----------------------------------------------------------------------------
+/** Starts collecting the quads of draw2DImage(). Calls can be nested, the
+ *  quads are drawn at the latest by the outermost end().
+ */
+void SpriteBatch::begin()
+{
+    assert(m_active == NULL || m_active == this);
+    m_active = this;
+    m_depth++;
+}   // begin
+
+// ----------------------------------------------------------------------------
+/** Ends a begin(), and draws all collected quads if it is the outermost
+ *  one. */
+void SpriteBatch::end()
+{
+    assert(m_active == this && m_depth > 0);
+    if (--m_depth > 0)
+        return;
+    flush();
+    m_active = NULL;
+}   // end
+
+// ----------------------------------------------------------------------------
+/** Adds a quad to the batch.
+ *  \param texture The texture of the quad.
+ *  \param dest The destination rectangle in pixels.
+ *  \param source The source rectangle in texels.
+ *  \param clip Optional clip rectangle, the quad is not drawn if it is not
+ *         valid (like in draw2DImage()).
+ *  \param colors Either NULL (white) or the 4 colors of the corners, in the
+ *         order used by draw2DImage().
+ *  \param blend How the quad is blended.
+ */
+void SpriteBatch::add(const video::ITexture *texture,
+                      const core::rect<float> &dest,
+                      const core::rect<s32> &source,
+                      const core::rect<s32> *clip,
+                      const video::SColor *colors, BlendMode blend)
+{
+    if (clip && !clip->isValid())
+        return;
+
+    const core::dimension2d<u32> &screen = irr_driver->getActualScreenSize();
+    const float left   = dest.UpperLeftCorner.X  * 2.0f / screen.Width - 1.0f;
+    const float right  = dest.LowerRightCorner.X * 2.0f / screen.Width - 1.0f;
+    const float top    = 1.0f - dest.UpperLeftCorner.Y  * 2.0f / screen.Height;
+    const float bottom = 1.0f - dest.LowerRightCorner.Y * 2.0f / screen.Height;
+
+    const core::dimension2d<u32> &size = texture->getSize();
+    const float u0 = float(source.UpperLeftCorner.X)  / size.Width;
+    const float u1 = float(source.LowerRightCorner.X) / size.Width;
+    float v_top    = float(source.UpperLeftCorner.Y)  / size.Height;
+    float v_bottom = float(source.LowerRightCorner.Y) / size.Height;
+    // Render targets are upside down
+    if (texture->isRenderTarget())
+        std::swap(v_top, v_bottom);
+
+    Vertex quad[4] =
+    {
+        { { left,  bottom }, { u0, v_bottom }, 0xffffffff },
+        { { left,  top    }, { u0, v_top    }, 0xffffffff },
+        { { right, bottom }, { u1, v_bottom }, 0xffffffff },
+        { { right, top    }, { u1, v_top    }, 0xffffffff }
+    };
+    if (colors)
+    {
+        for (unsigned int i = 0; i < 4; i++)
+            quad[i].m_color = colors[i].color;
+    }
+
+    core::rect<float> bounds = dest;
+    bounds.repair();
+    addQuad(texture->getOpenGLTextureName(), blend, clip, bounds, quad);
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Adds the vertices of a quad to a group. It joins the latest group with
+ *  the same texture, blend mode and clip rectangle, unless a later group
+ *  overlaps the quad (then it would be drawn before a quad which was added
+ *  before it, and which it might cover). Otherwise a new group is created.
+ *  \param texture The OpenGL texture of the quad.
+ *  \param blend How the quad is blended.
+ *  \param clip Optional clip rectangle.
+ *  \param bounds The destination rectangle in pixels, used for the overlap
+ *         test.
+ *  \param quad The 4 vertices of the quad.
+ */
+void SpriteBatch::addQuad(GLuint texture, BlendMode blend,
+                          const core::rect<s32> *clip,
+                          const core::rect<float> &bounds,
+                          const Vertex *quad)
+{
+    Group *group = NULL;
+    for (int i = (int)m_groups.size() - 1; i >= 0; i--)
+    {
+        Group &g = m_groups[i];
+        if (g.m_texture == texture && g.m_blend == blend &&
+            g.m_has_clip == (clip != NULL) && (!clip || g.m_clip == *clip))
+        {
+            group = &g;
+            break;
+        }
+        if (g.m_bounds.isRectCollided(bounds))
+            break;
+    }
+
+    if (!group)
+    {
+        m_groups.emplace_back();
+        group = &m_groups.back();
+        group->m_texture = texture;
+        group->m_blend = blend;
+        group->m_has_clip = clip != NULL;
+        if (clip)
+            group->m_clip = *clip;
+        group->m_bounds = bounds;
+        group->m_first = 0;
+    }
+    else
+    {
+        group->m_bounds.addInternalPoint(bounds.UpperLeftCorner);
+        group->m_bounds.addInternalPoint(bounds.LowerRightCorner);
+    }
+    group->m_vertices.insert(group->m_vertices.end(), quad, quad + 4);
+}   // addQuad
+
+// ----------------------------------------------------------------------------
+/** Makes sure the index buffer has the indices for num_quads quads. */
+void SpriteBatch::resizeIndexBuffer(unsigned int num_quads)
+{
+    if (num_quads <= m_ibo_quads)
+        return;
+    m_ibo_quads = num_quads * 2;
+    std::vector<GLuint> indices(m_ibo_quads * 6);
+    for (unsigned int i = 0; i < m_ibo_quads; i++)
+    {
+        // Two triangles in the order of a triangle strip
+        indices[i * 6    ] = i * 4;
+        indices[i * 6 + 1] = i * 4 + 1;
+        indices[i * 6 + 2] = i * 4 + 2;
+        indices[i * 6 + 3] = i * 4 + 2;
+        indices[i * 6 + 4] = i * 4 + 1;
+        indices[i * 6 + 5] = i * 4 + 3;
+    }
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, m_ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint),
+                 indices.data(), GL_STATIC_DRAW);
+}   // resizeIndexBuffer
+
+// ----------------------------------------------------------------------------
+/** Draws all quads added so far, with one draw call per group. */
+void SpriteBatch::flush()
+{
+    if (m_groups.empty())
+        return;
+
+    m_vertex_data.clear();
+    for (Group &group : m_groups)
+    {
+        group.m_first = (unsigned int)(m_vertex_data.size() / 4);
+        m_vertex_data.insert(m_vertex_data.end(), group.m_vertices.begin(),
+                             group.m_vertices.end());
+    }
+    const unsigned int num_quads = (unsigned int)(m_vertex_data.size() / 4);
+
+    if (m_vao == 0)
+        createBuffers();
+    glBindVertexArray(m_vao);
+    resizeIndexBuffer(num_quads);
+    const size_t size = m_vertex_data.size() * sizeof(Vertex);
+    glBindBuffer(GL_ARRAY_BUFFER, m_vbo);
+    if (size > m_vbo_size)
+        m_vbo_size = size * 2;
+    // Orphan the buffer, the last batch might still be drawn from it
+    glBufferData(GL_ARRAY_BUFFER, m_vbo_size, NULL, GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, size, m_vertex_data.data());
+
+    SpriteBatchShader::getInstance()->use();
+    const core::dimension2d<u32> &screen = irr_driver->getActualScreenSize();
+    for (const Group &group : m_groups)
+    {
+        switch (group.m_blend)
+        {
+        case BM_NONE:
+            glDisable(GL_BLEND);
+            break;
+        case BM_ALPHA:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+            break;
+        case BM_ADDITIVE:
+            glEnable(GL_BLEND);
+            glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+            break;
+        }
+        if (group.m_has_clip)
+        {
+            glEnable(GL_SCISSOR_TEST);
+            glScissor(group.m_clip.UpperLeftCorner.X,
+                      screen.Height - group.m_clip.LowerRightCorner.Y,
+                      group.m_clip.getWidth(), group.m_clip.getHeight());
+        }
+        SpriteBatchShader::getInstance()->setTextureUnits(group.m_texture);
+        glDrawElements(GL_TRIANGLES, (GLsizei)(group.m_vertices.size() / 4 * 6),
+                       GL_UNSIGNED_INT,
+                       (GLvoid*)(group.m_first * 6 * sizeof(GLuint)));
+        if (group.m_has_clip)
+            glDisable(GL_SCISSOR_TEST);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+
+    m_num_sprites += num_quads;
+    m_num_draws += (unsigned int)m_groups.size();
+    m_groups.clear();
+}   // flush
+
+// ----------------------------------------------------------------------------
+/** Called once per frame, keeps the statistics of the frame which has just
+ *  been rendered. */
+void SpriteBatch::resetStats()
+{
+    m_last_num_sprites = m_num_sprites;
+    m_last_num_draws = m_num_draws;
+    m_num_sprites = 0;
+    m_num_draws = 0;
+}   // resetStats
+
+// ----------------------------------------------------------------------------
+/** Checks the grouping of quads: quads only join an earlier group if this
+ *  does not change the drawing order of overlapping quads, and texture,
+ *  blend mode and clip rectangle must match. No OpenGL calls are made.
+ */
+void SpriteBatch::unitTesting()
+{
+    const Vertex quad[4] = {};
+    const core::rect<s32> clip(0, 0, 100, 100);
+    const core::rect<s32> other_clip(0, 0, 50, 50);
+    // Returns the number of quads in a group
+    auto size = [](const Group &g)
+    {
+        return (unsigned int)g.m_vertices.size() / 4;
+    };
+
+    SpriteBatch batch;
+    // Like glyphs of one text (which touch, but do not overlap) with an
+    // icon of another texture between them
+    batch.addQuad(1, BM_ALPHA, NULL, core::rect<float>(0, 0, 10, 10), quad);
+    batch.addQuad(2, BM_ALPHA, NULL, core::rect<float>(50, 0, 60, 10), quad);
+    batch.addQuad(1, BM_ALPHA, NULL, core::rect<float>(10, 0, 20, 10), quad);
+    assert(batch.m_groups.size() == 2);
+    assert(batch.m_groups[0].m_texture == 1 && size(batch.m_groups[0]) == 2);
+    assert(batch.m_groups[1].m_texture == 2 && size(batch.m_groups[1]) == 1);
+    assert(batch.m_groups[0].m_bounds == core::rect<float>(0, 0, 20, 10));
+
+    // A quad covering the icon must be drawn after it, so it can not join
+    // the first group
+    batch.addQuad(1, BM_ALPHA, NULL, core::rect<float>(55, 5, 65, 15), quad);
+    assert(batch.m_groups.size() == 3);
+    assert(batch.m_groups[2].m_texture == 1 && size(batch.m_groups[2]) == 1);
+
+    // The latest matching group is used
+    batch.addQuad(1, BM_ALPHA, NULL, core::rect<float>(0, 50, 10, 60), quad);
+    assert(batch.m_groups.size() == 3 && size(batch.m_groups[2]) == 2);
+
+    // A quad of the same texture which overlaps only its own group joins it
+    batch.addQuad(1, BM_ALPHA, NULL, core::rect<float>(5, 55, 15, 65), quad);
+    assert(batch.m_groups.size() == 3 && size(batch.m_groups[2]) == 3);
+    batch.m_groups.clear();
+
+    // Blend mode and clip rectangle separate groups
+    batch.addQuad(1, BM_ALPHA,    NULL, core::rect<float>(0, 0, 1, 1), quad);
+    batch.addQuad(1, BM_ADDITIVE, NULL, core::rect<float>(2, 0, 3, 1), quad);
+    batch.addQuad(1, BM_ALPHA, &clip,   core::rect<float>(4, 0, 5, 1), quad);
+    batch.addQuad(1, BM_ALPHA, &other_clip,
+                  core::rect<float>(6, 0, 7, 1), quad);
+    assert(batch.m_groups.size() == 4);
+    batch.addQuad(1, BM_ALPHA, &clip,   core::rect<float>(8, 0, 9, 1), quad);
+    batch.addQuad(1, BM_ALPHA,    NULL, core::rect<float>(10, 0, 11, 1), quad);
+    assert(batch.m_groups.size() == 4);
+    assert(size(batch.m_groups[0]) == 2 && size(batch.m_groups[1]) == 1 &&
+           size(batch.m_groups[2]) == 2 && size(batch.m_groups[3]) == 1);
+    batch.m_groups.clear();
+}   // unitTesting
+
+#endif   // !SERVER_ONLY
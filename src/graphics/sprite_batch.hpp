@@ -0,0 +1,153 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SPRITE_BATCH_HPP
+#define HEADER_SPRITE_BATCH_HPP
+
+#ifndef SERVER_ONLY
+
+#include "graphics/gl_headers.hpp"
+#include "utils/no_copy.hpp"
+
+#include <rect.h>
+#include <SColor.h>
+#include <vector>
+
+namespace irr
+{
+    namespace video { class ITexture; }
+}
+using namespace irr;
+
+/**
+  * \brief Draws 2D textured quads with as few draw calls as possible.
+  *  While a batch is active (between begin() and end()), draw2DImage()
+  *  adds its quad to the batch instead of drawing it. When the batch is
+  *  flushed, the quads are grouped by OpenGL texture (so all quads using
+  *  the same texture atlas, e.g. a glyph page of a font, share a group),
+  *  blend mode and clip rectangle. All quads are uploaded into one dynamic
+  *  vertex buffer, and each group is drawn with one draw call.
+  *  A quad is only moved into an earlier group if it does not overlap any
+  *  quad of a later group, so the result is the same as drawing the quads
+  *  in the order they were added. The other 2D drawing functions flush the
+  *  active batch before drawing.
+  * \ingroup graphics
+  */
+class SpriteBatch : public NoCopy
+{
+public:
+    enum BlendMode
+    {
+        BM_NONE,
+        BM_ALPHA,
+        BM_ADDITIVE
+    };   // BlendMode
+
+private:
+    /** A vertex of a quad, the position is in normalized device
+     *  coordinates. */
+    struct Vertex
+    {
+        float    m_position[2];
+        float    m_tcoords[2];
+        uint32_t m_color;
+    };   // Vertex
+
+    /** Quads using the same texture, blend mode and clip rectangle. */
+    struct Group
+    {
+        GLuint              m_texture;
+        BlendMode           m_blend;
+        bool                m_has_clip;
+        core::rect<s32>     m_clip;
+        /** Bounding box of all quads of this group, in pixels. */
+        core::rect<float>   m_bounds;
+        std::vector<Vertex> m_vertices;
+        /** Index of the first quad of this group in the vertex buffer. */
+        unsigned int        m_first;
+    };   // Group
+
+    std::vector<Group>  m_groups;
+    std::vector<Vertex> m_vertex_data;
+
+    GLuint       m_vao;
+    GLuint       m_vbo;
+    GLuint       m_ibo;
+    size_t       m_vbo_size;
+    /** Number of quads the index buffer has indices for. */
+    unsigned int m_ibo_quads;
+
+    /** Number of nested begin() calls. */
+    unsigned int m_depth;
+
+    /** The batch which collects the quads of draw2DImage(), or NULL. */
+    static SpriteBatch *m_active;
+
+    /** Number of quads and draw calls of the current and the last frame. */
+    static unsigned int m_num_sprites, m_num_draws;
+    static unsigned int m_last_num_sprites, m_last_num_draws;
+
+    // ------------------------------------------------------------------------
+    void createBuffers();
+    void addQuad(GLuint texture, BlendMode blend, const core::rect<s32> *clip,
+                 const core::rect<float> &bounds, const Vertex *quad);
+    void resizeIndexBuffer(unsigned int num_quads);
+
+public:
+         SpriteBatch();
+        ~SpriteBatch();
+    void begin();
+    void end();
+    void flush();
+    void add(const video::ITexture *texture, const core::rect<float> &dest,
+             const core::rect<s32> &source, const core::rect<s32> *clip,
+             const video::SColor *colors, BlendMode blend);
+    static void resetStats();
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    void add(const video::ITexture *texture, const core::rect<s32> &dest,
+             const core::rect<s32> &source, const core::rect<s32> *clip,
+             const video::SColor *colors, BlendMode blend)
+    {
+        add(texture, core::rect<float>((float)dest.UpperLeftCorner.X,
+                                       (float)dest.UpperLeftCorner.Y,
+                                       (float)dest.LowerRightCorner.X,
+                                       (float)dest.LowerRightCorner.Y),
+            source, clip, colors, blend);
+    }   // add
+    // ------------------------------------------------------------------------
+    /** Returns the batch which currently collects 2D quads, or NULL. */
+    static SpriteBatch *getActive()                       { return m_active; }
+    // ------------------------------------------------------------------------
+    /** Draws the quads of the active batch (if any), before something else
+     *  is drawn on top of them. */
+    static void flushActive()
+    {
+        if (m_active)
+            m_active->flush();
+    }   // flushActive
+    // ------------------------------------------------------------------------
+    /** Returns the number of quads drawn with batches in the last frame. */
+    static unsigned int getNumSprites()         { return m_last_num_sprites; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of draw calls used for them in the last frame. */
+    static unsigned int getNumDraws()             { return m_last_num_draws; }
+};   // SpriteBatch
+
+#endif   // !SERVER_ONLY
+#endif
@@ -32,13 +32,15 @@
 
 using namespace irr;
 
+float* STKAnimatedMesh::m_joint_buffer = NULL;
+
 STKAnimatedMesh::STKAnimatedMesh(irr::scene::IAnimatedMesh* mesh, irr::scene::ISceneNode* parent,
 irr::scene::ISceneManager* mgr, s32 id, const std::string& debug_name,
 const core::vector3df& position,
 const core::vector3df& rotation,
 const core::vector3df& scale, RenderInfo* render_info, bool all_parts_colorized) :
     CAnimatedMeshSceneNode(mesh, parent, mgr, id, position, rotation, scale),
-    m_skinned_mesh(NULL), m_skinning_offset(-1)
+    m_skinned_mesh(NULL), m_skinning_offset(-1), m_joints_animated(false)
 {
     isGLInitialized = false;
     isMaterialInitialized = false;
@@ -279,12 +281,15 @@ void STKAnimatedMesh::updateGL()
 
     if (useHardwareSkinning() && m_skinned_mesh->getTotalJoints() == 0) return;
 
-    scene::IMesh* m = getMeshForCurrentFrame();
     if (useHardwareSkinning())
     {
+        if (!m_joints_animated)
+            getMeshForCurrentFrame();
+        m_joints_animated = false;
         m_skinning_offset = -1;
         return;
     }
+    scene::IMesh* m = getMeshForCurrentFrame();
 
     for (u32 i = 0; i<m->getMeshBufferCount(); ++i)
     {
@@ -293,7 +298,10 @@ void STKAnimatedMesh::updateGL()
         if (isObject(material.MaterialType))
         {
 
-            size_t size = mb->getVertexCount() * GLmeshes[i].Stride, offset = GLmeshes[i].vaoBaseVertex * GLmeshes[i].Stride;
+            // The shared vertex buffers might store the vertices packed
+            const bool shared = CVS->supportsAsyncInstanceUpload() || CVS->isARBBaseInstanceUsable();
+            const size_t stride = shared ? VAOManager::getInstance()->getVertexPitch(mb->getVertexType()) : GLmeshes[i].Stride;
+            size_t size = mb->getVertexCount() * stride, offset = GLmeshes[i].vaoBaseVertex * stride;
             void *buf;
             if (CVS->supportsAsyncInstanceUpload())
             {
@@ -310,7 +318,10 @@ void STKAnimatedMesh::updateGL()
                 GLbitfield bitfield = GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT;
                 buf = glMapBufferRange(GL_ARRAY_BUFFER, offset, size, bitfield);
             }
-            memcpy(buf, mb->getVertices(), size);
+            if (shared)
+                VAOManager::getInstance()->packVertices(mb, buf);
+            else
+                memcpy(buf, mb->getVertices(), size);
             if (!CVS->supportsAsyncInstanceUpload())
             {
                 glUnmapBuffer(GL_ARRAY_BUFFER);
@@ -365,6 +376,20 @@ scene::IMesh* STKAnimatedMesh::getMeshForCurrentFrame(SkinningCallback sc,
         (uploadJoints, m_skinning_offset);
 }
 
+/** Computes the joint matrices of this frame into the joint buffer (see
+ *  setJointBuffer) instead of uploading each of them. Can be called from a
+ *  worker thread, but not at the same time as for another node which uses
+ *  the same mesh.
+ */
+void STKAnimatedMesh::animateJoints()
+{
+    assert(useHardwareSkinning() && m_skinning_offset != -1);
+    assert(m_joint_buffer);
+    scene::CAnimatedMeshSceneNode::getMeshForCurrentFrame(copyJoints,
+                                                          m_skinning_offset);
+    m_joints_animated = true;
+}
+
 void STKAnimatedMesh::setHardwareSkinning(bool val)
 {
     if (!CVS->supportsHardwareSkinning()) return;
@@ -383,4 +408,12 @@ void STKAnimatedMesh::uploadJoints(const irr::core::matrix4& m,
         16 * sizeof(float), m.pointer());
 }
 
+void STKAnimatedMesh::copyJoints(const irr::core::matrix4& m,
+                                 int joint, int offset)
+{
+    assert(offset != -1);
+    memcpy(m_joint_buffer + offset / sizeof(float) + joint * 16, m.pointer(),
+           16 * sizeof(float));
+}
+
 #endif   // !SERVER_ONLY
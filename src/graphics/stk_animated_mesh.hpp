@@ -62,15 +62,26 @@ public:
   void setHardwareSkinning(bool val);
   void resetSkinningState(scene::IAnimatedMesh*);
 
+  void animateJoints();
+
   // Callback for skinning mesh
   static void uploadJoints(const irr::core::matrix4& m,
                            int joint, int offset);
+  static void copyJoints(const irr::core::matrix4& m,
+                         int joint, int offset);
+  /** Sets the buffer into which animateJoints() writes the joint matrices,
+   *  which has the same layout as the skinning UBO. */
+  static void setJointBuffer(float* buffer) { m_joint_buffer = buffer; }
 private:
     RenderInfo* m_mesh_render_info;
     bool m_all_parts_colorized;
     bool m_got_animated_matrix;
     irr::scene::CSkinnedMesh* m_skinned_mesh;
     int m_skinning_offset;
+    /** True if the joints of this frame were already computed by
+     *  animateJoints(). */
+    bool m_joints_animated;
+    static float* m_joint_buffer;
 };
 
 #endif // STKANIMATEDMESH_HPP
@@ -22,22 +22,43 @@
 #include "graphics/materials.hpp"
 #include "graphics/threaded_tex_loader.hpp"
 #include "graphics/stk_texture.hpp"
+#include "graphics/texture_residency.hpp"
 #include "io/file_manager.hpp"
+#include "modes/profile_world.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/log.hpp"
 
 #include <algorithm>
 
 // ----------------------------------------------------------------------------
 STKTexManager::STKTexManager() : m_pbo(0), m_thread_size(0),
+                                 m_texture_residency(NULL),
+                                 m_load_report_pending(false),
+                                 m_load_report_start(0.0),
+                                 m_loaded_textures(0), m_cached_mipmaps(0),
+                                 m_generated_mipmaps(0),
+                                 m_texture_load_time(0), m_mipmap_time(0),
                                  m_threaded_load_textures_counter(0)
 {
     createThreadedTexLoaders();
+#ifndef SERVER_ONLY
+    // Streaming replaces the OpenGL textures, which does not work with
+    // bindless textures, and compressed textures use their own cache
+    if (UserConfigParams::m_texture_streaming &&
+        !ProfileWorld::isNoGraphics() && CVS->isGLSL() &&
+        !CVS->isAZDOEnabled() && !CVS->isTextureCompressionEnabled())
+        m_texture_residency = new TextureResidency();
+#endif
 }   // STKTexManager
 
 // ----------------------------------------------------------------------------
 STKTexManager::~STKTexManager()
 {
+#ifndef SERVER_ONLY
+    delete m_texture_residency;
+    m_texture_residency = NULL;
+#endif
     removeTexture(NULL/*texture*/, true/*remove_all*/);
     destroyThreadedTexLoaders();
 }   // ~STKTexManager
@@ -64,7 +85,17 @@ void STKTexManager::createThreadedTexLoaders()
             " each capacity %d MB.", m_thread_size,
             each_capacity / 1024 / 1024);
         if (UserConfigParams::m_hq_mipmap)
+        {
             Log::info("STKTexManager", "High quality mipmap enabled.");
+            if (UserConfigParams::m_mipmap_cache)
+            {
+                m_mipmap_cache_dir =
+                    file_manager->getCachedTexturesDir() + "mipmaps/";
+                if (!file_manager->checkAndCreateDirectoryP(
+                    m_mipmap_cache_dir))
+                    m_mipmap_cache_dir = "";
+            }
+        }
         glGenBuffers(1, &m_pbo);
         glBindBuffer(GL_PIXEL_UNPACK_BUFFER, m_pbo);
         glBufferStorage(GL_PIXEL_UNPACK_BUFFER, pbo_size, NULL,
@@ -170,6 +201,7 @@ video::ITexture* STKTexManager::getTexture(const std::string& path,
 
     if (create_if_unfound)
     {
+        const double start = StkTime::getRealTime();
         new_texture = new STKTexture(full_path.empty() ? path : full_path,
             tc, no_upload);
         if (new_texture->getOpenGLTextureName() == 0 && !no_upload)
@@ -186,6 +218,8 @@ video::ITexture* STKTexManager::getTexture(const std::string& path,
             delete new_texture;
             return NULL;
         }
+        m_loaded_textures.fetch_add(1);
+        addTextureLoadTime(StkTime::getRealTime() - start);
         if (new_texture->useThreadedLoading())
         {
             addThreadedLoadTexture(new_texture);
@@ -194,7 +228,13 @@ video::ITexture* STKTexManager::getTexture(const std::string& path,
     }
 
     if (create_if_unfound && !no_upload)
+    {
         addTexture(new_texture);
+#ifndef SERVER_ONLY
+        if (m_texture_residency && new_texture->getMipBias() > 0)
+            m_texture_residency->addTexture(new_texture);
+#endif
+    }
     return new_texture;
 }   // getTexture
 
@@ -224,6 +264,10 @@ void STKTexManager::removeTexture(STKTexture* texture, bool remove_all)
 #ifdef DEBUG
             if (remove_all && p->second->getReferenceCount() != 1)
                 undeleted_texture.push_back(p->second->getName().getPtr());
+#endif
+#ifndef SERVER_ONLY
+            if (m_texture_residency && p->second)
+                m_texture_residency->removeTexture(p->second);
 #endif
             p->second->drop();
             p = m_all_textures.erase(p);
@@ -411,7 +455,10 @@ void STKTexManager::checkThreadedLoadTextures(bool util_queue_empty)
         }
     }
     if (empty_queue && !uploaded)
+    {
+        updateLoadReport();
         return;
+    }
     uploaded = false;
     for (ThreadedTexLoader* ttl : m_all_tex_loaders)
     {
@@ -448,5 +495,77 @@ void STKTexManager::checkThreadedLoadTextures(bool util_queue_empty)
         for (ThreadedTexLoader* ttl : m_all_tex_loaders)
             ttl->unlock(true/*finish_it*/);
     }
+    updateLoadReport();
 #endif
 }   // checkThreadedLoadTextures
+
+// ----------------------------------------------------------------------------
+/** Returns true if the threaded texture loaders have textures which are not
+ *  uploaded yet.
+ */
+bool STKTexManager::hasThreadedLoadTextures()
+{
+#if !(defined(SERVER_ONLY) || defined(USE_GLES2))
+    if (!CVS->supportsThreadedTextureLoading())
+        return false;
+    pthread_mutex_lock(&m_threaded_load_textures_mutex);
+    const bool loading = m_threaded_load_textures_counter != 0;
+    pthread_mutex_unlock(&m_threaded_load_textures_mutex);
+    if (loading)
+        return true;
+    for (ThreadedTexLoader* ttl : m_all_tex_loaders)
+    {
+        if (ttl->lastQueueReady())
+            return true;
+    }
+#endif
+    return false;
+}   // hasThreadedLoadTextures
+
+// ----------------------------------------------------------------------------
+/** Starts collecting statistics about the textures loaded from now on, which
+ *  are printed once endLoadReport() was called and all textures are
+ *  uploaded.
+ *  \param name Name of the track which is loaded.
+ */
+void STKTexManager::beginLoadReport(const std::string& name)
+{
+    m_load_report_name    = name;
+    m_load_report_pending = false;
+    m_load_report_start   = StkTime::getRealTime();
+    m_loaded_textures     = 0;
+    m_cached_mipmaps      = 0;
+    m_generated_mipmaps   = 0;
+    m_texture_load_time   = 0;
+    m_mipmap_time         = 0;
+}   // beginLoadReport
+
+// ----------------------------------------------------------------------------
+/** Prints the load report started with beginLoadReport(), or delays it until
+ *  the threaded loaders have uploaded all textures.
+ */
+void STKTexManager::endLoadReport()
+{
+    if (m_load_report_name.empty())
+        return;
+    m_load_report_pending = true;
+    updateLoadReport();
+}   // endLoadReport
+
+// ----------------------------------------------------------------------------
+/** Prints the pending load report if all textures are uploaded.
+ */
+void STKTexManager::updateLoadReport()
+{
+    if (!m_load_report_pending || hasThreadedLoadTextures())
+        return;
+    Log::info("STKTexManager", "Textures of track '%s': %d loaded in "
+        "%.0f ms, high quality mipmaps: %d from the cache, %d generated, "
+        "%.0f ms; all uploaded after %.0f ms.", m_load_report_name.c_str(),
+        m_loaded_textures.load(), m_texture_load_time.load() / 1000.0,
+        m_cached_mipmaps.load(), m_generated_mipmaps.load(),
+        m_mipmap_time.load() / 1000.0,
+        (StkTime::getRealTime() - m_load_report_start) * 1000.0);
+    m_load_report_pending = false;
+    m_load_report_name    = "";
+}   // updateLoadReport
@@ -26,6 +26,7 @@
 #include "ITexture.h"
 #include <pthread.h>
 
+#include <atomic>
 #include <cassert>
 #include <string>
 #include <queue>
@@ -33,6 +34,7 @@
 #include <vector>
 
 class STKTexture;
+class TextureResidency;
 class ThreadedTexLoader;
 namespace irr
 {
@@ -75,6 +77,31 @@ private:
 
     int m_thread_size;
 
+    /** Streams the resolution of mesh textures, NULL if not used. */
+    TextureResidency* m_texture_residency;
+
+    /** Directory of the high quality mipmap cache, empty if the cache is
+     *  not used. */
+    std::string m_mipmap_cache_dir;
+
+    /** Name of the track whose texture loading is reported, see
+     *  beginLoadReport(). */
+    std::string m_load_report_name;
+
+    /** True if the load report is printed once all textures are
+     *  uploaded. */
+    bool m_load_report_pending;
+
+    /** Time at which the load report was started. */
+    double m_load_report_start;
+
+    /** Statistics of the load report, updated by the loader threads. */
+    std::atomic<int> m_loaded_textures, m_cached_mipmaps, m_generated_mipmaps;
+
+    /** Time (in microseconds, summed over all threads) used to load
+     *  textures and to create their high quality mipmaps. */
+    std::atomic<uint64_t> m_texture_load_time, m_mipmap_time;
+
     class SmallestTexture
     {
     public:
@@ -97,6 +124,8 @@ private:
     // ------------------------------------------------------------------------
     STKTexture* findTextureInFileSystem(const std::string& filename,
                                         std::string* full_path);
+    // ------------------------------------------------------------------------
+    void updateLoadReport();
 public:
     // ------------------------------------------------------------------------
     STKTexManager();
@@ -203,6 +232,39 @@ public:
     void createThreadedTexLoaders();
     // ------------------------------------------------------------------------
     void destroyThreadedTexLoaders();
+    // ------------------------------------------------------------------------
+    bool hasThreadedLoadTextures();
+    // ------------------------------------------------------------------------
+    /** Returns the texture residency manager, or NULL if textures are not
+     *  streamed. */
+    TextureResidency* getTextureResidency() const
+                                                { return m_texture_residency; }
+    // ------------------------------------------------------------------------
+    /** Returns the directory of the high quality mipmap cache, or "" if
+     *  the cache is not used. */
+    const std::string& getMipmapCacheDir() const  { return m_mipmap_cache_dir; }
+    // ------------------------------------------------------------------------
+    void beginLoadReport(const std::string& name);
+    // ------------------------------------------------------------------------
+    void endLoadReport();
+    // ------------------------------------------------------------------------
+    /** Adds the time used to load a texture to the load report. Can be
+     *  called from any thread.
+     *  \param time Time in s. */
+    void addTextureLoadTime(double time)
+    {
+        m_texture_load_time.fetch_add(uint64_t(time * 1000000.0));
+    }   // addTextureLoadTime
+    // ------------------------------------------------------------------------
+    /** Adds the time used to create the high quality mipmaps of a texture to
+     *  the load report. Can be called from any thread.
+     *  \param cached True if the mipmaps were read from the mipmap cache.
+     *  \param time Time in s. */
+    void addMipmapTime(bool cached, double time)
+    {
+        (cached ? m_cached_mipmaps : m_generated_mipmaps).fetch_add(1);
+        m_mipmap_time.fetch_add(uint64_t(time * 1000000.0));
+    }   // addMipmapTime
 
 };   // STKTexManager
 
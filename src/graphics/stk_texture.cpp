@@ -24,10 +24,13 @@
 #include "graphics/material_manager.hpp"
 #include "graphics/materials.hpp"
 #include "graphics/stk_tex_manager.hpp"
+#include "graphics/texture_residency.hpp"
 #include "modes/profile_world.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 
+#include <algorithm>
 #include <fstream>
 #include <functional>
 
@@ -39,7 +42,7 @@ STKTexture::STKTexture(const std::string& path, TexConfig* tc, bool no_upload)
           : video::ITexture(path.c_str()), m_texture_handle(0),
             m_single_channel(false), m_tex_config(NULL), m_material(NULL),
             m_texture_name(0), m_texture_size(0), m_texture_image(NULL),
-            m_file(NULL), m_img_loader(NULL)
+            m_file(NULL), m_img_loader(NULL), m_mip_bias(0)
 {
     if (tc != NULL)
     {
@@ -58,6 +61,11 @@ STKTexture::STKTexture(const std::string& path, TexConfig* tc, bool no_upload)
 #endif
     if (!CVS->isARBTextureSwizzleUsable())
         m_single_channel = false;
+    // Streamed textures start with the lowest resolution
+    if (!no_upload && isMeshTexture() &&
+        STKTexManager::getInstance()->getTextureResidency() &&
+        (!m_material || m_material->getAlphaMask().empty()))
+        m_mip_bias = TextureResidency::INITIAL_MIP_BIAS;
 #endif
     reload(no_upload);
 }   // STKTexture
@@ -68,7 +76,8 @@ STKTexture::STKTexture(uint8_t* data, const std::string& name, size_t size,
           : video::ITexture(name.c_str()), m_texture_handle(0),
             m_single_channel(single_channel), m_tex_config(NULL),
             m_material(NULL), m_texture_name(0), m_texture_size(0),
-            m_texture_image(NULL), m_file(NULL), m_img_loader(NULL)
+            m_texture_image(NULL), m_file(NULL), m_img_loader(NULL),
+            m_mip_bias(0)
 {
     m_size.Width = size;
     m_size.Height = size;
@@ -82,7 +91,7 @@ STKTexture::STKTexture(video::IImage* img, const std::string& name)
           : video::ITexture(name.c_str()), m_texture_handle(0),
             m_single_channel(false), m_tex_config(NULL), m_material(NULL),
             m_texture_name(0), m_texture_size(0), m_texture_image(NULL),
-            m_file(NULL), m_img_loader(NULL)
+            m_file(NULL), m_img_loader(NULL), m_mip_bias(0)
 {
     reload(false/*no_upload*/, NULL/*preload_data*/, img);
 }   // STKTexture
@@ -176,6 +185,9 @@ void STKTexture::reload(bool no_upload, uint8_t* preload_data,
                 &m_img_loader);
             if (m_img_loader == NULL)
                 return;
+            // Only images which can be decoded in a thread can be streamed
+            if (!m_img_loader->supportThreadedLoading())
+                m_mip_bias = 0;
             m_file->seek(0);
             m_orig_size = m_img_loader->getImageSize(m_file);
             if ((!m_material || m_material->getAlphaMask().empty()) &&
@@ -205,11 +217,12 @@ void STKTexture::reload(bool no_upload, uint8_t* preload_data,
             }
         }
         orig_img = resizeImage(orig_img, &m_orig_size, &m_size);
+        m_mip_bias = std::min(m_mip_bias, getMaxMipBias());
         applyMask(orig_img);
         data = orig_img ? (uint8_t*)orig_img->lock() : NULL;
         if (m_single_channel && !useThreadedLoading())
         {
-            data = singleChannelConversion(data);
+            data = singleChannelConversion(data, m_size);
             orig_img->unlock();
             orig_img->drop();
             orig_img = NULL;
@@ -345,16 +358,16 @@ void STKTexture::formatConversion(uint8_t* data, unsigned int* format,
 }   // formatConversion
 
 // ----------------------------------------------------------------------------
-video::IImage* STKTexture::resizeImage(video::IImage* orig_img,
-                                       core::dimension2du* orig_size,
-                                       core::dimension2du* final_size) const
+/** Returns the size of the texture for an image of the given size, i.e. the
+ *  size supported by the driver, reduced by the given number of mipmap
+ *  levels (but not below MIN_STREAMED_SIZE).
+ */
+core::dimension2du STKTexture::getTextureSize(const core::dimension2du& img_size,
+                                              unsigned int mip_bias) const
 {
-    video::IImage* image = orig_img;
+    core::dimension2du tex_size = img_size;
 #ifndef SERVER_ONLY
-    if (image == NULL)
-        assert(orig_size && orig_size->Width > 0 && orig_size->Height > 0);
-    core::dimension2du img_size = image ? image->getDimension() : *orig_size;
-    core::dimension2du tex_size = img_size.getOptimalSize
+    tex_size = img_size.getOptimalSize
         (!irr_driver->getVideoDriver()->queryFeature(video::EVDF_TEXTURE_NPOT));
     const core::dimension2du& max_size = irr_driver->getVideoDriver()
         ->getDriverAttributes().getAttributeAsDimension2d("MAX_TEXTURE_SIZE");
@@ -364,14 +377,26 @@ video::IImage* STKTexture::resizeImage(video::IImage* orig_img,
     if (tex_size.Height > max_size.Height)
         tex_size.Height = max_size.Height;
 
-    if (orig_size && final_size)
+    while (mip_bias > 0 && tex_size.Width >= MIN_STREAMED_SIZE * 2 &&
+           tex_size.Height >= MIN_STREAMED_SIZE * 2)
     {
-        *orig_size = img_size;
-        *final_size = tex_size;
+        tex_size.Width >>= 1;
+        tex_size.Height >>= 1;
+        mip_bias--;
     }
-    if (image == NULL)
-        return NULL;
+#endif   // !SERVER_ONLY
+    return tex_size;
+}   // getTextureSize
 
+// ----------------------------------------------------------------------------
+/** Converts an image to A8R8G8B8 with the given size if necessary. The
+ *  original image is dropped if a new image is returned.
+ */
+video::IImage* STKTexture::convertImage(video::IImage* image,
+                                        const core::dimension2du& tex_size) const
+{
+#ifndef SERVER_ONLY
+    const core::dimension2du& img_size = image->getDimension();
     if (image->getColorFormat() != video::ECF_A8R8G8B8 ||
         tex_size != img_size)
     {
@@ -384,7 +409,31 @@ video::IImage* STKTexture::resizeImage(video::IImage* orig_img,
         image->drop();
         image = new_texture;
     }
+#endif   // !SERVER_ONLY
+    return image;
+}   // convertImage
 
+// ----------------------------------------------------------------------------
+video::IImage* STKTexture::resizeImage(video::IImage* orig_img,
+                                       core::dimension2du* orig_size,
+                                       core::dimension2du* final_size) const
+{
+    video::IImage* image = orig_img;
+#ifndef SERVER_ONLY
+    if (image == NULL)
+        assert(orig_size && orig_size->Width > 0 && orig_size->Height > 0);
+    core::dimension2du img_size = image ? image->getDimension() : *orig_size;
+    core::dimension2du tex_size = getTextureSize(img_size, m_mip_bias);
+
+    if (orig_size && final_size)
+    {
+        *orig_size = img_size;
+        *final_size = tex_size;
+    }
+    if (image == NULL)
+        return NULL;
+
+    image = convertImage(image, tex_size);
 #endif   // !SERVER_ONLY
     return image;
 }   // resizeImage
@@ -660,13 +709,14 @@ bool STKTexture::useThreadedLoading() const
 void STKTexture::threadedReload(void* ptr, void* param) const
 {
 #if !(defined(SERVER_ONLY) || defined(USE_GLES2))
+    const double start = StkTime::getRealTime();
     video::IImage* orig_img =
         m_img_loader->loadImage(m_file, true/*skip_checking*/);
     orig_img = resizeImage(orig_img);
     uint8_t* data = (uint8_t*)orig_img->lock();
     if (m_single_channel)
     {
-        data = singleChannelConversion(data);
+        data = singleChannelConversion(data, m_size);
         orig_img->unlock();
         orig_img->drop();
         orig_img = NULL;
@@ -680,6 +730,8 @@ void STKTexture::threadedReload(void* ptr, void* param) const
         orig_img->setDeleteMemory(false);
         orig_img->drop();
     }
+    ((STKTexManager*)(param))->addTextureLoadTime(StkTime::getRealTime() -
+        start);
     if (useHQMipmap())
     {
         HQMipmapGenerator* hqmg = new HQMipmapGenerator(NamedPath, data,
@@ -741,3 +793,128 @@ bool STKTexture::isMeshTexture() const
 {
     return m_tex_config && m_tex_config->m_mesh_tex;
 }   // isMeshTexture
+
+//-----------------------------------------------------------------------------
+/** Returns the number of mipmap levels which can be skipped when streaming
+ *  this texture, 0 if the texture is not larger than MIN_STREAMED_SIZE.
+ */
+unsigned int STKTexture::getMaxMipBias() const
+{
+    core::dimension2du size = getTextureSize(m_orig_size, 0);
+    unsigned int bias = 0;
+    while (size.Width >= MIN_STREAMED_SIZE * 2 &&
+           size.Height >= MIN_STREAMED_SIZE * 2)
+    {
+        size.Width >>= 1;
+        size.Height >>= 1;
+        bias++;
+    }
+    return bias;
+}   // getMaxMipBias
+
+//-----------------------------------------------------------------------------
+/** Returns the size in bytes of the first mipmap level if the texture is
+ *  loaded with the given mipmap bias.
+ */
+unsigned int STKTexture::getTextureSizeForMipBias(unsigned int bias) const
+{
+    const core::dimension2du size = getTextureSize(m_orig_size, bias);
+    return size.Width * size.Height * (m_single_channel ? 1 : 4);
+}   // getTextureSizeForMipBias
+
+//-----------------------------------------------------------------------------
+/** Decodes the image of this texture for the given mipmap bias. This only
+ *  uses constant data of the texture and can be called in any thread.
+ *  \param file The opened image file, which is not dropped.
+ *  \param loader The image loader for the file.
+ *  \param bias Number of mipmap levels to skip.
+ *  \param size On return the size of the texture.
+ *  \return The data to upload with uploadForMipBias, or NULL if the image
+ *          cannot be decoded.
+ */
+uint8_t* STKTexture::decodeForMipBias(io::IReadFile* file,
+                                      video::IImageLoader* loader,
+                                      unsigned int bias,
+                                      core::dimension2du* size) const
+{
+#ifndef SERVER_ONLY
+    file->seek(0);
+    video::IImage* img = loader->loadImage(file);
+    if (img == NULL || img->getDimension().Width == 0 ||
+        img->getDimension().Height == 0)
+    {
+        if (img)
+            img->drop();
+        return NULL;
+    }
+    *size = getTextureSize(img->getDimension(), bias);
+    img = convertImage(img, *size);
+    uint8_t* data = (uint8_t*)img->lock();
+    if (m_single_channel)
+    {
+        data = singleChannelConversion(data, *size);
+        img->unlock();
+        img->drop();
+    }
+    else
+    {
+        img->unlock();
+        img->setDeleteMemory(false);
+        img->drop();
+    }
+    formatConversion(data, NULL, size->Width, size->Height);
+    return data;
+#else
+    return NULL;
+#endif   // !SERVER_ONLY
+}   // decodeForMipBias
+
+//-----------------------------------------------------------------------------
+/** Replaces the texture with data decoded by decodeForMipBias. A new OpenGL
+ *  texture is created, since textures loaded with the threaded loader have
+ *  immutable storage.
+ *  \param data The data, which is deleted.
+ *  \param size Size of the data.
+ *  \param bias The mipmap bias of the data.
+ */
+void STKTexture::uploadForMipBias(uint8_t* data, const core::dimension2du& size,
+                                  unsigned int bias)
+{
+#ifndef SERVER_ONLY
+    unsigned int format = m_single_channel ? GL_RED : GL_BGRA;
+    unsigned int internal_format = m_single_channel ? GL_R8 : isSrgb() ?
+                                                    GL_SRGB8_ALPHA8 : GL_RGBA8;
+#if defined(USE_GLES2)
+    if (!m_single_channel)
+        format = GL_RGBA;
+    if (!CVS->isGLSL())
+        internal_format = GL_RGBA;
+#endif
+
+    GLuint texture_name = 0;
+    glGenTextures(1, &texture_name);
+    glBindTexture(GL_TEXTURE_2D, texture_name);
+    if (m_single_channel)
+    {
+        glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_R, GL_ONE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_G, GL_ONE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_B, GL_ONE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_SWIZZLE_A, GL_RED);
+    }
+    glTexImage2D(GL_TEXTURE_2D, 0, internal_format, size.Width, size.Height,
+        0, format, GL_UNSIGNED_BYTE, data);
+    if (hasMipMaps())
+        glGenerateMipmap(GL_TEXTURE_2D);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    delete[] data;
+
+    unloadHandle();
+    if (m_texture_name != 0)
+        glDeleteTextures(1, &m_texture_name);
+    m_texture_name = texture_name;
+    m_size = size;
+    m_texture_size = size.Width * size.Height * (m_single_channel ? 1 : 4);
+    m_mip_bias = bias;
+#endif   // !SERVER_ONLY
+}   // uploadForMipBias
@@ -58,6 +58,17 @@ private:
 
     video::IImageLoader* m_img_loader;
 
+    /** Number of mipmap levels which are not loaded, i.e. the texture is
+     *  loaded with 1/2^m_mip_bias of its full size. Only used for streamed
+     *  textures, see TextureResidency. */
+    unsigned int m_mip_bias;
+
+    // ------------------------------------------------------------------------
+    core::dimension2du getTextureSize(const core::dimension2du& img_size,
+                                      unsigned int mip_bias) const;
+    // ------------------------------------------------------------------------
+    video::IImage* convertImage(video::IImage* image,
+                                const core::dimension2du& tex_size) const;
     // ------------------------------------------------------------------------
     video::IImage* resizeImage(video::IImage* orig_img,
                                core::dimension2du* orig_size = NULL,
@@ -72,10 +83,11 @@ private:
     void formatConversion(uint8_t* data, unsigned int* format, unsigned int w,
                           unsigned int h) const;
     // ------------------------------------------------------------------------
-    uint8_t* singleChannelConversion(uint8_t* data) const
+    uint8_t* singleChannelConversion(uint8_t* data,
+                                     const core::dimension2du& size) const
     {
-        uint8_t* sc = new uint8_t[m_size.Width * m_size.Height];
-        for (unsigned int i = 0; i < m_size.Width * m_size.Height; i++)
+        uint8_t* sc = new uint8_t[size.Width * size.Height];
+        for (unsigned int i = 0; i < size.Width * size.Height; i++)
             sc[i] = data[4 * i + 3];
         return sc;
     }
@@ -87,6 +99,9 @@ private:
     bool isPremulAlpha() const;
 
 public:
+    /** Streamed textures are never reduced below this size. */
+    static const unsigned int MIN_STREAMED_SIZE = 32;
+
     // ------------------------------------------------------------------------
     STKTexture(const std::string& path, TexConfig* tc, bool no_upload = false);
     // ------------------------------------------------------------------------
@@ -156,6 +171,24 @@ public:
     }
     // ------------------------------------------------------------------------
     bool isMeshTexture() const;
+    // ------------------------------------------------------------------------
+    /** Sets the number of mipmap levels to skip when the texture is loaded
+     *  the next time. */
+    void setMipBias(unsigned int bias)                    { m_mip_bias = bias; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of mipmap levels which are not loaded. */
+    unsigned int getMipBias() const                       { return m_mip_bias; }
+    // ------------------------------------------------------------------------
+    unsigned int getMaxMipBias() const;
+    // ------------------------------------------------------------------------
+    unsigned int getTextureSizeForMipBias(unsigned int bias) const;
+    // ------------------------------------------------------------------------
+    uint8_t* decodeForMipBias(io::IReadFile* file, video::IImageLoader* loader,
+                              unsigned int bias,
+                              core::dimension2du* size) const;
+    // ------------------------------------------------------------------------
+    void uploadForMipBias(uint8_t* data, const core::dimension2du& size,
+                          unsigned int bias);
 
 };   // STKTexture
 
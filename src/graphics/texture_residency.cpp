@@ -0,0 +1,405 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef SERVER_ONLY
+
+#include "graphics/texture_residency.hpp"
+#include "config/user_config.hpp"
+#include "graphics/irr_driver.hpp"
+#include "graphics/stk_mesh.hpp"
+#include "graphics/stk_tex_manager.hpp"
+#include "graphics/stk_texture.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+#include "utils/vs.hpp"
+
+#include <ICameraSceneNode.h>
+#include <IFileSystem.h>
+#include <IImageLoader.h>
+#include <IReadFile.h>
+
+#include <algorithm>
+
+/** Number of updates a texture must not have been seen before it can be
+ *  evicted. */
+static const unsigned int EVICT_FRAMES = 300;
+
+/** Maximum number of higher resolutions decoded at the same time. Keeping
+ *  this small makes sure that new requests for the textures covering most
+ *  of the screen are handled quickly. */
+static const unsigned int MAX_REQUESTS = 4;
+
+/** Maximum number of bytes uploaded in one update. */
+static const unsigned int MAX_UPLOAD_BYTES = 16 * 1024 * 1024;
+
+// ----------------------------------------------------------------------------
+TextureResidency::TextureResidency()
+{
+    m_decoding          = NULL;
+    m_abort             = false;
+    m_frame             = 0;
+    m_num_requests      = 0;
+    m_budget            = (uint64_t)std::max(0, (int)UserConfigParams::
+                          m_texture_budget) * 1024 * 1024;
+    m_resident_bytes    = 0;
+    m_committed_bytes   = 0;
+    m_stream_in_latency = 0;
+    m_thread = std::thread([this]() { decodeThread(); });
+    Log::info("TextureResidency", "Texture streaming with a budget of %d MB.",
+              (int)(m_budget / 1024 / 1024));
+}   // TextureResidency
+
+// ----------------------------------------------------------------------------
+TextureResidency::~TextureResidency()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_abort = true;
+    }
+    m_cv.notify_all();
+    m_thread.join();
+    for (Request &r : m_requests)
+        r.m_file->drop();
+    for (Result &r : m_results)
+        delete [] r.m_data;
+}   // ~TextureResidency
+
+// ----------------------------------------------------------------------------
+/** The background thread, which decodes the requested textures. */
+void TextureResidency::decodeThread()
+{
+    VS::setThreadName("TexStreaming");
+    while (true)
+    {
+        Request r;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv.wait(lock, [this]()
+                            { return m_abort || !m_requests.empty(); });
+            if (m_abort)
+                return;
+            r = m_requests.front();
+            m_requests.pop_front();
+            m_decoding = r.m_texture;
+        }
+        Result result;
+        result.m_texture = r.m_texture;
+        result.m_bias    = r.m_bias;
+        result.m_time    = r.m_time;
+        result.m_data    = r.m_texture->decodeForMipBias(r.m_file, r.m_loader,
+                                                        r.m_bias,
+                                                        &result.m_size);
+        r.m_file->drop();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_results.push_back(result);
+            m_decoding = NULL;
+        }
+        // Wakes up removeTexture if it waits for this texture
+        m_cv.notify_all();
+    }
+}   // decodeThread
+
+// ----------------------------------------------------------------------------
+/** Returns the memory used by a texture including its mipmaps. */
+uint64_t TextureResidency::getBytes(const STKTexture *texture,
+                                    unsigned int bias) const
+{
+    return (uint64_t)texture->getTextureSizeForMipBias(bias) * 4 / 3;
+}   // getBytes
+
+// ----------------------------------------------------------------------------
+/** Adds a texture loaded with a mipmap bias, which is then streamed. */
+void TextureResidency::addTexture(STKTexture *texture)
+{
+    Entry entry;
+    entry.m_texture      = texture;
+    entry.m_screen_size  = 0;
+    entry.m_last_visible = m_frame;
+    entry.m_pending_bias = -1;
+    m_entries[texture]   = entry;
+    const uint64_t bytes = getBytes(texture, texture->getMipBias());
+    m_resident_bytes    += bytes;
+    m_committed_bytes   += bytes;
+}   // addTexture
+
+// ----------------------------------------------------------------------------
+/** Removes a texture before it is deleted. If the texture is decoded at the
+ *  moment, this waits until the decoding is done.
+ */
+void TextureResidency::removeTexture(STKTexture *texture)
+{
+    auto it = m_entries.find(texture);
+    if (it == m_entries.end())
+        return;
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        for (auto r = m_requests.begin(); r != m_requests.end();)
+        {
+            if (r->m_texture != texture)
+            {
+                r++;
+                continue;
+            }
+            r->m_file->drop();
+            r = m_requests.erase(r);
+            m_num_requests--;
+        }
+        m_cv.wait(lock, [this, texture]() { return m_decoding != texture; });
+        for (auto r = m_results.begin(); r != m_results.end();)
+        {
+            if (r->m_texture != texture)
+            {
+                r++;
+                continue;
+            }
+            delete [] r->m_data;
+            r = m_results.erase(r);
+            m_num_requests--;
+        }
+    }
+
+    const uint64_t bytes = getBytes(texture, texture->getMipBias());
+    m_resident_bytes  -= bytes;
+    m_committed_bytes -= it->second.m_pending_bias >= 0
+                       ? getBytes(texture, it->second.m_pending_bias) : bytes;
+    m_entries.erase(it);
+}   // removeTexture
+
+// ----------------------------------------------------------------------------
+/** Called for each mesh node which is visible in the main camera. The size
+ *  covered on screen by the bounding box of the node determines the
+ *  resolution needed for its textures. This assumes that each texture is
+ *  mapped once over the node, which overestimates the resolution needed
+ *  for tiled textures.
+ *  \param node The mesh node.
+ *  \param box The bounding box of the node in world space.
+ *  \param camera The camera.
+ */
+void TextureResidency::markVisible(const STKMeshCommon *node,
+                                   const core::aabbox3df &box,
+                                   const scene::ICameraSceneNode *camera)
+{
+    const float radius   = box.getExtent().getLength() * 0.5f;
+    const float distance =
+        std::max(box.getCenter().getDistanceFrom(camera->getAbsolutePosition())
+                 - radius, camera->getNearValue());
+    // The projection matrix scales by cot(fov/2), which maps to half of
+    // the screen height
+    const float screen_size = radius / distance
+                            * camera->getProjectionMatrix()[5]
+                            * irr_driver->getActualScreenSize().Height;
+
+    auto mark = [this, screen_size](const GLMesh *mesh)
+    {
+        for (unsigned int i = 0; i < 8; i++)
+        {
+            if (!mesh->textures[i])
+                continue;
+            auto it = m_entries.find(mesh->textures[i]);
+            if (it == m_entries.end())
+                continue;
+            it->second.m_screen_size  = std::max(it->second.m_screen_size,
+                                                 screen_size);
+            it->second.m_last_visible = m_frame;
+        }
+    };
+    for (unsigned int i = 0; i < Material::SHADERTYPE_COUNT; i++)
+    {
+        for (const GLMesh *mesh : node->MeshSolidMaterial[i])
+            mark(mesh);
+    }
+    for (unsigned int i = 0; i < TM_COUNT; i++)
+    {
+        for (const GLMesh *mesh : node->TransparentMesh[i])
+            mark(mesh);
+    }
+}   // markVisible
+
+// ----------------------------------------------------------------------------
+/** Requests a texture to be decoded with a different mipmap bias. */
+void TextureResidency::request(Entry *entry, unsigned int bias)
+{
+    STKTexture *texture = entry->m_texture;
+    io::IReadFile *file = irr_driver->getDevice()->getFileSystem()
+        ->createAndOpenFile(texture->getName());
+    if (!file)
+        return;
+    video::IImageLoader *loader = NULL;
+    irr_driver->getVideoDriver()->createImageFromFile(file, &loader);
+    if (!loader || !loader->supportThreadedLoading())
+    {
+        file->drop();
+        return;
+    }
+
+    m_committed_bytes = m_committed_bytes + getBytes(texture, bias)
+                      - getBytes(texture, texture->getMipBias());
+    entry->m_pending_bias = bias;
+    m_num_requests++;
+
+    Request r;
+    r.m_texture = texture;
+    r.m_file    = file;
+    r.m_loader  = loader;
+    r.m_bias    = bias;
+    r.m_time    = StkTime::getRealTime();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_requests.push_back(r);
+    }
+    m_cv.notify_all();
+}   // request
+
+// ----------------------------------------------------------------------------
+/** Uploads the textures decoded by the thread, up to MAX_UPLOAD_BYTES. */
+void TextureResidency::uploadResults()
+{
+    std::vector<Result> results;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (m_results.empty())
+            return;
+        results.swap(m_results);
+    }
+
+    unsigned int uploaded = 0;
+    unsigned int i = 0;
+    for (; i < results.size() && uploaded < MAX_UPLOAD_BYTES; i++)
+    {
+        const Result &r = results[i];
+        Entry &entry = m_entries[r.m_texture];
+        const unsigned int old_bias = r.m_texture->getMipBias();
+        entry.m_pending_bias = -1;
+        m_num_requests--;
+        if (!r.m_data)
+        {
+            Log::warn("TextureResidency", "Cannot stream texture %s.",
+                      r.m_texture->getName().getPtr());
+            m_committed_bytes = m_committed_bytes
+                              + getBytes(r.m_texture, old_bias)
+                              - getBytes(r.m_texture, r.m_bias);
+            continue;
+        }
+        m_resident_bytes = m_resident_bytes + getBytes(r.m_texture, r.m_bias)
+                         - getBytes(r.m_texture, old_bias);
+        uploaded += r.m_size.Width * r.m_size.Height * 4;
+        r.m_texture->uploadForMipBias(r.m_data, r.m_size, r.m_bias);
+        if (r.m_bias < old_bias)
+        {
+            const float latency = float(StkTime::getRealTime() - r.m_time);
+            m_stream_in_latency = m_stream_in_latency == 0 ? latency
+                                : 0.9f * m_stream_in_latency + 0.1f * latency;
+        }
+    }
+
+    if (i < results.size())
+    {
+        // Keep the rest for the next update
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_results.insert(m_results.begin(), results.begin() + i,
+                         results.end());
+    }
+}   // uploadResults
+
+// ----------------------------------------------------------------------------
+/** Called once per frame after all visible nodes were marked. Uploads the
+ *  decoded textures, requests higher resolutions for the visible textures
+ *  which need them, and evicts textures if the budget is exceeded.
+ */
+void TextureResidency::update()
+{
+    // Wait until the threaded loader has uploaded all textures
+    if (STKTexManager::getInstance()->hasThreadedLoadTextures())
+        return;
+
+    uploadResults();
+
+    // Find the textures which need a higher resolution
+    std::vector<std::pair<float, Entry*> > stream_in;
+    for (auto &p : m_entries)
+    {
+        Entry &entry = p.second;
+        if (entry.m_last_visible != m_frame || entry.m_pending_bias >= 0)
+            continue;
+        const STKTexture *texture = entry.m_texture;
+        const float size = (float)std::max(texture->getSize().Width,
+                                           texture->getSize().Height);
+        if (texture->getMipBias() > 0 && size < entry.m_screen_size)
+            stream_in.push_back(std::make_pair(entry.m_screen_size, &entry));
+    }
+    std::sort(stream_in.begin(), stream_in.end(),
+              [](const std::pair<float, Entry*> &a,
+                 const std::pair<float, Entry*> &b)
+              {
+                  return a.first > b.first;
+              });
+
+    // Candidates for eviction, least recently seen first
+    std::vector<Entry*> evict;
+    bool evict_sorted = false;
+
+    for (auto &p : stream_in)
+    {
+        if (m_num_requests >= MAX_REQUESTS)
+            break;
+        Entry *entry = p.second;
+        // Stream in one level at a time, so that the textures covering the
+        // most of the screen improve first
+        const unsigned int bias = entry->m_texture->getMipBias() - 1;
+        const uint64_t extra = getBytes(entry->m_texture, bias)
+                        - getBytes(entry->m_texture, bias + 1);
+        if (m_committed_bytes + extra > m_budget)
+        {
+            if (!evict_sorted)
+            {
+                for (auto &e : m_entries)
+                {
+                    Entry &unused = e.second;
+                    if (unused.m_pending_bias < 0 &&
+                        unused.m_last_visible + EVICT_FRAMES < m_frame &&
+                        unused.m_texture->getMipBias() <
+                        unused.m_texture->getMaxMipBias())
+                        evict.push_back(&unused);
+                }
+                std::sort(evict.begin(), evict.end(),
+                          [](const Entry *a, const Entry *b)
+                          {
+                              return a->m_last_visible > b->m_last_visible;
+                          });
+                evict_sorted = true;
+            }
+            while (!evict.empty() && m_committed_bytes + extra > m_budget)
+            {
+                Entry *e = evict.back();
+                evict.pop_back();
+                request(e, e->m_texture->getMaxMipBias());
+            }
+            if (m_committed_bytes + extra > m_budget)
+                continue;
+        }
+        request(entry, bias);
+    }
+
+    for (auto &p : m_entries)
+        p.second.m_screen_size = 0;
+    m_frame++;
+}   // update
+
+#endif   // !SERVER_ONLY
@@ -0,0 +1,157 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TEXTURE_RESIDENCY_HPP
+#define HEADER_TEXTURE_RESIDENCY_HPP
+
+#ifndef SERVER_ONLY
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <aabbox3d.h>
+#include <dimension2d.h>
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace irr
+{
+    namespace io    { class IReadFile; }
+    namespace scene { class ICameraSceneNode; }
+    namespace video { class IImageLoader; class ITexture; }
+}
+class STKMeshCommon;
+class STKTexture;
+
+/**
+  * \brief Streams the resolution of mesh textures depending on how they
+  *  are seen, within a memory budget.
+  *  Streamed textures are loaded with the lowest resolution (see
+  *  STKTexture::MIN_STREAMED_SIZE). Each frame the visible mesh nodes
+  *  report the size (in pixels) they cover on screen, which determines
+  *  the resolution needed for their textures. Missing resolutions are
+  *  decoded in a background thread, textures covering more of the screen
+  *  first, and uploaded on the main thread. If the budget is exceeded,
+  *  textures which have not been seen for a while are evicted, i.e.
+  *  reduced to the lowest resolution again.
+  *  Streaming replaces the OpenGL texture, so it is not used with bindless
+  *  textures, and not with texture compression (which uses its own cache).
+  * \ingroup graphics
+  */
+class TextureResidency : public NoCopy
+{
+public:
+    /** Mipmap bias used to load textures with the lowest resolution. */
+    static const unsigned int INITIAL_MIP_BIAS = 16;
+
+private:
+    /** Per texture state. */
+    struct Entry
+    {
+        STKTexture  *m_texture;
+        /** Largest size (in pixels) covered on screen since the last
+         *  update. */
+        float        m_screen_size;
+        /** Frame in which the texture was last seen. */
+        unsigned int m_last_visible;
+        /** Mipmap bias which is decoded at the moment, or -1. */
+        int          m_pending_bias;
+    };   // Entry
+    std::unordered_map<irr::video::ITexture*, Entry> m_entries;
+
+    /** A texture to decode in the background. */
+    struct Request
+    {
+        STKTexture                *m_texture;
+        irr::io::IReadFile        *m_file;
+        irr::video::IImageLoader  *m_loader;
+        unsigned int               m_bias;
+        double                     m_time;
+    };   // Request
+
+    /** A decoded texture to upload. */
+    struct Result
+    {
+        STKTexture                *m_texture;
+        uint8_t                   *m_data;
+        irr::core::dimension2du    m_size;
+        unsigned int               m_bias;
+        double                     m_time;
+    };   // Result
+
+    /** Protects m_requests, m_results and m_decoding. */
+    std::mutex              m_mutex;
+    std::condition_variable m_cv;
+    std::deque<Request>     m_requests;
+    std::vector<Result>     m_results;
+    /** The texture decoded by the thread at the moment. */
+    STKTexture             *m_decoding;
+    bool                    m_abort;
+    std::thread             m_thread;
+
+    /** Counted up in each update. */
+    unsigned int m_frame;
+
+    /** Number of requests which are not uploaded yet. */
+    unsigned int m_num_requests;
+
+    /** Memory budget and memory used by all streamed textures (including
+     *  their mipmaps), and the memory they use once all pending requests
+     *  are done. */
+    uint64_t     m_budget, m_resident_bytes, m_committed_bytes;
+
+    /** Average time (in s) from requesting a higher resolution until it
+     *  is uploaded. */
+    float        m_stream_in_latency;
+
+    // ------------------------------------------------------------------------
+    void     decodeThread();
+    void     request(Entry *entry, unsigned int bias);
+    uint64_t getBytes(const STKTexture *texture, unsigned int bias) const;
+    void     uploadResults();
+
+public:
+             TextureResidency();
+            ~TextureResidency();
+    void     addTexture(STKTexture *texture);
+    void     removeTexture(STKTexture *texture);
+    void     markVisible(const STKMeshCommon *node,
+                         const irr::core::aabbox3df &box,
+                         const irr::scene::ICameraSceneNode *camera);
+    void     update();
+    // ------------------------------------------------------------------------
+    /** Returns the memory used by all streamed textures in bytes. */
+    uint64_t getResidentBytes() const           { return m_resident_bytes; }
+    // ------------------------------------------------------------------------
+    /** Returns the memory budget in bytes. */
+    uint64_t getBudget() const                          { return m_budget; }
+    // ------------------------------------------------------------------------
+    /** Returns the average stream in latency in s. */
+    float    getStreamInLatency() const      { return m_stream_in_latency; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of textures which are streamed at the moment. */
+    unsigned int getNumPending() const            { return m_num_requests; }
+};   // TextureResidency
+
+#endif   // !SERVER_ONLY
+#endif
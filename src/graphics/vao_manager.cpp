@@ -23,9 +23,145 @@
 #include "graphics/glwrap.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/stk_mesh.hpp"
+#include "utils/log.hpp"
+
+#include <CMeshBuffer.h>
+#include <SSkinMeshBuffer.h>
+#include <assert.h>
+#include <cmath>
+#include <cstring>
+
+namespace
+{
+    /** Layouts of the static vertex types in the shared vertex buffers if
+     *  packed vertices are used: positions and texture coordinates stay
+     *  float (track texture coordinates often tile far beyond the range
+     *  in which half floats are precise enough), normals and tangents are
+     *  stored as signed normalized 2_10_10_10 integers. */
+    struct PackedVertex
+    {
+        float    m_position[3];
+        uint32_t m_normal;
+        uint32_t m_color;
+        float    m_tcoords[2];
+    };   // PackedVertex
+
+    struct PackedVertex2TCoords
+    {
+        float    m_position[3];
+        uint32_t m_normal;
+        uint32_t m_color;
+        float    m_tcoords[2];
+        float    m_tcoords2[2];
+    };   // PackedVertex2TCoords
+
+    struct PackedVertexTangents
+    {
+        float    m_position[3];
+        uint32_t m_normal;
+        uint32_t m_color;
+        float    m_tcoords[2];
+        uint32_t m_tangent;
+        uint32_t m_bitangent;
+    };   // PackedVertexTangents
+
+    static_assert(sizeof(PackedVertex) == 28, "Wrong packed vertex size");
+    static_assert(sizeof(PackedVertex2TCoords) == 36,
+                  "Wrong packed vertex size");
+    static_assert(sizeof(PackedVertexTangents) == 36,
+                  "Wrong packed vertex size");
+
+    // ------------------------------------------------------------------------
+    /** Packs a direction into a GL_INT_2_10_10_10_REV value, with w = 0. */
+    uint32_t packDirection(core::vector3df v)
+    {
+        v.normalize();
+        const float c[3] = { v.X, v.Y, v.Z };
+        uint32_t result = 0;
+        for (unsigned int i = 0; i < 3; i++)
+        {
+            const int q = (int)roundf(core::clamp(c[i], -1.0f, 1.0f) * 511.0f);
+            result |= uint32_t(q & 0x3ff) << (i * 10);
+        }
+        return result;
+    }   // packDirection
+
+    // ------------------------------------------------------------------------
+    void packVertex(const video::S3DVertex &v, PackedVertex *p)
+    {
+        memcpy(p->m_position, &v.Pos, sizeof(p->m_position));
+        p->m_normal = packDirection(v.Normal);
+        p->m_color = v.Color.color;
+        memcpy(p->m_tcoords, &v.TCoords, sizeof(p->m_tcoords));
+    }   // packVertex
+
+    // ------------------------------------------------------------------------
+    void packVertex(const video::S3DVertex2TCoords &v, PackedVertex2TCoords *p)
+    {
+        packVertex(v, (PackedVertex*)p);
+        memcpy(p->m_tcoords2, &v.TCoords2, sizeof(p->m_tcoords2));
+    }   // packVertex
+
+    // ------------------------------------------------------------------------
+    void packVertex(const video::S3DVertexTangents &v, PackedVertexTangents *p)
+    {
+        packVertex(v, (PackedVertex*)p);
+        p->m_tangent = packDirection(v.Tangent);
+        p->m_bitangent = packDirection(v.Binormal);
+    }   // packVertex
+
+    // ------------------------------------------------------------------------
+    template<typename V, typename P>
+    void packVertices(const void *src, unsigned int count, void *dst)
+    {
+        const V *in = (const V*)src;
+        P *out = (P*)dst;
+        for (unsigned int i = 0; i < count; i++)
+            packVertex(in[i], out + i);
+    }   // packVertices
+
+    // ------------------------------------------------------------------------
+    template<typename T>
+    size_t freeArray(core::array<T> &a)
+    {
+        const size_t size = a.allocated_size() * sizeof(T);
+        a.clear();
+        return size;
+    }   // freeArray
+
+    // ------------------------------------------------------------------------
+    /** Frees the vertices and indices of a mesh buffer.
+     *  \return The number of bytes freed. */
+    size_t freeMeshBuffer(scene::IMeshBuffer *mb)
+    {
+        if (scene::SMeshBuffer *b = dynamic_cast<scene::SMeshBuffer*>(mb))
+            return freeArray(b->Vertices) + freeArray(b->Indices);
+        if (scene::SMeshBufferLightMap *b =
+            dynamic_cast<scene::SMeshBufferLightMap*>(mb))
+            return freeArray(b->Vertices) + freeArray(b->Indices);
+        if (scene::SMeshBufferTangents *b =
+            dynamic_cast<scene::SMeshBufferTangents*>(mb))
+            return freeArray(b->Vertices) + freeArray(b->Indices);
+        if (scene::SSkinMeshBuffer *b =
+            dynamic_cast<scene::SSkinMeshBuffer*>(mb))
+        {
+            return freeArray(b->Vertices_Standard) +
+                   freeArray(b->Vertices_2TCoords) +
+                   freeArray(b->Vertices_Tangents) +
+                   freeArray(b->Vertices_SkinnedMesh) +
+                   freeArray(b->Indices);
+        }
+        return 0;
+    }   // freeMeshBuffer
+}   // anonymous namespace
 
 VAOManager::VAOManager()
 {
+    m_packed_vertices = CVS->supportsPackedVertices();
+    m_vertex_bytes = 0;
+    m_unpacked_vertex_bytes = 0;
+    m_index_bytes = 0;
+    m_freed_bytes = 0;
     for (unsigned i = 0; i < VTXTYPE_COUNT; i++)
     {
         vao[i] = 0;
@@ -65,6 +201,14 @@ void VAOManager::cleanInstanceVAOs()
 
 VAOManager::~VAOManager()
 {
+    if (m_vertex_bytes > 0)
+    {
+        Log::info("VAOManager", "Shared vertex buffers: %d KB of vertices "
+                  "(%d KB unpacked), %d KB of indices, %d KB of CPU mesh "
+                  "data freed.", (int)(m_vertex_bytes / 1024),
+                  (int)(m_unpacked_vertex_bytes / 1024),
+                  (int)(m_index_bytes / 1024), (int)(m_freed_bytes / 1024));
+    }
     cleanInstanceVAOs();
     for (unsigned i = 0; i < VTXTYPE_COUNT; i++)
     {
@@ -123,17 +267,67 @@ void VAOManager::regenerateBuffer(enum VTXTYPE tp, size_t newlastvertex, size_t
     resizeBufferIfNecessary(last_index[tp], newlastindex, RealIBOSize[tp], sizeof(u16), GL_ELEMENT_ARRAY_BUFFER, ibo[tp], IBOPtr[tp]);
 }
 
-void VAOManager::regenerateVAO(enum VTXTYPE tp)
+/** Sets the vertex attributes of the vertex type tp for the currently bound
+ *  vertex buffer, using the packed layout if needed. */
+void VAOManager::bindVertexAttribs(enum VTXTYPE tp)
 {
-    if (vao[tp])
-        glDeleteVertexArrays(1, &vao[tp]);
-    glGenVertexArrays(1, &vao[tp]);
-    glBindVertexArray(vao[tp]);
-    glBindBuffer(GL_ARRAY_BUFFER, vbo[tp]);
+    if (!isPacked(tp))
+    {
+        VertexUtils::bindVertexArrayAttrib(getVertexType(tp));
+        return;
+    }
 
-    VertexUtils::bindVertexArrayAttrib(getVertexType(tp));
+    const GLsizei pitch = (GLsizei)getVertexPitch(tp);
+    // Position
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, pitch, 0);
+    // Normal
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_INT_2_10_10_10_REV, GL_TRUE, pitch,
+                          (GLvoid*)12);
+    // Color
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, pitch, (GLvoid*)16);
+    // Texcoord
+    glEnableVertexAttribArray(3);
+    glVertexAttribPointer(3, 2, GL_FLOAT, GL_FALSE, pitch, (GLvoid*)20);
+    if (tp == VTXTYPE_TCOORD)
+    {
+        // SecondTexcoord
+        glEnableVertexAttribArray(4);
+        glVertexAttribPointer(4, 2, GL_FLOAT, GL_FALSE, pitch, (GLvoid*)28);
+    }
+    else if (tp == VTXTYPE_TANGENT)
+    {
+        // Tangent
+        glEnableVertexAttribArray(5);
+        glVertexAttribPointer(5, 4, GL_INT_2_10_10_10_REV, GL_TRUE, pitch,
+                              (GLvoid*)28);
+        // Bitangent
+        glEnableVertexAttribArray(6);
+        glVertexAttribPointer(6, 4, GL_INT_2_10_10_10_REV, GL_TRUE, pitch,
+                              (GLvoid*)32);
+    }
+}
 
+/** Creates a vertex array for the shared buffers of the vertex type tp. The
+ *  vertex array is left bound. */
+GLuint VAOManager::createPoolVAO(enum VTXTYPE tp)
+{
+    GLuint result;
+    glGenVertexArrays(1, &result);
+    glBindVertexArray(result);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo[tp]);
+    bindVertexAttribs(tp);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ibo[tp]);
+    return result;
+}
+
+void VAOManager::regenerateVAO(enum VTXTYPE tp)
+{
+    if (vao[tp])
+        glDeleteVertexArrays(1, &vao[tp]);
+    vao[tp] = createPoolVAO(tp);
     glBindVertexArray(0);
 }
 
@@ -231,29 +425,29 @@ void VAOManager::regenerateInstancedVAO()
     for (unsigned i = 0; i < VTXTYPE_COUNT; i++)
     {
         video::E_VERTEX_TYPE tp = IrrVT[i];
-        if (!vbo[tp] || !ibo[tp])
+        if (!vbo[i] || !ibo[i])
             continue;
-        GLuint vao = createVAO(vbo[tp], ibo[tp], tp);
+        GLuint vao = createPoolVAO((VTXTYPE)i);
         glBindBuffer(GL_ARRAY_BUFFER, instance_vbo[InstanceTypeThreeTex]);
         VAOInstanceUtil<InstanceDataThreeTex>::SetVertexAttrib();
         InstanceVAO[std::pair<video::E_VERTEX_TYPE, InstanceType>(tp, InstanceTypeThreeTex)] = vao;
 
-        vao = createVAO(vbo[tp], ibo[tp], tp);
+        vao = createPoolVAO((VTXTYPE)i);
         glBindBuffer(GL_ARRAY_BUFFER, instance_vbo[InstanceTypeFourTex]);
         VAOInstanceUtil<InstanceDataFourTex>::SetVertexAttrib();
         InstanceVAO[std::pair<video::E_VERTEX_TYPE, InstanceType>(tp, InstanceTypeFourTex)] = vao;
 
-        vao = createVAO(vbo[tp], ibo[tp], tp);
+        vao = createPoolVAO((VTXTYPE)i);
         glBindBuffer(GL_ARRAY_BUFFER, instance_vbo[InstanceTypeShadow]);
         VAOInstanceUtil<InstanceDataSingleTex>::SetVertexAttrib();
         InstanceVAO[std::pair<video::E_VERTEX_TYPE, InstanceType>(tp, InstanceTypeShadow)] = vao;
 
-        vao = createVAO(vbo[tp], ibo[tp], tp);
+        vao = createPoolVAO((VTXTYPE)i);
         glBindBuffer(GL_ARRAY_BUFFER, instance_vbo[InstanceTypeRSM]);
         VAOInstanceUtil<InstanceDataSingleTex>::SetVertexAttrib();
         InstanceVAO[std::pair<video::E_VERTEX_TYPE, InstanceType>(tp, InstanceTypeRSM)] = vao;
 
-        vao = createVAO(vbo[tp], ibo[tp], tp);
+        vao = createPoolVAO((VTXTYPE)i);
         glBindBuffer(GL_ARRAY_BUFFER, instance_vbo[InstanceTypeGlow]);
         VAOInstanceUtil<GlowInstanceData>::SetVertexAttrib();
         InstanceVAO[std::pair<video::E_VERTEX_TYPE, InstanceType>(tp, InstanceTypeGlow)] = vao;
@@ -267,6 +461,18 @@ void VAOManager::regenerateInstancedVAO()
 
 size_t VAOManager::getVertexPitch(enum VTXTYPE tp) const
 {
+    if (isPacked(tp))
+    {
+        switch (tp)
+        {
+        case VTXTYPE_STANDARD:
+            return sizeof(PackedVertex);
+        case VTXTYPE_TCOORD:
+            return sizeof(PackedVertex2TCoords);
+        default:
+            return sizeof(PackedVertexTangents);
+        }
+    }
     switch (tp)
     {
     case VTXTYPE_STANDARD:
@@ -283,7 +489,7 @@ size_t VAOManager::getVertexPitch(enum VTXTYPE tp) const
     }
 }
 
-VAOManager::VTXTYPE VAOManager::getVTXTYPE(video::E_VERTEX_TYPE type)
+VAOManager::VTXTYPE VAOManager::getVTXTYPE(video::E_VERTEX_TYPE type) const
 {
     switch (type)
     {
@@ -322,17 +528,26 @@ void VAOManager::append(scene::IMeshBuffer *mb, VTXTYPE tp)
     size_t old_idx_cnt = last_index[tp];
 
     regenerateBuffer(tp, old_vtx_cnt + mb->getVertexCount(), old_idx_cnt + mb->getIndexCount());
+    const size_t vertex_size = mb->getVertexCount() * getVertexPitch(tp);
 #if !defined(USE_GLES2)
     if (CVS->supportsAsyncInstanceUpload())
     {
         void *tmp = (char*)VBOPtr[tp] + old_vtx_cnt * getVertexPitch(tp);
-        memcpy(tmp, mb->getVertices(), mb->getVertexCount() * getVertexPitch(tp));
+        packVertices(mb, tmp);
     }
     else
 #endif
     {
+        std::vector<uint8_t> packed;
+        const void *vertices = mb->getVertices();
+        if (isPacked(tp))
+        {
+            packed.resize(vertex_size);
+            packVertices(mb, packed.data());
+            vertices = packed.data();
+        }
         glBindBuffer(GL_ARRAY_BUFFER, vbo[tp]);
-        glBufferSubData(GL_ARRAY_BUFFER, old_vtx_cnt * getVertexPitch(tp), mb->getVertexCount() * getVertexPitch(tp), mb->getVertices());
+        glBufferSubData(GL_ARRAY_BUFFER, old_vtx_cnt * getVertexPitch(tp), vertex_size, vertices);
     }
 #if !defined(USE_GLES2)
     if (CVS->supportsAsyncInstanceUpload())
@@ -349,6 +564,11 @@ void VAOManager::append(scene::IMeshBuffer *mb, VTXTYPE tp)
 
     mappedBaseVertex[tp][mb] = old_vtx_cnt;
     mappedBaseIndex[tp][mb] = old_idx_cnt * sizeof(u16);
+
+    m_vertex_bytes += vertex_size;
+    m_unpacked_vertex_bytes += mb->getVertexCount() *
+                               getVertexPitchFromType(mb->getVertexType());
+    m_index_bytes += mb->getIndexCount() * sizeof(u16);
 }
 
 std::pair<unsigned, unsigned> VAOManager::getBase(scene::IMeshBuffer *mb)
@@ -371,4 +591,117 @@ std::pair<unsigned, unsigned> VAOManager::getBase(scene::IMeshBuffer *mb)
     return std::pair<unsigned, unsigned>(vtx, It->second);
 }
 
+/** Converts the vertices of a mesh buffer into the layout used in the shared
+ *  vertex buffers, see isPacked().
+ *  \param mb The mesh buffer.
+ *  \param dst Destination, which must hold the vertex count times
+ *         getVertexPitch() bytes.
+ */
+void VAOManager::packVertices(scene::IMeshBuffer *mb, void *dst) const
+{
+    const unsigned int count = mb->getVertexCount();
+    const VTXTYPE tp = getVTXTYPE(mb->getVertexType());
+    if (!isPacked(tp))
+    {
+        memcpy(dst, mb->getVertices(), count * getVertexPitch(tp));
+        return;
+    }
+    switch (tp)
+    {
+    case VTXTYPE_STANDARD:
+        ::packVertices<video::S3DVertex, PackedVertex>
+            (mb->getVertices(), count, dst);
+        break;
+    case VTXTYPE_TCOORD:
+        ::packVertices<video::S3DVertex2TCoords, PackedVertex2TCoords>
+            (mb->getVertices(), count, dst);
+        break;
+    default:
+        ::packVertices<video::S3DVertexTangents, PackedVertexTangents>
+            (mb->getVertices(), count, dst);
+        break;
+    }
+}
+
+/** Uploads all mesh buffers of a static mesh into the shared vertex buffers,
+ *  and frees their vertices and indices on the CPU. Afterwards the mesh can
+ *  only be drawn from the shared buffers, nothing must read its geometry
+ *  (e.g. to create physics) anymore.
+ *  \return The number of bytes freed.
+ */
+size_t VAOManager::uploadAndFreeMesh(scene::IMesh *mesh)
+{
+    size_t freed = 0;
+    for (unsigned int i = 0; i < mesh->getMeshBufferCount(); i++)
+    {
+        scene::IMeshBuffer *mb = mesh->getMeshBuffer(i);
+        if (mb->getVertexCount() == 0 || mb->getIndexCount() == 0)
+            continue;
+        getBase(mb);
+        freed += freeMeshBuffer(mb);
+    }
+    m_freed_bytes += freed;
+    return freed;
+}
+
+/** Checks that packDirection() quantizes directions like the GPU reads them
+ *  back as signed normalized 2_10_10_10 values: the sign is kept, +-1 is
+ *  exact, values outside [-1, 1] are clamped and w is 0.
+ */
+void VAOManager::unitTesting()
+{
+    // Decodes component i like OpenGL does for signed normalized values
+    auto unpack = [](uint32_t packed, unsigned int i)
+    {
+        int q = (packed >> (i * 10)) & 0x3ff;
+        if (q & 0x200)
+            q -= 0x400;
+        return std::max(q / 511.0f, -1.0f);
+    };
+
+    const core::vector3df axes[] =
+    {
+        core::vector3df( 1,  0,  0), core::vector3df(-1,  0,  0),
+        core::vector3df( 0,  1,  0), core::vector3df( 0, -1,  0),
+        core::vector3df( 0,  0,  1), core::vector3df( 0,  0, -1),
+        // Not normalized, the result must be clamped to +-1
+        core::vector3df(0, 0, 1000), core::vector3df(-1000, 0, 0)
+    };
+    for (const core::vector3df &axis : axes)
+    {
+        core::vector3df n = axis;
+        n.normalize();
+        const uint32_t packed = packDirection(axis);
+        assert((packed >> 30) == 0);
+        assert(unpack(packed, 0) == n.X);
+        assert(unpack(packed, 1) == n.Y);
+        assert(unpack(packed, 2) == n.Z);
+    }
+
+    uint32_t seed = 1234;
+    // Returns a random number in [-1, 1]
+    auto random = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return ((seed >> 8) & 0xffff) / 32767.5f - 1.0f;
+    };
+    for (unsigned int i = 0; i < 1000; i++)
+    {
+        core::vector3df v(random(), random(), random());
+        if (v.getLength() < 0.01f)
+            continue;
+        const uint32_t packed = packDirection(v);
+        assert((packed >> 30) == 0);
+        v.normalize();
+        const float c[3] = { v.X, v.Y, v.Z };
+        for (unsigned int j = 0; j < 3; j++)
+        {
+            const float u = unpack(packed, j);
+            // Rounded to the nearest step, and never flips the sign
+            assert(fabsf(u - c[j]) <= 0.5f / 511.0f + 1e-6f);
+            assert(u * c[j] >= 0.0f);
+        }
+    }
+}   // unitTesting
+
 #endif   // !SERVER_ONLY
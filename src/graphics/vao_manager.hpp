@@ -22,6 +22,7 @@
 #include "utils/singleton.hpp"
 #include <tuple>
 #include <S3DVertex.h>
+#include <IMesh.h>
 #include <IMeshBuffer.h>
 #include <ISceneNode.h>
 #include <vector>
@@ -199,17 +200,48 @@ class VAOManager : public Singleton<VAOManager>
     std::unordered_map<irr::scene::IMeshBuffer*, unsigned> mappedBaseVertex[VTXTYPE_COUNT], mappedBaseIndex[VTXTYPE_COUNT];
     std::map<std::pair<irr::video::E_VERTEX_TYPE, InstanceType>, GLuint> InstanceVAO;
 
+    /** True if normals and tangents of the static vertex types are stored
+     *  as GL_INT_2_10_10_10_REV, see CentralVideoSettings::
+     *  supportsPackedVertices(). Skinned meshes are never packed. */
+    bool m_packed_vertices;
+
+    /** Bytes of vertex and index data uploaded, the bytes the vertices
+     *  would have needed unpacked, and the bytes of CPU side mesh data
+     *  freed after the upload. */
+    size_t m_vertex_bytes, m_unpacked_vertex_bytes, m_index_bytes;
+    size_t m_freed_bytes;
+
     void cleanInstanceVAOs();
     void regenerateBuffer(enum VTXTYPE, size_t, size_t);
     void regenerateVAO(enum VTXTYPE);
     void regenerateInstancedVAO();
+    bool isPacked(enum VTXTYPE tp) const
+    {
+        return m_packed_vertices && tp != VTXTYPE_SKINNED_MESH;
+    }
     size_t getVertexPitch(enum VTXTYPE) const;
-    VTXTYPE getVTXTYPE(irr::video::E_VERTEX_TYPE type);
+    void bindVertexAttribs(enum VTXTYPE tp);
+    GLuint createPoolVAO(enum VTXTYPE tp);
+    VTXTYPE getVTXTYPE(irr::video::E_VERTEX_TYPE type) const;
     irr::video::E_VERTEX_TYPE getVertexType(enum VTXTYPE tp);
     void append(irr::scene::IMeshBuffer *, VTXTYPE tp);
 public:
     VAOManager();
     std::pair<unsigned, unsigned> getBase(irr::scene::IMeshBuffer *);
+    void packVertices(irr::scene::IMeshBuffer *mb, void *dst) const;
+    size_t uploadAndFreeMesh(irr::scene::IMesh *mesh);
+    /** Returns the size of a vertex of the given type in the shared vertex
+     *  buffers, which differs from the irrlicht vertex size if packed. */
+    size_t getVertexPitch(irr::video::E_VERTEX_TYPE type) const
+    {
+        return getVertexPitch(getVTXTYPE(type));
+    }
+    /** True if vertices of this type must be converted with packVertices()
+     *  before being written into the shared vertex buffers. */
+    bool isPacked(irr::video::E_VERTEX_TYPE type) const
+    {
+        return isPacked(getVTXTYPE(type));
+    }
     GLuint getInstanceBuffer(InstanceType it) { return instance_vbo[it]; }
     void *getInstanceBufferPtr(InstanceType it) { return Ptr[it]; }
     unsigned getVBO(irr::video::E_VERTEX_TYPE type) { return vbo[getVTXTYPE(type)]; }
@@ -217,6 +249,7 @@ public:
     unsigned getVAO(irr::video::E_VERTEX_TYPE type) { return vao[getVTXTYPE(type)]; }
     unsigned getInstanceVAO(irr::video::E_VERTEX_TYPE vt, enum InstanceType it) { return InstanceVAO[std::pair<irr::video::E_VERTEX_TYPE, InstanceType>(vt, it)]; }
     ~VAOManager();
+    static void unitTesting();
 };
 
 #endif
@@ -21,6 +21,7 @@
 
 #include "items/flyable.hpp"
 
+#include <cfloat>
 #include <cmath>
 
 #include <IMeshManipulator.h>
@@ -222,22 +223,23 @@ void Flyable::getClosestKart(const AbstractKart **minKart,
     *minKart = NULL;
 
     World *world = World::getWorld();
-    for(unsigned int i=0 ; i<world->getNumKarts(); i++ )
+    const SoccerWorld* sw = dynamic_cast<SoccerWorld*>(world);
+    // Returns the distance used for aiming, or a negative value if the
+    // kart can not be aimed at.
+    auto aim_distance = [&](const AbstractKart *kart) -> float
     {
-        AbstractKart *kart = world->getKart(i);
         // If a kart has star effect shown, the kart is immune, so
         // it is not considered a target anymore.
         if(kart->isEliminated() || kart == m_owner ||
             kart->isInvulnerable()                 ||
-            kart->getKartAnimation()                   ) continue;
+            kart->getKartAnimation()                   ) return -1.0f;
 
-        const SoccerWorld* sw = dynamic_cast<SoccerWorld*>(World::getWorld());
         if (sw)
         {
             // Don't hit teammates in soccer world
             if (sw->getKartTeam(kart->getWorldKartId()) == sw
                 ->getKartTeam(m_owner->getWorldKartId()))
-            continue;
+            return -1.0f;
         }
 
         btTransform t=kart->getTrans();
@@ -253,7 +255,7 @@ void Flyable::getClosestKart(const AbstractKart **minKart,
             // Ignore karts behind the current one
             Vec3 to_target       = kart->getXYZ() - inFrontOf->getXYZ();
             const float distance = to_target.length();
-            if(distance > 50) continue; // kart too far, don't aim at it
+            if(distance > 50) return -1.0f; // kart too far, don't aim at it
 
             btTransform trans = inFrontOf->getTrans();
             // get heading=trans.getBasis*(0,0,1) ... so save the multiplication:
@@ -267,17 +269,23 @@ void Flyable::getClosestKart(const AbstractKart **minKart,
             float c = to_target.dot(v)/s;
             // Original test was: fabsf(acos(c))>1,  which is the same as
             // c<cos(1) (acos returns values in [0, pi] anyway)
-            if(c<0.54) continue;
+            if(c<0.54) return -1.0f;
         }
-
-        if(distance2 < *minDistSquared)
-        {
-            *minDistSquared = distance2;
-            *minKart  = kart;
-            *minDelta = delta;
-        }
-    }  // for i<getNumKarts
-
+        return distance2 < 999999.9f ? distance2 : -1.0f;
+    };
+
+    // The aim distance is never smaller than the squared distance, so the
+    // spatial index can find the kart with the smallest aim distance.
+    const AbstractKart *kart = world->getSpatialQuery().findNearestKart(
+        trans_projectile.getOrigin(), inFrontOf != NULL ? 50.0f : FLT_MAX,
+        aim_distance);
+    if (kart)
+    {
+        *minDistSquared = aim_distance(kart);
+        *minKart        = kart;
+        *minDelta       = kart->getTrans().getOrigin()
+                        - trans_projectile.getOrigin();
+    }
 }   // getClosestKart
 
 //-----------------------------------------------------------------------------
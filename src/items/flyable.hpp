@@ -32,6 +32,7 @@ using namespace irr;
 #include "items/powerup_manager.hpp"
 #include "karts/moveable.hpp"
 #include "tracks/terrain_info.hpp"
+#include "utils/memory_pool.hpp"
 
 class AbstractKart;
 class AbstractKartAnimation;
@@ -160,6 +161,7 @@ protected:
                                     const bool turn_around=false,
                                     const btTransform* customDirection=NULL);
 public:
+    POOL_ALLOCATED("Flyable")
 
                  Flyable     (AbstractKart* kart,
                               PowerupManager::PowerupType type,
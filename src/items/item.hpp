@@ -27,6 +27,7 @@
 
 
 #include "utils/leak_check.hpp"
+#include "utils/memory_pool.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/vec3.hpp"
 
@@ -170,6 +171,8 @@ private:
     void          setType(ItemType type);
 
 public:
+    POOL_ALLOCATED("Item")
+
                   Item(ItemType type, const Vec3& xyz, const Vec3& normal,
                        scene::IMesh* mesh, scene::IMesh* lowres_mesh);
                   Item(const Vec3& xyz, float distance,
@@ -27,6 +27,7 @@
 #include "items/powerup.hpp"
 #include "items/rubber_ball.hpp"
 #include "karts/abstract_kart.hpp"
+#include "modes/world.hpp"
 
 ProjectileManager *projectile_manager=0;
 
@@ -136,20 +137,13 @@ Flyable *ProjectileManager::newProjectile(AbstractKart *kart,
 
 // -----------------------------------------------------------------------------
 /** Returns true if a projectile is within the given distance of the specified
- *  kart.
+ *  kart. This uses the positions at the start of the frame, see SpatialQuery.
  *  \param kart The kart for which the test is done.
  *  \param radius Distance within which the projectile must be.
 */
 bool ProjectileManager::projectileIsClose(const AbstractKart * const kart,
                                          float radius)
 {
-    float r2 = radius*radius;
-
-    for(Projectiles::iterator i  = m_active_projectiles.begin();
-                              i != m_active_projectiles.end();   i++)
-    {
-        float dist2 = (*i)->getXYZ().distance2(kart->getXYZ());
-        if(dist2<r2) return true;
-    }
-    return false;
+    return World::getWorld()->getSpatialQuery().isFlyableInRadius(
+                                                       kart->getXYZ(), radius);
 }   // projectileIsClose
@@ -66,6 +66,10 @@ public:
     bool             projectileIsClose(const AbstractKart * const kart,
                                        float radius);
     // ------------------------------------------------------------------------
+    /** Returns all projectiles which are currently moving on the track. */
+    const std::vector<Flyable*>& getActiveProjectiles() const
+                                               { return m_active_projectiles; }
+    // ------------------------------------------------------------------------
     /** Adds a special hit effect to be shown.
      *  \param hit_effect The hit effect to be added. */
     void             addHitEffect(HitEffect *hit_effect)
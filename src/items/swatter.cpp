@@ -236,35 +236,28 @@ void Swatter::chooseTarget()
 {
     // TODO: for the moment, only handle karts...
     const World*  world         = World::getWorld();
-    AbstractKart* closest_kart  = NULL;
-    float         min_dist2     = FLT_MAX;
-
-    for(unsigned int i=0; i<world->getNumKarts(); i++)
+    const SoccerWorld* sw       = dynamic_cast<const SoccerWorld*>(world);
+    auto distance2 = [this, sw](const AbstractKart *kart) -> float
     {
-        AbstractKart *kart = world->getKart(i);
         // TODO: isSwatterReady(), isSquashable()?
         if(kart->isEliminated() || kart==m_kart)
-            continue;
+            return -1.0f;
         // don't squash an already hurt kart
         if (kart->isInvulnerable() || kart->isSquashed())
-            continue;
+            return -1.0f;
 
-        const SoccerWorld* sw = dynamic_cast<SoccerWorld*>(World::getWorld());
         if (sw)
         {
             // Don't hit teammates in soccer world
             if (sw->getKartTeam(kart->getWorldKartId()) == sw
                 ->getKartTeam(m_kart->getWorldKartId()))
-            continue;
+            return -1.0f;
         }
 
-        float dist2 = (kart->getXYZ()-m_kart->getXYZ()).length2();
-        if(dist2<min_dist2)
-        {
-            min_dist2 = dist2;
-            closest_kart = kart;
-        }
-    }
+        return (kart->getXYZ()-m_kart->getXYZ()).length2();
+    };
+    AbstractKart *closest_kart = world->getSpatialQuery()
+        .findNearestKart(m_kart->getXYZ(), FLT_MAX, distance2);
     m_target = closest_kart;    // may be NULL
     m_closest_kart = closest_kart;
 }
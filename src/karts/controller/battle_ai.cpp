@@ -29,6 +29,8 @@
 #include "tracks/arena_graph.hpp"
 #include "tracks/track.hpp"
 
+#include <algorithm>
+
 #ifdef AI_DEBUG
 #include "irrlicht.h"
 #endif
@@ -73,22 +75,25 @@ BattleAI::~BattleAI()
  */
 void BattleAI::findClosestKart(bool consider_difficulty, bool find_sta)
 {
-    float distance = 99999.9f;
-    int closest_kart_num = 0;
+    const float max_distance = 99999.9f;
     const int end = m_world->getNumKarts();
-
-    for (int start_id =
+    const int first_id =
         find_sta ? end - race_manager->getNumSpareTireKarts() : 0;
-        start_id < end; start_id++)
+    const Vec3 &xyz = m_kart->getXYZ();
+
+    auto cost = [this, consider_difficulty, find_sta, first_id, max_distance,
+                 &xyz](unsigned int id) -> float
     {
-        const AbstractKart* kart = m_world->getKart(start_id);
+        if ((int)id < first_id)
+            return -1.0f;
+        const AbstractKart* kart = m_world->getKart(id);
         const SpareTireAI* sta =
             dynamic_cast<const SpareTireAI*>(kart->getController());
         if (kart->isEliminated() && !(find_sta && sta && sta->isMoving()))
-            continue;
+            return -1.0f;
 
         if (kart->getWorldKartId() == m_kart->getWorldKartId())
-            continue; // Skip the same kart
+            return -1.0f; // Skip the same kart
 
         // Test whether takes current difficulty into account for closest kart
         // Notice: it don't affect aiming, this function will be called once
@@ -97,31 +102,37 @@ void BattleAI::findClosestKart(bool consider_difficulty, bool find_sta)
             consider_difficulty)
         {
             // Skip human players for novice mode unless only they are left
-            const AbstractKart* temp = m_world->getKart(start_id);
-            if (temp->getController()->isPlayerController() &&
+            if (kart->getController()->isPlayerController() &&
                (m_world->getCurrentNumKarts() -
                 m_world->getCurrentNumPlayers()) > 1)
-                continue;
+                return -1.0f;
         }
         else if (m_cur_difficulty == RaceManager::DIFFICULTY_BEST &&
             consider_difficulty)
         {
             // Skip AI players for supertux mode
-            const AbstractKart* temp = m_world->getKart(start_id);
-            if (!(temp->getController()->isPlayerController()))
-                continue;
+            if (!(kart->getController()->isPlayerController()))
+                return -1.0f;
         }
 
-        float dist_to_kart = m_graph->getDistance(getCurrentNode(),
+        const float dist_to_kart = m_graph->getDistance(getCurrentNode(),
             m_world->getSectorForKart(kart));
-        if (dist_to_kart <= distance)
-        {
-            distance = dist_to_kart;
-            closest_kart_num = start_id;
-        }
-    }
-
-    m_closest_kart = m_world->getKart(closest_kart_num);
+        const float dx = kart->getXYZ().getX() - xyz.getX();
+        const float dz = kart->getXYZ().getZ() - xyz.getZ();
+        const float d2 = dx * dx + dz * dz;
+        if (dist_to_kart > max_distance || d2 > max_distance * max_distance)
+            return -1.0f;
+        // The graph distance is measured between nodes, so for close karts
+        // it can be smaller than the straight distance, which is a lower
+        // bound of the path. The larger of both is used, so that the
+        // spatial index can limit the search.
+        return std::max(dist_to_kart * dist_to_kart, d2);
+    };
+    const int closest_kart_num = m_world->getSpatialQuery()
+        .findNearestKartId(xyz, max_distance, cost);
+
+    m_closest_kart = m_world->getKart(closest_kart_num < 0
+                                      ? 0 : closest_kart_num);
     m_closest_kart_node = m_world->getSectorForKart(m_closest_kart);
     m_closest_kart_point = m_closest_kart->getXYZ();
 
@@ -631,8 +631,8 @@ void SkiddingAI::handleItemCollectionAndAvoidance(Vec3 *aim_point,
 
     int node = m_track_node;
     float distance = 0;
-    std::vector<const Item *> items_to_collect;
-    std::vector<const Item *> items_to_avoid;
+    FrameItemList items_to_collect;
+    FrameItemList items_to_avoid;
 
     // 1) Filter and sort all items close by
     // -------------------------------------
@@ -824,7 +824,7 @@ void SkiddingAI::handleItemCollectionAndAvoidance(Vec3 *aim_point,
  *  \return True if it would hit any of the bad items.
 */
 bool SkiddingAI::hitBadItemWhenAimAt(const Item *item,
-                              const std::vector<const Item *> &items_to_avoid)
+                              const FrameItemList &items_to_avoid)
 {
     core::line3df to_item(m_kart->getXYZ().toIrrVector(),
                           item->getXYZ().toIrrVector());
@@ -883,7 +883,7 @@ bool SkiddingAI::handleSelectedItem(Vec3 kart_aim_direction, Vec3 *aim_point)
  *         into account).
  *  \return True if steering is necessary to avoid an item.
  */
-bool SkiddingAI::steerToAvoid(const std::vector<const Item *> &items_to_avoid,
+bool SkiddingAI::steerToAvoid(const FrameItemList &items_to_avoid,
                               const core::line3df &line_to_target,
                               Vec3 *aim_point)
 {
@@ -1037,8 +1037,8 @@ bool SkiddingAI::steerToAvoid(const std::vector<const Item *> &items_to_avoid,
  *  \param item_to_collect A pointer to a previously selected item to collect.
  */
 void SkiddingAI::evaluateItems(const Item *item, Vec3 kart_aim_direction,
-                               std::vector<const Item *> *items_to_avoid,
-                               std::vector<const Item *> *items_to_collect)
+                               FrameItemList *items_to_avoid,
+                               FrameItemList *items_to_collect)
 {
     const KartProperties *kp = m_kart->getKartProperties();
 
@@ -1110,7 +1110,7 @@ void SkiddingAI::evaluateItems(const Item *item, Vec3 kart_aim_direction,
 
     // Now insert the item into the sorted list of items to avoid
     // (or to collect). The lists are (for now) sorted by distance
-    std::vector<const Item*> *list;
+    FrameItemList *list;
     if(avoid)
         list = items_to_avoid;
     else
@@ -1410,17 +1410,39 @@ void SkiddingAI::handleItems(const float dt)
             // if the kart has a shield, do not break it by using a swatter.
             if(m_kart->getShieldTime() > min_bubble_time)
                 break;
-            // Fire if the closest kart ahead or to the back is not already
-            // squashed and close enough.
-            // FIXME: this can be improved on, since more than one kart might
-            //        be hit, and a kart ahead might not be at an angle at
-            //        which the glove can be used.
-            if(  ( m_kart_ahead && !m_kart_ahead->isSquashed()             &&
-                    (m_kart_ahead->getXYZ()-m_kart->getXYZ()).length2()<d2 &&
-                    m_kart_ahead->getSpeed() < m_kart->getSpeed()            ) ||
-                 ( m_kart_behind && !m_kart_behind->isSquashed() &&
-                    (m_kart_behind->getXYZ()-m_kart->getXYZ()).length2()<d2) )
-                    m_controls->setFire(true);
+            // Fire if any kart close along the track (ahead or to the back)
+            // is not already squashed and close enough. Karts ahead must be
+            // slower, otherwise they will get out of reach.
+            // FIXME: a kart ahead might not be at an angle at which the
+            //        glove can be used.
+            const float d = sqrtf(d2);
+            const float track_length =
+                Track::getCurrentTrack()->getTrackLength();
+            const float my_distance = m_world->getDistanceDownTrackForKart(
+                                                   m_kart->getWorldKartId());
+            std::vector<unsigned int> close_karts;
+            m_world->getSpatialQuery().findKartsAlongTrack(my_distance - d,
+                                                           my_distance + d,
+                                                           &close_karts);
+            for (unsigned int id : close_karts)
+            {
+                const AbstractKart *kart = m_world->getKart(id);
+                if (kart == m_kart || kart->isSquashed() ||
+                    kart->isGhostKart() || kart->hasFinishedRace() ||
+                    (kart->getXYZ()-m_kart->getXYZ()).length2() >= d2)
+                    continue;
+                // Distance the other kart is ahead, across the start line
+                float ahead = m_world->getDistanceDownTrackForKart(id)
+                            - my_distance;
+                if (ahead > 0.5f*track_length)
+                    ahead -= track_length;
+                else if (ahead < -0.5f*track_length)
+                    ahead += track_length;
+                if (ahead > 0 && kart->getSpeed() >= m_kart->getSpeed())
+                    continue;
+                m_controls->setFire(true);
+                break;
+            }
             break;
         }
     case PowerupManager::POWERUP_RUBBERBALL:
@@ -46,6 +46,7 @@
 #include "karts/controller/ai_base_lap_controller.hpp"
 #include "race/race_manager.hpp"
 #include "tracks/drive_node.hpp"
+#include "utils/memory_pool.hpp"
 #include "utils/random_generator.hpp"
 
 #include <line3d.h>
@@ -127,6 +128,11 @@ private:
         void clear() {m_road = false; m_kart = -1;}
     } m_crashes;
 
+    /** A list of items which is only used while computing one frame, so
+     *  it is allocated from the frame arena. */
+    typedef std::vector<const Item*, FrameStlAllocator<const Item*> >
+            FrameItemList;
+
     RaceManager::AISuperPower m_superpower;
 
     /*General purpose variables*/
@@ -253,14 +259,14 @@ private:
     void  handleItemCollectionAndAvoidance(Vec3 *aim_point,
                                            int last_node);
     bool  handleSelectedItem(Vec3 kart_aim_direction, Vec3 *aim_point);
-    bool  steerToAvoid(const std::vector<const Item *> &items_to_avoid,
+    bool  steerToAvoid(const FrameItemList &items_to_avoid,
                        const core::line3df &line_to_target,
                        Vec3 *aim_point);
     bool  hitBadItemWhenAimAt(const Item *item,
-                              const std::vector<const Item *> &items_to_avoid);
+                              const FrameItemList &items_to_avoid);
     void  evaluateItems(const Item *item, Vec3 kart_aim_direction,
-                        std::vector<const Item *> *items_to_avoid,
-                        std::vector<const Item *> *items_to_collect);
+                        FrameItemList *items_to_avoid,
+                        FrameItemList *items_to_collect);
 
     void  checkCrashes(const Vec3& pos);
     void  findNonCrashingPointFixed(Vec3 *result, int *last_node);
@@ -140,32 +140,32 @@ void SoccerAI::update(float dt)
  */
 void SoccerAI::findClosestKart(bool consider_difficulty, bool find_sta)
 {
-    float distance = 99999.9f;
-    const unsigned int n = m_world->getNumKarts();
-    int closest_kart_num = 0;
+    const float max_distance = 99999.9f;
+    const Vec3 &xyz = m_kart->getXYZ();
 
-    for (unsigned int i = 0; i < n; i++)
+    auto distance2 = [this, max_distance, &xyz](unsigned int id) -> float
     {
-        const AbstractKart* kart = m_world->getKart(i);
-        if (kart->isEliminated()) continue;
+        const AbstractKart* kart = m_world->getKart(id);
+        if (kart->isEliminated()) return -1.0f;
 
         if (kart->getWorldKartId() == m_kart->getWorldKartId())
-            continue; // Skip the same kart
+            return -1.0f; // Skip the same kart
 
         if (m_world->getKartTeam(kart
             ->getWorldKartId()) == m_world->getKartTeam(m_kart
             ->getWorldKartId()))
-            continue; // Skip the kart with the same team
-
-        Vec3 d = kart->getXYZ() - m_kart->getXYZ();
-        if (d.length_2d() <= distance)
-        {
-            distance = d.length_2d();
-            closest_kart_num = i;
-        }
-    }
-
-    m_closest_kart = m_world->getKart(closest_kart_num);
+            return -1.0f; // Skip the kart with the same team
+
+        const float dx = kart->getXYZ().getX() - xyz.getX();
+        const float dz = kart->getXYZ().getZ() - xyz.getZ();
+        const float d2 = dx * dx + dz * dz;
+        return d2 > max_distance * max_distance ? -1.0f : d2;
+    };
+    const int closest_kart_num = m_world->getSpatialQuery()
+        .findNearestKartId(xyz, max_distance, distance2);
+
+    m_closest_kart = m_world->getKart(closest_kart_num < 0
+                                      ? 0 : closest_kart_num);
     m_closest_kart_node = m_world->getSectorForKart(m_closest_kart);
     m_closest_kart_point = m_closest_kart->getXYZ();
 
@@ -37,6 +37,7 @@
 class AbstractKartAnimation;
 class Attachment;
 class btKart;
+class btKartRaycaster;
 class btUprightConstraint;
 class Controller;
 class HitEffect;
@@ -165,7 +166,7 @@ protected:
     // Bullet physics parameters
     // -------------------------
     btCompoundShape          m_kart_chassis;
-    btVehicleRaycaster      *m_vehicle_raycaster;
+    btKartRaycaster         *m_vehicle_raycaster;
     btKart                  *m_vehicle;
 
      /** The amount of energy collected by hitting coins. Note that it
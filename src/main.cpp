@@ -184,11 +184,15 @@
 #include "graphics/camera.hpp"
 #include "graphics/camera_debug.hpp"
 #include "graphics/central_settings.hpp"
+#include "graphics/culling_bvh.hpp"
 #include "graphics/graphics_restrictions.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/material_manager.hpp"
 #include "graphics/particle_kind_manager.hpp"
 #include "graphics/referee.hpp"
+#include "graphics/spherical_harmonics.hpp"
+#include "graphics/sprite_batch.hpp"
+#include "graphics/vao_manager.hpp"
 #include "guiengine/engine.hpp"
 #include "guiengine/event_handler.hpp"
 #include "guiengine/dialog_queue.hpp"
@@ -207,7 +211,12 @@
 #include "modes/cutscene_world.hpp"
 #include "modes/demo_world.hpp"
 #include "modes/profile_world.hpp"
+#include "modes/spatial_query.hpp"
+#include "network/bit_stream.hpp"
+#include "network/clock_sync.hpp"
+#include "network/input_buffer.hpp"
 #include "network/network_config.hpp"
+#include "network/network_proxy.hpp"
 #include "network/network_string.hpp"
 #include "network/rewind_manager.hpp"
 #include "network/servers_manager.hpp"
@@ -233,13 +242,17 @@
 #include "utils/command_line.hpp"
 #include "utils/constants.hpp"
 #include "utils/crash_reporting.hpp"
+#include "utils/job_system.hpp"
 #include "utils/leak_check.hpp"
 #include "utils/log.hpp"
+#include "utils/spatial_grid.hpp"
 #include "utils/translation.hpp"
+#include "utils/translation_table.hpp"
 
 static void cleanSuperTuxKart();
 static void cleanUserConfig();
 void runUnitTests();
+static int runNetworkProxy(const std::string &address);
 
 // ============================================================================
 //                        gamepad visualisation screen
@@ -559,6 +572,15 @@ void cmdLineHelp()
                               "laps.\n"
     "       --profile-time=n   Enable automatic driven profile mode for n "
                               "seconds.\n"
+    "       --capture-frames=n Save every n-th frame of a race to the "
+                              "screenshot directory.\n"
+    "       --job-threads=n    Number of threads used for parallel jobs "
+                              "(1 to disable).\n"
+    "       --physics-broadphase=s Broadphase of the physics: axis-sweep "
+                              "or dbvt.\n"
+    "       --history-check=file Write the kart positions of a physics "
+                              "replay (--history=2) to file, or compare with "
+                              "it if it exists.\n"
     "       --unlock-all       Permanently unlock all karts and tracks for testing.\n"
     "       --no-unlock-all    Disable unlock-all (i.e. base unlocking on player achievement).\n"
     "       --no-graphics      Do not display the actual race.\n"
@@ -581,6 +603,11 @@ void cmdLineHelp()
     "       --server-password= Sets a password for a server (both client&server).\n"
     "       --connect-now=ip   Connect to a server with IP known now (in format x.x.x.x:xxx(port)).\n"
     "       --login=s          Automatically log in (set the login).\n"
+    "       --network-proxy=port:x.x.x.x:port Forward a local port to a server "
+                              "simulating a bad connection.\n"
+    "       --proxy-latency=n  Latency in ms added by the proxy.\n"
+    "       --proxy-jitter=n   Maximum random latency in ms added by the proxy.\n"
+    "       --proxy-loss=n     Percentage of packets dropped by the proxy.\n"
     "       --password=s       Automatically log in (set the password).\n"
     "       --port=n           Port number to use.\n"
     "       --my-address=1.1.1.1:1  Own IP address (can replace stun protocol)\n"
@@ -592,6 +619,10 @@ void cmdLineHelp()
     "  -h,  --help             Show this help.\n"
     "       --log=N            Set the verbosity to a value between\n"
     "                          0 (Debug) and 5 (Only Fatal messages)\n"
+    "       --log-sync         Write log messages immediately (instead of\n"
+    "                          using a separate thread).\n"
+    "       --log-binary=FILE  Additionally write all log messages to FILE\n"
+    "                          in a binary format.\n"
     "       --root=DIR         Path to add to the list of STK root directories.\n"
     "                          You can specify more than one by separating them\n"
     "                          with colons (:).\n"
@@ -669,6 +700,12 @@ int handleCmdLineOutputModifier()
         Log::verbose("main", "Colours disabled.");
     }
 
+    std::string s;
+    if(CommandLine::has("--log-binary", &s))
+        Log::openBinaryFile(s);
+    if(!CommandLine::has("--log-sync"))
+        Log::startAsync();
+
     if(CommandLine::has("--console"))
         UserConfigParams::m_log_errors_to_console=true;
     if(CommandLine::has("--no-console"))
@@ -870,6 +907,13 @@ int handleCmdLinePreliminary()
     if(CommandLine::has("--dont-load-navmesh"))
         Track::m_dont_load_navmesh = true;
 
+    // The job system is created in initRest(), so the number of threads
+    // must be known before
+    if (CommandLine::has("--job-threads", &n))
+        UserConfigParams::m_job_threads_override = std::max(n, 0);
+    if (CommandLine::has("--physics-broadphase", &s))
+        UserConfigParams::m_physics_broadphase_override = s;
+
 
     return 0;
 }   // handleCmdLinePreliminary
@@ -915,6 +959,8 @@ int handleCmdLine()
         AIBaseController::setTestAI(n);
     if (CommandLine::has("--fps-debug"))
         UserConfigParams::m_fps_debug = true;
+    if (CommandLine::has("--capture-frames", &n))
+        UserConfigParams::m_capture_frame_interval = std::max(n, 0);
     if (CommandLine::has("--rewind") )
         RewindManager::setEnable(true);
     if(CommandLine::has("--soccer-ai-stats"))
@@ -1265,6 +1311,9 @@ int handleCmdLine()
         UserConfigParams::m_no_start_screen = true;
     }   // --history=%d
 
+    if (CommandLine::has("--history-check", &s))
+        history->setDeterminismCheck(s);
+
     if(CommandLine::has("--history"))  // handy default for --history=1
     {
         history->doReplayHistory(History::HISTORY_POSITION);
@@ -1388,6 +1437,7 @@ void initRest()
 
     font_manager = new FontManager();
     font_manager->loadFonts();
+    font_manager->prewarmFonts();
     GUIEngine::init(device, driver, StateManager::get());
 
     // This only initialises the non-network part of the add-ons manager. The
@@ -1404,6 +1454,9 @@ void initRest()
     Online::RequestManager::get()->startNetworkThread();
     NewsManager::get();   // this will create the news manager
 
+    JobSystem::create(UserConfigParams::m_job_threads_override >= 0
+                      ? UserConfigParams::m_job_threads_override
+                      : UserConfigParams::m_job_threads);
     music_manager = new MusicManager();
     SFXManager::create();
     // The order here can be important, e.g. KartPropertiesManager needs
@@ -1540,6 +1593,9 @@ int main(int argc, char *argv[] )
         if (CommandLine::has("--stdout", &s))
             FileManager::setStdoutName(s);
 
+        if (CommandLine::has("--network-proxy", &s))
+            return runNetworkProxy(s);
+
         // Init the minimum managers so that user config exists, then
         // handle all command line options that do not need (or must
         // not have) other managers initialised:
@@ -1769,16 +1825,14 @@ int main(int argc, char *argv[] )
             history->Load();
             race_manager->setupPlayerKartInfo();
             race_manager->startNew(false);
-            main_loop->run();
-            // well, actually run() will never return, since
-            // it exits after replaying history (see history::GetNextDT()).
-            // So the next line is just to make this obvious here!
-            exit(-3);
+            // The replay restarts when it is finished, the main loop is
+            // only left if the window is closed, or at the end of a
+            // --history-check (see History::finishCheck()).
         }
 
         // Not replaying
         // =============
-        if(!ProfileWorld::isProfileMode())
+        else if(!ProfileWorld::isProfileMode())
         {
             if(UserConfigParams::m_no_start_screen)
             {
@@ -1821,12 +1875,19 @@ int main(int argc, char *argv[] )
     if(NetworkConfig::get()->isNetworking() && STKHost::existHost())
         STKHost::get()->abort();
 
+    // A failed --history-check is reported in the exit status
+    const int exit_status =
+        history && history->isDeterminismCheckFailed() ? 1 : 0;
+
     cleanSuperTuxKart();
 
 #ifdef DEBUG
     MemoryLeaks::checkForLeaks();
 #endif
 
+    // Write all pending log messages before stdout is closed
+    Log::stopAsync();
+
 #ifndef WIN32
     if (user_config) //close logfiles
     {
@@ -1840,7 +1901,7 @@ int main(int argc, char *argv[] )
 
     delete file_manager;
 
-    return 0 ;
+    return exit_status;
 }   // main
 
 // ============================================================================
@@ -1932,6 +1993,8 @@ static void cleanSuperTuxKart()
     if(NetworkConfig::get()->isNetworking() && STKHost::existHost())
         STKHost::destroy();
 
+    JobSystem::destroy();
+
     cleanUserConfig();
 
     StateManager::deallocate();
@@ -1957,6 +2020,41 @@ static void cleanUserConfig()
     if(irr_driver)              delete irr_driver;
 }   // cleanUserConfig
 
+//=============================================================================
+/** Runs a local proxy that forwards packets to a server and simulates
+ *  latency, jitter and packet loss, to test network games.
+ *  \param address Local port and address of the server (port:ip:port).
+ */
+static int runNetworkProxy(const std::string &address)
+{
+    std::string::size_type colon = address.find(':');
+    int port = 0;
+    if (colon == std::string::npos ||
+        !StringUtils::fromString(address.substr(0, colon), port))
+    {
+        Log::error("main", "Invalid --network-proxy argument '%s'.",
+                   address.c_str());
+        return 1;
+    }
+    int latency = 0, jitter = 0, loss = 0;
+    CommandLine::has("--proxy-latency", &latency);
+    CommandLine::has("--proxy-jitter",  &jitter );
+    CommandLine::has("--proxy-loss",    &loss   );
+    if (enet_initialize() != 0)
+    {
+        Log::error("main", "Could not initialize enet.");
+        return 1;
+    }
+    NetworkProxy proxy((uint16_t)port,
+                       TransportAddress(address.substr(colon + 1)),
+                       std::max(latency, 0), std::max(jitter, 0),
+                       std::max(loss, 0));
+    if (proxy.isValid())
+        proxy.run();
+    enet_deinitialize();
+    return 1;
+}   // runNetworkProxy
+
 //=============================================================================
 void runUnitTests()
 {
@@ -1964,10 +2062,34 @@ void runUnitTests()
     Log::info("UnitTest", "=====================");
     Log::info("UnitTest", "GraphicsRestrictions");
     GraphicsRestrictions::unitTesting();
+    Log::info("UnitTest", "CullingBVH");
+    CullingBVH::unitTesting();
+#ifndef SERVER_ONLY
+    Log::info("UnitTest", "SphericalHarmonics");
+    SphericalHarmonics::unitTesting();
+    Log::info("UnitTest", "VAOManager");
+    VAOManager::unitTesting();
+    Log::info("UnitTest", "SpriteBatch");
+    SpriteBatch::unitTesting();
+#endif
     Log::info("UnitTest", "NetworkString");
     NetworkString::unitTesting();
+    Log::info("UnitTest", "BitWriter");
+    BitWriter::unitTesting();
     Log::info("UnitTest", "TransportAddress");
     TransportAddress::unitTesting();
+    Log::info("UnitTest", "InputBuffer");
+    InputBuffer::unitTesting();
+    Log::info("UnitTest", "ClockSync");
+    ClockSync::unitTesting();
+    Log::info("UnitTest", "TranslationTable");
+    TranslationTable::unitTesting();
+    Log::info("UnitTest", "Translations");
+    Translations::unitTesting();
+    Log::info("UnitTest", "SpatialGrid");
+    SpatialGrid::unitTesting();
+    Log::info("UnitTest", "SpatialQuery");
+    SpatialQuery::unitTesting();
 
     Log::info("UnitTest", "Easter detection");
     // Test easter mode: in 2015 Easter is 5th of April - check with 0 days
@@ -38,6 +38,7 @@
 #include "race/history.hpp"
 #include "race/race_manager.hpp"
 #include "states_screens/state_manager.hpp"
+#include "utils/memory_pool.hpp"
 #include "utils/profiler.hpp"
 
 MainLoop* main_loop = 0;
@@ -231,6 +232,9 @@ void MainLoop::run()
     {
         PROFILER_PUSH_CPU_MARKER("Main loop", 0xFF, 0x00, 0xF7);
 
+        // Reset the per-frame allocation counters and the frame arena
+        MemoryPool::startAllFrames();
+
         m_prev_time = m_curr_time;
         float dt   = getLimitedDt();
 
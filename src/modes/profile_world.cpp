@@ -23,6 +23,7 @@
 #include "graphics/irr_driver.hpp"
 #include "karts/kart_with_stats.hpp"
 #include "karts/controller/controller.hpp"
+#include "physics/physics.hpp"
 #include "tracks/track.hpp"
 
 #include <ISceneManager.h>
@@ -203,6 +204,9 @@ void ProfileWorld::enterRaceOverState()
     float runtime = (irr_driver->getRealTime()-m_start_time)*0.001f;
     Log::verbose("profile", "Number of frames: %d time %f, Average FPS: %f",
                  m_frame_count, runtime, (float)m_frame_count/runtime);
+    Log::verbose("profile", "Physics steps: %d, average time per step: %f ms",
+                 Physics::getInstance()->getNumSteps(),
+                 Physics::getInstance()->getAverageStepTime());
 
     // Print geometry statistics if we're not in no-graphics mode
     if(!m_no_graphics)
@@ -0,0 +1,233 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "modes/spatial_query.hpp"
+
+#include "items/flyable.hpp"
+#include "items/projectile_manager.hpp"
+#include "karts/abstract_kart.hpp"
+#include "modes/linear_world.hpp"
+#include "tracks/track.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+
+/** Side length of the grid cells, about the radius of typical queries. */
+static const float CELL_SIZE = 16.0f;
+
+// ----------------------------------------------------------------------------
+SpatialQuery::SpatialQuery() : m_kart_grid(CELL_SIZE),
+                               m_flyable_grid(CELL_SIZE)
+{
+    m_track_length = 0;
+}   // SpatialQuery
+
+// ----------------------------------------------------------------------------
+/** Removes all karts and flyables. */
+void SpatialQuery::clear()
+{
+    m_kart_grid.clear();
+    m_flyable_grid.clear();
+    m_karts.clear();
+    m_track_order.clear();
+    m_track_length = 0;
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Rebuilds the index from the current positions of all karts and all
+ *  active projectiles.
+ *  \param world The world.
+ */
+void SpatialQuery::update(const World *world)
+{
+    m_karts = world->getKarts();
+    m_positions.clear();
+    for (const AbstractKart *kart : m_karts)
+        m_positions.push_back(kart->getXYZ());
+    m_kart_grid.build(m_positions);
+
+    m_positions.clear();
+    for (const Flyable *flyable : projectile_manager->getActiveProjectiles())
+        m_positions.push_back(flyable->getXYZ());
+    m_flyable_grid.build(m_positions);
+
+    m_track_order.clear();
+    m_track_length = 0;
+    const LinearWorld *lw = dynamic_cast<const LinearWorld*>(world);
+    if (!lw)
+        return;
+    m_track_length = Track::getCurrentTrack()->getTrackLength();
+    for (unsigned int i = 0; i < m_karts.size(); i++)
+    {
+        if (m_karts[i]->isEliminated())
+            continue;
+        m_track_order.push_back(
+            std::make_pair(lw->getDistanceDownTrackForKart(i), i));
+    }
+    std::sort(m_track_order.begin(), m_track_order.end());
+}   // update
+
+// ----------------------------------------------------------------------------
+/** Returns true if any flyable is closer than radius to a point.
+ *  \param xyz The point.
+ *  \param radius The radius.
+ */
+bool SpatialQuery::isFlyableInRadius(const Vec3 &xyz, float radius) const
+{
+    bool found = false;
+    m_flyable_grid.forEachInRadius(xyz, radius,
+        [&found](unsigned int i, float d2) { found = true; });
+    return found;
+}   // isFlyableInRadius
+
+// ----------------------------------------------------------------------------
+/** Returns all karts which are not eliminated and whose distance down the
+ *  track is in [from, to], in the order along the range. The range can
+ *  extend beyond the start or the end of the lap (e.g. [length-10,
+ *  length+10] for the karts close to the start line). Only linear worlds
+ *  have a track order, in other worlds no karts are returned.
+ *  \param from Start of the range.
+ *  \param to End of the range.
+ *  \param kart_ids On return the world kart ids of the karts found (the
+ *         vector is cleared first).
+ */
+void SpatialQuery::findKartsAlongTrack(float from, float to,
+                                       std::vector<unsigned int> *kart_ids)
+                                       const
+{
+    kart_ids->clear();
+    if (m_track_length <= 0 || from > to)
+        return;
+    if (to - from >= m_track_length)
+    {
+        for (const std::pair<float, unsigned int> &p : m_track_order)
+            kart_ids->push_back(p.second);
+        return;
+    }
+    const float length = to - from;
+    from = fmodf(from, m_track_length);
+    if (from < 0) from += m_track_length;
+    to = from + length;
+
+    typedef std::pair<float, unsigned int> Entry;
+    auto less = [](const Entry &e, float d) { return e.first < d; };
+    std::vector<Entry>::const_iterator i =
+        std::lower_bound(m_track_order.begin(), m_track_order.end(), from,
+                         less);
+    for (; i != m_track_order.end() && i->first <= to; i++)
+        kart_ids->push_back(i->second);
+    // The part of the range after the end of the lap
+    if (to > m_track_length)
+    {
+        const float wrapped_to = to - m_track_length;
+        for (i = m_track_order.begin();
+             i != m_track_order.end() && i->first <= wrapped_to; i++)
+        {
+            kart_ids->push_back(i->second);
+        }
+    }
+}   // findKartsAlongTrack
+
+// ----------------------------------------------------------------------------
+/** Checks the queries with an index built directly from positions and
+ *  distances down the track. Karts are identified by their world kart id
+ *  only, so no kart objects are needed.
+ */
+void SpatialQuery::unitTesting()
+{
+    SpatialQuery query;
+    const Vec3 kart_xyz[] = { Vec3(0, 0, 0), Vec3(10, 0, 0), Vec3(-10, 0, 0),
+                              Vec3(0, 0, 30), Vec3(100, 0, 100) };
+    const unsigned int num_karts = sizeof(kart_xyz) / sizeof(kart_xyz[0]);
+    for (unsigned int i = 0; i < num_karts; i++)
+        query.m_positions.push_back(kart_xyz[i]);
+    query.m_kart_grid.build(query.m_positions);
+    query.m_positions.clear();
+    query.m_positions.push_back(Vec3(50, 0, 0));
+    query.m_flyable_grid.build(query.m_positions);
+
+    // Squared x/z distance to a point, karts further than max_distance (or
+    // the kart itself) are rejected like in the callers of findNearestKart
+    auto distance2 = [&kart_xyz](const Vec3 &xyz, float max_distance,
+                                 int self)
+    {
+        return [&kart_xyz, xyz, max_distance, self](unsigned int id)
+        {
+            if ((int)id == self)
+                return -1.0f;
+            const float dx = kart_xyz[id].getX() - xyz.getX();
+            const float dz = kart_xyz[id].getZ() - xyz.getZ();
+            const float d2 = dx * dx + dz * dz;
+            return d2 > max_distance * max_distance ? -1.0f : d2;
+        };
+    };
+
+    int nearest = query.findNearestKartId(Vec3(1, 0, 0), 50.0f,
+        distance2(Vec3(1, 0, 0), 50.0f, -1));
+    assert(nearest == 0);
+    // Kart 0 itself is rejected, kart 1 and 2 are at the same distance,
+    // so the smaller world id wins
+    nearest = query.findNearestKartId(Vec3(0, 0, 0), 50.0f,
+        distance2(Vec3(0, 0, 0), 50.0f, 0));
+    assert(nearest == 1);
+    // Only kart 4 is further than 50m from the others
+    nearest = query.findNearestKartId(Vec3(100, 0, 100), 50.0f,
+        distance2(Vec3(100, 0, 100), 50.0f, 4));
+    assert(nearest == -1);
+    nearest = query.findNearestKartId(Vec3(90, 0, 90), 50.0f,
+        distance2(Vec3(90, 0, 90), 50.0f, -1));
+    assert(nearest == 4);
+
+    // The radius is exclusive
+    assert(query.isFlyableInRadius(Vec3(45, 0, 0), 5.5f));
+    assert(!query.isFlyableInRadius(Vec3(45, 0, 0), 5.0f));
+    assert(!query.isFlyableInRadius(Vec3(0, 0, 0), 20.0f));
+
+    // Along the track, on a 100m lap. Kart 2 is eliminated.
+    const float distance[] = { 5.0f, 50.0f, -1.0f, 95.0f, 52.0f };
+    query.m_track_length = 100.0f;
+    for (unsigned int i = 0; i < num_karts; i++)
+    {
+        if (distance[i] >= 0)
+            query.m_track_order.push_back(std::make_pair(distance[i], i));
+    }
+    std::sort(query.m_track_order.begin(), query.m_track_order.end());
+    std::vector<unsigned int> ids;
+    query.findKartsAlongTrack(45.0f, 52.0f, &ids);
+    assert(ids.size() == 2 && ids[0] == 1 && ids[1] == 4);
+    // Across the start line, in the order along the range
+    query.findKartsAlongTrack(90.0f, 110.0f, &ids);
+    assert(ids.size() == 2 && ids[0] == 3 && ids[1] == 0);
+    query.findKartsAlongTrack(-10.0f, 10.0f, &ids);
+    assert(ids.size() == 2 && ids[0] == 3 && ids[1] == 0);
+    query.findKartsAlongTrack(10.0f, 40.0f, &ids);
+    assert(ids.empty());
+    query.findKartsAlongTrack(0.0f, 100.0f, &ids);
+    assert(ids.size() == 4);
+
+    query.clear();
+    nearest = query.findNearestKartId(Vec3(0, 0, 0), 50.0f,
+        distance2(Vec3(0, 0, 0), 50.0f, -1));
+    assert(nearest == -1);
+    assert(!query.isFlyableInRadius(Vec3(50, 0, 0), 1.0f));
+    query.findKartsAlongTrack(0.0f, 100.0f, &ids);
+    assert(ids.empty());
+    // Avoid warnings if asserts are disabled
+    (void)nearest;
+}   // unitTesting
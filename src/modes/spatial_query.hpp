@@ -0,0 +1,107 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+#ifndef HEADER_SPATIAL_QUERY_HPP
+#define HEADER_SPATIAL_QUERY_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/spatial_grid.hpp"
+#include "utils/vec3.hpp"
+
+#include <utility>
+#include <vector>
+
+class AbstractKart;
+class World;
+
+/**
+  * \brief Answers spatial queries about karts and flyables (e.g. the
+  *  closest kart to aim at, or if a projectile is close to a kart).
+  *  The world rebuilds the index at the start of each update, before the
+  *  karts (and therefore the AI controllers and attachments) are updated.
+  *  The index only stores positions and world kart ids, so it stays valid
+  *  when projectiles are deleted later in the update, and all queries of a
+  *  frame use the positions at the start of the frame, no matter when in
+  *  the frame they are made.
+  *  For linear worlds the karts are also sorted by their distance down
+  *  the track.
+  * \ingroup modes
+  */
+class SpatialQuery : public NoCopy
+{
+private:
+    /** Grids over all karts and all flyables. The index of a kart is its
+     *  world kart id. */
+    SpatialGrid                m_kart_grid, m_flyable_grid;
+
+    /** The karts, in the order of the world kart ids. */
+    std::vector<AbstractKart*> m_karts;
+
+    /** Buffer for the positions passed to the grids. */
+    std::vector<Vec3>          m_positions;
+
+    /** Distance down the track and world kart id of all karts which are
+     *  not eliminated, sorted by distance. Only used in linear worlds. */
+    std::vector<std::pair<float, unsigned int> > m_track_order;
+
+    /** Length of a lap, 0 if the world is not a linear world. */
+    float                      m_track_length;
+
+public:
+         SpatialQuery();
+    void update(const World *world);
+    void clear();
+    bool isFlyableInRadius(const Vec3 &xyz, float radius) const;
+    void findKartsAlongTrack(float from, float to,
+                             std::vector<unsigned int> *kart_ids) const;
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns the world kart id of the kart with the smallest cost, or -1
+     *  if no kart is accepted by the cost function. Karts with the same
+     *  cost are sorted by world id. See SpatialGrid::findNearest for the
+     *  requirements of the cost function, which is called as
+     *  cost(unsigned int world_kart_id).
+     *  \param xyz Center of the search.
+     *  \param max_distance Maximum distance which must be searched.
+     *  \param cost The cost function.
+     */
+    template<typename F>
+    int findNearestKartId(const Vec3 &xyz, float max_distance, F cost) const
+    {
+        unsigned int index;
+        if (m_kart_grid.findNearest(xyz, 1, max_distance, cost, &index) == 0)
+            return -1;
+        return (int)index;
+    }   // findNearestKartId
+    // ------------------------------------------------------------------------
+    /** Returns the kart with the smallest cost, or NULL if no kart is
+     *  accepted by the cost function. Same as findNearestKartId, except
+     *  that the cost function is called as cost(const AbstractKart*).
+     */
+    template<typename F>
+    AbstractKart *findNearestKart(const Vec3 &xyz, float max_distance,
+                                  F cost) const
+    {
+        const std::vector<AbstractKart*> &all = m_karts;
+        const int id = findNearestKartId(xyz, max_distance,
+            [&all, &cost](unsigned int i) { return cost(all[i]); });
+        return id < 0 ? NULL : m_karts[id];
+    }   // findNearestKart
+
+};   // SpatialQuery
+
+#endif
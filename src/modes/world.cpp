@@ -301,6 +301,7 @@ void World::reset()
     SFXManager::get()->resumeAll();
 
     projectile_manager->cleanup();
+    m_spatial_query.clear();
     race_manager->reset();
     // Make sure to overwrite the data from the previous race.
     if(!history->replayHistory()) history->initRecording();
@@ -980,6 +981,13 @@ void World::update(float dt)
     RewindManager::get()->saveStates();
     PROFILER_POP_CPU_MARKER();
 
+    // Karts, controllers and attachments use the spatial index, so it
+    // must be updated before the karts. It only stores positions, so it
+    // can still be used after projectiles are deleted below.
+    PROFILER_PUSH_CPU_MARKER("World::update (spatial query)", 0x30, 0x7F, 0x00);
+    m_spatial_query.update(this);
+    PROFILER_POP_CPU_MARKER();
+
     PROFILER_PUSH_CPU_MARKER("World::update (Kart::upate)", 0x40, 0x7F, 0x00);
 
     // Update all the karts. This in turn will also update the controller,
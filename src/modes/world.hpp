@@ -29,6 +29,7 @@
 #include <stdexcept>
 
 #include "graphics/weather.hpp"
+#include "modes/spatial_query.hpp"
 #include "modes/world_status.hpp"
 #include "race/highscores.hpp"
 #include "states_screens/race_gui_base.hpp"
@@ -94,6 +95,9 @@ protected:
     KartList                  m_karts;
     RandomGenerator           m_random;
 
+    /** Spatial index over all karts and flyables, rebuilt in each update. */
+    SpatialQuery              m_spatial_query;
+
     AbstractKart* m_fastest_kart;
     /** Number of eliminated karts. */
     int         m_eliminated_karts;
@@ -295,6 +299,9 @@ public:
     /** Returns all karts. */
     const KartList & getKarts() const { return m_karts; }
     // ------------------------------------------------------------------------
+    /** Returns the spatial index over all karts and flyables. */
+    const SpatialQuery& getSpatialQuery() const { return m_spatial_query; }
+    // ------------------------------------------------------------------------
     /** Returns the number of currently active (i.e.non-elikminated) karts. */
     unsigned int    getCurrentNumKarts() const { return (int)m_karts.size() -
                                                          m_eliminated_karts; }
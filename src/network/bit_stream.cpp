@@ -0,0 +1,219 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/bit_stream.hpp"
+
+#include "network/message_schema.hpp"
+#include "network/network_string.hpp"
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+
+// ----------------------------------------------------------------------------
+/** Writes directly into the buffer of a network string. max_bytes are
+ *  appended to the string, and the unused part is removed again in
+ *  finish(). The string must not be modified before finish() is called.
+ *  \param ns The network string to append to.
+ *  \param max_bytes Maximum number of bytes that will be written.
+ */
+BitWriter::BitWriter(BareNetworkString *ns, unsigned int max_bytes)
+{
+    m_buffer       = ns->grow(max_bytes);
+    m_capacity     = max_bytes;
+    m_num_bytes    = 0;
+    m_scratch      = 0;
+    m_scratch_bits = 0;
+    m_overflow     = false;
+    m_string       = ns;
+}   // BitWriter
+
+// ----------------------------------------------------------------------------
+/** Writes the last partially filled byte (the unused bits are 0). If the
+ *  writer appends to a network string, the unused bytes are removed from
+ *  the string.
+ *  \return The number of bytes written.
+ */
+unsigned int BitWriter::finish()
+{
+    if (m_scratch_bits > 0)
+    {
+        m_scratch_bits = 8;
+        flushBytes();
+    }
+    if (m_string)
+    {
+        m_string->shrink(m_capacity - m_num_bytes);
+        m_string = NULL;
+    }
+    return m_num_bytes;
+}   // finish
+
+// ============================================================================
+/** Reads the data of a network string which has not been read yet. The
+ *  string must not be modified while the reader is used. */
+BitReader::BitReader(const BareNetworkString &ns)
+{
+    m_data         = ns.getCurrentData();
+    m_size         = ns.size();
+    m_offset       = 0;
+    m_scratch      = 0;
+    m_scratch_bits = 0;
+    m_error        = false;
+}   // BitReader
+
+// ============================================================================
+/** Tests writing and reading all field types, and compares the time to
+ *  encode and decode a kart update message for 100 karts with the byte
+ *  aligned encoding of BareNetworkString.
+ */
+void BitWriter::unitTesting()
+{
+    uint8_t buffer[64];
+    {
+        BitWriter w(buffer, sizeof(buffer));
+        w.writeBits(5, 3);
+        w.writeBool(true);
+        w.writeBits(0xffffffff, 32);
+        w.writeVarUInt(0);
+        w.writeVarUInt(300);
+        w.writeVarUInt(0xffffffff);
+        w.writeVarInt(-1);
+        w.writeVarInt(-2147483647 - 1);
+        w.writeFloat(1.2345f);
+        w.writeQuantizedFloat(0.5f, -1.0f, 1.0f, 8);
+        w.writeQuantizedFloat(5.0f, -1.0f, 1.0f, 8);
+        // 3+1+32 bits, varints with 1+2+5+1+5 bytes, 32+8+8 bits
+        const unsigned int size = w.finish();
+        assert(size == 25 && !w.hasOverflow());
+        (void)size;
+
+        BitReader r(buffer, 25);
+        assert(r.readBits(3) == 5);
+        assert(r.readBool());
+        assert(r.readBits(32) == 0xffffffff);
+        assert(r.readVarUInt() == 0);
+        assert(r.readVarUInt() == 300);
+        assert(r.readVarUInt() == 0xffffffff);
+        assert(r.readVarInt() == -1);
+        assert(r.readVarInt() == -2147483647 - 1);
+        assert(r.readFloat() == 1.2345f);
+        assert(fabsf(r.readQuantizedFloat(-1.0f, 1.0f, 8) - 0.5f) < 0.01f);
+        assert(r.readQuantizedFloat(-1.0f, 1.0f, 8) == 1.0f);
+        assert(r.getRemainingBits() == 4);
+        assert(!r.hasError());
+        r.readBits(8);
+        assert(r.hasError());
+    }
+
+    // Overflow and truncated data
+    {
+        BitWriter w(buffer, 2);
+        w.writeBits(0x1234, 16);
+        assert(!w.hasOverflow());
+        w.writeBool(true);
+        const unsigned int size = w.finish();
+        assert(size == 2 && w.hasOverflow());
+        (void)size;
+        BitReader r(buffer, 2);
+        typedef MessageSchema<Schema::UInt<16>, Schema::VarUInt> Short;
+        uint16_t u16;
+        uint32_t u32;
+        const bool ok = Short::read(&r, &u16, &u32);
+        assert(!ok && u16 == 0x1234);
+        (void)ok;
+    }
+
+    // Writing into a network string
+    {
+        BareNetworkString ns(4);
+        ns.addUInt8(42);
+        typedef MessageSchema<Schema::UInt<8>, Schema::Bool, Schema::VarInt,
+                              Schema::Position, Schema::Rotation<15> > Test;
+        static_assert(Test::MAX_BITS == 8 + 1 + 40 + 96 + 47, "MAX_BITS");
+        BitWriter w(&ns, Test::MAX_BYTES);
+        const btQuaternion q = btQuaternion(btVector3(0.3f, 1, -0.2f), 2.5f);
+        Test::write(&w, 200, true, -5, Vec3(1, 2, 3), q);
+        const unsigned int size = w.finish();
+        assert(size == 20 && ns.getTotalSize() == 21);
+        (void)size;
+
+        const uint8_t first = ns.getUInt8();
+        assert(first == 42);
+        (void)first;
+        BitReader r(ns);
+        uint8_t u8; bool b; int32_t i; Vec3 xyz; btQuaternion rot;
+        const bool ok = Test::read(&r, &u8, &b, &i, &xyz, &rot);
+        assert(ok && u8 == 200 && b && i == -5 && xyz == Vec3(1, 2, 3));
+        // q and -q are the same rotation
+        assert(fabsf(fabsf(rot.dot(q)) - 1.0f) < 0.0001f);
+        (void)ok;
+    }
+
+    // Benchmark: a server update for 100 karts
+    typedef MessageSchema<Schema::UInt<8>, Schema::Position,
+                          Schema::Rotation<15> > KartState;
+    const unsigned int NUM_KARTS = 100, NUM_MESSAGES = 1000;
+    std::vector<Vec3> xyz(NUM_KARTS);
+    std::vector<btQuaternion> rot(NUM_KARTS);
+    for (unsigned int i = 0; i < NUM_KARTS; i++)
+    {
+        xyz[i] = Vec3(i * 3.0f, 0.5f, -(float)i);
+        rot[i] = btQuaternion(btVector3(0, 1, 0), i * 0.1f);
+    }
+
+    uint32_t sum_bits = 0, sum_bytes = 0;
+    unsigned int size_bits = 0, size_bytes = 0;
+    const double start_bits = StkTime::getRealTime();
+    for (unsigned int n = 0; n < NUM_MESSAGES; n++)
+    {
+        BareNetworkString ns(NUM_KARTS * KartState::MAX_BYTES + 8);
+        BitWriter w(&ns, NUM_KARTS * KartState::MAX_BYTES + 8);
+        w.writeVarUInt(NUM_KARTS);
+        for (unsigned int i = 0; i < NUM_KARTS; i++)
+            KartState::write(&w, i, xyz[i], rot[i]);
+        size_bits = w.finish();
+
+        BitReader r(ns);
+        const unsigned int count = r.readVarUInt();
+        for (unsigned int i = 0; i < count; i++)
+        {
+            uint8_t id; Vec3 pos; btQuaternion q;
+            KartState::read(&r, &id, &pos, &q);
+            sum_bits += id;
+        }
+    }
+    const double end_bits = StkTime::getRealTime();
+    for (unsigned int n = 0; n < NUM_MESSAGES; n++)
+    {
+        BareNetworkString ns(NUM_KARTS * 29);
+        for (unsigned int i = 0; i < NUM_KARTS; i++)
+            ns.addUInt8(i).add(xyz[i]).add(rot[i]);
+        size_bytes = ns.getTotalSize();
+        while (ns.size() >= 29)
+        {
+            sum_bytes += ns.getUInt8();
+            ns.getVec3();
+            ns.getQuat();
+        }
+    }
+    const double end_bytes = StkTime::getRealTime();
+    assert(sum_bits == sum_bytes);
+    Log::info("BitWriter", "Kart update for %d karts: bit packed %d bytes, "
+              "%.2f us, byte aligned %d bytes, %.2f us.", NUM_KARTS,
+              size_bits, (end_bits - start_bits) * 1000000.0 / NUM_MESSAGES,
+              size_bytes, (end_bytes - end_bits) * 1000000.0 / NUM_MESSAGES);
+}   // unitTesting
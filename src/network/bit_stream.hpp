@@ -0,0 +1,271 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_BIT_STREAM_HPP
+#define HEADER_BIT_STREAM_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <string.h>
+
+class BareNetworkString;
+
+/**
+  * \brief Writes values with an arbitrary number of bits into a buffer
+  *  provided by the caller, e.g. a buffer on the stack or the (pooled)
+  *  buffer of a network string. Bits are stored starting with the least
+  *  significant bit of each byte. The writer never allocates memory: if
+  *  the buffer is full, further data is discarded and hasOverflow()
+  *  returns true.
+  * \ingroup network
+  */
+class BitWriter : public NoCopy
+{
+private:
+    /** The buffer to write to. */
+    uint8_t           *m_buffer;
+
+    /** Size of the buffer. */
+    unsigned int       m_capacity;
+
+    /** Number of complete bytes written to the buffer. */
+    unsigned int       m_num_bytes;
+
+    /** Bits which are not yet written to the buffer. */
+    uint64_t           m_scratch;
+
+    /** Number of bits in m_scratch. */
+    unsigned int       m_scratch_bits;
+
+    /** Set if more data was written than fits into the buffer. */
+    bool               m_overflow;
+
+    /** If the buffer is part of a network string, the string, so that the
+     *  unused part of the buffer can be removed in finish(). */
+    BareNetworkString *m_string;
+
+    // ------------------------------------------------------------------------
+    void flushBytes()
+    {
+        while (m_scratch_bits >= 8)
+        {
+            if (m_num_bytes < m_capacity)
+                m_buffer[m_num_bytes++] = (uint8_t)m_scratch;
+            else
+                m_overflow = true;
+            m_scratch >>= 8;
+            m_scratch_bits -= 8;
+        }
+    }   // flushBytes
+
+public:
+    // ------------------------------------------------------------------------
+    /** Writes into a buffer of the given size. */
+    BitWriter(uint8_t *buffer, unsigned int capacity)
+    {
+        m_buffer       = buffer;
+        m_capacity     = capacity;
+        m_num_bytes    = 0;
+        m_scratch      = 0;
+        m_scratch_bits = 0;
+        m_overflow     = false;
+        m_string       = NULL;
+    }   // BitWriter
+    // ------------------------------------------------------------------------
+             BitWriter(BareNetworkString *ns, unsigned int max_bytes);
+    unsigned int finish();
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Writes the lowest bits of a value (at most 32 bits). */
+    void writeBits(uint32_t value, unsigned int bits)
+    {
+        assert(bits <= 32);
+        if (bits < 32)
+            value &= (1u << bits) - 1;
+        m_scratch |= (uint64_t)value << m_scratch_bits;
+        m_scratch_bits += bits;
+        flushBytes();
+    }   // writeBits
+    // ------------------------------------------------------------------------
+    void writeBool(bool b) { writeBits(b ? 1 : 0, 1); }
+    // ------------------------------------------------------------------------
+    /** Writes the bit pattern of a float. */
+    void writeFloat(float f)
+    {
+        uint32_t u;
+        memcpy(&u, &f, sizeof(u));
+        writeBits(u, 32);
+    }   // writeFloat
+    // ------------------------------------------------------------------------
+    /** Writes an unsigned integer in groups of 7 bits, each with a
+     *  continuation bit, so small values only need one byte. */
+    void writeVarUInt(uint32_t value)
+    {
+        while (value >= 0x80)
+        {
+            writeBits((value & 0x7f) | 0x80, 8);
+            value >>= 7;
+        }
+        writeBits(value, 8);
+    }   // writeVarUInt
+    // ------------------------------------------------------------------------
+    /** Writes a signed integer as variable length integer, values close to
+     *  0 (positive or negative) need the fewest bytes. */
+    void writeVarInt(int32_t value)
+    {
+        writeVarUInt(((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+    }   // writeVarInt
+    // ------------------------------------------------------------------------
+    /** Writes a float in the range [min, max] with the given number of
+     *  bits. Values outside of the range are clamped. */
+    void writeQuantizedFloat(float f, float min, float max, unsigned int bits)
+    {
+        assert(bits > 0 && bits <= 24 && max > min);
+        const uint32_t steps = (1u << bits) - 1;
+        const float t = std::min(std::max((f - min) / (max - min), 0.0f),
+                                 1.0f);
+        writeBits((uint32_t)(t * steps + 0.5f), bits);
+    }   // writeQuantizedFloat
+    // ------------------------------------------------------------------------
+    /** Returns the number of bytes used so far, including a partially
+     *  filled last byte. */
+    unsigned int getNumBytes() const
+    {
+        return m_num_bytes + (m_scratch_bits > 0 ? 1 : 0);
+    }   // getNumBytes
+    // ------------------------------------------------------------------------
+    /** Returns true if the data did not fit into the buffer. */
+    bool hasOverflow() const { return m_overflow; }
+};   // BitWriter
+
+// ============================================================================
+/**
+  * \brief Reads the data written by a BitWriter. Reading beyond the end of
+  *  the data returns 0 and sets an error flag, so a message can be decoded
+  *  completely and checked only once with hasError().
+  * \ingroup network
+  */
+class BitReader : public NoCopy
+{
+private:
+    /** The data to read from. */
+    const uint8_t *m_data;
+
+    /** Size of the data. */
+    unsigned int   m_size;
+
+    /** Index of the next byte to load into m_scratch. */
+    unsigned int   m_offset;
+
+    /** Bits loaded from the data but not read yet. */
+    uint64_t       m_scratch;
+
+    /** Number of bits in m_scratch. */
+    unsigned int   m_scratch_bits;
+
+    /** Set if it was tried to read beyond the end of the data. */
+    bool           m_error;
+
+public:
+    // ------------------------------------------------------------------------
+    /** Reads from a buffer of the given size. */
+    BitReader(const uint8_t *data, unsigned int size)
+    {
+        m_data         = data;
+        m_size         = size;
+        m_offset       = 0;
+        m_scratch      = 0;
+        m_scratch_bits = 0;
+        m_error        = false;
+    }   // BitReader
+    // ------------------------------------------------------------------------
+    BitReader(const BareNetworkString &ns);
+    // ------------------------------------------------------------------------
+    /** Reads a value with the given number of bits (at most 32). */
+    uint32_t readBits(unsigned int bits)
+    {
+        assert(bits <= 32);
+        while (m_scratch_bits < bits)
+        {
+            if (m_offset >= m_size)
+            {
+                m_error = true;
+                return 0;
+            }
+            m_scratch |= (uint64_t)m_data[m_offset++] << m_scratch_bits;
+            m_scratch_bits += 8;
+        }
+        const uint32_t value = bits == 32 ? (uint32_t)m_scratch
+                             : (uint32_t)m_scratch & ((1u << bits) - 1);
+        m_scratch >>= bits;
+        m_scratch_bits -= bits;
+        return value;
+    }   // readBits
+    // ------------------------------------------------------------------------
+    bool readBool() { return readBits(1) != 0; }
+    // ------------------------------------------------------------------------
+    float readFloat()
+    {
+        const uint32_t u = readBits(32);
+        float f;
+        memcpy(&f, &u, sizeof(f));
+        return f;
+    }   // readFloat
+    // ------------------------------------------------------------------------
+    uint32_t readVarUInt()
+    {
+        uint32_t value = 0;
+        for (unsigned int shift = 0; shift < 35; shift += 7)
+        {
+            const uint32_t byte = readBits(8);
+            value |= (byte & 0x7f) << shift;
+            if ((byte & 0x80) == 0)
+                return value;
+        }
+        // More than 5 bytes are not written by writeVarUInt
+        m_error = true;
+        return 0;
+    }   // readVarUInt
+    // ------------------------------------------------------------------------
+    int32_t readVarInt()
+    {
+        const uint32_t u = readVarUInt();
+        return (int32_t)(u >> 1) ^ -(int32_t)(u & 1);
+    }   // readVarInt
+    // ------------------------------------------------------------------------
+    float readQuantizedFloat(float min, float max, unsigned int bits)
+    {
+        assert(bits > 0 && bits <= 24 && max > min);
+        const uint32_t steps = (1u << bits) - 1;
+        return min + readBits(bits) * (max - min) / steps;
+    }   // readQuantizedFloat
+    // ------------------------------------------------------------------------
+    /** Returns true if it was tried to read more data than available. */
+    bool hasError() const { return m_error; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of bits which were not read yet. */
+    unsigned int getRemainingBits() const
+    {
+        return (m_size - m_offset) * 8 + m_scratch_bits;
+    }   // getRemainingBits
+};   // BitReader
+
+#endif
@@ -0,0 +1,232 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/clock_sync.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <map>
+#include <math.h>
+
+// ----------------------------------------------------------------------------
+/** Unit testing function: exchanges requests with a simulated remote host
+ *  whose clock has an offset, over a connection with random (and
+ *  asymmetric) latency and lost packets, and checks that the estimates
+ *  converge.
+ */
+void ClockSync::unitTesting()
+{
+    const double REMOTE_OFFSET = 1234.5678;
+    const double MIN_LATENCY   = 0.020;
+    const double MAX_JITTER    = 0.030;
+
+    uint32_t seed = 4711;
+    // Returns a random number in [0,1)
+    auto random = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return ((seed >> 8) & 0xffff) / 65536.0;
+    };
+
+    ClockSync sync;
+    assert(sync.getNumSamples() == 0);
+    assert(sync.getOffset() == 0);
+
+    // Replies arriving at the local host: arrival time -> data
+    struct Reply { uint32_t m_sequence; double m_t1, m_t2; };
+    std::multimap<double, Reply> in_flight;
+    double now = 100.0;
+    for (int i = 0; i < 100; i++, now += 0.25)
+    {
+        // Deliver all replies that arrived until now
+        while (!in_flight.empty() && in_flight.begin()->first <= now)
+        {
+            const Reply &r = in_flight.begin()->second;
+            sync.addReply(r.m_sequence, r.m_t1, r.m_t2,
+                          in_flight.begin()->first);
+            in_flight.erase(in_flight.begin());
+        }
+
+        uint32_t sequence = sync.startRequest(now);
+        // 10% of the requests or replies are lost
+        if (random() < 0.1)
+            continue;
+        // The jitter is mostly small, with some large spikes
+        double up   = MIN_LATENCY + MAX_JITTER * pow(random(), 3);
+        double down = MIN_LATENCY + MAX_JITTER * pow(random(), 3);
+        Reply reply;
+        reply.m_sequence = sequence;
+        reply.m_t1       = now + up + REMOTE_OFFSET;
+        reply.m_t2       = reply.m_t1 + 0.001;
+        in_flight.insert(std::make_pair(now + up + 0.001 + down, reply));
+    }
+
+    assert(sync.getNumSamples() == HISTORY_SIZE);
+    // The estimates must be close to the ideal values
+    assert(fabs(sync.getOffset() - REMOTE_OFFSET) < 0.002);
+    assert(sync.getRTT() >= 2 * MIN_LATENCY);
+    assert(sync.getRTT() <  2 * MIN_LATENCY + 0.004);
+    assert(sync.getRTTPercentile(0.0f) == sync.getRTT());
+    assert(sync.getRTTPercentile(50.0f) >= sync.getRTT());
+    assert(sync.getRTTPercentile(100.0f) <= 2 * (MIN_LATENCY + MAX_JITTER));
+    assert(sync.getJitter() >= 0 && sync.getJitter() <= 2 * MAX_JITTER);
+    assert(fabs(sync.toRemoteTime(now) - now - REMOTE_OFFSET) < 0.002);
+
+    // Unknown and duplicated replies must be ignored
+    uint32_t sequence = sync.startRequest(now);
+    assert(!sync.addReply(sequence + 1, now, now, now));
+    assert(sync.addReply(sequence, now + REMOTE_OFFSET,
+                         now + REMOTE_OFFSET, now + 0.05));
+    assert(!sync.addReply(sequence, now + REMOTE_OFFSET,
+                          now + REMOTE_OFFSET, now + 0.05));
+
+    sync.reset();
+    assert(sync.getNumSamples() == 0);
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+ClockSync::ClockSync()
+{
+    reset();
+}   // ClockSync
+
+// ----------------------------------------------------------------------------
+/** Discards all requests and samples. */
+void ClockSync::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (unsigned int i = 0; i < MAX_PENDING; i++)
+    {
+        m_pending[i].m_sequence  = 0;
+        m_pending[i].m_send_time = -1.0;
+    }
+    m_next_sequence = 0;
+    m_num_samples   = 0;
+    m_next_sample   = 0;
+    m_rtt           = 0.0;
+    m_offset        = 0.0;
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Records that a request is sent, and returns its sequence number which
+ *  must be sent to the remote host.
+ *  \param local_time The local time at which the request is sent.
+ */
+uint32_t ClockSync::startRequest(double local_time)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint32_t sequence = m_next_sequence++;
+    Request &request = m_pending[sequence % MAX_PENDING];
+    request.m_sequence  = sequence;
+    request.m_send_time = local_time;
+    return sequence;
+}   // startRequest
+
+// ----------------------------------------------------------------------------
+/** Adds the reply to a request and updates the estimates.
+ *  \param sequence The sequence number of the request.
+ *  \param remote_receive_time Remote time at which the request arrived.
+ *  \param remote_send_time Remote time at which the reply was sent.
+ *  \param local_time Local time at which the reply arrived.
+ *  \return False if the request is unknown (e.g. too old or answered
+ *          before), true otherwise.
+ */
+bool ClockSync::addReply(uint32_t sequence, double remote_receive_time,
+                         double remote_send_time, double local_time)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Request &request = m_pending[sequence % MAX_PENDING];
+    if (request.m_sequence != sequence || request.m_send_time < 0)
+        return false;
+
+    Sample &sample = m_samples[m_next_sample];
+    sample.m_rtt    = (local_time - request.m_send_time)
+                    - (remote_send_time - remote_receive_time);
+    sample.m_rtt    = std::max(sample.m_rtt, 0.0);
+    sample.m_offset = ( (remote_receive_time - request.m_send_time)
+                      + (remote_send_time    - local_time          ) ) * 0.5;
+    request.m_send_time = -1.0;
+    m_next_sample = (m_next_sample + 1) % HISTORY_SIZE;
+    if (m_num_samples < HISTORY_SIZE)
+        m_num_samples++;
+
+    // Min filter: the sample with the smallest round trip time has the
+    // least queueing delay and therefore the most accurate offset.
+    const Sample *best = &m_samples[0];
+    for (unsigned int i = 1; i < m_num_samples; i++)
+    {
+        if (m_samples[i].m_rtt < best->m_rtt)
+            best = &m_samples[i];
+    }
+    m_rtt    = best->m_rtt;
+    m_offset = best->m_offset;
+    return true;
+}   // addReply
+
+// ----------------------------------------------------------------------------
+/** Returns the minimum round trip time in the history, 0 if no sample
+ *  is available. */
+double ClockSync::getRTT() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_rtt;
+}   // getRTT
+
+// ----------------------------------------------------------------------------
+/** Returns the offset that must be added to a local time to get the
+ *  remote time, 0 if no sample is available. */
+double ClockSync::getOffset() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_offset;
+}   // getOffset
+
+// ----------------------------------------------------------------------------
+/** Returns a percentile of the round trip times in the history.
+ *  \param percentile Percentile between 0 (minimum) and 100 (maximum).
+ */
+double ClockSync::getRTTPercentile(float percentile) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    if (m_num_samples == 0)
+        return 0.0;
+    double rtt[HISTORY_SIZE];
+    for (unsigned int i = 0; i < m_num_samples; i++)
+        rtt[i] = m_samples[i].m_rtt;
+    percentile = std::max(0.0f, std::min(percentile, 100.0f));
+    unsigned int n = (unsigned int)(percentile / 100.0f * (m_num_samples - 1)
+                                    + 0.5f);
+    std::nth_element(rtt, rtt + n, rtt + m_num_samples);
+    return rtt[n];
+}   // getRTTPercentile
+
+// ----------------------------------------------------------------------------
+/** Returns the jitter, i.e. by how much the round trip time of 95% of the
+ *  packets exceeds the minimum round trip time. */
+double ClockSync::getJitter() const
+{
+    return std::max(getRTTPercentile(95.0f) - getRTT(), 0.0);
+}   // getJitter
+
+// ----------------------------------------------------------------------------
+/** Returns the number of samples the estimates are based on. */
+unsigned int ClockSync::getNumSamples() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_num_samples;
+}   // getNumSamples
@@ -0,0 +1,105 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_CLOCK_SYNC_HPP
+#define HEADER_CLOCK_SYNC_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <mutex>
+
+/**
+  * \brief Estimates the round trip time to a remote host and the offset
+  *  of its clock, NTP style.
+  *  For each request the local send time t0 is stored. The remote host
+  *  answers with its receive time t1 and send time t2, and the reply is
+  *  received at local time t3. Then the round trip time is
+  *  (t3-t0) - (t2-t1), and the offset of the remote clock is
+  *  ((t1-t0) + (t2-t3)) / 2, which is exact if both directions have the
+  *  same latency. Queueing delays make the latency larger and asymmetric,
+  *  so the offset is taken from the sample with the smallest round trip
+  *  time in the history (min filter). All data is stored in fixed size
+  *  rings. Samples are added by the network thread, the estimates can be
+  *  read by any thread.
+  * \ingroup network
+  */
+class ClockSync : public NoCopy
+{
+private:
+    /** Number of requests that can be in flight. Replies to older
+     *  requests are ignored. */
+    static const unsigned int MAX_PENDING  = 16;
+
+    /** Number of samples used for the estimates. */
+    static const unsigned int HISTORY_SIZE = 32;
+
+    /** A request that was sent, but not answered yet. */
+    struct Request
+    {
+        uint32_t m_sequence;
+        double   m_send_time;
+    };
+
+    /** A measurement, i.e. a reply to a request. */
+    struct Sample
+    {
+        double m_rtt;
+        double m_offset;
+    };
+
+    Request      m_pending[MAX_PENDING];
+    Sample       m_samples[HISTORY_SIZE];
+
+    /** Sequence number of the next request. */
+    uint32_t     m_next_sequence;
+
+    /** Number of valid samples (at most HISTORY_SIZE). */
+    unsigned int m_num_samples;
+
+    /** Index in m_samples where the next sample is stored. */
+    unsigned int m_next_sample;
+
+    /** The current estimates, updated when a sample is added. */
+    double       m_rtt;
+    double       m_offset;
+
+    /** Protects all data, since samples are added by the network thread. */
+    mutable std::mutex m_mutex;
+
+public:
+             ClockSync();
+    void     reset();
+    uint32_t startRequest(double local_time);
+    bool     addReply(uint32_t sequence, double remote_receive_time,
+                      double remote_send_time, double local_time);
+    double   getRTT() const;
+    double   getOffset() const;
+    double   getRTTPercentile(float percentile) const;
+    double   getJitter() const;
+    unsigned int getNumSamples() const;
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Converts a time of the local clock into a time of the remote clock. */
+    double toRemoteTime(double local_time) const
+    {
+        return local_time + getOffset();
+    }   // toRemoteTime
+};   // ClockSync
+
+#endif
@@ -26,6 +26,7 @@
 
 #include "network/network_string.hpp"
 #include "utils/leak_check.hpp"
+#include "utils/memory_pool.hpp"
 #include "utils/types.hpp"
 
 #include "enet/enet.h"
@@ -71,6 +72,8 @@ private:
     double m_arrival_time;
 
 public:
+    POOL_ALLOCATED("Event")
+
          Event(ENetEvent* event);
         ~Event();
 
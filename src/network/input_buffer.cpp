@@ -0,0 +1,168 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/input_buffer.hpp"
+
+#include <assert.h>
+
+// ----------------------------------------------------------------------------
+/** Unit testing function: sends one input per tick over a simulated network
+ *  with packet loss and jitter, and checks the order and the tick in which
+ *  the inputs are played out.
+ */
+void InputBuffer::unitTesting()
+{
+    const int NUM_TICKS  = 2000;
+    const int MIN_DELAY  = 6;    // 50 ms at 120 ticks per second
+    const int MAX_JITTER = 12;   // 100 ms
+    const int LOSS       = 10;   // percent
+
+    // Use a simple LCG so that the test is deterministic
+    uint32_t seed = 12345;
+    std::multimap<int, Input> in_flight;
+    for (int t = 0; t < NUM_TICKS; t++)
+    {
+        seed = seed * 1103515245 + 12345;
+        if ((seed >> 16) % 100 < LOSS)
+            continue;
+        seed = seed * 1103515245 + 12345;
+        int arrival = t + MIN_DELAY + (seed >> 16) % (MAX_JITTER + 1);
+        Input input;
+        input.m_tick          = t;
+        input.m_kart_id       = (uint8_t)(t % 2);
+        input.m_serialized[0] = input.m_serialized[1] = 0;
+        input.m_serialized[2] = 0;
+        input.m_action        = PA_ACCEL;
+        input.m_value         = t;
+        in_flight.insert(std::make_pair(arrival, input));
+    }
+    const unsigned int num_sent = (unsigned int)in_flight.size();
+
+    // With a playout delay larger than the maximum latency each input is
+    // played out exactly playout delay ticks after it was sent.
+    for (int delay = MIN_DELAY; delay <= MIN_DELAY + MAX_JITTER; delay += 6)
+    {
+        InputBuffer buffer(delay);
+        std::multimap<int, Input>::const_iterator next = in_flight.begin();
+        std::vector<Input> inputs;
+        int last_tick[2] = { -1, -1 };
+        unsigned int num_played = 0;
+        for (int t = 0; t < NUM_TICKS + delay + MIN_DELAY + MAX_JITTER; t++)
+        {
+            while (next != in_flight.end() && next->first <= t)
+            {
+                buffer.add(next->second);
+                next++;
+            }
+            inputs.clear();
+            buffer.getDueInputs(t, &inputs);
+            for (unsigned int i = 0; i < inputs.size(); i++)
+            {
+                const Input &input = inputs[i];
+                assert(input.m_value == input.m_tick);
+                assert(input.m_tick > last_tick[input.m_kart_id]);
+                assert(input.m_tick + delay <= t);
+                if (delay >= MIN_DELAY + MAX_JITTER)
+                    assert(input.m_tick + delay == t);
+                last_tick[input.m_kart_id] = input.m_tick;
+                num_played++;
+            }
+        }
+        assert(num_played + buffer.getNumDiscarded() == num_sent);
+        if (delay >= MIN_DELAY + MAX_JITTER)
+            assert(buffer.getNumDiscarded() == 0);
+    }
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Creates an input buffer.
+ *  \param playout_delay Number of ticks an input is delayed.
+ */
+InputBuffer::InputBuffer(int playout_delay)
+{
+    m_playout_delay = playout_delay;
+    m_num_discarded = 0;
+}   // InputBuffer
+
+// ----------------------------------------------------------------------------
+/** Removes all inputs, e.g. at the start of a race. */
+void InputBuffer::reset()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_queues.clear();
+    m_last_tick.clear();
+    m_num_discarded = 0;
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Adds an input, called when a packet is received on the network thread.
+ *  Inputs older than the last input played out for the same kart are
+ *  discarded.
+ *  \param input The input to add.
+ */
+void InputBuffer::add(const Input &input)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<uint8_t, int>::const_iterator last =
+        m_last_tick.find(input.m_kart_id);
+    if (last != m_last_tick.end() && input.m_tick < last->second)
+    {
+        m_num_discarded++;
+        return;
+    }
+
+    // Packets are usually received in order, so search from the end. Inputs
+    // of the same tick keep the order in which they were received.
+    std::deque<Input> &queue = m_queues[input.m_kart_id];
+    std::deque<Input>::iterator i = queue.end();
+    while (i != queue.begin() && (i - 1)->m_tick > input.m_tick)
+        i--;
+    queue.insert(i, input);
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Appends all inputs which must be played out at the start of the given
+ *  tick to the vector, and removes them from the buffer. The inputs of each
+ *  kart are sorted by tick.
+ *  \param tick The tick which is about to be simulated.
+ *  \param inputs The vector to which the inputs are added.
+ */
+void InputBuffer::getDueInputs(int tick, std::vector<Input> *inputs)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::map<uint8_t, std::deque<Input> >::iterator q;
+    for (q = m_queues.begin(); q != m_queues.end(); q++)
+    {
+        std::deque<Input> &queue = q->second;
+        while (!queue.empty() && queue.front().m_tick + m_playout_delay <= tick)
+        {
+            m_last_tick[q->first] = queue.front().m_tick;
+            inputs->push_back(queue.front());
+            queue.pop_front();
+        }
+    }
+}   // getDueInputs
+
+// ----------------------------------------------------------------------------
+/** Returns the number of inputs that were discarded because they arrived
+ *  after a newer input of the same kart was played out. */
+unsigned int InputBuffer::getNumDiscarded()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return m_num_discarded;
+}   // getNumDiscarded
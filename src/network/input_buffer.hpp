@@ -0,0 +1,87 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_INPUT_BUFFER_HPP
+#define HEADER_INPUT_BUFFER_HPP
+
+#include "input/input.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <deque>
+#include <map>
+#include <mutex>
+#include <vector>
+
+/**
+  * \brief A jitter buffer for the inputs of remote karts.
+  *  Inputs are received on the network thread and stored per kart, sorted
+  *  by the simulation tick in which they were created by the sender. The
+  *  main thread takes all inputs which are due at the start of a tick: an
+  *  input created in tick t is played out in tick t + playout delay. This
+  *  hides the variation of the network latency, as long as it is smaller
+  *  than the playout delay. An input that arrives after a newer input of
+  *  the same kart was applied is outdated and discarded.
+  * \ingroup network
+  */
+class InputBuffer : public NoCopy
+{
+public:
+    /** One input of a kart, i.e. the compressed kart control state and
+     *  the action that changed it. */
+    struct Input
+    {
+        int          m_tick;
+        uint8_t      m_kart_id;
+        uint8_t      m_serialized[3];
+        PlayerAction m_action;
+        int          m_value;
+    };   // Input
+
+private:
+    /** The inputs of each kart, sorted by tick. */
+    std::map<uint8_t, std::deque<Input> > m_queues;
+
+    /** The tick of the last input that was played out for each kart. */
+    std::map<uint8_t, int> m_last_tick;
+
+    /** Protects the queues, which are filled by the network thread. */
+    std::mutex m_mutex;
+
+    /** Number of ticks an input is delayed. */
+    int        m_playout_delay;
+
+    /** Number of inputs that were discarded because they were too late. */
+    unsigned int m_num_discarded;
+
+public:
+         InputBuffer(int playout_delay);
+    void add(const Input &input);
+    void getDueInputs(int tick, std::vector<Input> *inputs);
+    void reset();
+    unsigned int getNumDiscarded();
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Sets the number of ticks an input is delayed. */
+    void setPlayoutDelay(int delay)            { m_playout_delay = delay; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of ticks an input is delayed. */
+    int getPlayoutDelay() const                { return m_playout_delay; }
+};   // InputBuffer
+
+#endif
@@ -0,0 +1,223 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/interest_manager.hpp"
+
+#include "config/user_config.hpp"
+#include "karts/abstract_kart.hpp"
+#include "modes/linear_world.hpp"
+#include "network/network_player_profile.hpp"
+#include "network/stk_peer.hpp"
+#include "tracks/track.hpp"
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+/** Karts closer than this (in m) are always updated at the full rate. */
+static const float NEAR_DISTANCE = 40.0f;
+
+/** Karts in front of a viewer and closer than this are considered visible
+ *  and updated at the full rate, other karts closer than this at half the
+ *  rate. Karts further away are updated at a quarter of the rate and with
+ *  reduced precision. */
+static const float VIEW_DISTANCE = 150.0f;
+
+/** Cosine of half the opening angle of the cone in which karts are
+ *  considered visible (a bit wider than the camera). */
+static const float VIEW_COS = 0.5f;
+
+/** Maximum time (in s) of bandwidth that can be saved up. */
+static const float MAX_BURST = 0.5f;
+
+/** Time (in s) between two bandwidth reports. */
+static const float REPORT_INTERVAL = 10.0f;
+
+// ----------------------------------------------------------------------------
+InterestManager::InterestManager()
+{
+}   // InterestManager
+
+// ----------------------------------------------------------------------------
+/** Removes the state of all peers, called at the start of a race. */
+void InterestManager::reset()
+{
+    m_peers.clear();
+}   // reset
+
+// ----------------------------------------------------------------------------
+/** Returns how often the state of a kart should be sent to the current
+ *  viewers (1 = with every update), and if it is enough to send it with
+ *  reduced precision.
+ *  \param world The world.
+ *  \param kart The kart.
+ *  \param coarse On return true if the kart can be sent with reduced
+ *         precision.
+ */
+float InterestManager::getWeight(const World *world, const AbstractKart *kart,
+                                 bool *coarse) const
+{
+    *coarse = false;
+    // A peer without karts (which should not happen) gets everything
+    if (m_viewers.empty())
+        return 1.0f;
+
+    const LinearWorld *lw = dynamic_cast<const LinearWorld*>(world);
+    const float track_length = lw ? Track::getCurrentTrack()->getTrackLength()
+                                  : 0.0f;
+    float distance = VIEW_DISTANCE + 1.0f;
+    bool in_view   = false;
+    for (const AbstractKart *viewer : m_viewers)
+    {
+        const Vec3 to_kart = kart->getXYZ() - viewer->getXYZ();
+        const float straight = to_kart.length();
+        float d = straight;
+        if (lw && track_length > 0)
+        {
+            d = fabsf(lw->getDistanceDownTrackForKart(kart->getWorldKartId())
+                    - lw->getDistanceDownTrackForKart(
+                                                 viewer->getWorldKartId()));
+            d = std::min(d, track_length - d);
+        }
+        distance = std::min(distance, d);
+        // The camera looks along the kart's forward direction
+        const Vec3 forward = viewer->getTrans().getBasis().getColumn(2);
+        if (straight < VIEW_DISTANCE &&
+            forward.dot(to_kart) > VIEW_COS * straight)
+            in_view = true;
+    }
+
+    if (distance < NEAR_DISTANCE || in_view)
+        return 1.0f;
+    if (distance < VIEW_DISTANCE)
+        return 0.5f;
+    *coarse = true;
+    return 0.25f;
+}   // getWeight
+
+// ----------------------------------------------------------------------------
+/** Selects the kart states to send to one peer in this update.
+ *  \param world The world.
+ *  \param peer The peer.
+ *  \param dt Time since the last update of this peer.
+ *  \param header_bytes Size of the message without any kart states.
+ *  \param full_bytes Maximum size of a kart state with full precision.
+ *  \param coarse_bytes Maximum size of a kart state with reduced precision.
+ *  \param selection On return the kart states to send (the vector is
+ *         cleared first).
+ */
+void InterestManager::selectKarts(const World *world, STKPeer *peer,
+                                  float dt, unsigned int header_bytes,
+                                  unsigned int full_bytes,
+                                  unsigned int coarse_bytes,
+                                  std::vector<Selection> *selection)
+{
+    selection->clear();
+    const unsigned int num_karts = world->getNumKarts();
+    const float bandwidth = (float)UserConfigParams::m_server_peer_bandwidth;
+    const uint32_t bytes_sent = peer->getBytesSent();
+
+    std::map<int, PeerState>::iterator it = m_peers.find(peer->getHostId());
+    if (it == m_peers.end())
+    {
+        PeerState state;
+        state.m_tokens          = bandwidth * MAX_BURST;
+        state.m_last_bytes_sent = bytes_sent;
+        state.m_report_time     = 0;
+        state.m_report_bytes    = bytes_sent;
+        state.m_num_due         = 0;
+        state.m_num_sent        = 0;
+        it = m_peers.insert(std::make_pair(peer->getHostId(), state)).first;
+    }
+    PeerState &state = it->second;
+    if (state.m_priority.size() != num_karts)
+        state.m_priority.assign(num_karts, 1.0f);
+
+    // Refill the budget, and remove everything that was sent to this peer
+    // since the last update
+    state.m_tokens = std::min(state.m_tokens + bandwidth * dt,
+                              bandwidth * MAX_BURST)
+                   - (float)(uint32_t)(bytes_sent - state.m_last_bytes_sent);
+    state.m_last_bytes_sent = bytes_sent;
+
+    m_viewers.clear();
+    for (NetworkPlayerProfile *profile : peer->getAllPlayerProfiles())
+    {
+        const int id = profile->getWorldKartID();
+        if (id >= 0 && id < (int)num_karts)
+            m_viewers.push_back(world->getKart(id));
+    }
+
+    m_candidates.clear();
+    for (unsigned int i = 0; i < num_karts; i++)
+    {
+        const AbstractKart *kart = world->getKart(i);
+        // The peer's own karts are controlled by the peer
+        if (std::find(m_viewers.begin(), m_viewers.end(), kart)
+            != m_viewers.end())
+            continue;
+        bool coarse;
+        state.m_priority[i] += getWeight(world, kart, &coarse);
+        if (state.m_priority[i] < 1.0f)
+            continue;
+        Candidate c;
+        c.m_priority = state.m_priority[i];
+        c.m_kart_id  = i;
+        c.m_coarse   = coarse;
+        m_candidates.push_back(c);
+    }
+    std::sort(m_candidates.begin(), m_candidates.end(),
+              [](const Candidate &a, const Candidate &b)
+              {
+                  if (a.m_priority != b.m_priority)
+                      return a.m_priority > b.m_priority;
+                  return a.m_kart_id < b.m_kart_id;
+              });
+
+    // Always send at least one kart, so that a peer with a very small
+    // budget still gets updates
+    float budget = std::max(state.m_tokens - header_bytes, (float)full_bytes);
+    for (const Candidate &c : m_candidates)
+    {
+        const unsigned int size = c.m_coarse ? coarse_bytes : full_bytes;
+        if (size > budget)
+            break;
+        budget -= size;
+        Selection s;
+        s.m_kart_id = c.m_kart_id;
+        s.m_coarse  = c.m_coarse;
+        selection->push_back(s);
+        state.m_priority[c.m_kart_id] = 0;
+    }
+    state.m_num_due  += (unsigned int)m_candidates.size();
+    state.m_num_sent += (unsigned int)selection->size();
+
+    state.m_report_time += dt;
+    if (state.m_report_time >= REPORT_INTERVAL)
+    {
+        const uint32_t bytes = bytes_sent - state.m_report_bytes;
+        Log::info("InterestManager", "Peer %d: %.0f bytes/s, sent %d of %d "
+                  "due kart states.", peer->getHostId(),
+                  bytes / state.m_report_time, state.m_num_sent,
+                  state.m_num_due);
+        state.m_report_time  = 0;
+        state.m_report_bytes = bytes_sent;
+        state.m_num_due      = 0;
+        state.m_num_sent     = 0;
+    }
+}   // selectKarts
@@ -0,0 +1,106 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_INTEREST_MANAGER_HPP
+#define HEADER_INTEREST_MANAGER_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <map>
+#include <vector>
+
+class AbstractKart;
+class STKPeer;
+class World;
+
+/**
+  * \brief Decides on the server which kart states are sent to which peer.
+  *  For each peer the karts are weighted by their relevance: karts close
+  *  to one of the peer's karts (measured down the track in linear worlds)
+  *  or in front of it (i.e. likely visible to its camera) are updated with
+  *  every kart update, other karts less often, and distant karts also with
+  *  reduced precision. Each kart accumulates its weight as priority in
+  *  each update, and is due once the priority reaches 1. Due karts are
+  *  sent by decreasing priority as long as the bandwidth budget of the
+  *  peer allows, karts which are not sent keep their priority and are
+  *  preferred in the next update.
+  *  The budget of a peer is a token bucket filled with the configured
+  *  bandwidth, from which all data sent to the peer (not only kart
+  *  updates) is removed. The bandwidth used per peer is logged regularly.
+  * \ingroup network
+  */
+class InterestManager : public NoCopy
+{
+public:
+    /** A kart state to send, and if it is sent with reduced precision. */
+    struct Selection
+    {
+        uint8_t m_kart_id;
+        bool    m_coarse;
+    };   // Selection
+
+private:
+    /** Per peer state. */
+    struct PeerState
+    {
+        /** Accumulated priority of each kart. */
+        std::vector<float> m_priority;
+
+        /** Number of bytes which can be sent to the peer. Can be negative
+         *  if more was sent than the budget allowed. */
+        float    m_tokens;
+
+        /** Value of STKPeer::getBytesSent() at the last update. */
+        uint32_t m_last_bytes_sent;
+
+        /** Time since the last report, and bytes sent and kart states
+         *  which were due and sent in this time. */
+        float    m_report_time;
+        uint32_t m_report_bytes;
+        unsigned int m_num_due, m_num_sent;
+    };   // PeerState
+
+    /** The state of each peer, keyed by host id. */
+    std::map<int, PeerState> m_peers;
+
+    /** A kart which is due to be sent. */
+    struct Candidate
+    {
+        float        m_priority;
+        unsigned int m_kart_id;
+        bool         m_coarse;
+    };   // Candidate
+
+    /** Buffers kept to avoid reallocations. */
+    std::vector<Candidate>     m_candidates;
+    std::vector<AbstractKart*> m_viewers;
+
+    float getWeight(const World *world, const AbstractKart *kart,
+                    bool *coarse) const;
+
+public:
+         InterestManager();
+    void reset();
+    void selectKarts(const World *world, STKPeer *peer, float dt,
+                     unsigned int header_bytes, unsigned int full_bytes,
+                     unsigned int coarse_bytes,
+                     std::vector<Selection> *selection);
+};   // InterestManager
+
+#endif
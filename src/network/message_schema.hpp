@@ -0,0 +1,271 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_MESSAGE_SCHEMA_HPP
+#define HEADER_MESSAGE_SCHEMA_HPP
+
+#include "network/bit_stream.hpp"
+#include "utils/types.hpp"
+#include "utils/vec3.hpp"
+
+#include "LinearMath/btQuaternion.h"
+
+#include <cmath>
+#include <type_traits>
+
+/** \brief Field types for a MessageSchema. Each field defines the C++ type
+ *  of its value, the maximum number of bits it needs, and how the value
+ *  is written to a BitWriter and read from a BitReader.
+ *  \ingroup network
+ */
+namespace Schema
+{
+    /** An unsigned integer with a fixed number of bits. The value type is
+     *  the smallest unsigned integer type with enough bits. */
+    template<unsigned int BITS>
+    struct UInt
+    {
+        static_assert(BITS > 0 && BITS <= 32, "Invalid number of bits");
+        typedef typename std::conditional<BITS <= 8, uint8_t,
+                typename std::conditional<BITS <= 16, uint16_t,
+                                          uint32_t>::type>::type Type;
+        static const unsigned int MAX_BITS = BITS;
+        static void write(BitWriter *w, Type v) { w->writeBits(v, BITS); }
+        static void read(BitReader *r, Type *v) { *v = (Type)r->readBits(BITS); }
+    };   // UInt
+
+    // ------------------------------------------------------------------------
+    struct Bool
+    {
+        typedef bool Type;
+        static const unsigned int MAX_BITS = 1;
+        static void write(BitWriter *w, bool v) { w->writeBool(v); }
+        static void read(BitReader *r, bool *v) { *v = r->readBool(); }
+    };   // Bool
+
+    // ------------------------------------------------------------------------
+    /** An unsigned integer which is usually small, e.g. a count. */
+    struct VarUInt
+    {
+        typedef uint32_t Type;
+        static const unsigned int MAX_BITS = 40;
+        static void write(BitWriter *w, uint32_t v) { w->writeVarUInt(v); }
+        static void read(BitReader *r, uint32_t *v) { *v = r->readVarUInt(); }
+    };   // VarUInt
+
+    // ------------------------------------------------------------------------
+    /** A signed integer which is usually close to 0. */
+    struct VarInt
+    {
+        typedef int32_t Type;
+        static const unsigned int MAX_BITS = 40;
+        static void write(BitWriter *w, int32_t v) { w->writeVarInt(v); }
+        static void read(BitReader *r, int32_t *v) { *v = r->readVarInt(); }
+    };   // VarInt
+
+    // ------------------------------------------------------------------------
+    /** A float with full precision. */
+    struct Float
+    {
+        typedef float Type;
+        static const unsigned int MAX_BITS = 32;
+        static void write(BitWriter *w, float v) { w->writeFloat(v); }
+        static void read(BitReader *r, float *v) { *v = r->readFloat(); }
+    };   // Float
+
+    // ------------------------------------------------------------------------
+    /** A float in the range [MIN, MAX], stored with BITS bits. */
+    template<int MIN, int MAX, unsigned int BITS>
+    struct QuantizedFloat
+    {
+        static_assert(MIN < MAX, "Invalid range");
+        static_assert(BITS > 0 && BITS <= 24, "Invalid number of bits");
+        typedef float Type;
+        static const unsigned int MAX_BITS = BITS;
+        static void write(BitWriter *w, float v)
+        {
+            w->writeQuantizedFloat(v, (float)MIN, (float)MAX, BITS);
+        }   // write
+        static void read(BitReader *r, float *v)
+        {
+            *v = r->readQuantizedFloat((float)MIN, (float)MAX, BITS);
+        }   // read
+    };   // QuantizedFloat
+
+    // ------------------------------------------------------------------------
+    /** A position with full precision. */
+    struct Position
+    {
+        typedef Vec3 Type;
+        static const unsigned int MAX_BITS = 96;
+        static void write(BitWriter *w, const Vec3 &v)
+        {
+            w->writeFloat(v.getX());
+            w->writeFloat(v.getY());
+            w->writeFloat(v.getZ());
+        }   // write
+        static void read(BitReader *r, Vec3 *v)
+        {
+            const float x = r->readFloat();
+            const float y = r->readFloat();
+            const float z = r->readFloat();
+            v->setValue(x, y, z);
+        }   // read
+    };   // Position
+
+    // ------------------------------------------------------------------------
+    /** A position rounded to 1/STEPS_PER_M, with each coordinate stored as
+     *  variable length integer (e.g. 2 bytes for up to 1km with 8 steps
+     *  per m). */
+    template<int STEPS_PER_M>
+    struct QuantizedPosition
+    {
+        static_assert(STEPS_PER_M > 0, "Invalid resolution");
+        typedef Vec3 Type;
+        static const unsigned int MAX_BITS = 3 * VarInt::MAX_BITS;
+        static void write(BitWriter *w, const Vec3 &v)
+        {
+            w->writeVarInt((int32_t)floorf(v.getX() * STEPS_PER_M + 0.5f));
+            w->writeVarInt((int32_t)floorf(v.getY() * STEPS_PER_M + 0.5f));
+            w->writeVarInt((int32_t)floorf(v.getZ() * STEPS_PER_M + 0.5f));
+        }   // write
+        static void read(BitReader *r, Vec3 *v)
+        {
+            const float x = (float)r->readVarInt() / STEPS_PER_M;
+            const float y = (float)r->readVarInt() / STEPS_PER_M;
+            const float z = (float)r->readVarInt() / STEPS_PER_M;
+            v->setValue(x, y, z);
+        }   // read
+    };   // QuantizedPosition
+
+    // ------------------------------------------------------------------------
+    /** A unit quaternion, stored as the index of its largest component and
+     *  the three other components with BITS bits each. Since q and -q are
+     *  the same rotation, the largest component can be made positive, and
+     *  since the quaternion has length 1, the other components are in
+     *  [-1/sqrt(2), 1/sqrt(2)] and the largest can be computed from them.
+     */
+    template<unsigned int BITS>
+    struct Rotation
+    {
+        static_assert(BITS > 1 && BITS <= 24, "Invalid number of bits");
+        typedef btQuaternion Type;
+        static const unsigned int MAX_BITS = 2 + 3 * BITS;
+        static void write(BitWriter *w, const btQuaternion &q)
+        {
+            const float c[4] = { q.getX(), q.getY(), q.getZ(), q.getW() };
+            unsigned int largest = 0;
+            for (unsigned int i = 1; i < 4; i++)
+            {
+                if (fabsf(c[i]) > fabsf(c[largest]))
+                    largest = i;
+            }
+            const float sign = c[largest] < 0 ? -1.0f : 1.0f;
+            w->writeBits(largest, 2);
+            for (unsigned int i = 0; i < 4; i++)
+            {
+                if (i != largest)
+                    w->writeQuantizedFloat(sign * c[i], -0.70710678f,
+                                           0.70710678f, BITS);
+            }
+        }   // write
+        static void read(BitReader *r, btQuaternion *q)
+        {
+            const unsigned int largest = r->readBits(2);
+            float c[4];
+            float sum = 0;
+            for (unsigned int i = 0; i < 4; i++)
+            {
+                if (i == largest) continue;
+                c[i] = r->readQuantizedFloat(-0.70710678f, 0.70710678f, BITS);
+                sum += c[i] * c[i];
+            }
+            c[largest] = sqrtf(std::max(1.0f - sum, 0.0f));
+            q->setValue(c[0], c[1], c[2], c[3]);
+            q->normalize();
+        }   // read
+    };   // Rotation
+
+    // ------------------------------------------------------------------------
+    /** Writes and reads a list of fields recursively. */
+    template<typename... Fields> struct FieldList;
+
+    template<> struct FieldList<>
+    {
+        static const unsigned int MAX_BITS = 0;
+        static void write(BitWriter *w) {}
+        static void read(BitReader *r) {}
+    };   // FieldList<>
+
+    template<typename F, typename... Rest> struct FieldList<F, Rest...>
+    {
+        static const unsigned int MAX_BITS = F::MAX_BITS
+                                           + FieldList<Rest...>::MAX_BITS;
+        static void write(BitWriter *w, const typename F::Type &v,
+                          const typename Rest::Type&... rest)
+        {
+            F::write(w, v);
+            FieldList<Rest...>::write(w, rest...);
+        }   // write
+        static void read(BitReader *r, typename F::Type *v,
+                         typename Rest::Type*... rest)
+        {
+            F::read(r, v);
+            FieldList<Rest...>::read(r, rest...);
+        }   // read
+    };   // FieldList
+}   // namespace Schema
+
+// ============================================================================
+/**
+  * \brief Describes the layout of a message (or of a repeated part of a
+  *  message) at compile time, e.g.
+  *      typedef MessageSchema<Schema::UInt<8>, Schema::Position> KartPos;
+  *      KartPos::write(&writer, kart_id, xyz);
+  *      KartPos::read(&reader, &kart_id, &xyz);
+  *  The values are packed without any padding between fields. MAX_BYTES
+  *  is the maximum size of the encoded data, which can be used to size a
+  *  buffer on the stack.
+  * \ingroup network
+  */
+template<typename... Fields>
+class MessageSchema
+{
+public:
+    /** Maximum number of bits and bytes needed for the fields. */
+    static const unsigned int MAX_BITS =
+        Schema::FieldList<Fields...>::MAX_BITS;
+    static const unsigned int MAX_BYTES = (MAX_BITS + 7) / 8;
+
+    // ------------------------------------------------------------------------
+    /** Writes one value for each field. */
+    static void write(BitWriter *writer, const typename Fields::Type&... v)
+    {
+        Schema::FieldList<Fields...>::write(writer, v...);
+    }   // write
+    // ------------------------------------------------------------------------
+    /** Reads one value for each field.
+     *  \return False if the data was too short. */
+    static bool read(BitReader *reader, typename Fields::Type*... v)
+    {
+        Schema::FieldList<Fields...>::read(reader, v...);
+        return !reader->hasError();
+    }   // read
+};   // MessageSchema
+
+#endif
@@ -0,0 +1,175 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "network/network_proxy.hpp"
+
+#include "utils/log.hpp"
+
+#include <stdlib.h>
+
+// ----------------------------------------------------------------------------
+/** Opens the proxy socket. enet_initialize() must have been called.
+ *  \param port The local port clients connect to.
+ *  \param server Address of the server.
+ *  \param latency Fixed latency in ms in each direction.
+ *  \param jitter Maximum random additional latency in ms.
+ *  \param loss Percentage of packets that are dropped.
+ */
+NetworkProxy::NetworkProxy(uint16_t port, const TransportAddress &server,
+                           int latency, int jitter, int loss)
+{
+    m_server        = server.toEnetAddress();
+    m_latency       = latency;
+    m_jitter        = jitter;
+    m_loss          = loss;
+    m_num_forwarded = 0;
+    m_num_dropped   = 0;
+
+    m_socket = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+    ENetAddress address;
+    address.host = ENET_HOST_ANY;
+    address.port = port;
+    if (m_socket != ENET_SOCKET_NULL &&
+        enet_socket_bind(m_socket, &address) < 0)
+    {
+        enet_socket_destroy(m_socket);
+        m_socket = ENET_SOCKET_NULL;
+    }
+    if (m_socket == ENET_SOCKET_NULL)
+    {
+        Log::error("NetworkProxy", "Can not open port %d.", port);
+        return;
+    }
+    enet_socket_set_option(m_socket, ENET_SOCKOPT_NONBLOCK, 1);
+    Log::info("NetworkProxy", "Forwarding port %d to %s, latency %d ms, "
+              "jitter %d ms, loss %d%%.", port, server.toString().c_str(),
+              latency, jitter, loss);
+}   // NetworkProxy
+
+// ----------------------------------------------------------------------------
+NetworkProxy::~NetworkProxy()
+{
+    std::map<uint64_t, std::pair<ENetAddress, ENetSocket> >::iterator i;
+    for (i = m_clients.begin(); i != m_clients.end(); i++)
+        enet_socket_destroy(i->second.second);
+    if (m_socket != ENET_SOCKET_NULL)
+        enet_socket_destroy(m_socket);
+}   // ~NetworkProxy
+
+// ----------------------------------------------------------------------------
+/** Returns a key that identifies a client by its address. */
+uint64_t NetworkProxy::getKey(const ENetAddress &address)
+{
+    return ((uint64_t)address.host << 16) | address.port;
+}   // getKey
+
+// ----------------------------------------------------------------------------
+/** Receives all pending packets of a socket and either drops them or
+ *  queues them with a random delay.
+ *  \param socket The socket to read from.
+ *  \param client Key of the client, ignored for packets to the server.
+ *  \param to_server True if the socket receives packets from clients.
+ */
+void NetworkProxy::receive(ENetSocket socket, uint64_t client, bool to_server)
+{
+    uint8_t data[4096];
+    while (true)
+    {
+        ENetAddress sender;
+        ENetBuffer buffer;
+        buffer.data       = data;
+        buffer.dataLength = sizeof(data);
+        const int len = enet_socket_receive(socket, &sender, &buffer, 1);
+        if (len <= 0)
+            return;
+
+        if (to_server)
+        {
+            client = getKey(sender);
+            if (m_clients.find(client) == m_clients.end())
+            {
+                ENetSocket s = enet_socket_create(ENET_SOCKET_TYPE_DATAGRAM);
+                if (s == ENET_SOCKET_NULL)
+                    continue;
+                enet_socket_set_option(s, ENET_SOCKOPT_NONBLOCK, 1);
+                m_clients[client] = std::make_pair(sender, s);
+                Log::info("NetworkProxy", "New client %s.",
+                          TransportAddress(sender).toString().c_str());
+            }
+        }
+
+        if (rand() % 100 < m_loss)
+        {
+            m_num_dropped++;
+            continue;
+        }
+        const int delay = m_latency + (m_jitter > 0 ? rand() % (m_jitter + 1)
+                                                    : 0);
+        Packet packet;
+        packet.m_client    = client;
+        packet.m_to_server = to_server;
+        packet.m_data.assign(data, data + len);
+        m_queue.insert(std::make_pair(enet_time_get() + delay, packet));
+    }
+}   // receive
+
+// ----------------------------------------------------------------------------
+/** Sends all packets whose delay has passed. */
+void NetworkProxy::forwardDuePackets()
+{
+    const enet_uint32 now = enet_time_get();
+    while (!m_queue.empty() && m_queue.begin()->first <= now)
+    {
+        const Packet &packet = m_queue.begin()->second;
+        const std::pair<ENetAddress, ENetSocket> &client =
+            m_clients[packet.m_client];
+        ENetBuffer buffer;
+        buffer.data       = (void*)packet.m_data.data();
+        buffer.dataLength = packet.m_data.size();
+        if (packet.m_to_server)
+            enet_socket_send(client.second, &m_server, &buffer, 1);
+        else
+            enet_socket_send(m_socket, &client.first, &buffer, 1);
+        m_num_forwarded++;
+        m_queue.erase(m_queue.begin());
+    }
+}   // forwardDuePackets
+
+// ----------------------------------------------------------------------------
+/** Forwards packets until the process is killed. */
+void NetworkProxy::run()
+{
+    enet_uint32 last_log = enet_time_get();
+    while (true)
+    {
+        enet_uint32 condition = ENET_SOCKET_WAIT_RECEIVE;
+        enet_socket_wait(m_socket, &condition, 1);
+        receive(m_socket, 0, /*to_server*/true);
+        std::map<uint64_t, std::pair<ENetAddress, ENetSocket> >::iterator i;
+        for (i = m_clients.begin(); i != m_clients.end(); i++)
+            receive(i->second.second, i->first, /*to_server*/false);
+        forwardDuePackets();
+
+        if (enet_time_get() - last_log > 10000)
+        {
+            last_log = enet_time_get();
+            Log::info("NetworkProxy", "%u packets forwarded, %u dropped.",
+                      m_num_forwarded, m_num_dropped);
+        }
+    }
+}   // run
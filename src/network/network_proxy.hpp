@@ -0,0 +1,93 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_NETWORK_PROXY_HPP
+#define HEADER_NETWORK_PROXY_HPP
+
+#include "network/transport_address.hpp"
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include "enet/enet.h"
+
+#include <map>
+#include <vector>
+
+/**
+  * \brief A local UDP proxy between clients and a server which simulates a
+  *  bad network connection, used to test the networking code.
+  *  Clients connect to the proxy port instead of the server. All packets
+  *  in both directions are delayed by a fixed latency plus a random jitter
+  *  (which also reorders packets), and a percentage of them is dropped.
+  *  Started with --network-proxy, see main.cpp.
+  * \ingroup network
+  */
+class NetworkProxy : public NoCopy
+{
+private:
+    /** A packet waiting to be forwarded. */
+    struct Packet
+    {
+        /** The client this packet is from or to. */
+        uint64_t             m_client;
+        /** True if the packet is sent from the client to the server. */
+        bool                 m_to_server;
+        std::vector<uint8_t> m_data;
+    };   // Packet
+
+    /** The socket clients send to. */
+    ENetSocket    m_socket;
+
+    /** The address of the server. */
+    ENetAddress   m_server;
+
+    /** For each client (identified by its address) the address and a
+     *  socket used to talk to the server, so that the server sees one
+     *  peer per client. */
+    std::map<uint64_t, std::pair<ENetAddress, ENetSocket> > m_clients;
+
+    /** The packets to forward, sorted by the time (in ms) they are due. */
+    std::multimap<enet_uint32, Packet> m_queue;
+
+    /** Fixed latency in ms added in each direction. */
+    int           m_latency;
+
+    /** Maximum random latency in ms added in each direction. */
+    int           m_jitter;
+
+    /** Percentage of packets that are dropped. */
+    int           m_loss;
+
+    unsigned int  m_num_forwarded;
+    unsigned int  m_num_dropped;
+
+    static uint64_t getKey(const ENetAddress &address);
+    void receive(ENetSocket socket, uint64_t client, bool to_server);
+    void forwardDuePackets();
+
+public:
+         NetworkProxy(uint16_t port, const TransportAddress &server,
+                      int latency, int jitter, int loss);
+        ~NetworkProxy();
+    void run();
+    // ------------------------------------------------------------------------
+    /** Returns true if the proxy socket could be opened. */
+    bool isValid() const { return m_socket != ENET_SOCKET_NULL; }
+};   // NetworkProxy
+
+#endif
@@ -46,12 +46,15 @@ void NetworkString::unitTesting()
     // Append some values from the message
     s.addUInt16(12345);
     s.addFloat(1.2345f);
+    s.addDouble(12345.678901234);
 
     // Since this string was not received, we need to skip the type and token explicitly.
     s.skip(5);
     assert(s.getUInt16() == 12345);
     float f = s.getFloat();
     assert(f==1.2345f);
+    double d = s.getDouble();
+    assert(d==12345.678901234);
 
     // Check modifying a token in an already assembled message
     uint32_t new_token = 0x87654321;
@@ -25,6 +25,7 @@
 
 #include "network/protocol.hpp"
 #include "utils/leak_check.hpp"
+#include "utils/memory_pool.hpp"
 #include "utils/types.hpp"
 #include "utils/vec3.hpp"
 
@@ -55,8 +56,9 @@ private:
     LEAK_CHECK();
 
 protected:
-    /** The actual buffer. */
-    std::vector<uint8_t> m_buffer;
+    /** The actual buffer. Most network strings are small, so the buffer
+     *  is allocated from the small object pool. */
+    std::vector<uint8_t, PoolStlAllocator<uint8_t> > m_buffer;
 
     /** To avoid copying the buffer when bytes are deleted (which only
     *  happens at the front), use an offset index. All positions given
@@ -114,6 +116,7 @@ protected:
     }   // get
 
 public:
+    POOL_ALLOCATED("NetworkString")
 
     /** Constructor, sets the protocol type of this message. */
     BareNetworkString(int capacity=16)
@@ -173,6 +176,29 @@ public:
      *  string must be sent. */
     unsigned int getTotalSize() const { return m_buffer.size(); }
     // ------------------------------------------------------------------------
+    /** Returns a pointer to the data which has not been read yet. */
+    const uint8_t* getCurrentData() const
+    {
+        return m_buffer.data() + m_current_offset;
+    }   // getCurrentData
+    // ------------------------------------------------------------------------
+    /** Appends n bytes to the string and returns a pointer to them, so that
+     *  data can be encoded directly into the buffer (see BitWriter). The
+     *  pointer is only valid until the string is modified again. */
+    uint8_t* grow(unsigned int n)
+    {
+        const size_t old_size = m_buffer.size();
+        m_buffer.resize(old_size + n);
+        return m_buffer.data() + old_size;
+    }   // grow
+    // ------------------------------------------------------------------------
+    /** Removes n bytes from the end of the string. */
+    void shrink(unsigned int n)
+    {
+        assert(n <= m_buffer.size());
+        m_buffer.resize(m_buffer.size() - n);
+    }   // shrink
+    // ------------------------------------------------------------------------
     // All functions related to adding data to a network string
     /** Add 8 bit unsigned int. */
     BareNetworkString& addUInt8(const uint8_t value)
@@ -216,6 +242,15 @@ public:
         return addUInt32(*p);
     }   // addFloat
 
+    // ------------------------------------------------------------------------
+    /** Adds an 8 byte floating point value, e.g. a time stamp. */
+    BareNetworkString& addDouble(const double value)
+    {
+        uint64_t u;
+        memcpy(&u, &value, sizeof(double));
+        return addUInt32((uint32_t)(u >> 32)).addUInt32((uint32_t)u);
+    }   // addDouble
+
     // ------------------------------------------------------------------------
     /** Adds the content of another network string. It only copies data which
      *  has not been 'removed' (i.e. skipped). */
@@ -284,6 +319,17 @@ public:
         return f;
     }   // getFloat
 
+    // ------------------------------------------------------------------------
+    /** Gets an 8 byte floating point value. */
+    double getDouble() const
+    {
+        uint64_t u = (uint64_t)getUInt32() << 32;
+        u |= getUInt32();
+        double d;
+        memcpy(&d, &u, sizeof(double));
+        return d;
+    }   // getDouble
+
     // ------------------------------------------------------------------------
     /** Gets a Vec3. */
     Vec3 getVec3() const
@@ -408,5 +454,9 @@ public:
 
 };   // class NetworkString
 
+// NetworkString objects are deleted through BareNetworkString pointers, which
+// uses the pool's sized delete of the base class.
+static_assert(sizeof(NetworkString) == sizeof(BareNetworkString),
+              "NetworkString must not add data members to BareNetworkString");
 
 #endif // NETWORK_STRING_HPP
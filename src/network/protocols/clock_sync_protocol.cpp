@@ -0,0 +1,113 @@
+#include "network/protocols/clock_sync_protocol.hpp"
+
+#include "network/event.hpp"
+#include "network/network_config.hpp"
+#include "network/stk_host.hpp"
+#include "network/stk_peer.hpp"
+#include "utils/time.hpp"
+
+/** How often requests are sent to each peer (in seconds). */
+static const double REQUEST_INTERVAL = 0.25;
+
+//-----------------------------------------------------------------------------
+/** This protocol estimates the round trip time to each peer and the clock
+ *  offset to the server, see ClockSync.
+ *  FIXME: ATM the main thread will load the world as part of an update
+ *  of the ProtocolManager (which updates the protocols). Since all protocols
+ *  are locked dusing this update, the synchronisation protocol is actually
+ *  delayed from starting while world is loading (since finding the protocol
+ *  for a message requires the protocol lock) - causing at least two frames
+ *  of significanlty delayed pings. The min filter of ClockSync discards
+ *  these samples.
+ */
+ClockSyncProtocol::ClockSyncProtocol() 
+                 : Protocol(PROTOCOL_SYNCHRONIZATION)
+{
+    m_last_request_time = 0;
+    m_last_log_time     = 0;
+}   // ClockSyncProtocol
+
+//-----------------------------------------------------------------------------
+ClockSyncProtocol::~ClockSyncProtocol()
+{
+}   // ~ClockSyncProtocol
+
+//-----------------------------------------------------------------------------
+void ClockSyncProtocol::setup()
+{
+    Log::info("ClockSyncProtocol", "Ready !");
+}   // setup
+
+//-----------------------------------------------------------------------------
+/** Called when receiving a message. A request is answered immediately with
+ *  the time it was received and the time the answer is sent. A reply is
+ *  added to the ClockSync of the peer it is from.
+ */
+bool ClockSyncProtocol::notifyEventAsynchronous(Event* event)
+{
+    if (event->getType() != EVENT_TYPE_MESSAGE)
+        return true;
+    const double receive_time = StkTime::getRealTime();
+    if(!checkDataSize(event, 5)) return true;
+
+    const NetworkString &data = event->data();
+    uint8_t  type     = data.getUInt8();
+    uint32_t sequence = data.getUInt32();
+    STKPeer *peer     = event->getPeer();
+
+    if (type == CS_REQUEST)
+    {
+        NetworkString *response = getNetworkString(21);
+        response->addUInt8(CS_REPLY).addUInt32(sequence)
+                 .addDouble(receive_time).addDouble(StkTime::getRealTime());
+        peer->sendPacket(response, false);
+        delete response;
+        return true;
+    }
+
+    if (!checkDataSize(event, 16)) return true;
+    double remote_receive_time = data.getDouble();
+    double remote_send_time    = data.getDouble();
+    if (!peer->getClockSync().addReply(sequence, remote_receive_time,
+                                       remote_send_time, receive_time))
+    {
+        Log::debug("ClockSyncProtocol",
+                   "Reply to unknown request %u from host %d.",
+                   sequence, peer->getHostId());
+    }
+    return true;
+}   // notifyEventAsynchronous
+
+//-----------------------------------------------------------------------------
+/** Sends a request to each peer (on a client this is only the server)
+ *  four times a second, and regularly logs the statistics of each peer.
+ */
+void ClockSyncProtocol::asynchronousUpdate()
+{
+    double current_time = StkTime::getRealTime();
+    if (current_time < m_last_request_time + REQUEST_INTERVAL)
+        return;
+    m_last_request_time = current_time;
+
+    const std::vector<STKPeer*> &peers = STKHost::get()->getPeers();
+    const bool log = current_time > m_last_log_time + 10.0;
+    if (log)
+        m_last_log_time = current_time;
+    for (unsigned int i = 0; i < peers.size(); i++)
+    {
+        ClockSync &sync = peers[i]->getClockSync();
+        NetworkString *request = getNetworkString(5);
+        request->addUInt8(CS_REQUEST).addUInt32(sync.startRequest(current_time));
+        peers[i]->sendPacket(request, false);
+        delete request;
+        if (log)
+        {
+            Log::debug("ClockSyncProtocol",
+                       "Host %d rtt %.1f ms median %.1f ms jitter %.1f ms "
+                       "offset %.3f ms.", peers[i]->getHostId(),
+                       sync.getRTT()*1000.0,
+                       sync.getRTTPercentile(50.0f)*1000.0,
+                       sync.getJitter()*1000.0, sync.getOffset()*1000.0);
+        }
+    }   // for i < peers.size()
+}   // asynchronousUpdate
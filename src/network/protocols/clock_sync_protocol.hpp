@@ -0,0 +1,42 @@
+#ifndef CLOCK_SYNC_PROTOCOL_HPP
+#define CLOCK_SYNC_PROTOCOL_HPP
+
+#include "network/protocol.hpp"
+#include "utils/cpp2011.hpp"
+
+/** \brief Measures the round trip time to each peer, and on a client the
+ *  offset of the server clock.
+ *  Each host regularly sends requests to its peers, which are answered
+ *  with the time the request was received and the time the answer was
+ *  sent. The measurements are stored in the ClockSync object of each
+ *  peer. The protocol runs as long as the host is connected, so that
+ *  STKHost::getServerTime() stays accurate during a race.
+ */
+class ClockSyncProtocol : public Protocol
+{
+private:
+    enum ClockSyncMessage {
+        CS_REPLY   = 0x00,
+        CS_REQUEST = 0x01
+    };   // ClockSyncMessage
+
+    /** Time at which the last requests were sent. */
+    double m_last_request_time;
+
+    /** Time at which the statistics were last logged. */
+    double m_last_log_time;
+
+public:
+             ClockSyncProtocol();
+    virtual ~ClockSyncProtocol();
+
+    virtual bool notifyEventAsynchronous(Event* event) OVERRIDE;
+    virtual void setup() OVERRIDE;
+    virtual void asynchronousUpdate() OVERRIDE;
+
+    // ------------------------------------------------------------------------
+    virtual void update(float dt) OVERRIDE {}
+
+};   // class ClockSyncProtocol
+
+#endif // CLOCK_SYNC_PROTOCOL_HPP
@@ -17,10 +17,12 @@
 
 #include "network/protocols/controller_events_protocol.hpp"
 
+#include "config/user_config.hpp"
 #include "modes/world.hpp"
 #include "karts/abstract_kart.hpp"
 #include "karts/controller/controller.hpp"
 #include "network/event.hpp"
+#include "network/message_schema.hpp"
 #include "network/network_config.hpp"
 #include "network/network_player_profile.hpp"
 #include "network/game_setup.hpp"
@@ -30,11 +32,27 @@
 #include "network/stk_peer.hpp"
 #include "utils/log.hpp"
 
+/** Inputs are keyed by the physics time step (see Physics::update). */
+static const int TICKS_PER_SECOND = 120;
+
+/** A message starts with the tick of the actions and their number. */
+typedef MessageSchema<Schema::VarUInt, Schema::VarUInt> ActionsHeader;
+
+/** Followed by the world kart id, the compressed kart controls (see
+ *  controllerAction()), the action and its value for each action. */
+typedef MessageSchema<Schema::UInt<8>, Schema::UInt<7>, Schema::UInt<8>,
+                      Schema::UInt<8>, Schema::UInt<4>,
+                      Schema::VarInt> Action;
+static_assert(PA_COUNT <= 16, "Player actions do not fit into 4 bits");
+
 //-----------------------------------------------------------------------------
 
 ControllerEventsProtocol::ControllerEventsProtocol()
-                        : Protocol( PROTOCOL_CONTROLLER_EVENTS)
+                        : Protocol( PROTOCOL_CONTROLLER_EVENTS),
+                          m_input_buffer(0)
 {
+    m_input_buffer.setPlayoutDelay(UserConfigParams::m_network_input_delay
+                                   * TICKS_PER_SECOND / 1000);
 }   // ControllerEventsProtocol
 
 //-----------------------------------------------------------------------------
@@ -44,47 +62,59 @@ ControllerEventsProtocol::~ControllerEventsProtocol()
 }   // ~ControllerEventsProtocol
 
 //-----------------------------------------------------------------------------
+/** Returns the tick which is simulated next. The time since start is used
+ *  since it is increasing in all race modes. */
+int ControllerEventsProtocol::getCurrentTick()
+{
+    return (int)(World::getWorld()->getTimeSinceStart() * TICKS_PER_SECOND);
+}   // getCurrentTick
 
+//-----------------------------------------------------------------------------
+/** Called on the network thread when actions were received. The actions
+ *  are only stored in the input buffer, they are applied by the main thread
+ *  in applyInputs(). A server forwards the message to all other clients.
+ */
 bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
 {
-    if(!checkDataSize(event, 13)) return true;
-
     NetworkString &data = event->data();
-    float time = data.getFloat();
+    BitReader reader(data);
+    uint32_t tick, num_actions;
+    if (!ActionsHeader::read(&reader, &tick, &num_actions))
+    {
+        Log::warn("ControllerEventProtocol", "Message too short.");
+        return true;
+    }
 
-    uint8_t client_index = -1;
-    while (data.size() >= 9)
+    const unsigned int num_karts = World::getWorld()->getNumKarts();
+    for (unsigned int i = 0; i < num_actions; i++)
     {
-        uint8_t kart_id = data.getUInt8();
-        if (kart_id >=World::getWorld()->getNumKarts())
+        InputBuffer::Input input;
+        uint8_t action;
+        input.m_tick = tick;
+        if (!Action::read(&reader, &input.m_kart_id, &input.m_serialized[0],
+                          &input.m_serialized[1], &input.m_serialized[2],
+                          &action, &input.m_value))
+        {
+            break;
+        }
+        input.m_action = (PlayerAction)action;
+        if (input.m_kart_id >= num_karts)
         {
-            Log::warn("ControllerEventProtocol", "No valid kart id (%s).",
-                      kart_id);
+            Log::warn("ControllerEventProtocol", "No valid kart id (%d).",
+                      input.m_kart_id);
             continue;
         }
-        uint8_t serialized_1   = data.getUInt8();
-        uint8_t serialized_2   = data.getUInt8();
-        uint8_t serialized_3   = data.getUInt8();
-        PlayerAction action    = (PlayerAction)(data.getUInt8());
-        int action_value       = data.getUInt32();
-        Log::info("ControllerEventsProtocol", "KartID %d action %d value %d",
-                  kart_id, action, action_value);
-        Controller *controller = World::getWorld()->getKart(kart_id)
-                                                  ->getController();
-        KartControl *controls  = controller->getControls();
-        controls->setBrake(   (serialized_1 & 0x40)!=0);
-        controls->setNitro(   (serialized_1 & 0x20)!=0);
-        controls->setRescue(  (serialized_1 & 0x10)!=0);
-        controls->setFire(    (serialized_1 & 0x08)!=0);
-        controls->setLookBack((serialized_1 & 0x04)!=0);
-        controls->setSkidControl(KartControl::SkidControl(serialized_1 & 0x03));
-
-        controller->action(action, action_value);
+        LOG_DEBUG("ControllerEventsProtocol",
+                  "Tick %d kartID %d action %d value %d", tick,
+                  input.m_kart_id, input.m_action, input.m_value);
+        m_input_buffer.add(input);
     }
-    if (data.size() > 0 )
+    // Only the padding bits of the last byte should remain
+    if (reader.hasError() || reader.getRemainingBits() >= 8)
     {
         Log::warn("ControllerEventProtocol",
-                  "The data seems corrupted. Remains %d", data.size());
+                  "The data seems corrupted. Remains %d bits",
+                  reader.getRemainingBits());
     }
     if (NetworkConfig::get()->isServer())
     {
@@ -95,10 +125,65 @@ bool ControllerEventsProtocol::notifyEventAsynchronous(Event* event)
     return true;
 }   // notifyEventAsynchronous
 
+//-----------------------------------------------------------------------------
+/** Applies all remote inputs which are due in the current tick. Called on
+ *  the main thread before the world is updated.
+ */
+void ControllerEventsProtocol::applyInputs()
+{
+    m_due_inputs.clear();
+    m_input_buffer.getDueInputs(getCurrentTick(), &m_due_inputs);
+    World *world = World::getWorld();
+    for (unsigned int i = 0; i < m_due_inputs.size(); i++)
+    {
+        const InputBuffer::Input &input = m_due_inputs[i];
+        const uint8_t serialized_1 = input.m_serialized[0];
+        Controller *controller = world->getKart(input.m_kart_id)
+                                      ->getController();
+        KartControl *controls  = controller->getControls();
+        controls->setBrake(   (serialized_1 & 0x40)!=0);
+        controls->setNitro(   (serialized_1 & 0x20)!=0);
+        controls->setRescue(  (serialized_1 & 0x10)!=0);
+        controls->setFire(    (serialized_1 & 0x08)!=0);
+        controls->setLookBack((serialized_1 & 0x04)!=0);
+        controls->setSkidControl(KartControl::SkidControl(serialized_1 & 0x03));
+
+        controller->action(input.m_action, input.m_value);
+    }
+}   // applyInputs
+
+//-----------------------------------------------------------------------------
+/** Sends all actions of local karts of this frame in one message to the
+ *  server.
+ */
+void ControllerEventsProtocol::update(float dt)
+{
+    if (m_pending_actions.empty())
+        return;
+    const unsigned int size = ActionsHeader::MAX_BYTES
+                            + m_pending_actions.size() * Action::MAX_BYTES;
+    NetworkString *ns = getNetworkString(size);
+    BitWriter writer(ns, size);
+    ActionsHeader::write(&writer, m_pending_actions[0].m_tick,
+                         m_pending_actions.size());
+    for (const InputBuffer::Input &input : m_pending_actions)
+    {
+        Action::write(&writer, input.m_kart_id, input.m_serialized[0],
+                      input.m_serialized[1], input.m_serialized[2],
+                      input.m_action, input.m_value);
+    }
+    writer.finish();
+    sendToServer(ns, false);
+    delete ns;
+    // Keep the memory of the vector for the next frame
+    m_pending_actions.clear();
+}   // update
+
 //-----------------------------------------------------------------------------
 /** Called from the local kart controller when an action (like steering,
  *  acceleration, ...) was triggered. It compresses the current kart control
- *  state and sends a message with the new info to the server.
+ *  state and adds it to the message that is sent to the server at the end
+ *  of this frame (see update()).
  *  \param controller The controller that triggered the action.
  *  \param action Which action was triggered.
  *  \param value New value for the given action.
@@ -124,13 +209,18 @@ void ControllerEventsProtocol::controllerAction(Controller* controller,
     uint8_t serialized_2 = (uint8_t)(controls->getAccel()*255.0);
     uint8_t serialized_3 = (uint8_t)(controls->getSteer()*127.0);
 
-    NetworkString *ns = getNetworkString(13);
-    ns->addFloat(World::getWorld()->getTime());
-    ns->addUInt8(controller->getKart()->getWorldKartId());
-    ns->addUInt8(serialized_1).addUInt8(serialized_2).addUInt8(serialized_3);
-    ns->addUInt8((uint8_t)(action)).addUInt32(value);
-    sendToServer(ns, false); // send message to server
-    delete ns;
+    // All actions of this frame are sent with the tick of the first one
+    InputBuffer::Input input;
+    input.m_tick          = m_pending_actions.empty()
+                          ? getCurrentTick() : m_pending_actions[0].m_tick;
+    input.m_kart_id       = controller->getKart()->getWorldKartId();
+    input.m_serialized[0] = serialized_1;
+    input.m_serialized[1] = serialized_2;
+    input.m_serialized[2] = serialized_3;
+    input.m_action        = action;
+    input.m_value         = value;
+    m_pending_actions.push_back(input);
 
-    Log::info("ControllerEventsProtocol", "Action %d value %d", action, value);
+    LOG_DEBUG("ControllerEventsProtocol", "Action %d value %d",
+              action, value);
 }   // controllerAction
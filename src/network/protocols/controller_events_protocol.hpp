@@ -22,25 +22,46 @@
 #include "network/protocol.hpp"
 
 #include "input/input.hpp"
+#include "network/input_buffer.hpp"
 #include "utils/cpp2011.hpp"
 
 class Controller;
 class STKPeer;
 
+/** \brief Sends the actions of local karts to the server, which forwards
+ *  them to all other clients.
+ *  Received actions are not applied immediately on the network thread, they
+ *  are stored in an InputBuffer keyed by the tick in which they were
+ *  created, and applied by the main thread at the start of the tick they
+ *  are due (see applyInputs()). All actions of one frame are sent in one
+ *  packet.
+ */
 class ControllerEventsProtocol : public Protocol
 {
+private:
+    /** The inputs received from the remote karts. */
+    InputBuffer    m_input_buffer;
+
+    /** The actions of the current frame which are not yet sent. */
+    std::vector<InputBuffer::Input> m_pending_actions;
+
+    /** Inputs that are applied in this tick, kept to avoid reallocations. */
+    std::vector<InputBuffer::Input> m_due_inputs;
+
+    static int getCurrentTick();
 
 public:
              ControllerEventsProtocol();
     virtual ~ControllerEventsProtocol();
 
     virtual bool notifyEventAsynchronous(Event* event) OVERRIDE;
-    virtual void update(float dt) OVERRIDE {};
+    virtual void update(float dt) OVERRIDE;
     virtual void setup() OVERRIDE {};
     virtual void asynchronousUpdate() OVERRIDE {}
 
     void controllerAction(Controller* controller, PlayerAction action,
                           int value);
+    void applyInputs();
 
 };   // class ControllerEventsProtocol
 
@@ -8,12 +8,24 @@
 #include "modes/world.hpp"
 #include "network/event.hpp"
 #include "network/game_setup.hpp"
+#include "network/message_schema.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/stk_host.hpp"
 #include "network/stk_peer.hpp"
 
 #include <stdint.h>
 
+/** Each message starts with the GameEventType. */
+typedef MessageSchema<Schema::UInt<8> > EventType;
+
+/** Item id, powerup type and amount, and world kart id. */
+typedef MessageSchema<Schema::VarUInt, Schema::UInt<8>,
+                      Schema::UInt<8> > ItemCollected;
+
+/** World kart id and finishing time. */
+typedef MessageSchema<Schema::UInt<8>, Schema::Float> KartFinished;
+
+// ----------------------------------------------------------------------------
 /** This class handles all 'major' game events. E.g. collecting an item,
  *  finishing a race etc. The game events manager is notified from the 
  *  game code, and it calls the corresponding function in this class.
@@ -60,15 +72,17 @@ bool GameEventsProtocol::notifyEvent(Event* event)
         Log::warn("GameEventsProtocol", "Bad token.");
         return true;
     }
-    int8_t type = data.getUInt8();
+    BitReader reader(data);
+    uint8_t type;
+    EventType::read(&reader, &type);
     switch (type)
     {
     case GE_CLIENT_STARTED_RSG:
         receivedClientHasStarted(event); break;
     case GE_ITEM_COLLECTED:
-        collectedItem(data);        break;
+        collectedItem(&reader);     break;
     case GE_KART_FINISHED_RACE:
-        kartFinishedRace(data);     break;
+        kartFinishedRace(&reader);  break;
 
     default:
         Log::warn("GameEventsProtocol", "Unkown message type.");
@@ -88,7 +102,9 @@ void GameEventsProtocol::collectedItem(Item* item, AbstractKart* kart)
     const std::vector<STKPeer*> &peers = STKHost::get()->getPeers();
     for (unsigned int i = 0; i < peers.size(); i++)
     {
-        NetworkString *ns = getNetworkString(7);
+        const unsigned int size = EventType::MAX_BYTES
+                                + ItemCollected::MAX_BYTES;
+        NetworkString *ns = getNetworkString(size);
         ns->setSynchronous(true);
         // Item picked : send item id, powerup type and kart race id
         uint8_t powerup = 0;
@@ -98,8 +114,11 @@ void GameEventsProtocol::collectedItem(Item* item, AbstractKart* kart)
             powerup = (((int)(kart->getPowerup()->getType()) << 4) & 0xf0) 
                            + (kart->getPowerup()->getNum()         & 0x0f);
 
-        ns->addUInt8(GE_ITEM_COLLECTED).addUInt32(item->getItemId())
-           .addUInt8(powerup).addUInt8(kart->getWorldKartId());
+        BitWriter writer(ns, size);
+        EventType::write(&writer, GE_ITEM_COLLECTED);
+        ItemCollected::write(&writer, item->getItemId(), powerup,
+                             kart->getWorldKartId());
+        writer.finish();
         peers[i]->sendPacket(ns, /*reliable*/true);
         delete ns;
         Log::info("GameEventsProtocol",
@@ -111,15 +130,15 @@ void GameEventsProtocol::collectedItem(Item* item, AbstractKart* kart)
 // ----------------------------------------------------------------------------
 /** Called on the client when an itemCollected message is received.
  */
-void GameEventsProtocol::collectedItem(const NetworkString &data)
+void GameEventsProtocol::collectedItem(BitReader *reader)
 {
-    if (data.size() < 6)
+    uint32_t item_id;
+    uint8_t powerup_type, kart_id;
+    if (!ItemCollected::read(reader, &item_id, &powerup_type, &kart_id))
     {
         Log::warn("GameEventsProtocol", "collectedItem: Too short message.");
+        return;
     }
-    uint32_t item_id = data.getUInt32();
-    uint8_t powerup_type = data.getUInt8();
-    uint8_t kart_id = data.getUInt8();
     // now set the kart powerup
     AbstractKart* kart = World::getWorld()->getKart(kart_id);
     ItemManager::get()->collectedItem(ItemManager::get()->getItem(item_id),
@@ -136,10 +155,13 @@ void GameEventsProtocol::collectedItem(const NetworkString &data)
  */
 void GameEventsProtocol::kartFinishedRace(AbstractKart *kart, float time)
 {
-    NetworkString *ns = getNetworkString(20);
+    const unsigned int size = EventType::MAX_BYTES + KartFinished::MAX_BYTES;
+    NetworkString *ns = getNetworkString(size);
     ns->setSynchronous(true);
-    ns->addUInt8(GE_KART_FINISHED_RACE).addUInt8(kart->getWorldKartId())
-       .addFloat(time);
+    BitWriter writer(ns, size);
+    EventType::write(&writer, GE_KART_FINISHED_RACE);
+    KartFinished::write(&writer, kart->getWorldKartId(), time);
+    writer.finish();
     sendMessageToPeersChangingToken(ns, /*reliable*/true);
     delete ns;
 }   // kartFinishedRace
@@ -147,18 +169,17 @@ void GameEventsProtocol::kartFinishedRace(AbstractKart *kart, float time)
 // ----------------------------------------------------------------------------
 /** This function is called on a client when it receives a kartFinishedRace
  *  event from the server. It updates the game with this information.
- *  \param ns The message from the server.
+ *  \param reader Reads the message from the server.
  */
-void GameEventsProtocol::kartFinishedRace(const NetworkString &ns)
+void GameEventsProtocol::kartFinishedRace(BitReader *reader)
 {
-    if (ns.size() < 5) // for token and type
+    uint8_t kart_id;
+    float time;
+    if (!KartFinished::read(reader, &kart_id, &time))
     {
         Log::warn("GameEventsProtocol", "kartFinisheRace: Too short message.");
         return;
     }
-
-    uint8_t kart_id = ns.getUInt8();
-    float time      = ns.getFloat();
     World::getWorld()->getKart(kart_id)->finishedRace(time,
                                                       /*from_server*/true);
 }   // kartFinishedRace
@@ -171,9 +192,11 @@ void GameEventsProtocol::kartFinishedRace(const NetworkString &ns)
 void GameEventsProtocol::clientHasStarted()
 {
     assert(NetworkConfig::get()->isClient());
-    NetworkString *ns = getNetworkString(1);
+    NetworkString *ns = getNetworkString(EventType::MAX_BYTES);
     ns->setSynchronous(true);
-    ns->addUInt8(GE_CLIENT_STARTED_RSG);
+    BitWriter writer(ns, EventType::MAX_BYTES);
+    EventType::write(&writer, GE_CLIENT_STARTED_RSG);
+    writer.finish();
     sendToServer(ns, /*reliable*/true);
     delete ns;
 }   // clientHasStarted
@@ -5,6 +5,7 @@
 #include "utils/cpp2011.hpp"
 
 class AbstractKart;
+class BitReader;
 class Item;
 
 class GameEventsProtocol : public Protocol
@@ -29,11 +30,11 @@ public:
 
     virtual bool notifyEvent(Event* event) OVERRIDE;
     void collectedItem(Item* item, AbstractKart* kart);
-    void collectedItem(const NetworkString &ns);
+    void collectedItem(BitReader *reader);
     void kartFinishedRace(AbstractKart *kart, float time);
     void clientHasStarted();
     void receivedClientHasStarted(Event *event);
-    void kartFinishedRace(const NetworkString &ns);
+    void kartFinishedRace(BitReader *reader);
     virtual void setup() OVERRIDE;
     virtual void update(float dt) OVERRIDE {};
     virtual void asynchronousUpdate() OVERRIDE{}
@@ -4,10 +4,33 @@
 #include "karts/controller/controller.hpp"
 #include "modes/world.hpp"
 #include "network/event.hpp"
+#include "network/message_schema.hpp"
 #include "network/network_config.hpp"
 #include "network/protocol_manager.hpp"
+#include "network/stk_host.hpp"
+#include "network/stk_peer.hpp"
 #include "utils/time.hpp"
 
+/** An update starts with the world time and the number of karts. */
+typedef MessageSchema<Schema::Float, Schema::VarUInt> UpdateHeader;
+
+/** Followed by the world kart id of each kart, and if its state is sent
+ *  with reduced precision. */
+typedef MessageSchema<Schema::UInt<8>, Schema::Bool> KartHeader;
+
+/** The position and rotation of a kart with full precision. */
+typedef MessageSchema<Schema::Position, Schema::Rotation<15> > FullState;
+
+/** The position and rotation of a distant kart. */
+typedef MessageSchema<Schema::QuantizedPosition<8>,
+                      Schema::Rotation<9> > CoarseState;
+
+static const unsigned int FULL_BYTES   = (KartHeader::MAX_BITS
+                                        + FullState::MAX_BITS + 7) / 8;
+static const unsigned int COARSE_BYTES = (KartHeader::MAX_BITS
+                                        + CoarseState::MAX_BITS + 7) / 8;
+
+// ----------------------------------------------------------------------------
 KartUpdateProtocol::KartUpdateProtocol() : Protocol(PROTOCOL_KART_UPDATE)
 {
 }   // KartUpdateProtocol
@@ -25,9 +48,10 @@ void KartUpdateProtocol::setup()
     m_next_positions.resize(World::getWorld()->getNumKarts());
     m_next_quaternions.resize(World::getWorld()->getNumKarts());
 
-    // This flag keeps track if valid data for an update is in
-    // the arrays
-    m_was_updated = false;
+    // These flags keep track for which karts valid data for an update
+    // is in the arrays
+    m_was_updated.assign(World::getWorld()->getNumKarts(), false);
+    m_interest_manager.reset();
 
     m_previous_time = 0;
 }   // setup
@@ -42,27 +66,77 @@ bool KartUpdateProtocol::notifyEvent(Event* event)
     // the game was exited, so make sure we still have a world.
     if (event->getType() != EVENT_TYPE_MESSAGE || !World::getWorld())
         return true;
-    NetworkString &ns = event->data();
-    if (ns.size() < 33)
+    BitReader reader(event->data());
+    float time;
+    uint32_t num_karts;
+    if (!UpdateHeader::read(&reader, &time, &num_karts))
     {
         Log::info("KartUpdateProtocol", "Message too short.");
         return true;
     }
-    float time = ns.getFloat();
-    while(ns.size() >= 29)
+    for (unsigned int i = 0; i < num_karts; i++)
     {
-        uint8_t kart_id             = ns.getUInt8();
-        Vec3 xyz                    = ns.getVec3();
-        btQuaternion quat           = ns.getQuat();
+        uint8_t kart_id;
+        bool coarse;
+        Vec3 xyz;
+        btQuaternion quat;
+        bool ok = KartHeader::read(&reader, &kart_id, &coarse);
+        if (ok && coarse)
+            ok = CoarseState::read(&reader, &xyz, &quat);
+        else if (ok)
+            ok = FullState::read(&reader, &xyz, &quat);
+        if (!ok || kart_id >= m_next_positions.size())
+        {
+            Log::warn("KartUpdateProtocol", "Invalid kart state.");
+            return true;
+        }
         m_next_positions  [kart_id] = xyz;
         m_next_quaternions[kart_id] = quat;
-    }   // while ns.size()>29
-
-    // Set the flag that a new update was received
-    m_was_updated = true;
+        // Set the flag that a new update was received
+        m_was_updated[kart_id] = true;
+    }   // for i < num_karts
     return true;
 }   // notifyEvent
 
+// ----------------------------------------------------------------------------
+/** Sends the kart states to each client. The InterestManager selects which
+ *  karts are sent to which client (and with which precision), so each
+ *  client gets its own message.
+ *  \param dt Time since the last update.
+ */
+void KartUpdateProtocol::sendServerUpdates(float dt)
+{
+    World *world = World::getWorld();
+    const unsigned int size = UpdateHeader::MAX_BYTES
+                            + world->getNumKarts() * FULL_BYTES;
+    const std::vector<STKPeer*> &peers = STKHost::get()->getPeers();
+    for (STKPeer *peer : peers)
+    {
+        m_interest_manager.selectKarts(world, peer, dt,
+                                       5 + UpdateHeader::MAX_BYTES,
+                                       FULL_BYTES, COARSE_BYTES,
+                                       &m_selection);
+        NetworkString *ns = getNetworkString(size);
+        ns->setSynchronous(true);
+        BitWriter writer(ns, size);
+        UpdateHeader::write(&writer, world->getTime(), m_selection.size());
+        for (const InterestManager::Selection &s : m_selection)
+        {
+            AbstractKart* kart = world->getKart(s.m_kart_id);
+            KartHeader::write(&writer, s.m_kart_id, s.m_coarse);
+            if (s.m_coarse)
+                CoarseState::write(&writer, kart->getXYZ(),
+                                   kart->getRotation());
+            else
+                FullState::write(&writer, kart->getXYZ(),
+                                 kart->getRotation());
+        }
+        writer.finish();
+        peer->sendPacket(ns, /*reliable*/false);
+        delete ns;
+    }   // for peer in peers
+}   // sendServerUpdates
+
 // ----------------------------------------------------------------------------
 /** Sends regular update events from the server to all clients and from the
  *  clients to the server (FIXME - is that actually necessary??)
@@ -79,42 +153,37 @@ void KartUpdateProtocol::update(float dt)
     double current_time = StkTime::getRealTime();
     if (current_time > m_previous_time + 0.1) // 10 updates per second
     {
+        // The first update sends all karts anyway
+        const float time_step = m_previous_time > 0
+                              ? (float)(current_time - m_previous_time)
+                              : 0.1f;
         m_previous_time = current_time;
         if (NetworkConfig::get()->isServer())
         {
-            World *world = World::getWorld();
-            NetworkString *ns = getNetworkString(4+world->getNumKarts()*29);
-            ns->setSynchronous(true);
-            ns->addFloat( world->getTime() );
-            for (unsigned int i = 0; i < world->getNumKarts(); i++)
-            {
-                AbstractKart* kart = world->getKart(i);
-                Vec3 xyz = kart->getXYZ();
-                ns->addUInt8( kart->getWorldKartId());
-                ns->add(xyz).add(kart->getRotation());
-                Log::verbose("KartUpdateProtocol",
-                             "Sending %d's positions %f %f %f",
-                             kart->getWorldKartId(), xyz[0], xyz[1], xyz[2]);
-            }
-            sendMessageToPeersChangingToken(ns, /*reliable*/false);
-            delete ns;
+            sendServerUpdates(time_step);
         }
         else
         {
-            NetworkString *ns =
-                     getNetworkString(4+29*race_manager->getNumLocalPlayers());
+            const unsigned int num_local = race_manager->getNumLocalPlayers();
+            const unsigned int size = UpdateHeader::MAX_BYTES
+                                    + num_local*FULL_BYTES;
+            NetworkString *ns = getNetworkString(size);
             ns->setSynchronous(true);
-            ns->addFloat(World::getWorld()->getTime());
-            for(unsigned int i=0; i<race_manager->getNumLocalPlayers(); i++)
+            BitWriter writer(ns, size);
+            UpdateHeader::write(&writer, World::getWorld()->getTime(),
+                                num_local);
+            for(unsigned int i=0; i<num_local; i++)
             {
                 AbstractKart *kart = World::getWorld()->getLocalPlayerKart(i);
                 const Vec3 &xyz = kart->getXYZ();
-                ns->addUInt8(kart->getWorldKartId());
-                ns->add(xyz).add(kart->getRotation());
+                KartHeader::write(&writer, kart->getWorldKartId(),
+                                  /*coarse*/false);
+                FullState::write(&writer, xyz, kart->getRotation());
                 Log::verbose("KartUpdateProtocol",
                              "Sending %d's positions %f %f %f",
                               kart->getWorldKartId(), xyz[0], xyz[1], xyz[2]);
             }
+            writer.finish();
             sendToServer(ns, /*reliable*/false);
             delete ns;
         }   // if server
@@ -125,23 +194,21 @@ void KartUpdateProtocol::update(float dt)
     // There is no lock necessary, since receiving new positions is done in
     // notifyEvent, which is called from the same thread that calls this
     // function.
-    if(m_was_updated)
+    for (unsigned id = 0; id < m_next_positions.size(); id++)
     {
-        for (unsigned id = 0; id < m_next_positions.size(); id++)
+        if (!m_was_updated[id])
+            continue;
+        m_was_updated[id] = false;  // mark that the update was applied
+        AbstractKart *kart = World::getWorld()->getKart(id);
+        if (!kart->getController()->isLocalPlayerController())
         {
-            AbstractKart *kart = World::getWorld()->getKart(id);
-            if (!kart->getController()->isLocalPlayerController())
-            {
-                btTransform transform = kart->getBody()
-                                      ->getInterpolationWorldTransform();
-                transform.setOrigin(m_next_positions[id]);
-                transform.setRotation(m_next_quaternions[id]);
-                kart->getBody()->setCenterOfMassTransform(transform);
-                Log::verbose("KartUpdateProtocol", "Update kart %i pos",
-                             id);
-            }   // if not local player
-        }   // for id < num_karts
-        m_was_updated = false;  // mark that all updates were applied
-    }   // if m_was_updated
+            btTransform transform = kart->getBody()
+                                  ->getInterpolationWorldTransform();
+            transform.setOrigin(m_next_positions[id]);
+            transform.setRotation(m_next_quaternions[id]);
+            kart->getBody()->setCenterOfMassTransform(transform);
+            Log::verbose("KartUpdateProtocol", "Update kart %i pos", id);
+        }   // if not local player
+    }   // for id < num_karts
 }   // update
 
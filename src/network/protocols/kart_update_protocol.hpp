@@ -1,6 +1,7 @@
 #ifndef KART_UPDATE_PROTOCOL_HPP
 #define KART_UPDATE_PROTOCOL_HPP
 
+#include "network/interest_manager.hpp"
 #include "network/protocol.hpp"
 #include "utils/cpp2011.hpp"
 #include "utils/vec3.hpp"
@@ -22,8 +23,14 @@ private:
     /** Stores the last updated rotation for a kart. */
     std::vector<btQuaternion> m_next_quaternions;
 
-    /** True if a new update for the kart positions was received. */
-    bool m_was_updated;
+    /** True for each kart for which a new update was received. */
+    std::vector<bool> m_was_updated;
+
+    /** Selects the karts sent to each peer (only used on the server). */
+    InterestManager m_interest_manager;
+
+    /** Buffer for the karts selected for one peer. */
+    std::vector<InterestManager::Selection> m_selection;
 
     /** Time the last kart update was sent. Used to send updates with
      * a fixed frequency. */
@@ -37,6 +44,7 @@ public:
     virtual void setup() OVERRIDE;
     virtual void update(float dt) OVERRIDE;
     virtual void asynchronousUpdate() OVERRIDE {};
+    void sendServerUpdates(float dt);
 
 };   // KartUpdateProtocol
 
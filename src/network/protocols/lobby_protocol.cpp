@@ -27,7 +27,7 @@
 #include "network/protocols/controller_events_protocol.hpp"
 #include "network/protocols/game_events_protocol.hpp"
 #include "network/protocols/kart_update_protocol.hpp"
-#include "network/protocols/latency_protocol.hpp"
+#include "network/protocols/clock_sync_protocol.hpp"
 #include "network/race_event_manager.hpp"
 #include "network/stk_host.hpp"
 #include "race/race_manager.hpp"
@@ -131,13 +131,15 @@ void LobbyProtocol::loadWorld()
 }   // loadWorld
 
 // ----------------------------------------------------------------------------
-/** Terminates the LatencyProtocol.
+/** Starts the ClockSyncProtocol unless it is already running (e.g. from a
+ *  previous race). It is not terminated when the race starts, since the
+ *  clock offset and latencies are needed during the race.
  */
-void LobbyProtocol::terminateLatencyProtocol()
+void LobbyProtocol::startClockSyncProtocol()
 {
-    Protocol *p = ProtocolManager::getInstance()
-                ->getProtocol(PROTOCOL_SYNCHRONIZATION);
-    LatencyProtocol *sp = dynamic_cast<LatencyProtocol*>(p);
-    if (sp)
-        sp->requestTerminate();
-}   // stopLatencyProtocol
+    if (ProtocolManager::getInstance()->getProtocol(PROTOCOL_SYNCHRONIZATION))
+        return;
+    Protocol *p = new ClockSyncProtocol();
+    p->requestStart();
+    Log::info("LobbyProtocol", "ClockSyncProtocol started.");
+}   // startClockSyncProtocol
@@ -26,7 +26,6 @@
 #include "network/network_player_profile.hpp"
 #include "network/protocols/get_public_address.hpp"
 #include "network/protocols/connect_to_peer.hpp"
-#include "network/protocols/latency_protocol.hpp"
 #include "network/protocol_manager.hpp"
 #include "network/race_event_manager.hpp"
 #include "network/stk_host.hpp"
@@ -40,6 +39,8 @@
 #include "utils/random_generator.hpp"
 #include "utils/time.hpp"
 
+#include <algorithm>
+
 
 /** This is the central game setup protocol running in the server. It is
  *  mostly a finite state machine. Note that all nodes in ellipses and light
@@ -215,7 +216,11 @@ void ServerLobby::update(float dt)
             m_client_ready_count.getData() == m_game_setup->getPlayerCount())
         {
             signalRaceStartToClients();
-            m_server_delay = 0.02f;
+            // Delay by the (one way) latency of the slowest client, so
+            // that its messages for a certain time have arrived when the
+            // server simulates that time.
+            m_server_delay = std::max(0.02f,
+                           (float)STKHost::get()->getMaxPeerLatency());
             m_client_ready_count.getData() = 0;
         }
         m_client_ready_count.unlock();
@@ -367,9 +372,7 @@ void ServerLobby::startSelection(const Event *event)
     m_state = SELECTING;
     WaitingForOthersScreen::getInstance()->push();
 
-    Protocol *p = new LatencyProtocol();
-    p->requestStart();
-    Log::info("LobbyProtocol", "LatencyProtocol started.");
+    startClockSyncProtocol();
 
 }   // startSelection
 
@@ -915,7 +918,6 @@ void ServerLobby::startedRaceOnClient(Event *event)
     if (m_client_ready_count.getData() == m_game_setup->getPlayerCount())
     {
         m_state = DELAY_SERVER;
-        terminateLatencyProtocol();
     }
     m_client_ready_count.unlock();
 }   // startedRaceOnClient
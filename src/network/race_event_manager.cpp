@@ -30,6 +30,12 @@ void RaceEventManager::update(float dt)
     if(!ProtocolManager::getInstance())
         return;
 
+    // Apply the inputs of remote karts which are due in this tick first
+    ControllerEventsProtocol* protocol = static_cast<ControllerEventsProtocol*>(
+        ProtocolManager::getInstance()->getProtocol(PROTOCOL_CONTROLLER_EVENTS));
+    if (protocol)
+        protocol->applyInputs();
+
     World::getWorld()->updateWorld(dt);
 
     // if the race is over
@@ -27,6 +27,7 @@
 RewindInfo::RewindInfo(float time, bool is_confirmed)
 {
     m_time         = time;
+    m_server_time  = 0.0;
     m_is_confirmed = is_confirmed;
 }   // RewindInfo
 
@@ -23,6 +23,7 @@
 #include "network/network_string.hpp"
 #include "network/rewinder.hpp"
 #include "utils/leak_check.hpp"
+#include "utils/memory_pool.hpp"
 #include "utils/ptr_vector.hpp"
 
 #include <assert.h>
@@ -47,12 +48,18 @@ private:
     /** Time when this state was taken. */
     float m_time;
 
+    /** Time of the server clock when this state was taken (0 if this is
+     *  not a network game). */
+    double m_server_time;
+
     /** A confirmed event is one that was sent from the server. When
      *  rewinding we have to start with a confirmed state for each
      *  object.  */
     bool m_is_confirmed;
 
 public:
+    POOL_ALLOCATED("RewindInfo")
+
     RewindInfo(float time, bool is_confirmed);
 
     /** Called when going back in time to undo any rewind information. */
@@ -68,6 +75,13 @@ public:
     /** Returns the time at which this rewind state was saved. */
     float getTime() const { return m_time; }
     // ------------------------------------------------------------------------
+    /** Sets the time of the server clock at which this info was recorded. */
+    void setServerTime(double t) { m_server_time = t; }
+    // ------------------------------------------------------------------------
+    /** Returns the time of the server clock at which this info was recorded,
+     *  see STKHost::getServerTime(). */
+    double getServerTime() const { return m_server_time; }
+    // ------------------------------------------------------------------------
     /** Sets if this RewindInfo is confirmed or not. */
     void setConfirmed(bool b) { m_is_confirmed = b; }
     // ------------------------------------------------------------------------
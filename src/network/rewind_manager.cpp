@@ -23,6 +23,7 @@
 #include "network/network_string.hpp"
 #include "network/rewinder.hpp"
 #include "network/rewind_info.hpp"
+#include "network/stk_host.hpp"
 #include "physics/physics.hpp"
 #include "race/history.hpp"
 #include "utils/log.hpp"
@@ -70,6 +71,23 @@ RewindManager::~RewindManager()
     m_rewind_info.clear();
 }   // ~RewindManager
 
+// ----------------------------------------------------------------------------
+/** Sets the time that is to be used for all further states or events,
+ *  and the time step size. This is necessary so that states/events before 
+ *  and after World::m_time is increased have the same time stamp. In network
+ *  games the (estimated) time of the server clock is recorded as well, so
+ *  that local states and events can be related to the ones of other hosts.
+ *  \param t Time.
+ *  \param dt Time step size.
+ */
+void RewindManager::setCurrentTime(float t, float dt)
+{
+    m_current_time = t;
+    m_time_step    = dt;
+    m_current_server_time = STKHost::existHost()
+                          ? STKHost::get()->getServerTime() : 0.0;
+}   // setCurrentTime
+
 // ----------------------------------------------------------------------------
 /** Frees all saved state information and all destroyable rewinder.
  */
@@ -83,6 +101,7 @@ void RewindManager::reset()
     m_overall_state_size   = 0;
     m_state_frequency      = 0.1f;   // save 10 states a second
     m_last_saved_state     = -9999.9f;  // forces initial state save
+    m_current_server_time  = 0.0;
 
     if(!m_enable_rewind_manager) return;
 
@@ -113,6 +132,7 @@ void RewindManager::insertRewindInfo(RewindInfo *ri)
 #ifdef REWIND_SEARCH_STATS
     m_count_of_searches++;
 #endif
+    ri->setServerTime(m_current_server_time);
     float t = ri->getTime();
 
     if(ri->isEvent())
@@ -114,6 +114,10 @@ private:
     /** The current time step size. */
     float m_time_step;
 
+    /** The time of the server clock at which the current time was set,
+     *  0 if this is not a network game. */
+    double m_current_server_time;
+
 #define REWIND_SEARCH_STATS
 
 #ifdef REWIND_SEARCH_STATS
@@ -134,17 +138,7 @@ public:
     static RewindManager *create();
     static void destroy();
     // ------------------------------------------------------------------------
-    /** Sets the time that is to be used for all further states or events,
-     *  and the time step size. This is necessary so that states/events before 
-     *  and after World::m_time is increased have the same time stamp. 
-     *  \param t Time.
-     *  \param dt Time step size.
-     */
-    void setCurrentTime(float t, float dt)
-    {
-        m_current_time = t;
-        m_time_step    = dt;
-    }   // setCurrentTime
+    void setCurrentTime(float t, float dt);
 
     // ------------------------------------------------------------------------
     /** Returns the current time. */
@@ -152,6 +146,9 @@ public:
     // ------------------------------------------------------------------------
     float getCurrentTimeStep() const { return m_time_step; }
     // ------------------------------------------------------------------------
+    /** Returns the server time at which the current time was set. */
+    double getCurrentServerTime() const { return m_current_server_time; }
+    // ------------------------------------------------------------------------
     /** En- or disables rewinding. */
     static void setEnable(bool m) { m_enable_rewind_manager = m;}
 
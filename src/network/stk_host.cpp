@@ -34,6 +34,7 @@
 #include "utils/time.hpp"
 #include "utils/vs.hpp"
 
+#include <algorithm>
 #include <string.h>
 #if defined(WIN32)
 #  include "ws2tcpip.h"
@@ -217,22 +218,26 @@ void STKHost::create()
  *  LocalPlayerController for each kart. Each remote player gets a
  *  NULL ActivePlayer (the ActivePlayer is only used for assigning the input
  *  device to each kart, achievements and highscores, so it's not needed for
- *  remote players). It will also start the LatencyProtocol, 
- *  RaceEventManager and then load the world.
-
+ *  remote players). It will also start the RaceEventManager and then load
+ *  the world.
+ *
+ *  The ClockSyncProtocol, started with the kart selection, keeps running
+ *  during the race. It regularly sends requests to all peers, and the
+ *  ClockSync of each STKPeer estimates the clock offset, round trip time
+ *  and jitter of the connection from the replies. A client uses the offset
+ *  in getServerTime(). Once the server and all clients have loaded the
+ *  world, the server calls signalRaceStartToClients() and sets its start
+ *  delay to getMaxPeerLatency(), i.e. the one way latency (including the
+ *  jitter) of the slowest client, but at least 20 ms. When all clients have
+ *  started the race, the server waits for this delay (DELAY_SERVER) before
+ *  it starts the race itself. So the messages of all clients for a certain
+ *  time have arrived when the server simulates that time.
+ *
  * TODO:
- *  Once the server has received all
- *  messages in notifyEventAsynchronous(), it will call startCountdown()
- *  in the LatencyProtocol. The LatencyProtocol is 
- *  sending regular (once per second) pings to the clients and measure
- *  the averate latency. Upon starting the countdown this information
- *  is included in the ping request, so the clients can start the countdown
- *  at that stage as well.
- * 
  *  Once the countdown is 0 (or below), the Synchronization Protocol will
  *  start the protocols: KartUpdateProtocol, ControllerEventsProtocol,
- *  GameEventsProtocol. Then the LatencyProtocol is terminated
- *  which indicates to the main loop to start the actual game.
+ *  GameEventsProtocol, which indicates to the main loop to start the
+ *  actual game.
  */
 
 // ============================================================================
@@ -514,6 +519,34 @@ bool STKHost::isAuthorisedToControl() const
     return m_peers[0]->isAuthorised();
 }   // isAuthorisedToControl
 
+// ----------------------------------------------------------------------------
+/** Returns the current time of the server's real time clock. On a client
+ *  this is estimated using the clock offset measured by the
+ *  ClockSyncProtocol (before the first measurement it is the local time).
+ */
+double STKHost::getServerTime() const
+{
+    const double now = StkTime::getRealTime();
+    if (NetworkConfig::get()->isServer() || m_peers.empty())
+        return now;
+    return m_peers[0]->getClockSync().toRemoteTime(now);
+}   // getServerTime
+
+// ----------------------------------------------------------------------------
+/** Returns an estimate of the one way latency in seconds to the peer with
+ *  the slowest connection, including the jitter of its connection.
+ */
+double STKHost::getMaxPeerLatency() const
+{
+    double latency = 0.0;
+    for (unsigned int i = 0; i < m_peers.size(); i++)
+    {
+        const ClockSync &sync = m_peers[i]->getClockSync();
+        latency = std::max(latency, (sync.getRTT() + sync.getJitter()) * 0.5);
+    }
+    return latency;
+}   // getMaxPeerLatency
+
 // ----------------------------------------------------------------------------
 /** \brief Thread function checking if data is received.
  *  This function tries to get data from network low-level functions as
@@ -551,8 +584,8 @@ void* STKHost::mainLoop(void* self)
             // Create an STKEvent with the event data. This will also
             // create the peer if it doesn't exist already
             Event* stk_event = new Event(&event);
-            Log::verbose("STKHost", "Event of type %d received",
-                         (int)(stk_event->getType()));
+            LOG_VERBOSE("STKHost", "Event of type %d received",
+                        (int)(stk_event->getType()));
             STKPeer* peer = stk_event->getPeer();
             if (stk_event->getType() == EVENT_TYPE_CONNECTED)
             {
@@ -564,12 +597,15 @@ void* STKHost::mainLoop(void* self)
             else if (stk_event->getType() == EVENT_TYPE_MESSAGE)
             {
                 Network::logPacket(stk_event->data(), true);
-                TransportAddress stk_addr(peer->getAddress());
-                Log::verbose("NetworkManager",
-                             "Message, Sender : %s, message:",
-                             stk_addr.toString(/*show port*/false).c_str());
-                Log::verbose("NetworkManager", "%s",
-                             stk_event->data().getLogMessage().c_str());
+                if (LOG_IS_ENABLED(Log::LL_VERBOSE))
+                {
+                    TransportAddress stk_addr(peer->getAddress());
+                    Log::verbose("NetworkManager",
+                                 "Message, Sender : %s, message:",
+                                 stk_addr.toString(/*show port*/false).c_str());
+                    Log::verbose("NetworkManager", "%s",
+                                 stk_event->data().getLogMessage().c_str());
+                }
             }   // if message event
 
             // notify for the event now.
@@ -232,6 +232,9 @@ public:
     /** Returns the host id of this host. */
     uint8_t getMyHostId() const { return m_host_id; }
     // --------------------------------------------------------------------
+    double getServerTime() const;
+    double getMaxPeerLatency() const;
+    // --------------------------------------------------------------------
     /** Sends a message from a client to the server. */
     void sendToServer(NetworkString *data, bool reliable = true)
     {
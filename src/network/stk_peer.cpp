@@ -35,6 +35,7 @@ STKPeer::STKPeer(ENetPeer *enet_peer)
     m_client_server_token = 0;
     m_host_id             = 0;
     m_token_set           = false;
+    m_bytes_sent.store(0);
 }   // STKPeer
 
 //-----------------------------------------------------------------------------
@@ -62,15 +63,15 @@ void STKPeer::disconnect()
 void STKPeer::sendPacket(NetworkString *data, bool reliable)
 {
     data->setToken(m_client_server_token);
-    TransportAddress a(m_enet_peer->address);
-    Log::verbose("STKPeer", "sending packet of size %d to %s",
-                 data->size(), a.toString().c_str());
+    LOG_VERBOSE("STKPeer", "sending packet of size %d to %s", data->size(),
+                TransportAddress(m_enet_peer->address).toString().c_str());
          
     ENetPacket* packet = enet_packet_create(data->getData(),
                                             data->getTotalSize(),
                                     (reliable ? ENET_PACKET_FLAG_RELIABLE
                                               : ENET_PACKET_FLAG_UNSEQUENCED));
     enet_peer_send(m_enet_peer, 0, packet);
+    m_bytes_sent.fetch_add(data->getTotalSize());
 }   // sendPacket
 
 //-----------------------------------------------------------------------------
@@ -23,11 +23,13 @@
 #ifndef STK_PEER_HPP
 #define STK_PEER_HPP
 
+#include "network/clock_sync.hpp"
 #include "utils/no_copy.hpp"
 #include "utils/types.hpp"
 
 #include <enet/enet.h>
 
+#include <atomic>
 #include <vector>
 
 class NetworkPlayerProfile;
@@ -55,6 +57,13 @@ protected:
 
     /** True if this peer is authorised to control a server. */
     bool m_is_authorised;
+
+    /** Round trip time and clock offset estimates of this peer. */
+    ClockSync m_clock_sync;
+
+    /** Number of bytes sent to this peer. Packets can be sent from the
+     *  main thread and the network thread. */
+    std::atomic<uint32_t> m_bytes_sent;
 public:
              STKPeer(ENetPeer *enet_peer);
     virtual ~STKPeer();
@@ -85,6 +94,16 @@ public:
     /** Returns if the token for this client is known. */
     bool isClientServerTokenSet() const { return m_token_set; }
     // ------------------------------------------------------------------------
+    /** Returns the round trip time and clock offset estimates of this
+     *  peer, which are updated by the ClockSyncProtocol. */
+    ClockSync& getClockSync() { return m_clock_sync; }
+    // ------------------------------------------------------------------------
+    const ClockSync& getClockSync() const { return m_clock_sync; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of bytes sent to this peer (which wraps around
+     *  at 4GB, so only differences should be used). */
+    uint32_t getBytesSent() const { return m_bytes_sent.load(); }
+    // ------------------------------------------------------------------------
     /** Sets the host if of this peer. */
     void setHostId(int host_id) { m_host_id = host_id; }
     // ------------------------------------------------------------------------
@@ -40,7 +40,7 @@ btRigidBody& btKart::getFixedBody()
 }
 
 // ============================================================================
-btKart::btKart(btRigidBody* chassis, btVehicleRaycaster* raycaster,
+btKart::btKart(btRigidBody* chassis, btKartRaycaster* raycaster,
                Kart *kart)
       : m_vehicleRaycaster(raycaster)
 {
@@ -212,44 +212,74 @@ void btKart::updateWheelTransformsWS(btWheelInfo& wheel,
 }   // updateWheelTransformsWS
 
 // ----------------------------------------------------------------------------
-/**
+/** Computes the ray used to determine the suspension length of a wheel.
+ *  This also updates the world space transform of the wheel.
+ *  \param index Index of the wheel.
+ *  \param fraction Scales the connection point of the wheel towards the
+ *         centre of the chassis.
+ *  \param from, to On return start and end point of the ray.
  */
-btScalar btKart::rayCast(unsigned int index, float fraction)
+void btKart::getWheelRay(unsigned int index, float fraction,
+                         btVector3 *from, btVector3 *to)
 {
     btWheelInfo &wheel = m_wheelInfo[index];
-
-    // Work around a bullet problem: when using a convex hull the raycast
-    // would sometimes hit the chassis (which does not happen when using a
-    // box shape). Therefore set the collision mask in the chassis body so
-    // that it is not hit anymore.
-    short int old_group=0;
-    if(m_chassisBody->getBroadphaseHandle())
-    {
-        old_group = m_chassisBody->getBroadphaseHandle()
-                                 ->m_collisionFilterGroup;
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = 0;
-    }
-
     updateWheelTransformsWS( wheel,false, fraction);
 
-    btScalar max_susp_len = wheel.getSuspensionRestLength()
-                          + wheel.m_maxSuspensionTravel;
-
     // Do a slightly longer raycast to see if the kart might soon hit the 
     // ground and some 'cushioning' is needed to avoid that the chassis
     // hits the ground.
-    btScalar raylen = max_susp_len + 0.5f;
+    btScalar raylen = getWheelRayLength(wheel);
 
     btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS * (raylen);
-    const btVector3& source = wheel.m_raycastInfo.m_hardPointWS;
-    wheel.m_raycastInfo.m_contactPointWS = source + rayvector;
-    const btVector3& target = wheel.m_raycastInfo.m_contactPointWS;
+    *from = wheel.m_raycastInfo.m_hardPointWS;
+    wheel.m_raycastInfo.m_contactPointWS = *from + rayvector;
+    *to = wheel.m_raycastInfo.m_contactPointWS;
+}   // getWheelRay
 
-    btVehicleRaycaster::btVehicleRaycasterResult rayResults;
+// ----------------------------------------------------------------------------
+/** Computes the ray used to determine the contact point of a visual (rear)
+ *  wheel. getWheelRay must have been called for this wheel before.
+ *  \param index Index of the wheel, must be 2 or 3.
+ *  \param from, to On return start and end point of the ray.
+ */
+void btKart::getVisualWheelRay(unsigned int index, btVector3 *from,
+                               btVector3 *to)
+{
+    assert(index==2 || index==3);
+    const btWheelInfo &wheel = m_wheelInfo[index];
+    btVector3 rayvector = wheel.m_raycastInfo.m_wheelDirectionWS
+                        * getWheelRayLength(wheel);
 
-    btAssert(m_vehicleRaycaster);
+    btTransform chassisTrans = getChassisWorldTransform();
+    if (getRigidBody()->getMotionState())
+    {
+        getRigidBody()->getMotionState()->getWorldTransform(chassisTrans);
+    }
+    btQuaternion q(m_visual_rotation, 0, 0);
+    btQuaternion rot_new = chassisTrans.getRotation() * q;
+    chassisTrans.setRotation(rot_new);
+    btVector3 pos = m_kart->getKartModel()->getWheelGraphicsPosition(index);
+    pos.setZ(pos.getZ()*0.9f);
+    *from = chassisTrans( pos );
+    *to   = *from + rayvector;
+}   // getVisualWheelRay
 
-    void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+// ----------------------------------------------------------------------------
+/** Updates the suspension information of a wheel with the result of the
+ *  ray cast from getWheelRay.
+ *  \param index Index of the wheel.
+ *  \param object The object hit by the ray, or NULL.
+ *  \param rayResults The result of the ray cast.
+ *  \return The suspension length, or -1 if the ground was not hit.
+ */
+btScalar btKart::updateWheelFromRay(unsigned int index, void *object,
+               const btVehicleRaycaster::btVehicleRaycasterResult &rayResults)
+{
+    btWheelInfo &wheel = m_wheelInfo[index];
+
+    btScalar max_susp_len = wheel.getSuspensionRestLength()
+                          + wheel.m_maxSuspensionTravel;
+    btScalar raylen = getWheelRayLength(wheel);
 
     wheel.m_raycastInfo.m_groundObject = 0;
 
@@ -316,44 +346,126 @@ btScalar btKart::rayCast(unsigned int index, float fraction)
             - wheel.m_raycastInfo.m_wheelDirectionWS;
         wheel.m_clippedInvContactDotSuspension = btScalar(1.0);
     }
+    return depth;
+}   // updateWheelFromRay
 
-#define USE_VISUAL
-#ifndef USE_VISUAL
+// ----------------------------------------------------------------------------
+/** Stores the result of a visual wheel ray from getVisualWheelRay.
+ *  \param index Index of the wheel, must be 2 or 3.
+ *  \param from Start point of the ray.
+ *  \param object The object hit by the ray, or NULL.
+ *  \param rayResults The result of the ray cast.
+ */
+void btKart::updateVisualWheelFromRay(unsigned int index,
+                                      const btVector3 &from, void *object,
+               const btVehicleRaycaster::btVehicleRaycasterResult &rayResults)
+{
     m_visual_contact_point[index] = rayResults.m_hitPointInWorld;
-#else
+    m_visual_contact_point[index-2] = from;
+    m_visual_wheels_touch_ground &= (object!=NULL);
+}   // updateVisualWheelFromRay
+
+// ----------------------------------------------------------------------------
+/** Disables or restores the collision group of the chassis. 
+ *  Work around a bullet problem: when using a convex hull the raycast
+ *  would sometimes hit the chassis (which does not happen when using a
+ *  box shape). Therefore set the collision mask in the chassis body so
+ *  that it is not hit anymore.
+ *  \param disable True to disable collisions with the chassis, false
+ *         to restore the old collision group.
+ *  \param old_group Stores the original collision group.
+ */
+void btKart::disableChassisRaycast(bool disable, short int *old_group)
+{
+    if(!m_chassisBody->getBroadphaseHandle())
+        return;
+    if(disable)
+    {
+        *old_group = m_chassisBody->getBroadphaseHandle()
+                                  ->m_collisionFilterGroup;
+        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup = 0;
+    }
+    else
+    {
+        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
+            = *old_group;
+    }
+}   // disableChassisRaycast
+
+// ----------------------------------------------------------------------------
+/** Casts the suspension ray of a single wheel (and for the rear wheels
+ *  the ray for the visual contact point).
+ *  \param index Index of the wheel.
+ *  \param fraction Scales the connection point of the wheel towards the
+ *         centre of the chassis.
+ *  \return The suspension length, or -1 if the ground was not hit.
+ */
+btScalar btKart::rayCast(unsigned int index, float fraction)
+{
+    btAssert(m_vehicleRaycaster);
+
+    short int old_group=0;
+    disableChassisRaycast(/*disable*/true, &old_group);
+
+    btVector3 source, target;
+    getWheelRay(index, fraction, &source, &target);
+    btVehicleRaycaster::btVehicleRaycasterResult rayResults;
+    void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
+    btScalar depth = updateWheelFromRay(index, object, rayResults);
+
     if(index==2 || index==3)
     {
-        btTransform chassisTrans = getChassisWorldTransform();
-        if (getRigidBody()->getMotionState())
-        {
-            getRigidBody()->getMotionState()->getWorldTransform(chassisTrans);
-        }
-        btQuaternion q(m_visual_rotation, 0, 0);
-        btQuaternion rot_new = chassisTrans.getRotation() * q;
-        chassisTrans.setRotation(rot_new);
-        btVector3 pos = m_kart->getKartModel()->getWheelGraphicsPosition(index);
-        pos.setZ(pos.getZ()*0.9f);
-        btVector3 source = chassisTrans( pos );
-        btVector3 target = source + rayvector;
+        getVisualWheelRay(index, &source, &target);
         btVehicleRaycaster::btVehicleRaycasterResult rayResults;
-
         void* object = m_vehicleRaycaster->castRay(source,target,rayResults);
-        m_visual_contact_point[index] = rayResults.m_hitPointInWorld;
-        m_visual_contact_point[index-2] = source;
-        m_visual_wheels_touch_ground &= (object!=NULL);
+        updateVisualWheelFromRay(index, source, object, rayResults);
     }
-#endif
 
-    if(m_chassisBody->getBroadphaseHandle())
+    disableChassisRaycast(/*disable*/false, &old_group);
+
+    return depth;
+
+}   // rayCast
+
+// ----------------------------------------------------------------------------
+/** Casts the suspension rays of all wheels and the rays of the visual
+ *  wheels as one batch, which allows the ray caster to traverse the
+ *  track's BVH once for all rays.
+ */
+void btKart::rayCastAllWheels()
+{
+    btAssert(m_vehicleRaycaster);
+    const int MAX_RAYS = btKartRaycaster::MAX_BATCH_SIZE;
+    const int num_wheels = m_wheelInfo.size();
+    const int num_rays = num_wheels > 3 ? num_wheels + 2 : num_wheels;
+    if(num_rays > MAX_RAYS)
     {
-        m_chassisBody->getBroadphaseHandle()->m_collisionFilterGroup
-            = old_group;
+        for (int i=0;i<num_wheels;i++)
+            rayCast(i);
+        return;
     }
 
+    short int old_group=0;
+    disableChassisRaycast(/*disable*/true, &old_group);
 
-    return depth;
+    btVector3 from[MAX_RAYS], to[MAX_RAYS];
+    btVehicleRaycaster::btVehicleRaycasterResult results[MAX_RAYS];
+    void *objects[MAX_RAYS];
+    for (int i=0;i<num_wheels;i++)
+        getWheelRay(i, 1.0f, &from[i], &to[i]);
+    for (int i=num_wheels; i<num_rays; i++)
+        getVisualWheelRay(2 + i - num_wheels, &from[i], &to[i]);
 
-}   // rayCast
+    m_vehicleRaycaster->castRays(num_rays, from, to, results, objects);
+
+    for (int i=0;i<num_wheels;i++)
+        updateWheelFromRay(i, objects[i], results[i]);
+    for (int i=num_wheels; i<num_rays; i++)
+        updateVisualWheelFromRay(2 + i - num_wheels, from[i], objects[i],
+                                 results[i]);
+
+    disableChassisRaycast(/*disable*/false, &old_group);
+}   // rayCastAllWheels
 
 // ----------------------------------------------------------------------------
 const btTransform& btKart::getChassisWorldTransform() const
@@ -387,9 +499,9 @@ void btKart::updateVehicle( btScalar step )
 
     m_num_wheels_on_ground       = 0;
     m_visual_wheels_touch_ground = true;
+    rayCastAllWheels();
     for (int i=0;i<m_wheelInfo.size();i++)
     {
-        rayCast( i);
         if(m_wheelInfo[i].m_raycastInfo.m_isInContact)
             m_num_wheels_on_ground++;
         else
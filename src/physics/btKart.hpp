@@ -67,7 +67,7 @@ private:
     btScalar calcRollingFriction(btWheelContactPoint& contactPoint);
 
     btScalar            m_damping;
-    btVehicleRaycaster *m_vehicleRaycaster;
+    btKartRaycaster    *m_vehicleRaycaster;
 
     /** The zipper speed (i.e. the velocity the kart should reach in
      *  the first frame that the zipper is active). */
@@ -134,6 +134,26 @@ private:
 
     void     defaultInit();
     btScalar rayCast(btWheelInfo& wheel, const btVector3& ray);
+    void     getWheelRay(unsigned int index, float fraction,
+                         btVector3 *from, btVector3 *to);
+    void     getVisualWheelRay(unsigned int index, btVector3 *from,
+                               btVector3 *to);
+    btScalar updateWheelFromRay(unsigned int index, void *object,
+               const btVehicleRaycaster::btVehicleRaycasterResult &rayResults);
+    void     updateVisualWheelFromRay(unsigned int index,
+                                      const btVector3 &from, void *object,
+               const btVehicleRaycaster::btVehicleRaycasterResult &rayResults);
+    void     disableChassisRaycast(bool disable, short int *old_group);
+    void     rayCastAllWheels();
+    // ------------------------------------------------------------------------
+    /** Returns the length of the suspension ray of a wheel. This is slightly
+     *  longer than the maximum suspension length to see if the kart might
+     *  soon hit the ground and some 'cushioning' is needed. */
+    btScalar getWheelRayLength(const btWheelInfo &wheel) const
+    {
+        return wheel.getSuspensionRestLength() + wheel.m_maxSuspensionTravel
+             + 0.5f;
+    }   // getWheelRayLength
 
 public:
 
@@ -144,7 +164,7 @@ public:
      *         (this is used to get access to the kart properties).
      */
                        btKart(btRigidBody* chassis,
-                              btVehicleRaycaster* raycaster,
+                              btKartRaycaster* raycaster,
                               Kart *kart);
      virtual          ~btKart();
     void               reset();
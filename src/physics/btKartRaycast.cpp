@@ -107,5 +107,100 @@ void* btKartRaycaster::castRay(const btVector3& from, const btVector3& to,
         }
     }
     return 0;
-}
+}   // castRay
 
+// ----------------------------------------------------------------------------
+/** Casts a batch of rays, e.g. the suspension rays of all wheels of a kart.
+ *  If no object apart from the track is close to any of the rays, the rays
+ *  are cast as a packet against the track mesh only (which is much cheaper
+ *  than a full world ray test per ray). Otherwise each ray is cast on its
+ *  own with castRay. The results are the same as calling castRay for each
+ *  ray.
+ *  \param count Number of rays, at most MAX_BATCH_SIZE.
+ *  \param from, to Start and end points of the rays.
+ *  \param results On return the results of each ray.
+ *  \param objects On return the object hit by each ray, or NULL.
+ */
+void btKartRaycaster::castRays(unsigned int count, const btVector3 *from,
+                               const btVector3 *to,
+                               btVehicleRaycasterResult *results,
+                               void **objects)
+{
+    // ========================================================================
+    /** Detects if any object apart from the track could be hit by a ray
+     *  inside of the tested box. The filtering is the same as used by
+     *  btCollisionWorld::ClosestRayResultCallback. */
+    class OtherObjectCallback : public btBroadphaseAabbCallback
+    {
+    private:
+        const btCollisionObject *m_track;
+    public:
+        bool m_found_other;
+        OtherObjectCallback(const btCollisionObject *track)
+            : m_track(track), m_found_other(false) {}
+        // --------------------------------------------------------------------
+        virtual bool process(const btBroadphaseProxy *proxy)
+        {
+            if ((proxy->m_collisionFilterGroup &
+                 btBroadphaseProxy::AllFilter) == 0 ||
+                (btBroadphaseProxy::DefaultFilter &
+                 proxy->m_collisionFilterMask) == 0)
+                return true;
+            if (proxy->m_clientObject != m_track)
+                m_found_other = true;
+            return !m_found_other;
+        }   // process
+    };   // OtherObjectCallback
+    // ========================================================================
+
+    const TriangleMesh &tm = Track::getCurrentTrack()->getTriangleMesh();
+    const btRigidBody *track_body = tm.getBody();
+    bool only_track = track_body != NULL && count <= MAX_BATCH_SIZE &&
+                      track_body->hasContactResponse();
+    if (only_track)
+    {
+        btVector3 aabb_min = from[0], aabb_max = from[0];
+        for (unsigned int i = 0; i < count; i++)
+        {
+            aabb_min.setMin(from[i]);
+            aabb_min.setMin(to[i]);
+            aabb_max.setMax(from[i]);
+            aabb_max.setMax(to[i]);
+        }
+        OtherObjectCallback callback(track_body);
+        m_dynamicsWorld->getBroadphase()->aabbTest(aabb_min, aabb_max,
+                                                   callback);
+        only_track = !callback.m_found_other;
+    }
+
+    if (!only_track)
+    {
+        for (unsigned int i = 0; i < count; i++)
+            objects[i] = castRay(from[i], to[i], results[i]);
+        return;
+    }
+
+    TriangleMesh::RayHit hits[MAX_BATCH_SIZE];
+    tm.castRays(count, from, to, hits);
+    for (unsigned int i = 0; i < count; i++)
+    {
+        if (!hits[i].m_hit)
+        {
+            objects[i] = NULL;
+            continue;
+        }
+        btVehicleRaycasterResult &result = results[i];
+        result.m_hitPointInWorld  = hits[i].m_xyz;
+        result.m_hitNormalInWorld = hits[i].m_normal;
+        result.m_distFraction     = hits[i].m_fraction;
+        result.m_triangle_index   = -1;
+        if (m_smooth_normals)
+        {
+            result.m_triangle_index = hits[i].m_triangle_index;
+            result.m_hitNormalInWorld =
+                tm.getInterpolatedNormal(hits[i].m_triangle_index,
+                                         result.m_hitPointInWorld);
+        }
+        objects[i] = const_cast<btRigidBody*>(track_body);
+    }
+}   // castRays
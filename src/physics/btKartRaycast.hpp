@@ -28,6 +28,9 @@ private:
     *  so this flag is set depending on track when constructing this object. */
     bool                m_smooth_normals;
 public:
+    /** Maximum number of rays which can be cast in one castRays call. */
+    static const unsigned int MAX_BATCH_SIZE = 16;
+
     btKartRaycaster(btDynamicsWorld* world, bool smooth_normals=false)
         :m_dynamicsWorld(world), m_smooth_normals(smooth_normals)
     {
@@ -35,6 +38,9 @@ public:
 
     virtual void* castRay(const btVector3& from,const btVector3& to,
                           btVehicleRaycasterResult& result);
+    void castRays(unsigned int count, const btVector3 *from,
+                  const btVector3 *to, btVehicleRaycasterResult *results,
+                  void **objects);
 
 };
 
@@ -0,0 +1,238 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "physics/parallel_collision_dispatcher.hpp"
+
+#include "utils/job_system.hpp"
+
+#include <algorithm>
+
+/** With fewer pairs the overhead of the parallel narrowphase is larger
+ *  than the gain. */
+static const int MIN_PARALLEL_PAIRS = 16;
+
+thread_local ParallelCollisionDispatcher::PairContext
+    *ParallelCollisionDispatcher::m_context = NULL;
+
+// ----------------------------------------------------------------------------
+ParallelCollisionDispatcher::ParallelCollisionDispatcher(
+                                               btCollisionConfiguration *conf)
+                           : btCollisionDispatcher(conf)
+{
+    m_num_groups = 0;
+    m_enabled    = true;
+}   // ParallelCollisionDispatcher
+
+// ----------------------------------------------------------------------------
+/** Returns the union-find node of a compound object, creating a new node
+ *  if necessary. */
+int ParallelCollisionDispatcher::getNode(const btCollisionObject *object)
+{
+    std::unordered_map<const btCollisionObject*, int>::iterator i =
+        m_object_node.find(object);
+    if (i != m_object_node.end())
+        return i->second;
+    const int node = (int)m_node_parent.size();
+    m_node_parent.push_back(node);
+    m_object_node[object] = node;
+    return node;
+}   // getNode
+
+// ----------------------------------------------------------------------------
+/** Returns the root of the set the given node belongs to. */
+int ParallelCollisionDispatcher::findRoot(int node)
+{
+    while (m_node_parent[node] != node)
+    {
+        m_node_parent[node] = m_node_parent[m_node_parent[node]];
+        node = m_node_parent[node];
+    }
+    return node;
+}   // findRoot
+
+// ----------------------------------------------------------------------------
+/** Computes the contacts of all overlapping pairs. If the parallel
+ *  narrowphase can not be used (or is not worth it), this is done by the
+ *  serial btCollisionDispatcher.
+ */
+void ParallelCollisionDispatcher::dispatchAllCollisionPairs(
+                                            btOverlappingPairCache *pair_cache,
+                                            const btDispatcherInfo &info,
+                                            btDispatcher *dispatcher)
+{
+    const int num_pairs = pair_cache->getNumOverlappingPairs();
+    JobSystem *job_system = JobSystem::get();
+    // A custom near callback, the continuous narrowphase (which computes a
+    // minimum over all pairs) and debug drawing are only supported serially.
+    if (!m_enabled || num_pairs < MIN_PARALLEL_PAIRS || !job_system ||
+        job_system->getNumThreads() < 2                               ||
+        getNearCallback() != &btCollisionDispatcher::defaultNearCallback ||
+        info.m_dispatchFunc != btDispatcherInfo::DISPATCH_DISCRETE    ||
+        (info.m_debugDraw && info.m_debugDraw->getDebugMode() != 0)     )
+    {
+        m_num_groups = 0;
+        btCollisionDispatcher::dispatchAllCollisionPairs(pair_cache, info,
+                                                         dispatcher);
+        return;
+    }
+
+    btBroadphasePair *pairs = pair_cache->getOverlappingPairArrayPtr();
+
+    // Put all pairs sharing a compound object into the same set
+    m_object_node.clear();
+    m_node_parent.clear();
+    m_pair_node.resize(num_pairs);
+    for (int i = 0; i < num_pairs; i++)
+    {
+        const btCollisionObject *o0 =
+            (btCollisionObject*)pairs[i].m_pProxy0->m_clientObject;
+        const btCollisionObject *o1 =
+            (btCollisionObject*)pairs[i].m_pProxy1->m_clientObject;
+        const int n0 = o0->getCollisionShape()->isCompound() ? getNode(o0)
+                                                             : -1;
+        const int n1 = o1->getCollisionShape()->isCompound() ? getNode(o1)
+                                                             : -1;
+        if (n0 >= 0 && n1 >= 0)
+        {
+            const int r0 = findRoot(n0);
+            const int r1 = findRoot(n1);
+            if (r0 != r1)
+                m_node_parent[std::max(r0, r1)] = std::min(r0, r1);
+        }
+        m_pair_node[i] = n0 >= 0 ? n0 : n1;
+    }
+
+    // Create the groups, each group contains its pairs in the original order
+    m_node_group.assign(m_node_parent.size(), -1);
+    m_num_groups = 0;
+    for (int i = 0; i < num_pairs; i++)
+    {
+        int group = -1;
+        if (m_pair_node[i] >= 0)
+            group = m_node_group[findRoot(m_pair_node[i])];
+        if (group < 0)
+        {
+            group = m_num_groups++;
+            if (m_groups.size() < m_num_groups)
+                m_groups.resize(m_num_groups);
+            m_groups[group].m_pairs.clear();
+            m_groups[group].m_operations.clear();
+            if (m_pair_node[i] >= 0)
+                m_node_group[findRoot(m_pair_node[i])] = group;
+        }
+        m_groups[group].m_pairs.push_back(i);
+    }
+
+    job_system->parallelFor(m_num_groups, [this, pairs, &info](unsigned int g)
+        {
+            PairGroup &group = m_groups[g];
+            PairContext context;
+            context.m_operations = &group.m_operations;
+            m_context = &context;
+            for (unsigned int i = 0; i < group.m_pairs.size(); i++)
+            {
+                context.m_pair     = group.m_pairs[i];
+                context.m_sequence = 0;
+                defaultNearCallback(pairs[context.m_pair], *this, info);
+            }
+            m_context = NULL;
+        });
+
+    // Now update the list of manifolds in the serial order
+    m_operations.clear();
+    for (unsigned int g = 0; g < m_num_groups; g++)
+    {
+        m_operations.insert(m_operations.end(),
+                            m_groups[g].m_operations.begin(),
+                            m_groups[g].m_operations.end());
+    }
+    std::sort(m_operations.begin(), m_operations.end());
+    for (unsigned int i = 0; i < m_operations.size(); i++)
+    {
+        btPersistentManifold *manifold = m_operations[i].m_manifold;
+        if (m_operations[i].m_create)
+        {
+            manifold->m_index1a = m_manifoldsPtr.size();
+            m_manifoldsPtr.push_back(manifold);
+        }
+        else
+            btCollisionDispatcher::releaseManifold(manifold);
+    }
+}   // dispatchAllCollisionPairs
+
+// ----------------------------------------------------------------------------
+/** Records a manifold operation of the pair processed by this thread. */
+void ParallelCollisionDispatcher::addOperation(btPersistentManifold *manifold,
+                                               bool create)
+{
+    ManifoldOperation op;
+    op.m_order    = ((uint64_t)m_context->m_pair << 32)
+                  | m_context->m_sequence++;
+    op.m_manifold = manifold;
+    op.m_create   = create;
+    m_context->m_operations->push_back(op);
+}   // addOperation
+
+// ----------------------------------------------------------------------------
+btPersistentManifold *ParallelCollisionDispatcher::getNewManifold(void *b0,
+                                                                  void *b1)
+{
+    if (!m_context)
+        return btCollisionDispatcher::getNewManifold(b0, b1);
+
+    btPersistentManifold *manifold;
+    {
+        std::lock_guard<std::mutex> lock(m_allocator_mutex);
+        manifold = btCollisionDispatcher::getNewManifold(b0, b1);
+        // The manifold is added to the list again after the narrowphase
+        m_manifoldsPtr.pop_back();
+    }
+    addOperation(manifold, /*create*/true);
+    return manifold;
+}   // getNewManifold
+
+// ----------------------------------------------------------------------------
+void ParallelCollisionDispatcher::releaseManifold(
+                                              btPersistentManifold *manifold)
+{
+    if (!m_context)
+        btCollisionDispatcher::releaseManifold(manifold);
+    else
+        addOperation(manifold, /*create*/false);
+}   // releaseManifold
+
+// ----------------------------------------------------------------------------
+void *ParallelCollisionDispatcher::allocateCollisionAlgorithm(int size)
+{
+    if (!m_context)
+        return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+    std::lock_guard<std::mutex> lock(m_allocator_mutex);
+    return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+}   // allocateCollisionAlgorithm
+
+// ----------------------------------------------------------------------------
+void ParallelCollisionDispatcher::freeCollisionAlgorithm(void *ptr)
+{
+    if (!m_context)
+    {
+        btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_allocator_mutex);
+    btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+}   // freeCollisionAlgorithm
@@ -0,0 +1,132 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_PARALLEL_COLLISION_DISPATCHER_HPP
+#define HEADER_PARALLEL_COLLISION_DISPATCHER_HPP
+
+#include "btBulletDynamicsCommon.h"
+
+#include "utils/types.hpp"
+
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+/**
+  * \brief A collision dispatcher which computes the contacts of all
+  *  overlapping pairs (the narrowphase) in parallel using the JobSystem.
+  *  The result is identical to the serial btCollisionDispatcher:
+  *  - Bullet's compound algorithm temporarily modifies the compound object
+  *    (i.e. a kart) while it is processed. So all pairs that share a
+  *    compound object are put into the same group, and each group is
+  *    processed by one thread in the original pair order. Other objects
+  *    (e.g. the track) are only read (see lib/bullet/stk.patch).
+  *  - The order of the contact manifolds determines the order in which the
+  *    constraint solver handles the contacts. Manifolds created or released
+  *    while pairs are processed in parallel are only recorded, and are then
+  *    added to (or removed from) the list of manifolds in the order in
+  *    which the serial dispatcher would have done it.
+  * \ingroup physics
+  */
+class ParallelCollisionDispatcher : public btCollisionDispatcher
+{
+private:
+    /** A manifold that was created or released while processing a pair. */
+    struct ManifoldOperation
+    {
+        /** Index of the pair (upper 32 bit) and sequence number of this
+         *  operation for this pair, used to restore the serial order. */
+        uint64_t               m_order;
+        btPersistentManifold  *m_manifold;
+        bool                   m_create;
+        bool operator<(const ManifoldOperation &o) const
+        {
+            return m_order < o.m_order;
+        }
+    };
+
+    /** All pairs that must be processed by the same thread. */
+    struct PairGroup
+    {
+        std::vector<unsigned int>      m_pairs;
+        std::vector<ManifoldOperation> m_operations;
+    };
+
+    /** The state of the thread which processes a pair. */
+    struct PairContext
+    {
+        std::vector<ManifoldOperation> *m_operations;
+        unsigned int                    m_pair;
+        unsigned int                    m_sequence;
+    };
+
+    /** The context of the pair this thread currently processes, or NULL if
+     *  this thread does not execute the parallel narrowphase. */
+    static thread_local PairContext *m_context;
+
+    /** The groups of the current step. Groups are kept between steps to
+     *  avoid reallocating their vectors. */
+    std::vector<PairGroup>   m_groups;
+
+    /** Number of groups used in the current step. */
+    unsigned int             m_num_groups;
+
+    /** Union-find data: index of the node for each compound object, and
+     *  the parent of each node. */
+    std::unordered_map<const btCollisionObject*, int> m_object_node;
+    std::vector<int>         m_node_parent;
+
+    /** Node of each pair, or -1 if the pair has no compound object. */
+    std::vector<int>         m_pair_node;
+
+    /** Group of each root node. */
+    std::vector<int>         m_node_group;
+
+    /** All manifold operations of a step, sorted to the serial order. */
+    std::vector<ManifoldOperation> m_operations;
+
+    /** Protects the pool allocators of the dispatcher. */
+    std::mutex               m_allocator_mutex;
+
+    /** If false, the serial narrowphase is always used. */
+    bool                     m_enabled;
+
+    int      getNode(const btCollisionObject *object);
+    int      findRoot(int node);
+    void     addOperation(btPersistentManifold *manifold, bool create);
+
+public:
+             ParallelCollisionDispatcher(btCollisionConfiguration *conf);
+    virtual ~ParallelCollisionDispatcher() {}
+    virtual void dispatchAllCollisionPairs(btOverlappingPairCache *pair_cache,
+                                           const btDispatcherInfo &info,
+                                           btDispatcher *dispatcher);
+    virtual btPersistentManifold *getNewManifold(void *b0, void *b1);
+    virtual void  releaseManifold(btPersistentManifold *manifold);
+    virtual void *allocateCollisionAlgorithm(int size);
+    virtual void  freeCollisionAlgorithm(void *ptr);
+    // ------------------------------------------------------------------------
+    /** Enables or disables the parallel narrowphase. */
+    void setEnabled(bool enabled)                   { m_enabled = enabled; }
+    // ------------------------------------------------------------------------
+    /** Returns the number of pair groups processed in parallel in the last
+     *  step (0 if the serial narrowphase was used). */
+    unsigned int getNumGroups() const               { return m_num_groups; }
+};   // ParallelCollisionDispatcher
+
+#endif
@@ -22,6 +22,7 @@
 #include "animations/three_d_animation.hpp"
 #include "config/player_manager.hpp"
 #include "config/player_profile.hpp"
+#include "config/user_config.hpp"
 #include "karts/abstract_kart.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/stars.hpp"
@@ -34,6 +35,7 @@
 #include "karts/explosion_animation.hpp"
 #include "physics/btKart.hpp"
 #include "physics/irr_debug_drawer.hpp"
+#include "physics/parallel_collision_dispatcher.hpp"
 #include "physics/physical_object.hpp"
 #include "physics/stk_dynamics_world.hpp"
 #include "physics/triangle_mesh.hpp"
@@ -42,6 +44,7 @@
 #include "tracks/track.hpp"
 #include "tracks/track_object.hpp"
 #include "utils/profiler.hpp"
+#include "utils/time.hpp"
 
 // ----------------------------------------------------------------------------
 /** Initialise physics.
@@ -50,23 +53,35 @@
 Physics::Physics() : btSequentialImpulseConstraintSolver()
 {
     m_collision_conf      = new btDefaultCollisionConfiguration();
-    m_dispatcher          = new btCollisionDispatcher(m_collision_conf);
+    m_dispatcher          = new ParallelCollisionDispatcher(m_collision_conf);
 }   // Physics
 
 //-----------------------------------------------------------------------------
 /** The actual initialisation of the physics, which is called after the track
  *  model is loaded. This allows the physics to use the actual track dimension
- *  for the axis sweep.
+ *  for the axis sweep. The dynamic AABB tree broadphase does not depend on
+ *  the track size, and handles many moving objects (e.g. in battle or
+ *  soccer mode with many karts) better.
  */
 void Physics::init(const Vec3 &world_min, const Vec3 &world_max)
 {
     m_physics_loop_active = false;
-    m_axis_sweep          = new btAxisSweep3(world_min, world_max);
+    const std::string &broadphase =
+        UserConfigParams::m_physics_broadphase_override.empty()
+        ? (std::string)UserConfigParams::m_physics_broadphase
+        : UserConfigParams::m_physics_broadphase_override;
+    if (broadphase == "dbvt")
+        m_broadphase      = new btDbvtBroadphase();
+    else
+        m_broadphase      = new btAxisSweep3(world_min, world_max);
+    m_dispatcher->setEnabled(UserConfigParams::m_physics_parallel_narrowphase);
     m_dynamics_world      = new STKDynamicsWorld(m_dispatcher,
-                                                 m_axis_sweep,
+                                                 m_broadphase,
                                                  this,
                                                  m_collision_conf);
     m_karts_to_delete.clear();
+    m_num_steps           = 0;
+    m_update_time         = 0;
     m_dynamics_world->setGravity(
         btVector3(0.0f,
                   -Track::getCurrentTrack()->getGravity(),
@@ -80,7 +95,7 @@ Physics::~Physics()
 {
     delete m_debug_drawer;
     delete m_dynamics_world;
-    delete m_axis_sweep;
+    delete m_broadphase;
     delete m_dispatcher;
     delete m_collision_conf;
 }   // ~Physics
@@ -140,6 +155,7 @@ void Physics::removeKart(const AbstractKart *kart)
 void Physics::update(float dt)
 {
     PROFILER_PUSH_CPU_MARKER("Physics", 0, 0, 0);
+    const double start_time = StkTime::getRealTime();
 
     m_physics_loop_active = true;
     // Bullet can report the same collision more than once (up to 4
@@ -152,7 +168,7 @@ void Physics::update(float dt)
 
     // Maximum of three substeps. This will work for framerate down to
     // 20 FPS (bullet default frequency is 60 HZ).
-    m_dynamics_world->stepSimulation(dt, 6, 1.0f/120.0f);
+    m_num_steps += m_dynamics_world->stepSimulation(dt, 6, 1.0f/120.0f);
 
     // Now handle the actual collision. Note: flyables can not be removed
     // inside of this loop, since the same flyables might hit more than one
@@ -348,6 +364,7 @@ void Physics::update(float dt)
         removeKart(m_karts_to_delete[i]);
     m_karts_to_delete.clear();
 
+    m_update_time += StkTime::getRealTime() - start_time;
     PROFILER_POP_CPU_MARKER();
 }   // update
 
@@ -485,7 +502,8 @@ void Physics::KartKartCollision(AbstractKart *kart_a,
 }   // KartKartCollision
 
 //-----------------------------------------------------------------------------
-/** This function is called at each internal bullet timestep. It is used
+/** This function is called at each internal bullet timestep, after the
+ *  constraints of all simulation islands have been solved. It is used
  *  here to do the collision handling: using the contact manifolds after a
  *  physics time step might miss some collisions (when more than one internal
  *  time step was done, and the collision is added and removed). So this
@@ -493,26 +511,16 @@ void Physics::KartKartCollision(AbstractKart *kart_a,
  *  actual physics timestep. This list only stores a collision if it's not
  *  already in the list, so a collisions which is reported more than once is
  *  nevertheless only handled once.
- *  The list of collision
+ *  Since all islands are solved at this stage, each contact manifold is
+ *  only tested once per timestep (while solveGroup is called once for each
+ *  island or batch of islands).
  *  Parameters: see bullet documentation for details.
  */
-btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
-                             btPersistentManifold** manifold,int numManifolds,
-                             btTypedConstraint** constraints,
-                             int numConstraints,
-                             const btContactSolverInfo& info,
-                             btIDebugDraw* debugDrawer,
-                             btStackAlloc* stackAlloc,
-                             btDispatcher* dispatcher)
+void Physics::allSolved(const btContactSolverInfo& info,
+                        btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc)
 {
-    btScalar returnValue=
-        btSequentialImpulseConstraintSolver::solveGroup(bodies, numBodies,
-                                                        manifold, numManifolds,
-                                                        constraints,
-                                                        numConstraints, info,
-                                                        debugDrawer,
-                                                        stackAlloc,
-                                                        dispatcher);
+    btSequentialImpulseConstraintSolver::allSolved(info, debugDrawer,
+                                                   stackAlloc);
     int currentNumManifolds = m_dispatcher->getNumManifolds();
     // We can't explode a rocket in a loop, since a rocket might collide with
     // more than one object, and/or more than once with each object (if there
@@ -684,9 +692,7 @@ btScalar Physics::solveGroup(btCollisionObject** bodies, int numBodies,
         else
             assert("Unknown user pointer");           // 4) Should never happen
     }   // for i<numManifolds
-
-    return returnValue;
-}   // solveGroup
+}   // allSolved
 
 // ----------------------------------------------------------------------------
 /** A debug draw function to show the track and all karts.
@@ -25,6 +25,8 @@
   */
 
 #include <set>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "btBulletDynamicsCommon.h"
@@ -35,6 +37,7 @@
 #include "utils/singleton.hpp"
 
 class AbstractKart;
+class ParallelCollisionDispatcher;
 class STKDynamicsWorld;
 class Vec3;
 
@@ -50,11 +53,9 @@ private:
      *  substep might be taken, resulting in potentially even more
      *  duplicates. To handle this, all collisions (i.e. pair of objects)
      *  are stored in a vector, but only one entry per collision pair
-     *  of objects.
-     *  While this is a natural application of std::set, the set has some
-     *  overhead (since it will likely use a tree to sort the entries).
-     *  Considering that the number of collisions is usually rather small
-     *  a simple list and linear search is faster is is being used here. */
+     *  of objects. The vector keeps the order in which collisions were
+     *  reported, a hash set is used to quickly detect duplicates (with
+     *  many karts a linear search becomes too slow). */
     class CollisionPair
     {
     private:
@@ -109,14 +110,35 @@ private:
     class CollisionList : public std::vector<CollisionPair>
     {
     private:
+        typedef std::pair<const UserPointer*, const UserPointer*> Key;
+
+        /** Hash function for a pair of user pointers. */
+        struct KeyHash
+        {
+            size_t operator()(const Key &key) const
+            {
+                std::hash<const UserPointer*> h;
+                return h(key.first) * 31 + h(key.second);
+            }
+        };   // KeyHash
+
+        /** The user pointers of all pairs in this list. */
+        std::unordered_set<Key, KeyHash> m_all_keys;
+
         void push_back(CollisionPair p) {
             // only add a pair if it's not already in there
-            for(iterator i=begin(); i!=end(); i++) {
-                if((*i)==p) return;
-            }
+            Key key(p.getUserPointer(0), p.getUserPointer(1));
+            if(!m_all_keys.insert(key).second) return;
             std::vector<CollisionPair>::push_back(p);
         };  // push_back
     public:
+        /** Removes all collisions. */
+        void clear()
+        {
+            std::vector<CollisionPair>::clear();
+            m_all_keys.clear();
+        }   // clear
+        // --------------------------------------------------------------------
         /** Adds information about a collision to this vector. */
         void push_back(const UserPointer *a, const btVector3 &contact_point_a,
                        const UserPointer *b, const btVector3 &contact_point_b)
@@ -144,11 +166,19 @@ private:
     /** Used in physics debugging to draw the physics world. */
     IrrDebugDrawer                  *m_debug_drawer;
 
-    btCollisionDispatcher           *m_dispatcher;
-    btBroadphaseInterface           *m_axis_sweep;
+    ParallelCollisionDispatcher     *m_dispatcher;
+
+    /** The broadphase, either an axis sweep or a dynamic AABB tree
+     *  (depending on UserConfigParams::m_physics_broadphase). */
+    btBroadphaseInterface           *m_broadphase;
     btDefaultCollisionConfiguration *m_collision_conf;
     CollisionList                    m_all_collisions;
 
+    /** Statistics: number of simulation steps, and the time (in seconds)
+     *  spent in update(). */
+    int                              m_num_steps;
+    double                           m_update_time;
+
     /** Singleton. */
     static Physics                  *m_physics;
 
@@ -177,12 +207,18 @@ public:
     /** Returns true if the debug drawer is enabled. */
     bool  isDebug() const     {return m_debug_drawer->debugEnabled(); }
     IrrDebugDrawer* getDebugDrawer() { return m_debug_drawer; }
-    virtual btScalar solveGroup(btCollisionObject** bodies, int numBodies,
-                                btPersistentManifold** manifold,int numManifolds,
-                                btTypedConstraint** constraints,int numConstraints,
-                                const btContactSolverInfo& info,
-                                btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc,
-                                btDispatcher* dispatcher);
+    virtual void allSolved(const btContactSolverInfo& info,
+                           btIDebugDraw* debugDrawer, btStackAlloc* stackAlloc);
+    // ------------------------------------------------------------------------
+    /** Returns the number of simulation steps taken. */
+    int    getNumSteps() const { return m_num_steps; }
+    // ------------------------------------------------------------------------
+    /** Returns the average time (in ms) of a simulation step, including
+     *  the collision handling. */
+    double getAverageStepTime() const
+    {
+        return m_num_steps > 0 ? m_update_time * 1000.0 / m_num_steps : 0;
+    }   // getAverageStepTime
 };
 
 #endif // HEADER_PHYSICS_HPP
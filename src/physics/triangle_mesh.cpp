@@ -25,8 +25,14 @@
 
 #include "btBulletDynamicsCommon.h"
 
+#include <algorithm>
 #include <fstream>
 
+#if __SSE2__ || _M_X64 || _M_IX86_FP >= 2
+ #include <emmintrin.h>
+ #define SIMD_SSE2_SUPPORT (1)
+#endif
+
 // -----------------------------------------------------------------------------
 /** Constructor: Initialises all data structures with zero.
  */
@@ -403,3 +409,334 @@ bool TriangleMesh::castRay(const btVector3 &from, const btVector3 &to,
     return ray_callback.hasHit();
 
 }   // castRay
+
+// ============================================================================
+namespace
+{
+    /** Maximum number of rays which traverse the BVH together. */
+    const unsigned int RAY_PACKET_SIZE = 16;
+
+    // ------------------------------------------------------------------------
+    /** Returns the volume of a box with each side extended by 1m. This is
+     *  used as an estimate of the number of triangles in the box, the
+     *  padding makes sure that a box around an axis aligned ray does not
+     *  have a volume of 0. */
+    float getPaddedVolume(const btVector3 &min, const btVector3 &max)
+    {
+        const btVector3 size = max - min + btVector3(1.0f, 1.0f, 1.0f);
+        return size.getX() * size.getY() * size.getZ();
+    }   // getPaddedVolume
+
+    /** A packet of up to RAY_PACKET_SIZE rays (in the local coordinate
+     *  system of the mesh). The BVH is traversed once for the bounding box
+     *  of all rays, and each triangle found is then tested against all rays
+     *  of the packet, four rays at a time. The intersection test is the same
+     *  one bullet uses in btTriangleRaycastCallback (including the edge
+     *  tolerance), so the results are the same as casting each ray on its
+     *  own. The arrays are stored as structure-of-arrays so they can be
+     *  loaded directly into SIMD registers. Unused lanes are degenerated
+     *  rays (from==to) which can never hit a triangle. */
+    class RayPacket : public btTriangleCallback
+    {
+    public:
+        float m_from_x[RAY_PACKET_SIZE], m_from_y[RAY_PACKET_SIZE],
+              m_from_z[RAY_PACKET_SIZE];
+        float m_to_x[RAY_PACKET_SIZE], m_to_y[RAY_PACKET_SIZE],
+              m_to_z[RAY_PACKET_SIZE];
+        /** Fraction of the closest hit so far, 1.0 if nothing was hit. */
+        float m_fraction[RAY_PACKET_SIZE];
+        /** Index of the closest triangle hit, -1 if nothing was hit. */
+        int   m_triangle_index[RAY_PACKET_SIZE];
+        /** The triangle normal of the closest hit (pointing towards the
+         *  start of the ray, not normalised). */
+        btVector3 m_normal[RAY_PACKET_SIZE];
+        /** Bounding box of each group of four rays. */
+        btVector3 m_group_min[RAY_PACKET_SIZE / 4];
+        btVector3 m_group_max[RAY_PACKET_SIZE / 4];
+        /** Number of rays, rounded up to a multiple of 4. */
+        unsigned int m_num_lanes;
+
+        // --------------------------------------------------------------------
+        RayPacket()
+        {
+            m_num_lanes = 0;
+            for (unsigned int i = 0; i < RAY_PACKET_SIZE; i++)
+            {
+                m_from_x[i] = m_from_y[i] = m_from_z[i] = 0.0f;
+                m_to_x[i]   = m_to_y[i]   = m_to_z[i]   = 0.0f;
+                m_fraction[i]       = 1.0f;
+                m_triangle_index[i] = -1;
+            }
+        }   // RayPacket
+        // --------------------------------------------------------------------
+        /** Sets the number of rays used in this packet. */
+        void setNumRays(unsigned int count)
+        {
+            assert(count <= RAY_PACKET_SIZE);
+            m_num_lanes = (count + 3) & ~3;
+        }   // setNumRays
+        // --------------------------------------------------------------------
+        void setRay(unsigned int i, const btVector3 &from, const btVector3 &to)
+        {
+            m_from_x[i] = from.getX(); m_from_y[i] = from.getY();
+            m_from_z[i] = from.getZ();
+            m_to_x[i]   = to.getX();   m_to_y[i]   = to.getY();
+            m_to_z[i]   = to.getZ();
+            btVector3 &group_min = m_group_min[i / 4];
+            btVector3 &group_max = m_group_max[i / 4];
+            if (i % 4 == 0)
+            {
+                group_min = from;
+                group_max = from;
+            }
+            group_min.setMin(from);
+            group_min.setMin(to);
+            group_max.setMax(from);
+            group_max.setMax(to);
+        }   // setRay
+        // --------------------------------------------------------------------
+        /** Returns true if the box of the rays of the group with the given
+         *  index overlaps the box of a triangle. */
+        bool groupOverlaps(unsigned int group, const btVector3 &tri_min,
+                           const btVector3 &tri_max) const
+        {
+            return TestAabbAgainstAabb2(m_group_min[group], m_group_max[group],
+                                        tri_min, tri_max);
+        }   // groupOverlaps
+        // --------------------------------------------------------------------
+        /** Records a hit of ray i. */
+        void addHit(unsigned int i, float fraction, float dist_a,
+                    const btVector3 &normal, int triangle_index)
+        {
+            m_fraction[i]       = fraction;
+            m_triangle_index[i] = triangle_index;
+            m_normal[i]         = dist_a <= 0.0f ? -normal : normal;
+        }   // addHit
+        // --------------------------------------------------------------------
+        virtual void processTriangle(btVector3 *triangle, int part_id,
+                                     int triangle_index)
+        {
+            const btVector3 &v0 = triangle[0];
+            const btVector3 &v1 = triangle[1];
+            const btVector3 &v2 = triangle[2];
+            const btVector3 normal = (v1 - v0).cross(v2 - v0);
+            const float dist = v0.dot(normal);
+            const float edge_tolerance = normal.length2() * -0.0001f;
+            btVector3 tri_min = v0, tri_max = v0;
+            tri_min.setMin(v1); tri_min.setMin(v2);
+            tri_max.setMax(v1); tri_max.setMax(v2);
+
+#if SIMD_SSE2_SUPPORT
+            const __m128 nx = _mm_set1_ps(normal.getX());
+            const __m128 ny = _mm_set1_ps(normal.getY());
+            const __m128 nz = _mm_set1_ps(normal.getZ());
+            const __m128 vdist = _mm_set1_ps(dist);
+            const __m128 zero  = _mm_setzero_ps();
+            const __m128 one   = _mm_set1_ps(1.0f);
+            const __m128 tol   = _mm_set1_ps(edge_tolerance);
+            for (unsigned int i = 0; i < m_num_lanes; i += 4)
+            {
+                if (!groupOverlaps(i / 4, tri_min, tri_max))
+                    continue;
+                const __m128 fx = _mm_loadu_ps(m_from_x + i);
+                const __m128 fy = _mm_loadu_ps(m_from_y + i);
+                const __m128 fz = _mm_loadu_ps(m_from_z + i);
+                const __m128 tx = _mm_loadu_ps(m_to_x + i);
+                const __m128 ty = _mm_loadu_ps(m_to_y + i);
+                const __m128 tz = _mm_loadu_ps(m_to_z + i);
+                __m128 dist_a = _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+                                    _mm_mul_ps(nx, fx), _mm_mul_ps(ny, fy)),
+                                    _mm_mul_ps(nz, fz)), vdist);
+                __m128 dist_b = _mm_sub_ps(_mm_add_ps(_mm_add_ps(
+                                    _mm_mul_ps(nx, tx), _mm_mul_ps(ny, ty)),
+                                    _mm_mul_ps(nz, tz)), vdist);
+                // Start and end point must be on different sides
+                __m128 mask = _mm_cmplt_ps(_mm_mul_ps(dist_a, dist_b), zero);
+                if (!_mm_movemask_ps(mask))
+                    continue;
+                const __m128 d = _mm_div_ps(dist_a, _mm_sub_ps(dist_a, dist_b));
+                mask = _mm_and_ps(mask,
+                                  _mm_cmplt_ps(d, _mm_loadu_ps(m_fraction+i)));
+                if (!_mm_movemask_ps(mask))
+                    continue;
+                // Intersection point with the plane of the triangle
+                const __m128 s  = _mm_sub_ps(one, d);
+                const __m128 px = _mm_add_ps(_mm_mul_ps(s, fx), _mm_mul_ps(d, tx));
+                const __m128 py = _mm_add_ps(_mm_mul_ps(s, fy), _mm_mul_ps(d, ty));
+                const __m128 pz = _mm_add_ps(_mm_mul_ps(s, fz), _mm_mul_ps(d, tz));
+                // Vectors from the intersection point to the three vertices
+                const __m128 ax = _mm_sub_ps(_mm_set1_ps(v0.getX()), px);
+                const __m128 ay = _mm_sub_ps(_mm_set1_ps(v0.getY()), py);
+                const __m128 az = _mm_sub_ps(_mm_set1_ps(v0.getZ()), pz);
+                const __m128 bx = _mm_sub_ps(_mm_set1_ps(v1.getX()), px);
+                const __m128 by = _mm_sub_ps(_mm_set1_ps(v1.getY()), py);
+                const __m128 bz = _mm_sub_ps(_mm_set1_ps(v1.getZ()), pz);
+                const __m128 cx = _mm_sub_ps(_mm_set1_ps(v2.getX()), px);
+                const __m128 cy = _mm_sub_ps(_mm_set1_ps(v2.getY()), py);
+                const __m128 cz = _mm_sub_ps(_mm_set1_ps(v2.getZ()), pz);
+#define EDGE_TEST(ux, uy, uz, wx, wy, wz)                                     \
+                _mm_cmpge_ps(_mm_add_ps(_mm_add_ps(                           \
+                  _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(uy, wz), _mm_mul_ps(uz, wy)), nx), \
+                  _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(uz, wx), _mm_mul_ps(ux, wz)), ny)),\
+                  _mm_mul_ps(_mm_sub_ps(_mm_mul_ps(ux, wy), _mm_mul_ps(uy, wx)), nz)),\
+                  tol)
+                mask = _mm_and_ps(mask, EDGE_TEST(ax, ay, az, bx, by, bz));
+                mask = _mm_and_ps(mask, EDGE_TEST(bx, by, bz, cx, cy, cz));
+                mask = _mm_and_ps(mask, EDGE_TEST(cx, cy, cz, ax, ay, az));
+#undef EDGE_TEST
+                const int bits = _mm_movemask_ps(mask);
+                if (!bits)
+                    continue;
+                float fraction[4], da[4];
+                _mm_storeu_ps(fraction, d);
+                _mm_storeu_ps(da, dist_a);
+                for (unsigned int j = 0; j < 4; j++)
+                {
+                    if (bits & (1 << j))
+                        addHit(i + j, fraction[j], da[j], normal,
+                               triangle_index);
+                }
+            }   // for i < m_num_lanes
+#else
+            for (unsigned int i = 0; i < m_num_lanes; i++)
+            {
+                if (!groupOverlaps(i / 4, tri_min, tri_max))
+                    continue;
+                const btVector3 from(m_from_x[i], m_from_y[i], m_from_z[i]);
+                const btVector3 to(m_to_x[i], m_to_y[i], m_to_z[i]);
+                const float dist_a = normal.dot(from) - dist;
+                const float dist_b = normal.dot(to) - dist;
+                if (dist_a * dist_b >= 0.0f)
+                    continue;
+                const float d = dist_a / (dist_a - dist_b);
+                if (d >= m_fraction[i])
+                    continue;
+                btVector3 point;
+                point.setInterpolate3(from, to, d);
+                const btVector3 a = v0 - point;
+                const btVector3 b = v1 - point;
+                const btVector3 c = v2 - point;
+                if (a.cross(b).dot(normal) >= edge_tolerance &&
+                    b.cross(c).dot(normal) >= edge_tolerance &&
+                    c.cross(a).dot(normal) >= edge_tolerance    )
+                    addHit(i, d, dist_a, normal, triangle_index);
+            }   // for i < m_num_lanes
+#endif
+        }   // processTriangle
+    };   // RayPacket
+}   // anonymous namespace
+
+// ----------------------------------------------------------------------------
+/** Casts a batch of rays against this mesh. This gives the same results as
+ *  calling castRay for each ray, but is considerably faster for coherent
+ *  rays (e.g. the wheels of a kart, or a tile of a height map): rays are
+ *  grouped into packets, for each packet the BVH is only traversed once,
+ *  and the triangles found are tested against four rays at a time.
+ *  \param count Number of rays.
+ *  \param from, to Arrays with the start and end points of each ray.
+ *  \param hits On return the results for each ray.
+ *  \param interpolate_normal If true, the returned normals are interpolated
+ *         based on the three normals of the triangle hit.
+ */
+void TriangleMesh::castRays(unsigned int count, const btVector3 *from,
+                            const btVector3 *to, RayHit *hits,
+                            bool interpolate_normal) const
+{
+    if (!m_collision_shape)
+    {
+        for (unsigned int i = 0; i < count; i++)
+        {
+            hits[i].m_hit            = false;
+            hits[i].m_material       = NULL;
+            hits[i].m_fraction       = 1.0f;
+            hits[i].m_triangle_index = -1;
+            hits[i].m_normal.setValue(0, 1, 0);
+        }
+        return;
+    }
+
+    btTransform world_trans;
+    // If there is a body, take the current transform from the body.
+    if (m_body)
+        world_trans = m_body->getWorldTransform();
+    else
+        world_trans.setIdentity();
+    const btTransform inv_trans = world_trans.inverse();
+
+    btBvhTriangleMeshShape *shape =
+        static_cast<btBvhTriangleMeshShape*>(m_collision_shape);
+
+    unsigned int start = 0;
+    while (start < count)
+    {
+        // Collect coherent rays into a packet: a ray is only added if the
+        // bounding box of the packet does not become much bigger than the
+        // boxes of the individual rays, otherwise the packet would have to
+        // test many triangles none of its rays can hit.
+        RayPacket packet;
+        btVector3 aabb_min, aabb_max, first_from, first_to;
+        float rays_volume = 0.0f;
+        unsigned int n = 0;
+        while (n < RAY_PACKET_SIZE && start + n < count)
+        {
+            const btVector3 local_from = inv_trans(from[start + n]);
+            const btVector3 local_to   = inv_trans(to[start + n]);
+            btVector3 ray_min = local_from, ray_max = local_from;
+            ray_min.setMin(local_to);
+            ray_max.setMax(local_to);
+            const float ray_volume = getPaddedVolume(ray_min, ray_max);
+            if (n == 0)
+            {
+                aabb_min   = ray_min;
+                aabb_max   = ray_max;
+                first_from = local_from;
+                first_to   = local_to;
+            }
+            else
+            {
+                ray_min.setMin(aabb_min);
+                ray_max.setMax(aabb_max);
+                if (getPaddedVolume(ray_min, ray_max) >
+                    2.0f * (rays_volume + ray_volume))
+                    break;
+                aabb_min = ray_min;
+                aabb_max = ray_max;
+            }
+            rays_volume += ray_volume;
+            packet.setRay(n, local_from, local_to);
+            n++;
+        }   // while n < RAY_PACKET_SIZE
+        packet.setNumRays(n);
+
+        // A single ray uses bullet's ray traversal of the BVH, which only
+        // visits the nodes the ray actually intersects.
+        if (n == 1)
+            shape->performRaycast(&packet, first_from, first_to);
+        else
+            shape->processAllTriangles(&packet, aabb_min, aabb_max);
+
+        for (unsigned int i = 0; i < n; i++)
+        {
+            RayHit &hit = hits[start + i];
+            hit.m_triangle_index = packet.m_triangle_index[i];
+            hit.m_hit            = hit.m_triangle_index > -1;
+            hit.m_fraction       = packet.m_fraction[i];
+            if (!hit.m_hit)
+            {
+                hit.m_material = NULL;
+                hit.m_normal.setValue(0, 1, 0);
+                continue;
+            }
+            hit.m_xyz.setInterpolate3(from[start + i], to[start + i],
+                                      hit.m_fraction);
+            hit.m_material = m_triangleIndex2Material[hit.m_triangle_index];
+            if (interpolate_normal)
+                hit.m_normal = getInterpolatedNormal(hit.m_triangle_index,
+                                                     hit.m_xyz);
+            else
+                hit.m_normal = world_trans.getBasis() * packet.m_normal[i];
+            hit.m_normal.normalize();
+        }   // for i < n
+        start += n;
+    }   // while start < count
+}   // castRays
@@ -58,6 +58,23 @@ private:
     bool m_can_be_transformed;
 
 public:
+    /** The result of one ray of a castRays() query. */
+    struct RayHit
+    {
+        /** The position in world where the ray hit. */
+        btVector3       m_xyz;
+        /** The (optionally interpolated) normal at the hit position. */
+        btVector3       m_normal;
+        /** The material of the triangle hit, NULL if nothing was hit. */
+        const Material *m_material;
+        /** Fraction of the ray (0 = from, 1 = to) at which the hit is. */
+        float           m_fraction;
+        /** Index of the triangle hit, or -1. */
+        int             m_triangle_index;
+        /** True if a triangle was hit. */
+        bool            m_hit;
+    };   // RayHit
+
     class RigidBodyTriangleMesh : public btRigidBody
     {
     public:
@@ -112,6 +129,9 @@ public:
     bool castRay(const btVector3 &from, const btVector3 &to,
                  btVector3 *xyz, const Material **material,
                  btVector3 *normal=NULL, bool interpolate_normal=false) const;
+    void castRays(unsigned int count, const btVector3 *from,
+                  const btVector3 *to, RayHit *hits,
+                  bool interpolate_normal=false) const;
     // ------------------------------------------------------------------------
     /** Returns the points of the 'indx' triangle.
      *  \param indx Index of the triangle to get.
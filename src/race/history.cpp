@@ -19,8 +19,11 @@
 #include "race/history.hpp"
 
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
 #include "io/file_manager.hpp"
+#include "main_loop.hpp"
 #include "modes/world.hpp"
 #include "karts/abstract_kart.hpp"
 #include "network/rewind_manager.hpp"
@@ -36,7 +39,10 @@ History* history = 0;
  */
 History::History()
 {
-    m_replay_mode = HISTORY_NONE;
+    m_replay_mode      = HISTORY_NONE;
+    m_check_file       = NULL;
+    m_check_compare    = false;
+    m_check_mismatches = 0;
 }   // History
 
 //-----------------------------------------------------------------------------
@@ -115,9 +121,13 @@ float History::updateReplayAndGetDT()
 {
     m_current++;
     World *world = World::getWorld();
+    if (m_replay_mode == HISTORY_PHYSICS && !m_check_file_name.empty())
+        checkFrame();
     if(m_current>=(int)m_all_deltas.size())
     {
         Log::info("History", "Replay finished");
+        if (m_replay_mode == HISTORY_PHYSICS && !m_check_file_name.empty())
+            finishCheck();
         m_current = 0;
         // This is useful to use a reproducable rewind problem:
         // replay it with history, for debugging only
@@ -149,6 +159,105 @@ float History::updateReplayAndGetDT()
     return m_all_deltas[m_current];
 }   // updateReplayAndGetDT
 
+//-----------------------------------------------------------------------------
+/** Checks the determinism of a physics replay, e.g. of the parallel
+ *  narrowphase against the single-threaded one: the transforms of all karts
+ *  at the start of each frame are written bit-exact into the check file. If
+ *  the check file already exists, they are compared with it instead. So the
+ *  replay is run once with --job-threads=1 to write the file, and then with
+ *  more threads to compare.
+ */
+void History::checkFrame()
+{
+    if (m_current == 0)
+    {
+        m_check_file = fopen(m_check_file_name.c_str(), "r");
+        m_check_compare = m_check_file != NULL;
+        if (!m_check_compare)
+            m_check_file = fopen(m_check_file_name.c_str(), "w");
+        if (!m_check_file)
+        {
+            Log::fatal("History", "Can't open '%s'.",
+                       m_check_file_name.c_str());
+        }
+        Log::info("History", "%s kart transforms %s '%s'.",
+                  m_check_compare ? "Comparing" : "Writing",
+                  m_check_compare ? "with" : "to", m_check_file_name.c_str());
+        m_check_mismatches = 0;
+    }
+
+    World *world = World::getWorld();
+    for (unsigned int k = 0; k < world->getNumKarts(); k++)
+    {
+        const btTransform &t = world->getKart(k)->getTrans();
+        const btQuaternion q = t.getRotation();
+        float v[7] = { t.getOrigin().getX(), t.getOrigin().getY(),
+                       t.getOrigin().getZ(), q.getX(), q.getY(), q.getZ(),
+                       q.getW() };
+        if (!m_check_compare)
+        {
+            // %a is exact, so the transforms can be compared bit by bit
+            fprintf(m_check_file, "%d %d %a %a %a %a %a %a %a\n",
+                    m_current, k, v[0], v[1], v[2], v[3], v[4], v[5], v[6]);
+            continue;
+        }
+        char s[1024];
+        int frame = -1, kart = -1;
+        float r[7];
+        if (fgets(s, 1023, m_check_file) == NULL ||
+            sscanf(s, "%d %d %a %a %a %a %a %a %a", &frame, &kart,
+                   &r[0], &r[1], &r[2], &r[3], &r[4], &r[5], &r[6]) != 9 ||
+            frame != m_current || kart != (int)k)
+        {
+            Log::fatal("History", "'%s' does not match this replay (frame "
+                       "%d, kart %d).", m_check_file_name.c_str(), m_current,
+                       k);
+        }
+        if (memcmp(v, r, sizeof(v)) != 0)
+        {
+            // Only the first difference is detailed, the others follow
+            if (m_check_mismatches == 0)
+            {
+                Log::error("History", "Frame %d, kart %d differs: "
+                           "position (%f %f %f) instead of (%f %f %f).",
+                           m_current, k, v[0], v[1], v[2], r[0], r[1], r[2]);
+            }
+            m_check_mismatches++;
+        }
+    }   // for k
+}   // checkFrame
+
+//-----------------------------------------------------------------------------
+/** Reports the result of the determinism check at the end of the replay,
+ *  and leaves the main loop. main() then returns 1 if the replay was not
+ *  deterministic, see isDeterminismCheckFailed().
+ */
+void History::finishCheck()
+{
+    if (m_check_file)
+    {
+        fclose(m_check_file);
+        m_check_file = NULL;
+    }
+    main_loop->abort();
+    if (!m_check_compare)
+    {
+        Log::info("History", "Kart transforms written to '%s'.",
+                  m_check_file_name.c_str());
+    }
+    else if (m_check_mismatches == 0)
+    {
+        Log::info("History", "Replay is deterministic, all kart transforms "
+                  "match '%s'.", m_check_file_name.c_str());
+    }
+    else
+    {
+        Log::error("History", "Replay is not deterministic, %d kart "
+                   "transforms differ from '%s'.", m_check_mismatches,
+                   m_check_file_name.c_str());
+    }
+}   // finishCheck
+
 //-----------------------------------------------------------------------------
 /** Saves the history stored in the internal data structures into a file called
  *  history.dat.
@@ -338,6 +447,11 @@ void History::Load()
     }   // for k
     RewindManager::setEnable(rewind_manager_was_enabled);
 
+    // Random events (e.g. the collected powerups) must be the same in all
+    // runs of a determinism check
+    if (!m_check_file_name.empty())
+        srand(0);
+
     fprintf(fd, "History file end.\n");
     fclose(fd);
 }   // Load
@@ -19,6 +19,7 @@
 #ifndef HEADER_HISTORY_HPP
 #define HEADER_HISTORY_HPP
 
+#include <stdio.h>
 #include <vector>
 #include <string>
 
@@ -76,7 +77,22 @@ private:
     /** The identities of the karts to use. */
     std::vector<std::string>  m_kart_ident;
 
+    /** Name of the file used to check the determinism of a physics replay,
+     *  empty if not checked. See setDeterminismCheck(). */
+    std::string               m_check_file_name;
+
+    /** The open check file while a replay is checked. */
+    FILE                     *m_check_file;
+
+    /** True if the check file is compared with, false if it is written. */
+    bool                      m_check_compare;
+
+    /** Number of kart transforms which differ from the check file. */
+    int                       m_check_mismatches;
+
     void  allocateMemory(int number_of_frames);
+    void  checkFrame();
+    void  finishCheck();
 public:
           History        ();
     void  startReplay    ();
@@ -99,6 +115,16 @@ public:
     /** Enable replaying a history, enabled from the command line. */
     void  doReplayHistory(HistoryReplayMode m) {m_replay_mode = m;           }
     // ------------------------------------------------------------------------
+    /** Checks that a physics replay gives the same result in each run, see
+     *  checkFrame(). Enabled from the command line. */
+    void  setDeterminismCheck(const std::string &file_name)
+    {
+        m_check_file_name = file_name;
+    }   // setDeterminismCheck
+    // ------------------------------------------------------------------------
+    /** Returns true if a checked replay differed from the check file. */
+    bool  isDeterminismCheckFailed() const { return m_check_mismatches > 0; }
+    // ------------------------------------------------------------------------
     /** Returns true if the physics should not be simulated in replay mode.
      *  I.e. either no replay mode, or physics replay mode. */
     bool dontDoPhysics   () const { return m_replay_mode == HISTORY_POSITION;}
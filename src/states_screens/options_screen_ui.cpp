@@ -342,6 +342,7 @@ void OptionsScreenUI::eventCallback(Widget* widget, const std::string& name, con
 
         font_manager->getFont<BoldFace>()->reset();
         font_manager->getFont<RegularFace>()->reset();
+        font_manager->prewarmFonts();
         GUIEngine::getFont()->updateRTL();
         GUIEngine::getTitleFont()->updateRTL();
         GUIEngine::getSmallFont()->updateRTL();
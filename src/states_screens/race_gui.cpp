@@ -209,6 +209,8 @@ void RaceGUI::renderGlobal(float dt)
 
     World *world = World::getWorld();
     assert(world != NULL);
+    // The glyphs of the messages are drawn with a few draw calls
+    beginSpriteBatch();
     if(world->getPhase() >= WorldStatus::READY_PHASE &&
        world->getPhase() <= WorldStatus::GO_PHASE      )
     {
@@ -217,6 +219,7 @@ void RaceGUI::renderGlobal(float dt)
 
     if(world->getPhase() == World::GOAL_PHASE)
             drawGlobalGoal();
+    endSpriteBatch();
     // Timer etc. are not displayed unless the game is actually started.
 	if (!world->isRacePhase())
 	{
@@ -447,6 +450,7 @@ void RaceGUI::drawGlobalMiniMap()
     core::rect<s32> dest(m_map_left, upper_y,
                          m_map_left + m_map_width, lower_y);
 
+    beginSpriteBatch();
     track->drawMiniMap(dest);
 
     World *world = World::getWorld();
@@ -493,6 +497,7 @@ void RaceGUI::drawGlobalMiniMap()
                                  lower_y   -(int)(draw_at.getY()-(m_minimap_player_size/2.5f)));
         draw2DImage(icon, position, source, NULL, NULL, true);
     }
+    endSpriteBatch();
 #endif
 }   // drawGlobalMiniMap
 
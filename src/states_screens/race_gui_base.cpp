@@ -29,6 +29,7 @@
 #include "graphics/material.hpp"
 #include "graphics/material_manager.hpp"
 #include "graphics/referee.hpp"
+#include "graphics/sprite_batch.hpp"
 #include "guiengine/scalable_font.hpp"
 #include "io/file_manager.hpp"
 #include "items/attachment_manager.hpp"
@@ -101,6 +102,11 @@ RaceGUIBase::RaceGUIBase()
 
     m_referee               = NULL;
     m_multitouch_gui        = NULL;
+    m_sprite_batch          = NULL;
+#ifndef SERVER_ONLY
+    if (CVS->isGLSL())
+        m_sprite_batch      = new SpriteBatch();
+#endif
 
 
 	frame_count = 0;
@@ -197,8 +203,33 @@ RaceGUIBase::~RaceGUIBase()
     // If the referee is currently being shown,
     // remove it from the scene graph.
     delete m_referee;
+#ifndef SERVER_ONLY
+    delete m_sprite_batch;
+#endif
 }   // ~RaceGUIBase
 
+//-----------------------------------------------------------------------------
+/** Starts collecting the 2D images drawn by the gui (icons and text) into
+ *  the sprite batch, until the matching endSpriteBatch().
+ */
+void RaceGUIBase::beginSpriteBatch()
+{
+#ifndef SERVER_ONLY
+    if (m_sprite_batch)
+        m_sprite_batch->begin();
+#endif
+}   // beginSpriteBatch
+
+//-----------------------------------------------------------------------------
+/** Draws the 2D images collected since beginSpriteBatch(). */
+void RaceGUIBase::endSpriteBatch()
+{
+#ifndef SERVER_ONLY
+    if (m_sprite_batch)
+        m_sprite_batch->end();
+#endif
+}   // endSpriteBatch
+
 //-----------------------------------------------------------------------------
 /** Creates the 2D vertices for a regular polygon. Adopted from Irrlicht.
  *  \param n Number of vertices to use.
@@ -474,7 +505,9 @@ void RaceGUIBase::renderPlayerView(const Camera *camera, float dt)
     
     if (m_multitouch_gui != NULL)
     {
+        beginSpriteBatch();
         m_multitouch_gui->drawMultitouchSteering(kart, viewport, scaling);
+        endSpriteBatch();
     }
 }   // renderPlayerView
 
@@ -673,6 +706,7 @@ void RaceGUIBase::drawGlobalPlayerIcons(int bottom_margin)
     if(minor_mode == RaceManager::MINOR_MODE_SOCCER)
         return;
 
+    beginSpriteBatch();
     int x_base = 10;
     int y_base = 20;
     unsigned int y_space = irr_driver->getActualScreenSize().Height - bottom_margin - y_base;
@@ -981,6 +1015,7 @@ void RaceGUIBase::drawGlobalPlayerIcons(int bottom_margin)
         }
 
     } //next position
+    endSpriteBatch();
 #endif
 }   // drawGlobalPlayerIcons
 
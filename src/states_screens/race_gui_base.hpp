@@ -40,6 +40,7 @@ class Camera;
 class Material;
 class Referee;
 class RaceGUIMultitouch;
+class SpriteBatch;
 
 /**
   * \brief An abstract base class for the two race guis (race_gui and
@@ -181,6 +182,12 @@ protected:
     
     RaceGUIMultitouch* m_multitouch_gui;
 
+    /** Collects the icons and text of the gui to draw them with few draw
+     *  calls, NULL without shaders. */
+    SpriteBatch      *m_sprite_batch;
+
+    void beginSpriteBatch();
+    void endSpriteBatch();
     void cleanupMessages(const float dt);
     //void createMarkerTexture();
     void createRegularPolygon(unsigned int n, float radius,
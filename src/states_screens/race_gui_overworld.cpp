@@ -192,6 +192,9 @@ void RaceGUIOverworld::renderGlobal(float dt)
 
     World *world = World::getWorld();
     assert(world != NULL);
+    // The message glyphs, trophy icons, minimap and kart icons are drawn
+    // with a few draw calls
+    beginSpriteBatch();
     if(world->getPhase() >= WorldStatus::READY_PHASE &&
        world->getPhase() <= WorldStatus::GO_PHASE      )
     {
@@ -199,8 +202,11 @@ void RaceGUIOverworld::renderGlobal(float dt)
     }
 
     // Timer etc. are not displayed unless the game is actually started.
-    if(!world->isRacePhase()) return;
-    if (!m_enabled) return;
+    if(!world->isRacePhase() || !m_enabled)
+    {
+        endSpriteBatch();
+        return;
+    }
 
     if (m_multitouch_gui == NULL)
     {
@@ -211,6 +217,7 @@ void RaceGUIOverworld::renderGlobal(float dt)
     //irr_driver->getVideoDriver()->enableMaterial2D(false);
     drawGlobalMiniMap();
     //irr_driver->getVideoDriver()->enableMaterial2D();
+    endSpriteBatch();
 
     m_is_first_render_call = false;
 #endif
@@ -238,14 +245,14 @@ void RaceGUIOverworld::renderPlayerView(const Camera *camera, float dt)
 
     //Log::info("RaceGUIOverworld", "Scale: %f, %f", scaling.X, scaling.Y);
 
+    beginSpriteBatch();
     drawAllMessages     (kart, viewport, scaling);
 
-    if(!World::getWorld()->isRacePhase()) return;
-
-    if (m_multitouch_gui == NULL)
+    if(World::getWorld()->isRacePhase() && m_multitouch_gui == NULL)
     {
         drawPowerupIcons(kart, viewport, scaling);
     }
+    endSpriteBatch();
 }   // renderPlayerView
 
 //-----------------------------------------------------------------------------
@@ -114,6 +114,13 @@ public:
       m_fallback = fallback;
   }
 
+  /** Return the dictionary used for messages not found in this one, or
+      NULL. */
+  Dictionary* get_fallback() const
+  {
+      return m_has_fallback ? m_fallback : NULL;
+  }
+
   /** Iterate over all messages with a context, Func is of type:
       void func(const std::string& ctxt, const std::string& msgid, const std::vector<std::string>& msgstrs) */
   template<class Func>
@@ -120,40 +120,9 @@ DictionaryManager::get_dictionary(const Language& language)
 
     for (SearchPath::reverse_iterator p = search_path.rbegin(); p != search_path.rend(); ++p)
     {
-      std::vector<std::string> files = filesystem->open_directory(*p);
-
-      std::string best_filename = "";
-      int best_score = 0;
-
-      for(std::vector<std::string>::iterator filename = files.begin(); filename != files.end(); filename++)
-      {
-        // check if filename matches requested language
-        if (has_suffix(*filename, ".po"))
-        { // ignore anything that isn't a .po file
-
-          Language po_language = Language::from_env(convertFilename2Language(*filename));
-
-          if (!po_language)
-          {
-              Log::warn("tinygettext", "%s: warning: ignoring, unknown language",
-                         filename->c_str());
-          }
-          else
-          {
-            int score = Language::match(language, po_language);
-
-            if (score > best_score)
-            {
-              best_score = score;
-              best_filename = *filename;
-            }
-          }
-        }
-      }
-
-      if (!best_filename.empty())
+      std::string pofile = find_po_file(*p, language);
+      if (!pofile.empty())
       {
-        std::string pofile = *p + "/" + best_filename;
         try
         {
           std::unique_ptr<std::istream> in = filesystem->open_file(pofile);
@@ -184,6 +153,61 @@ DictionaryManager::get_dictionary(const Language& language)
   }
 }
 
+std::string
+DictionaryManager::find_po_file(const std::string& path, const Language& language)
+{
+  std::vector<std::string> files = filesystem->open_directory(path);
+
+  std::string best_filename = "";
+  int best_score = 0;
+
+  for(std::vector<std::string>::iterator filename = files.begin(); filename != files.end(); filename++)
+  {
+    // check if filename matches requested language
+    if (has_suffix(*filename, ".po"))
+    { // ignore anything that isn't a .po file
+
+      Language po_language = Language::from_env(convertFilename2Language(*filename));
+
+      if (!po_language)
+      {
+          Log::warn("tinygettext", "%s: warning: ignoring, unknown language",
+                     filename->c_str());
+      }
+      else
+      {
+        int score = Language::match(language, po_language);
+
+        if (score > best_score)
+        {
+          best_score = score;
+          best_filename = *filename;
+        }
+      }
+    }
+  }
+
+  if (best_filename.empty())
+    return "";
+  return path + "/" + best_filename;
+}
+
+void
+DictionaryManager::get_po_files(const Language& language,
+                                std::vector<std::string>* files)
+{
+  assert(language);
+  for (SearchPath::reverse_iterator p = search_path.rbegin(); p != search_path.rend(); ++p)
+  {
+    std::string pofile = find_po_file(*p, language);
+    if (!pofile.empty())
+      files->push_back(pofile);
+  }
+
+  if (language.get_country().size() > 0)
+    get_po_files(Language::from_spec(language.get_language()), files);
+}
+
 std::set<Language>
 DictionaryManager::get_languages()
 {
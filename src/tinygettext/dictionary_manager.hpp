@@ -55,6 +55,10 @@ private:
 
   void clear_cache();
 
+  /** Return the best matching .po file for \a language in \a path, or an
+      empty string if there is none */
+  std::string find_po_file(const std::string& path, const Language& language);
+
 #ifdef DEBUG
     unsigned int m_magic_number;
 #endif
@@ -86,6 +90,10 @@ public:
       added directories have higher priority then later added ones */
   void add_directory(const std::string& pathname);
 
+  /** Append the .po files get_dictionary() would parse for \a language
+      (including the files of its fallback language) to \a files */
+  void get_po_files(const Language& language, std::vector<std::string>* files);
+
   /** Return a set of the available languages in their country code */
   std::set<Language> get_languages();
 
@@ -253,6 +253,7 @@ void DriveGraph::load(const std::string &quad_file_name,
             m_lap_length = l;
     }
 
+    createSpatialIndex();
     loadBoundingBoxNodes();
 
 }   // load
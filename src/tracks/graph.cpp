@@ -30,6 +30,9 @@
 #include "tracks/track.hpp"
 #include "utils/log.hpp"
 
+#include <algorithm>
+#include <limits>
+
 const int Graph::UNKNOWN_SECTOR = -1;
 const float Graph::MIN_HEIGHT_TESTING = -1.0f;
 const float Graph::MAX_HEIGHT_TESTING = 5.0f;
@@ -45,6 +48,12 @@ Graph::Graph()
     m_bb_min      = Vec3( 99999,  99999,  99999);
     m_bb_max      = Vec3(-99999, -99999, -99999);
     memset(m_bb_nodes, 0, 4 * sizeof(int));
+    m_grid_min_x     = 0;
+    m_grid_min_z     = 0;
+    m_grid_cell_size = 1.0f;
+    m_grid_size_x    = 0;
+    m_grid_size_z    = 0;
+    m_has_3d_quads   = false;
 }  // Graph
 
 // -----------------------------------------------------------------------------
@@ -438,6 +447,42 @@ void Graph::findRoadSector(const Vec3& xyz, int *sector,
         return;
     }   // if still on same quad
 
+    // Without a list of sectors to test use the spatial index: only the
+    // quads overlapping the grid cell of xyz need to be tested. They are
+    // tested in the same order as the linear search below (starting after
+    // the current sector), so the result is identical even if quads
+    // overlap (e.g. on shortcuts).
+    if (!all_sectors && !m_grid.empty())
+    {
+        const int start = *sector==UNKNOWN_SECTOR ||
+                          *sector==(int)m_all_nodes.size()-1 ? 0 : *sector+1;
+        *sector = UNKNOWN_SECTOR;
+        // Unbounded quads are contained in all cells, and are the only ones
+        // which need testing outside of the grid.
+        int cell_x, cell_z;
+        const std::vector<int> *candidates =
+            getGridCell(xyz, &cell_x, &cell_z)
+            ? &m_grid[cell_z*m_grid_size_x + cell_x]
+            : &m_unbounded_quads;
+        if (candidates->empty())
+            return;
+
+        const unsigned int count = (unsigned int)candidates->size();
+        const unsigned int first = (unsigned int)
+            (std::lower_bound(candidates->begin(), candidates->end(), start)
+             - candidates->begin());
+        for (unsigned int i = 0; i < count; i++)
+        {
+            const int indx = (*candidates)[(first + i) % count];
+            if (getQuad(indx)->pointInside(xyz, ignore_vertical))
+            {
+                *sector = indx;
+                return;
+            }
+        }
+        return;
+    }   // if spatial index
+
     // Now we search through all quads, starting with
     // the current one
     int indx       = *sector;
@@ -528,6 +573,34 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
         if(current_sector<0) current_sector += getNumNodes();
     }
 
+    // Use the spatial index to only test the quads close to xyz. This gives
+    // the same result (including ties) as the full search below, which is
+    // only used if the index can not determine the result.
+    int cell_x, cell_z;
+    if (!all_sectors && getGridCell(xyz, &cell_x, &cell_z))
+    {
+        // If no quad at all can fulfill the height condition the result
+        // is the closest quad independent of height (second phase below).
+        bool height_test = !ignore_vertical;
+        if (height_test && !m_has_3d_quads)
+        {
+            // Quads with dist = y - min_height in (-1, 5), with some
+            // tolerance for rounding errors.
+            std::vector<float>::const_iterator i =
+                std::lower_bound(m_sorted_min_heights.begin(),
+                                 m_sorted_min_heights.end(),
+                                 xyz.getY() - 5.01f);
+            height_test = i != m_sorted_min_heights.end() &&
+                          *i < xyz.getY() + 1.01f;
+        }
+        const int first = current_sector+1 == (int)getNumNodes()
+                        ? 0 : current_sector+1;
+        const int sector = findOutOfRoadSectorInGrid(xyz, cell_x, cell_z,
+                                                     first, height_test);
+        if (sector != UNKNOWN_SECTOR)
+            return sector;
+    }
+
     int   min_sector = UNKNOWN_SECTOR;
     float min_dist_2 = 999999.0f*999999.0f;
 
@@ -585,6 +658,259 @@ int Graph::findOutOfRoadSector(const Vec3& xyz, const int curr_sector,
     return min_sector;
 }   // findOutOfRoadSector
 
+//-----------------------------------------------------------------------------
+/** Finds the closest quad for findOutOfRoadSector using the grid. The grid
+ *  is searched in rings of cells around the cell of the point, until no
+ *  quad outside of the searched area can be closer than the closest quad
+ *  found. Of several quads with the same distance the one that comes first
+ *  in the order in which findOutOfRoadSector tests the quads is returned.
+ *  \param xyz The point to search for.
+ *  \param cell_x, cell_z The grid cell containing xyz.
+ *  \param first The quad findOutOfRoadSector would test first.
+ *  \param height_test If the height condition should be used. This must
+ *         only be false if the condition is ignored, or if no quad at all
+ *         fulfills it (i.e. the second phase of findOutOfRoadSector).
+ *  \return The closest quad, or UNKNOWN_SECTOR if the grid search was
+ *          aborted or no quad was found, in which case all quads must be
+ *          tested.
+ */
+int Graph::findOutOfRoadSectorInGrid(const Vec3 &xyz, int cell_x, int cell_z,
+                                     int first, bool height_test) const
+{
+    const int n = getNumNodes();
+    // Quads are contained in several cells, so if a large part of the
+    // grid needs to be searched, testing all quads is faster.
+    const int max_tests = n / 4;
+    int   tests      = 0;
+    int   min_sector = UNKNOWN_SECTOR;
+    int   min_order  = -1;
+    float min_dist_2 = 999999.0f*999999.0f;
+    for (int r = 0; ; r++)
+    {
+        for (int z = cell_z - r; z <= cell_z + r; z++)
+        {
+            if (z < 0 || z >= m_grid_size_z) continue;
+            // Only the first and last row of a ring contain all cells
+            const int step = (z == cell_z - r || z == cell_z + r)
+                           ? 1 : std::max(2 * r, 1);
+            for (int x = cell_x - r; x <= cell_x + r; x += step)
+            {
+                if (x < 0 || x >= m_grid_size_x) continue;
+                const std::vector<int> &cell = m_grid[z*m_grid_size_x + x];
+                tests += (int)cell.size();
+                for (unsigned int i = 0; i < cell.size(); i++)
+                {
+                    const Quad *q = m_all_nodes[cell[i]];
+                    if (q->isIgnored())
+                        continue;
+                    const float dist_2 = q->getDistance2FromPoint(xyz);
+                    if (dist_2 > min_dist_2)
+                        continue;
+                    // Position of this quad in the test order
+                    const int order = cell[i] >= first ? cell[i] - first
+                                                       : cell[i] - first + n;
+                    if (dist_2 == min_dist_2 && order >= min_order)
+                        continue;
+                    const float dist = xyz.getY() - q->getMinHeight();
+                    if ((dist < 5.0f && dist > -1.0f) || q->is3DQuad() ||
+                        !height_test)
+                    {
+                        min_dist_2 = dist_2;
+                        min_sector = cell[i];
+                        min_order  = order;
+                    }
+                }   // for i < cell.size()
+            }   // for x
+        }   // for z
+
+        // Compute the minimum distance from xyz to any cell not yet tested
+        const float infinity = std::numeric_limits<float>::max();
+        float d = infinity;
+        if (cell_x - r > 0)
+            d = std::min(d, xyz.getX() - (m_grid_min_x +
+                                          (cell_x - r) * m_grid_cell_size));
+        if (cell_x + r + 1 < m_grid_size_x)
+            d = std::min(d, m_grid_min_x + (cell_x + r + 1) * m_grid_cell_size
+                            - xyz.getX());
+        if (cell_z - r > 0)
+            d = std::min(d, xyz.getZ() - (m_grid_min_z +
+                                          (cell_z - r) * m_grid_cell_size));
+        if (cell_z + r + 1 < m_grid_size_z)
+            d = std::min(d, m_grid_min_z + (cell_z + r + 1) * m_grid_cell_size
+                            - xyz.getZ());
+        // All cells tested
+        if (d == infinity)
+            return min_sector;
+        // Allow for some rounding errors in the distance computations
+        if (min_sector != UNKNOWN_SECTOR && d > 0 &&
+            d * d > min_dist_2 * 1.001f + 0.001f)
+            return min_sector;
+        if (tests > max_tests)
+            return UNKNOWN_SECTOR;
+    }   // for r
+}   // findOutOfRoadSectorInGrid
+
+//-----------------------------------------------------------------------------
+/** Computes the grid cell which contains the given point.
+ *  \param xyz The point.
+ *  \param cell_x, cell_z On return the grid cell.
+ *  \return False if there is no spatial index, or the point is outside of
+ *          the grid.
+ */
+bool Graph::getGridCell(const Vec3 &xyz, int *cell_x, int *cell_z) const
+{
+    if (m_grid.empty())
+        return false;
+    float x = (xyz.getX() - m_grid_min_x) / m_grid_cell_size;
+    float z = (xyz.getZ() - m_grid_min_z) / m_grid_cell_size;
+    // This also rejects NAN coordinates
+    if (!(x >= 0.0f && z >= 0.0f && x < (float)m_grid_size_x &&
+          z < (float)m_grid_size_z))
+        return false;
+    *cell_x = std::min((int)x, m_grid_size_x - 1);
+    *cell_z = std::min((int)z, m_grid_size_z - 1);
+    return true;
+}   // getGridCell
+
+//-----------------------------------------------------------------------------
+/** Creates a uniform 2d grid over all quads, which is used to speed up
+ *  findRoadSector and findOutOfRoadSector. Each quad is added to all cells
+ *  overlapped by its 2d bounding box. This must be called after all quads
+ *  have been created.
+ */
+void Graph::createSpatialIndex()
+{
+    m_grid.clear();
+    m_unbounded_quads.clear();
+    const unsigned int num_nodes = (unsigned int)m_all_nodes.size();
+    if (num_nodes == 0)
+        return;
+
+    // A small margin so that rounding errors in pointInside can not cause
+    // a point on the border of a quad to be outside of its bounding box.
+    const Vec3 margin(0.01f, 0.0f, 0.01f);
+
+    std::vector<Vec3> quad_min(num_nodes), quad_max(num_nodes);
+    Vec3 grid_min = (*m_all_nodes[0])[0];
+    Vec3 grid_max = grid_min;
+    float total_size = 0;
+    for (unsigned int i = 0; i < num_nodes; i++)
+    {
+        const Quad &q = *m_all_nodes[i];
+        Vec3 min = q[0], max = q[0];
+        for (unsigned int j = 0; j < 4; j++)
+        {
+            min.min(q[j]);
+            max.max(q[j]);
+            // 3d quads test against a box along the normal (see
+            // BoundingBox3D), which must be completely contained.
+            if (q.is3DQuad())
+            {
+                min.min(q[j] + 5.0f * q.getNormal());
+                min.min(q[j] - 1.0f * q.getNormal());
+                max.max(q[j] + 5.0f * q.getNormal());
+                max.max(q[j] - 1.0f * q.getNormal());
+            }
+        }
+        min -= margin;
+        max += margin;
+        quad_min[i] = min;
+        quad_max[i] = max;
+        grid_min.min(min);
+        grid_max.max(max);
+        total_size += std::max(max.getX() - min.getX(),
+                               max.getZ() - min.getZ());
+
+        // A 2d quad is tested as two triangles (0,1,2) and (2,3,0) using
+        // the half planes of their sides. This only restricts a point to
+        // the triangle if it has the expected orientation, which is tested
+        // using the centre of each triangle. Otherwise pointInside can be
+        // true outside of the bounding box, so this quad is always tested.
+        if (!q.is3DQuad())
+        {
+            const Vec3 c1 = (q[0] + q[1] + q[2]) * (1.0f / 3.0f);
+            const Vec3 c2 = (q[2] + q[3] + q[0]) * (1.0f / 3.0f);
+            if (!(c1.sideOfLine2D(q[0], q[2]) <  0 &&
+                  c1.sideOfLine2D(q[0], q[1]) >  0 &&
+                  c1.sideOfLine2D(q[1], q[2]) >  0 &&
+                  c2.sideOfLine2D(q[0], q[2]) >  0 &&
+                  c2.sideOfLine2D(q[2], q[3]) >  0 &&
+                  c2.sideOfLine2D(q[3], q[0]) >  0    ))
+                m_unbounded_quads.push_back(i);
+        }
+    }   // for i < num_nodes
+
+    m_has_3d_quads = false;
+    m_sorted_min_heights.clear();
+    for (unsigned int i = 0; i < num_nodes; i++)
+    {
+        const Quad *q = m_all_nodes[i];
+        if (q->isIgnored())
+            continue;
+        if (q->is3DQuad())
+            m_has_3d_quads = true;
+        else
+            m_sorted_min_heights.push_back(q->getMinHeight());
+    }
+    std::sort(m_sorted_min_heights.begin(), m_sorted_min_heights.end());
+
+    // Unbounded quads are added to every cell. If there are too many of
+    // them (e.g. a graph with incorrectly oriented quads) the index would
+    // not help, so don't create it.
+    if (m_unbounded_quads.size() > num_nodes / 4)
+    {
+        Log::warn("Graph", "%d of %d quads can not be bounded, no spatial "
+                  "index created.", (int)m_unbounded_quads.size(), num_nodes);
+        m_unbounded_quads.clear();
+        return;
+    }
+
+    // Use the average quad size as cell size, but limit the overall
+    // number of cells.
+    const int MAX_CELLS = 256 * 256;
+    m_grid_cell_size = std::max(total_size / num_nodes, 1.0f);
+    m_grid_min_x     = grid_min.getX();
+    m_grid_min_z     = grid_min.getZ();
+    while (true)
+    {
+        m_grid_size_x = (int)((grid_max.getX() - m_grid_min_x)
+                              / m_grid_cell_size) + 1;
+        m_grid_size_z = (int)((grid_max.getZ() - m_grid_min_z)
+                              / m_grid_cell_size) + 1;
+        if (m_grid_size_x * m_grid_size_z <= MAX_CELLS)
+            break;
+        m_grid_cell_size *= 2.0f;
+    }
+
+    m_grid.resize(m_grid_size_x * m_grid_size_z);
+    unsigned int next_unbounded = 0;
+    for (unsigned int i = 0; i < num_nodes; i++)
+    {
+        int min_x = 0, min_z = 0;
+        int max_x = m_grid_size_x - 1, max_z = m_grid_size_z - 1;
+        if (next_unbounded < m_unbounded_quads.size() &&
+            m_unbounded_quads[next_unbounded] == (int)i)
+        {
+            next_unbounded++;
+        }
+        else
+        {
+            getGridCell(quad_min[i], &min_x, &min_z);
+            getGridCell(quad_max[i], &max_x, &max_z);
+        }
+        // Since quads are added in order, each cell is sorted.
+        for (int z = min_z; z <= max_z; z++)
+        {
+            for (int x = min_x; x <= max_x; x++)
+                m_grid[z*m_grid_size_x + x].push_back(i);
+        }
+    }   // for i < num_nodes
+
+    Log::debug("Graph", "Created %dx%d grid, cell size %f, %d unbounded "
+               "quads.", m_grid_size_x, m_grid_size_z, m_grid_cell_size,
+               (int)m_unbounded_quads.size());
+}   // createSpatialIndex
+
 //-----------------------------------------------------------------------------
 void Graph::loadBoundingBoxNodes()
 {
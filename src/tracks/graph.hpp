@@ -66,6 +66,8 @@ protected:
     // ------------------------------------------------------------------------
     /** Map 4 bounding box points to 4 closest graph nodes. */
     void loadBoundingBoxNodes();
+    // ------------------------------------------------------------------------
+    void createSpatialIndex();
 
 private:
     /** The 2d bounding box, used for hashing. */
@@ -75,6 +77,35 @@ private:
     /** The 4 closest graph nodes to the bounding box. */
     int m_bb_nodes[4];
 
+    /** A uniform 2d (x/z) grid over all quads, used to speed up
+     *  findRoadSector and findOutOfRoadSector. Each cell contains the
+     *  sorted indices of all quads whose 2d bounding box overlaps the
+     *  cell. Empty if no index was created. */
+    std::vector<std::vector<int> > m_grid;
+
+    /** Minimum x and z coordinate covered by the grid. */
+    float m_grid_min_x, m_grid_min_z;
+
+    /** Size of a grid cell. */
+    float m_grid_cell_size;
+
+    /** Number of grid cells in x and z direction. */
+    int m_grid_size_x, m_grid_size_z;
+
+    /** Sorted indices of quads for which pointInside can be true outside
+     *  of their bounding box (e.g. degenerated quads). These quads are
+     *  contained in every grid cell, and are also tested for points
+     *  outside of the grid. */
+    std::vector<int> m_unbounded_quads;
+
+    /** Sorted minimum heights of all 2d quads which are not ignored. Used
+     *  to quickly test if any quad can fulfill the height condition in
+     *  findOutOfRoadSector. */
+    std::vector<float> m_sorted_min_heights;
+
+    /** True if the graph contains 3d quads which are not ignored. */
+    bool m_has_3d_quads;
+
     /** The node of the graph mesh. */
     scene::ISceneNode *m_node;
 
@@ -97,6 +128,11 @@ private:
     // ------------------------------------------------------------------------
     void cleanupDebugMesh();
     // ------------------------------------------------------------------------
+    bool getGridCell(const Vec3 &xyz, int *cell_x, int *cell_z) const;
+    // ------------------------------------------------------------------------
+    int  findOutOfRoadSectorInGrid(const Vec3 &xyz, int cell_x, int cell_z,
+                                   int first, bool height_test) const;
+    // ------------------------------------------------------------------------
     virtual bool hasLapLine() const = 0;
     // ------------------------------------------------------------------------
     virtual void differentNodeColor(int n, video::SColor* c) const = 0;
@@ -66,6 +66,7 @@
 #include "utils/constants.hpp"
 #include "utils/log.hpp"
 #include "utils/string_utils.hpp"
+#include "utils/time.hpp"
 #include "utils/translation.hpp"
 
 #include <IBillboardTextSceneNode.h>
@@ -76,6 +77,7 @@
 #include <ISceneManager.h>
 #include <SMeshBuffer.h>
 
+#include <algorithm>
 #include <iostream>
 #include <stdexcept>
 #include <sstream>
@@ -151,6 +153,7 @@ Track::Track(const std::string &filename)
     m_startup_run           = false;
     m_default_number_of_laps = 3;
     m_all_nodes.clear();
+    m_main_track_count      = 0;
     m_static_physics_only_nodes.clear();
     m_all_cached_meshes.clear();
     loadTrackInfo();
@@ -308,6 +311,7 @@ void Track::cleanup()
         irr_driver->removeNode(m_all_nodes[i]);
     }
     m_all_nodes.clear();
+    m_main_track_count = 0;
 
     for (unsigned int i = 0; i < m_static_physics_only_nodes.size(); i++)
     {
@@ -1387,6 +1391,20 @@ bool Track::loadMainTrack(const XMLNode &root)
     scene_node->setMaterialFlag(video::EMF_LIGHTING, true);
     scene_node->setMaterialFlag(video::EMF_GOURAUD_SHADING, true);
 
+#ifndef SERVER_ONLY
+    // The physics of the main track model are created, so with the shared
+    // vertex buffers its geometry is only needed on the GPU from now on.
+    // A cached track keeps it, since it is uploaded again when reloaded.
+    if (CVS->isGLSL() && CVS->isARBBaseInstanceUsable() && !m_cache_track &&
+        UserConfigParams::m_free_track_mesh_data)
+    {
+        const size_t freed =
+            VAOManager::getInstance()->uploadAndFreeMesh(tangent_mesh);
+        Log::info("track", "Freed %d KB of mesh data of '%s' after upload.",
+                  (int)(freed / 1024), m_ident.c_str());
+    }
+#endif
+
     return true;
 }   // loadMainTrack
 
@@ -1585,6 +1603,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     // Use m_filename to also get the path, not only the identifier
     STKTexManager::getInstance()
         ->setTextureErrorMessage("While loading track '%s'", m_filename);
+    STKTexManager::getInstance()->beginLoadReport(m_ident);
     if(!m_reverse_available)
     {
         reverse_track = false;
@@ -1736,6 +1755,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     loadMainTrack(*root);
 
     unsigned int main_track_count = (unsigned int)m_all_nodes.size();
+    m_main_track_count = main_track_count;
 
     ModelDefinitionLoader model_def_loader(this);
 
@@ -1923,6 +1943,7 @@ void Track::loadTrackModel(bool reverse_track, unsigned int mode_id)
     }
 
     STKTexManager::getInstance()->unsetTextureErrorMessage();
+    STKTexManager::getInstance()->endLoadReport();
 #ifndef SERVER_ONLY
     if (CVS->isGLSL())
     {
@@ -2351,38 +2372,62 @@ void Track::itemCommand(const XMLNode *node)
 
 std::vector< std::vector<float> > Track::buildHeightMap()
 {
+    const double start_time = StkTime::getRealTime();
     std::vector< std::vector<float> > out(HEIGHT_MAP_RESOLUTION);
+    for (int i=0; i<HEIGHT_MAP_RESOLUTION; i++)
+        out[i].resize(HEIGHT_MAP_RESOLUTION);
 
-    float x = m_aabb_min.getX();
     const float x_len = m_aabb_max.getX() - m_aabb_min.getX();
     const float z_len = m_aabb_max.getZ() - m_aabb_min.getZ();
 
     const float x_step = x_len/HEIGHT_MAP_RESOLUTION;
     const float z_step = z_len/HEIGHT_MAP_RESOLUTION;
 
-    btVector3 hitpoint;
-    const Material* material;
-    btVector3 normal;
+    // The rays are cast in tiles of neighbouring columns, so that each
+    // batch is coherent and the rays can traverse the BVH together.
+    const int TILE_SIZE = 4;
+    btVector3 from[TILE_SIZE*TILE_SIZE], to[TILE_SIZE*TILE_SIZE];
+    TriangleMesh::RayHit hits[TILE_SIZE*TILE_SIZE];
 
-    for (int i=0; i<HEIGHT_MAP_RESOLUTION; i++)
+    for (int tile_i=0; tile_i<HEIGHT_MAP_RESOLUTION; tile_i+=TILE_SIZE)
     {
-        out[i].resize(HEIGHT_MAP_RESOLUTION);
-        float z = m_aabb_min.getZ();
-
-        for (int j=0; j<HEIGHT_MAP_RESOLUTION; j++)
+        const int end_i = std::min(tile_i+TILE_SIZE, HEIGHT_MAP_RESOLUTION);
+        for (int tile_j=0; tile_j<HEIGHT_MAP_RESOLUTION; tile_j+=TILE_SIZE)
         {
-            btVector3 pos(x, 100.0f, z);
-            btVector3 to = pos;
-            to.setY(-100000.f);
-
-            m_track_mesh->castRay(pos, to, &hitpoint, &material, &normal);
-            z += z_step;
-
-            out[i][j] = hitpoint.getY();
-        }   // j<HEIGHT_MAP_RESOLUTION
-        x += x_step;
-    }
+            const int end_j = std::min(tile_j+TILE_SIZE,
+                                       HEIGHT_MAP_RESOLUTION);
+            unsigned int n = 0;
+            for (int i=tile_i; i<end_i; i++)
+            {
+                const float x = m_aabb_min.getX() + i*x_step;
+                for (int j=tile_j; j<end_j; j++)
+                {
+                    const float z = m_aabb_min.getZ() + j*z_step;
+                    from[n] = btVector3(x, 100.0f, z);
+                    to[n]   = btVector3(x, -100000.0f, z);
+                    n++;
+                }
+            }
+            m_track_mesh->castRays(n, from, to, hits);
 
+            n = 0;
+            for (int i=tile_i; i<end_i; i++)
+            {
+                for (int j=tile_j; j<end_j; j++, n++)
+                {
+                    out[i][j] = hits[n].m_hit ? hits[n].m_xyz.getY()
+                                              : m_aabb_min.getY();
+                }
+            }
+        }   // for tile_j
+    }   // for tile_i
+
+    const double duration = StkTime::getRealTime() - start_time;
+    Log::debug("Track", "Height map: %d rays in %f ms (%f rays/s).",
+               HEIGHT_MAP_RESOLUTION*HEIGHT_MAP_RESOLUTION, duration*1000.0,
+               duration > 0 ? HEIGHT_MAP_RESOLUTION*HEIGHT_MAP_RESOLUTION
+                              / duration
+                            : 0.0);
     return out;
 }   // buildHeightMap
 
@@ -140,6 +140,10 @@ private:
     /** The list of all nodes. */
     std::vector<scene::ISceneNode*> m_all_nodes;
 
+    /** Number of nodes at the start of m_all_nodes which belong to the
+     *  main track model, i.e. which never move. */
+    unsigned int m_main_track_count;
+
     /** The list of all nodes that are to be converted into physics,
      *  but not to be drawn (e.g. invisible walls). */
     std::vector<scene::ISceneNode*> m_static_physics_only_nodes;
@@ -652,6 +656,13 @@ public:
     // ------------------------------------------------------------------------
     void addNode(scene::ISceneNode* node) { m_all_nodes.push_back(node); }
     // ------------------------------------------------------------------------
+    /** Returns the scene nodes of the main track model, which never move. */
+    std::vector<scene::ISceneNode*> getMainTrackNodes() const
+    {
+        return std::vector<scene::ISceneNode*>(m_all_nodes.begin(),
+                                     m_all_nodes.begin() + m_main_track_count);
+    }   // getMainTrackNodes
+    // ------------------------------------------------------------------------
     void addPhysicsOnlyNode(scene::ISceneNode* node)
     {
         m_object_physics_only_nodes.push_back(node);
@@ -20,6 +20,7 @@
 
 #include "animations/ipo.hpp"
 #include "animations/three_d_animation.hpp"
+#include "config/user_config.hpp"
 #include "graphics/lod_node.hpp"
 #include "graphics/material_manager.hpp"
 #include "io/xml_node.hpp"
@@ -70,7 +71,17 @@ void TrackObjectManager::init()
     {
         curr->onWorldReady();
     }
-}   // reset
+
+    m_animation_batch.clear();
+    if (UserConfigParams::m_batched_animations)
+    {
+        for (TrackObject* curr : m_all_objects)
+        {
+            if (curr->getAnimator())
+                m_animation_batch.add(curr->getAnimator());
+        }
+    }
+}   // init
 // ----------------------------------------------------------------------------
 /** Initialises all track objects.
  */
@@ -148,6 +159,7 @@ void TrackObjectManager::update(float dt)
     {
         curr->update(dt);
     }
+    m_animation_batch.update(dt);
 }   // update
 
 // ----------------------------------------------------------------------------
@@ -284,6 +296,8 @@ void TrackObjectManager::insertObject(TrackObject* object)
  */
 void TrackObjectManager::removeObject(TrackObject* obj)
 {
+    if (obj->getAnimator())
+        m_animation_batch.remove(obj->getAnimator());
     m_all_objects.remove(obj);
     delete obj;
 }   // removeObject
@@ -19,6 +19,7 @@
 #ifndef HEADER_TRACK_OBJECT_MANAGER_HPP
 #define HEADER_TRACK_OBJECT_MANAGER_HPP
 
+#include "animations/animation_batch.hpp"
 #include "physics/physical_object.hpp"
 #include "tracks/track_object.hpp"
 #include "utils/ptr_vector.hpp"
@@ -51,6 +52,10 @@ protected:
     /** A second list which holds all objects that karts can drive on. */
     PtrVector<TrackObject, REF> m_driveable_objects;
 
+    /** Evaluates the animations of all objects loaded with the track.
+     *  Objects inserted later (e.g. by scripts) are updated individually. */
+    AnimationBatch m_animation_batch;
+
 public:
          TrackObjectManager();
         ~TrackObjectManager();
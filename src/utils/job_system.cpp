@@ -0,0 +1,166 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/job_system.hpp"
+
+#include "utils/log.hpp"
+
+#include <algorithm>
+#include <assert.h>
+
+JobSystem *JobSystem::m_job_system = NULL;
+
+namespace
+{
+    /** True for the worker threads and while a thread executes jobs, used
+     *  to run nested parallelFor() calls serially. */
+    thread_local bool g_in_job = false;
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Creates the job system.
+ *  \param num_threads Total number of threads including the main thread,
+ *         0 to select the number depending on the number of cores.
+ */
+void JobSystem::create(int num_threads)
+{
+    assert(!m_job_system);
+    if (num_threads <= 0)
+    {
+        num_threads = (int)std::thread::hardware_concurrency();
+        num_threads = std::max(1, std::min(num_threads, 8));
+    }
+    m_job_system = new JobSystem(num_threads);
+    Log::info("JobSystem", "Using %d thread(s) for parallel jobs.",
+              num_threads);
+}   // create
+
+// ----------------------------------------------------------------------------
+/** Starts the worker threads.
+ *  \param num_threads Total number of threads including the calling thread.
+ */
+JobSystem::JobSystem(unsigned int num_threads)
+{
+    m_job            = NULL;
+    m_count          = 0;
+    m_next_index     = 0;
+    m_generation     = 0;
+    m_active_workers = 0;
+    m_abort          = false;
+    for (unsigned int i = 1; i < num_threads; i++)
+        m_workers.push_back(std::thread(&JobSystem::workerThread, this));
+}   // JobSystem
+
+// ----------------------------------------------------------------------------
+JobSystem::~JobSystem()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_abort = true;
+    }
+    m_cv_start.notify_all();
+    for (unsigned int i = 0; i < m_workers.size(); i++)
+        m_workers[i].join();
+}   // ~JobSystem
+
+// ----------------------------------------------------------------------------
+/** Main loop of a worker thread: waits for a new range of jobs, takes part
+ *  in executing it, and reports when it is done. */
+void JobSystem::workerThread()
+{
+    g_in_job = true;
+    unsigned int generation = 0;
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_cv_start.wait(lock, [this, generation]()
+                {
+                    return m_abort || m_generation != generation;
+                });
+            if (m_abort)
+                return;
+            generation = m_generation;
+        }
+        runJobs();
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_active_workers--;
+        if (m_active_workers == 0)
+            m_cv_done.notify_one();
+    }
+}   // workerThread
+
+// ----------------------------------------------------------------------------
+/** Executes jobs of the current range until all indices are taken. */
+void JobSystem::runJobs()
+{
+    while (true)
+    {
+        const unsigned int index = m_next_index.fetch_add(1);
+        if (index >= m_count)
+            return;
+        (*m_job)(index);
+    }
+}   // runJobs
+
+// ----------------------------------------------------------------------------
+/** Calls job(i) for all i in [0, count) using all threads of the job
+ *  system, and returns when all calls are finished. The order in which the
+ *  indices are processed is undefined.
+ *  \param count Number of indices.
+ *  \param job The function to call for each index.
+ *  \param caller_job Optional function which is executed by the calling
+ *         thread before it takes part in the jobs. It runs concurrently to
+ *         the jobs, parallelFor() calls from it are executed serially.
+ */
+void JobSystem::parallelFor(unsigned int count,
+                            const std::function<void(unsigned int)> &job,
+                            const std::function<void()> &caller_job)
+{
+    if (count == 0 || count == 1 || m_workers.empty() || g_in_job)
+    {
+        if (caller_job)
+            caller_job();
+        for (unsigned int i = 0; i < count; i++)
+            job(i);
+        return;
+    }
+
+    std::lock_guard<std::mutex> parallel_for_lock(m_parallel_for_mutex);
+    {
+        // All workers have finished the previous range (see below), so
+        // nobody accesses m_job, m_count or m_next_index at this stage.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job            = &job;
+        m_count          = count;
+        m_next_index     = 0;
+        m_active_workers = (unsigned int)m_workers.size();
+        m_generation++;
+    }
+    m_cv_start.notify_all();
+
+    g_in_job = true;
+    if (caller_job)
+        caller_job();
+    runJobs();
+    g_in_job = false;
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_cv_done.wait(lock, [this]() { return m_active_workers == 0; });
+    m_job = NULL;
+}   // parallelFor
@@ -0,0 +1,113 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_JOB_SYSTEM_HPP
+#define HEADER_JOB_SYSTEM_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+  * \brief A small pool of persistent worker threads to run data parallel
+  *  jobs, e.g. the narrowphase of the physics.
+  *  parallelFor() calls a function for all indices in a range and blocks
+  *  until all calls are done. The calling thread takes part in the work, so
+  *  with one thread the jobs are simply executed in order. Jobs must not
+  *  throw exceptions. parallelFor() can be called from any thread, a call
+  *  from inside a job is executed serially by the calling thread.
+  *  A caller job can be passed to parallelFor(), which the calling thread
+  *  executes while the worker threads start on the range. This allows to
+  *  overlap work which must be done by the calling thread (e.g. OpenGL
+  *  calls) with the jobs.
+  * \ingroup utils
+  */
+class JobSystem : public NoCopy
+{
+private:
+    /** All worker threads. */
+    std::vector<std::thread> m_workers;
+
+    /** Serialises parallelFor() calls from different threads. */
+    std::mutex               m_parallel_for_mutex;
+
+    /** Protects m_generation, m_active_workers and m_abort. */
+    std::mutex               m_mutex;
+
+    /** Signalled when a new range of jobs is available (or on abort). */
+    std::condition_variable  m_cv_start;
+
+    /** Signalled when the last worker finished its part of the jobs. */
+    std::condition_variable  m_cv_done;
+
+    /** The function to call for each index of the current range. */
+    const std::function<void(unsigned int)> *m_job;
+
+    /** Number of indices in the current range. */
+    unsigned int             m_count;
+
+    /** The next index to be processed. */
+    std::atomic<unsigned int> m_next_index;
+
+    /** Incremented for each parallelFor() call, so that workers can detect
+     *  new work. */
+    unsigned int             m_generation;
+
+    /** Number of workers that have not finished the current range. */
+    unsigned int             m_active_workers;
+
+    /** Set to tell the worker threads to exit. */
+    bool                     m_abort;
+
+    static JobSystem        *m_job_system;
+
+    void     workerThread();
+    void     runJobs();
+
+public:
+             JobSystem(unsigned int num_threads);
+            ~JobSystem();
+    void     parallelFor(unsigned int count,
+                         const std::function<void(unsigned int)> &job,
+                         const std::function<void()> &caller_job = nullptr);
+    // ------------------------------------------------------------------------
+    /** Returns the number of threads (including the calling thread) which
+     *  execute jobs. */
+    unsigned int getNumThreads() const
+    {
+        return (unsigned int)m_workers.size() + 1;
+    }   // getNumThreads
+    // ------------------------------------------------------------------------
+    static void create(int num_threads);
+    // ------------------------------------------------------------------------
+    /** Returns the job system, or NULL if it was not created. */
+    static JobSystem *get()                        { return m_job_system; }
+    // ------------------------------------------------------------------------
+    static void destroy()
+    {
+        delete m_job_system;
+        m_job_system = NULL;
+    }   // destroy
+};   // JobSystem
+
+#endif
@@ -19,9 +19,18 @@
 #include "utils/log.hpp"
 
 #include "config/user_config.hpp"
+#include "utils/types.hpp"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <mutex>
 #include <stdio.h>
+#include <string.h>
+#include <thread>
+#include <vector>
 
 #ifdef ANDROID
 #  include <android/log.h>
@@ -36,6 +45,160 @@ Log::LogLevel Log::m_min_log_level = Log::LL_VERBOSE;
 bool          Log::m_no_colors     = false;
 FILE*         Log::m_file_stdout   = NULL;
 
+namespace
+{
+    /** Header of a record in the buffer of a thread. */
+    struct RecordHeader
+    {
+        /** Size of the record including header, component and data. */
+        uint32_t m_size;
+        uint32_t m_data_size;
+        /** Nanoseconds since the start of the logging system. */
+        uint64_t m_time;
+        uint16_t m_component_size;
+        uint16_t m_thread_id;
+        uint8_t  m_level;
+        /** Log::RecordType, or RT_PADDING. */
+        uint8_t  m_type;
+    };   // RecordHeader
+
+    /** Type of the unused space at the end of a buffer. */
+    const uint8_t  RT_PADDING    = 0xff;
+
+    /** Records start at a multiple of this, so there is always space for
+     *  the header of a padding record at the end of a buffer. */
+    const uint32_t RECORD_ALIGN  = 32;
+
+    /** A single producer (the owning thread), single consumer ring buffer
+     *  of records. */
+    struct ThreadBuffer
+    {
+        static const uint32_t CAPACITY = 64 * 1024;
+        /** Total number of bytes written and read. */
+        std::atomic<uint64_t> m_write_pos;
+        std::atomic<uint64_t> m_read_pos;
+        /** Set when the owning thread exits. */
+        std::atomic<bool>     m_orphaned;
+        char                  m_data[CAPACITY];
+        ThreadBuffer() : m_write_pos(0), m_read_pos(0), m_orphaned(false) {}
+    };   // ThreadBuffer
+
+    /** A record copied out of a thread buffer by the writer. */
+    struct PendingRecord
+    {
+        RecordHeader m_header;
+        std::string  m_component;
+        std::string  m_data;
+        bool operator<(const PendingRecord &r) const
+        {
+            return m_header.m_time < r.m_header.m_time;
+        }
+    };   // PendingRecord
+
+    /** The buffer and id of a thread. The destructor marks the buffer as
+     *  orphaned when the thread exits, the writer then frees it. */
+    struct ThreadData
+    {
+        ThreadBuffer *m_buffer;
+        int           m_id;
+        ThreadData() : m_buffer(NULL), m_id(-1) {}
+        ~ThreadData()
+        {
+            if (m_buffer)
+                m_buffer->m_orphaned = true;
+            m_buffer = NULL;
+        }
+    };   // ThreadData
+
+    thread_local ThreadData g_thread_data;
+
+    std::atomic<int>           g_next_thread_id(0);
+    std::atomic<bool>          g_async(false);
+    std::thread                g_writer;
+    bool                       g_stop_writer = false;
+    std::mutex                 g_writer_mutex;
+    std::condition_variable    g_writer_cv;
+    /** Protects the list of buffers. */
+    std::mutex                 g_buffers_mutex;
+    std::vector<ThreadBuffer*> g_buffers;
+    /** Only one thread at a time can read from the buffers. */
+    std::mutex                 g_drain_mutex;
+    /** Serialises the actual output. */
+    std::mutex                 g_output_mutex;
+    FILE                      *g_binary_file = NULL;
+    const std::chrono::steady_clock::time_point g_start_time =
+        std::chrono::steady_clock::now();
+
+    // ------------------------------------------------------------------------
+    int getThreadId()
+    {
+        if (g_thread_data.m_id < 0)
+            g_thread_data.m_id = g_next_thread_id++;
+        return g_thread_data.m_id;
+    }   // getThreadId
+
+    // ------------------------------------------------------------------------
+    /** Appends a record to the buffer of the calling thread.
+     *  \return False if there is not enough space in the buffer.
+     */
+    bool pushRecord(ThreadBuffer *buffer, const RecordHeader &header,
+                    const char *component, const char *data)
+    {
+        const uint32_t size = header.m_size;
+        if (size > ThreadBuffer::CAPACITY / 2)
+            return false;
+        const uint64_t write = buffer->m_write_pos.load(std::memory_order_relaxed);
+        const uint64_t read  = buffer->m_read_pos.load(std::memory_order_acquire);
+        const uint32_t offset     = (uint32_t)(write % ThreadBuffer::CAPACITY);
+        const uint32_t contiguous = ThreadBuffer::CAPACITY - offset;
+        const uint32_t padding    = size <= contiguous ? 0 : contiguous;
+        if (write + padding + size - read > ThreadBuffer::CAPACITY)
+            return false;
+        if (padding > 0)
+        {
+            RecordHeader pad;
+            memset(&pad, 0, sizeof(pad));
+            pad.m_size = padding;
+            pad.m_type = RT_PADDING;
+            memcpy(buffer->m_data + offset, &pad, sizeof(pad));
+        }
+        char *p = buffer->m_data
+                + (uint32_t)((write + padding) % ThreadBuffer::CAPACITY);
+        memcpy(p, &header, sizeof(header));
+        memcpy(p + sizeof(header), component, header.m_component_size);
+        memcpy(p + sizeof(header) + header.m_component_size, data,
+               header.m_data_size);
+        buffer->m_write_pos.store(write + padding + size,
+                                  std::memory_order_release);
+        return true;
+    }   // pushRecord
+
+    // ------------------------------------------------------------------------
+    /** Copies all records of a buffer and frees their space. */
+    void readRecords(ThreadBuffer *buffer, std::vector<PendingRecord> *out)
+    {
+        uint64_t read = buffer->m_read_pos.load(std::memory_order_relaxed);
+        const uint64_t write =
+            buffer->m_write_pos.load(std::memory_order_acquire);
+        while (read < write)
+        {
+            const char *p = buffer->m_data
+                          + (uint32_t)(read % ThreadBuffer::CAPACITY);
+            PendingRecord record;
+            memcpy(&record.m_header, p, sizeof(RecordHeader));
+            read += record.m_header.m_size;
+            if (record.m_header.m_type == RT_PADDING)
+                continue;
+            p += sizeof(RecordHeader);
+            record.m_component.assign(p, record.m_header.m_component_size);
+            p += record.m_header.m_component_size;
+            record.m_data.assign(p, record.m_header.m_data_size);
+            out->push_back(record);
+        }
+        buffer->m_read_pos.store(read, std::memory_order_release);
+    }   // readRecords
+}   // namespace
+
 // ----------------------------------------------------------------------------
 /** Selects background/foreground colors for the message depending on
  *  log level. It is only called if messages are not redirected to a file.
@@ -123,18 +286,47 @@ void Log::resetTerminalColor()
 }   // resetTerminalColor
 
 // ----------------------------------------------------------------------------
-/** This actually prints the log message. If log messages are not redirected
- *  to a file, it tries to select a terminal colour.
- *  \param level Log level of the message to print.
- *  \param format A printf-like format string.
- *  \param va_list The values to be printed for the format.
+/** Writes one record to the console, the log file and the binary log file.
+ *  It is called either by the writer thread, or by the thread that
+ *  created the message if asynchronous logging is not used.
+ *  \param level Log level of the message.
+ *  \param type RT_TEXT or RT_BINARY.
+ *  \param time Seconds since the start of the logging system.
+ *  \param thread_id Id of the thread that created the message.
+ *  \param component Name of the component (0 terminated).
+ *  \param data The text of the message (0 terminated) or binary data.
+ *  \param size Length of the data.
  */
-void Log::printMessage(int level, const char *component, const char *format,
-                       VALIST args)
+void Log::writeRecord(int level, int type, double time, int thread_id,
+                      const char *component, const char *data,
+                      unsigned int size)
 {
-    assert(level>=0 && level <=LL_FATAL);
+    std::lock_guard<std::mutex> lock(g_output_mutex);
 
-    if(level<m_min_log_level) return;
+    if (g_binary_file)
+    {
+        RecordHeader header;
+        memset(&header, 0, sizeof(header));
+        header.m_data_size      = size;
+        header.m_time           = (uint64_t)(time * 1.0e9);
+        header.m_component_size = (uint16_t)strlen(component);
+        header.m_thread_id      = (uint16_t)thread_id;
+        header.m_level          = (uint8_t)level;
+        header.m_type           = (uint8_t)type;
+        header.m_size = sizeof(header) + header.m_component_size + size;
+        fwrite(&header, sizeof(header), 1, g_binary_file);
+        fwrite(component, header.m_component_size, 1, g_binary_file);
+        fwrite(data, size, 1, g_binary_file);
+    }
+
+    // Binary data is only printed as a summary in text output
+    char summary[32];
+    const char *text = data;
+    if (type == RT_BINARY)
+    {
+        sprintf(summary, "<%u bytes>", size);
+        text = summary;
+    }
 
 #ifdef ANDROID
     android_LogPriority alp;
@@ -158,57 +350,34 @@ void Log::printMessage(int level, const char *component, const char *format,
     static const char *names[] = {"debug", "verbose  ", "info   ",
                                   "warn   ", "error  ", "fatal  "};
 
-    // Using a va_list twice produces undefined results, ie crash.
-    // So make a copy if we're going to use it twice.
-    VALIST copy;
-    if (m_file_stdout)
-    {
-        va_copy(copy, args);
-    }
-#if defined(_MSC_FULL_VER) && defined(_DEBUG)
-    VALIST copy2;
-    va_copy(copy2, args);
-#endif
-
     // If we don't have a console file, write to stdout and hope for the best
     if(!m_file_stdout || level >= LL_WARN ||
         UserConfigParams::m_log_errors_to_console) // log to console & file
     {
-        VALIST out;
-        va_copy(out, args);
-
         setTerminalColor((LogLevel)level);
         #ifdef ANDROID
-        __android_log_vprint(alp, "SuperTuxKart", format, out);
+        __android_log_print(alp, "SuperTuxKart", "%s", text);
         #else
-        printf("[%s] %s: ", names[level], component);
-        vprintf(format, out);
+        printf("[%s] %.3f t%d %s: %s", names[level], time, thread_id,
+               component, text);
         #endif
         resetTerminalColor();  // this prints a \n
-
-        va_end(out);
     }
 
 #if defined(_MSC_FULL_VER) && defined(_DEBUG)
-    static char szBuff[2048];
-    vsnprintf(szBuff, sizeof(szBuff), format, copy2);
-
     OutputDebugString("[");
     OutputDebugString(names[level]);
     OutputDebugString("] ");
     OutputDebugString(component);
     OutputDebugString(": ");
-    OutputDebugString(szBuff);
+    OutputDebugString(text);
     OutputDebugString("\r\n");
 #endif
 
-
     if(m_file_stdout)
     {
-        fprintf (m_file_stdout, "[%s] %s: ", names[level], component);
-        vfprintf(m_file_stdout, format, copy);
-        fprintf (m_file_stdout, "\n");
-        va_end(copy);
+        fprintf(m_file_stdout, "[%s] %.3f t%d %s: %s\n", names[level], time,
+                thread_id, component, text);
     }
 
 #ifdef WIN32
@@ -219,18 +388,216 @@ void Log::printMessage(int level, const char *component, const char *format,
         char tmp[2048];
         sprintf(tmp, "[%s] %s: ", names[level], component);
         message += tmp;
-
-        VALIST out;
-        va_copy(out, args);
-        vsprintf(tmp, format, out);
-        message += tmp;
-        va_end(out);
+        message += text;
 
         MessageBoxA(NULL, message.c_str(), "SuperTuxKart - Fatal error", MB_OK);
     }
 #endif
+}   // writeRecord
+
+// ----------------------------------------------------------------------------
+/** Adds a record: if asynchronous logging is enabled it is appended to the
+ *  buffer of this thread, otherwise (and for errors) it is written
+ *  immediately.
+ *  \param level Log level of the record.
+ *  \param type RT_TEXT or RT_BINARY.
+ *  \param component Name of the component.
+ *  \param data Text or data of the record.
+ *  \param size Size of the data (for text including the terminating 0).
+ */
+void Log::addRecord(int level, int type, const char *component,
+                    const char *data, unsigned int size)
+{
+    const uint64_t time = std::chrono::duration_cast<std::chrono::nanoseconds>
+                         (std::chrono::steady_clock::now() - g_start_time)
+                         .count();
+    const int thread_id = getThreadId();
+
+    if (g_async && level < LL_ERROR)
+    {
+        if (!g_thread_data.m_buffer)
+        {
+            g_thread_data.m_buffer = new ThreadBuffer();
+            std::lock_guard<std::mutex> lock(g_buffers_mutex);
+            g_buffers.push_back(g_thread_data.m_buffer);
+        }
+        RecordHeader header;
+        header.m_data_size      = size;
+        header.m_time           = time;
+        header.m_component_size = (uint16_t)(strlen(component) + 1);
+        header.m_thread_id      = (uint16_t)thread_id;
+        header.m_level          = (uint8_t)level;
+        header.m_type           = (uint8_t)type;
+        header.m_size = (sizeof(header) + header.m_component_size + size
+                         + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+        ThreadBuffer *buffer = g_thread_data.m_buffer;
+        if (pushRecord(buffer, header, component, data))
+        {
+            // Wake up the writer early if the buffer is filling up
+            if (buffer->m_write_pos - buffer->m_read_pos
+                > ThreadBuffer::CAPACITY / 2)
+                g_writer_cv.notify_one();
+            return;
+        }
+        // The buffer is full: write all pending records, then try again
+        flush();
+        if (pushRecord(buffer, header, component, data))
+            return;
+    }
+
+    // Write pending records first to keep the order of messages
+    if (g_async)
+        flush();
+    writeRecord(level, type, time * 1.0e-9, thread_id, component, data,
+                type == RT_TEXT ? size - 1 : size);
+}   // addRecord
+
+// ----------------------------------------------------------------------------
+/** Formats a log message and adds it to the log.
+ *  \param level Log level of the message to print.
+ *  \param format A printf-like format string.
+ *  \param va_list The values to be printed for the format.
+ */
+void Log::printMessage(int level, const char *component, const char *format,
+                       VALIST args)
+{
+    assert(level>=0 && level <=LL_FATAL);
+
+    if(level<m_min_log_level) return;
+
+    char buffer[1024];
+    VALIST copy;
+    va_copy(copy, args);
+    int len = vsnprintf(buffer, sizeof(buffer), format, copy);
+    va_end(copy);
+    if (len < 0)
+        return;
+    if (len < (int)sizeof(buffer))
+    {
+        addRecord(level, RT_TEXT, component, buffer, len + 1);
+        return;
+    }
+
+    // Long message, allocate a buffer large enough
+    std::vector<char> long_buffer(len + 1);
+    va_copy(copy, args);
+    vsnprintf(long_buffer.data(), len + 1, format, copy);
+    va_end(copy);
+    addRecord(level, RT_TEXT, component, long_buffer.data(), len + 1);
 }   // printMessage
 
+// ----------------------------------------------------------------------------
+/** Logs binary data, e.g. a network packet. The data is completely written
+ *  only to the binary log file, text output only contains its size.
+ *  \param level Log level of the record.
+ *  \param component Name of the component.
+ *  \param data Pointer to the data.
+ *  \param size Number of bytes.
+ */
+void Log::binary(int level, const char *component, const void *data,
+                 unsigned int size)
+{
+    if (level < m_min_log_level)
+        return;
+    addRecord(level, RT_BINARY, component, (const char*)data, size);
+}   // binary
+
+// ----------------------------------------------------------------------------
+/** Main loop of the writer thread: regularly writes all pending records. */
+void Log::writerThread()
+{
+    while (true)
+    {
+        bool stop;
+        {
+            std::unique_lock<std::mutex> lock(g_writer_mutex);
+            g_writer_cv.wait_for(lock, std::chrono::milliseconds(10));
+            stop = g_stop_writer;
+        }
+        flush();
+        if (stop)
+            return;
+    }
+}   // writerThread
+
+// ----------------------------------------------------------------------------
+/** Writes all pending records of all threads, sorted by time. Buffers of
+ *  threads that have exited are freed.
+ */
+void Log::flush()
+{
+    std::lock_guard<std::mutex> drain_lock(g_drain_mutex);
+    std::vector<PendingRecord> records;
+    {
+        std::lock_guard<std::mutex> lock(g_buffers_mutex);
+        for (unsigned int i = 0; i < g_buffers.size(); )
+        {
+            // Test orphaned first: once it is set, the thread will not
+            // write to the buffer anymore.
+            const bool orphaned = g_buffers[i]->m_orphaned;
+            readRecords(g_buffers[i], &records);
+            if (orphaned)
+            {
+                delete g_buffers[i];
+                g_buffers.erase(g_buffers.begin() + i);
+            }
+            else
+                i++;
+        }
+    }
+    if (records.empty())
+        return;
+
+    std::stable_sort(records.begin(), records.end());
+    for (unsigned int i = 0; i < records.size(); i++)
+    {
+        const RecordHeader &h = records[i].m_header;
+        writeRecord(h.m_level, h.m_type, h.m_time * 1.0e-9, h.m_thread_id,
+                    records[i].m_component.c_str(), records[i].m_data.data(),
+                    h.m_type == RT_TEXT ? h.m_data_size - 1 : h.m_data_size);
+    }
+    std::lock_guard<std::mutex> lock(g_output_mutex);
+    fflush(stdout);
+    if (g_binary_file)
+        fflush(g_binary_file);
+}   // flush
+
+// ----------------------------------------------------------------------------
+/** Starts the writer thread, after which messages (except errors) are
+ *  written asynchronously. Pending messages are written at exit.
+ */
+void Log::startAsync()
+{
+    if (g_async)
+        return;
+    g_stop_writer = false;
+    g_writer      = std::thread(&Log::writerThread);
+    g_async       = true;
+    static bool at_exit_registered = false;
+    if (!at_exit_registered)
+    {
+        atexit(&Log::stopAsync);
+        at_exit_registered = true;
+    }
+}   // startAsync
+
+// ----------------------------------------------------------------------------
+/** Writes all pending messages and stops the writer thread. Afterwards
+ *  messages are written synchronously again.
+ */
+void Log::stopAsync()
+{
+    if (!g_async)
+        return;
+    g_async = false;
+    {
+        std::lock_guard<std::mutex> lock(g_writer_mutex);
+        g_stop_writer = true;
+    }
+    g_writer_cv.notify_one();
+    g_writer.join();
+    flush();
+}   // stopAsync
 
 // ----------------------------------------------------------------------------
 /** This function opens the files that will contain the output.
@@ -252,10 +619,45 @@ void Log::openOutputFiles(const std::string &logout)
     }
 } // closeOutputFiles
 
+// ----------------------------------------------------------------------------
+/** Opens a file to which all messages are written in a binary format,
+ *  which is cheaper to write than formatted text. Each record consists of
+ *  a header (in host byte order):
+ *  uint32 size of the record, uint32 size of the data,
+ *  uint64 nanoseconds since start, uint16 size of the component name,
+ *  uint16 thread id, uint8 log level, uint8 record type (Log::RecordType)
+ *  and 2 padding bytes, followed by the component name and the data (the
+ *  text of the message, without a terminating 0).
+ *  \param filename Name of the file.
+ */
+void Log::openBinaryFile(const std::string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "wb");
+    if (!file)
+    {
+        Log::error("Log", "Can not open binary log file '%s'.",
+                   filename.c_str());
+        return;
+    }
+    std::lock_guard<std::mutex> lock(g_output_mutex);
+    if (g_binary_file)
+        fclose(g_binary_file);
+    g_binary_file = file;
+}   // openBinaryFile
+
 // ----------------------------------------------------------------------------
 /** Function to close output files */
 void Log::closeOutputFiles()
 {
-    fclose(m_file_stdout);
+    stopAsync();
+    std::lock_guard<std::mutex> lock(g_output_mutex);
+    if (m_file_stdout)
+        fclose(m_file_stdout);
+    m_file_stdout = NULL;
+    if (g_binary_file)
+    {
+        fclose(g_binary_file);
+        g_binary_file = NULL;
+    }
 } // closeOutputFiles
 
@@ -36,6 +36,33 @@
 #  define va_copy(dest, src) dest = src
 #endif
 
+/** Returns true if messages of the given level are printed. */
+#define LOG_IS_ENABLED(LEVEL) ((LEVEL) >= Log::getLogLevel())
+
+/** These macros only evaluate their arguments if the message is actually
+ *  printed, which avoids e.g. building strings that are then discarded.
+ *  They should be used for low priority messages in frequently executed
+ *  code (e.g. for each network packet). */
+#define LOG_DEBUG(...)                                                  \
+    do { if (LOG_IS_ENABLED(Log::LL_DEBUG))   Log::debug(__VA_ARGS__); }   \
+    while (0)
+#define LOG_VERBOSE(...)                                                \
+    do { if (LOG_IS_ENABLED(Log::LL_VERBOSE)) Log::verbose(__VA_ARGS__); } \
+    while (0)
+#define LOG_INFO(...)                                                   \
+    do { if (LOG_IS_ENABLED(Log::LL_INFO))    Log::info(__VA_ARGS__); }    \
+    while (0)
+
+/** \brief The logging system of STK.
+ *  Each message has a level, a component and a printf-like format. It is
+ *  printed with a time stamp (seconds since start) and the id of the
+ *  thread that created it. Once startAsync() is called, messages are
+ *  only formatted by the calling thread and appended to a lock free
+ *  buffer of this thread; a writer thread prints them. Errors and fatal
+ *  messages are always printed immediately (after all pending messages).
+ *  Besides text messages binary records can be logged, and all messages
+ *  can be written to a binary log file, see openBinaryFile().
+ */
 class Log
 {
 public:
@@ -61,11 +88,25 @@ private:
 
     static void setTerminalColor(LogLevel level);
     static void resetTerminalColor();
+    static void addRecord(int level, int type, const char *component,
+                          const char *data, unsigned int size);
+    static void writeRecord(int level, int type, double time, int thread_id,
+                            const char *component, const char *data,
+                            unsigned int size);
+    static void writerThread();
 
 public:
+    /** Types of records in the binary log file. */
+    enum RecordType { RT_TEXT = 0, RT_BINARY = 1 };
 
     static void printMessage(int level, const char *component,
                              const char *format, VALIST va_list);
+    static void binary(int level, const char *component, const void *data,
+                       unsigned int size);
+    static void startAsync();
+    static void stopAsync();
+    static void flush();
+    static void openBinaryFile(const std::string &filename);
     // ------------------------------------------------------------------------
     /** A simple macro to define the various log functions.
      *  Note that an assert is added so that a debugger is triggered
@@ -0,0 +1,289 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/memory_pool.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <stdlib.h>
+
+namespace
+{
+    /** All existing pools, used to display statistics. */
+    std::vector<MemoryPool*> &getAllPools()
+    {
+        static std::vector<MemoryPool*> *all_pools =
+            new std::vector<MemoryPool*>();
+        return *all_pools;
+    }   // getAllPools
+
+    // ------------------------------------------------------------------------
+    /** Protects the list of all pools. */
+    std::mutex &getAllPoolsMutex()
+    {
+        static std::mutex *mutex = new std::mutex();
+        return *mutex;
+    }   // getAllPoolsMutex
+}   // namespace
+
+FrameArena *FrameArena::m_frame_arena = NULL;
+
+// ----------------------------------------------------------------------------
+MemoryPool::MemoryPool(const std::string &name)
+{
+    m_name                  = name;
+    m_allocations           = 0;
+    m_heap_allocations      = 0;
+    m_last_allocations      = 0;
+    m_last_heap_allocations = 0;
+    m_blocks_in_use         = 0;
+    m_heap_size             = 0;
+    std::lock_guard<std::mutex> lock(getAllPoolsMutex());
+    getAllPools().push_back(this);
+}   // MemoryPool
+
+// ----------------------------------------------------------------------------
+MemoryPool::~MemoryPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(getAllPoolsMutex());
+        std::vector<MemoryPool*> &all_pools = getAllPools();
+        all_pools.erase(std::find(all_pools.begin(), all_pools.end(), this));
+    }
+    assert(m_blocks_in_use == 0);
+    for (unsigned int i = 0; i < m_chunks.size(); i++)
+        free(m_chunks[i]);
+}   // ~MemoryPool
+
+// ----------------------------------------------------------------------------
+/** Returns the free list for the given block size, creating it if
+ *  necessary. The number of different block sizes per pool is small (one
+ *  per derived class), so a linear search is used. Must be called with the
+ *  mutex locked. */
+MemoryPool::SizeClass *MemoryPool::getSizeClass(size_t block_size)
+{
+    for (unsigned int i = 0; i < m_size_classes.size(); i++)
+    {
+        if (m_size_classes[i].m_block_size == block_size)
+            return &m_size_classes[i];
+    }
+    SizeClass sc;
+    sc.m_block_size = block_size;
+    sc.m_free_list  = NULL;
+    m_size_classes.push_back(sc);
+    return &m_size_classes.back();
+}   // getSizeClass
+
+// ----------------------------------------------------------------------------
+/** Allocates a block of at least the given size.
+ *  \param size Number of bytes needed.
+ */
+void *MemoryPool::allocate(size_t size)
+{
+    const size_t block_size = getBlockSize(size);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_allocations++;
+    if (block_size > MAX_BLOCK_SIZE)
+    {
+        m_heap_allocations++;
+        m_blocks_in_use++;
+        return ::operator new(size);
+    }
+
+    SizeClass *sc = getSizeClass(block_size);
+    if (!sc->m_free_list)
+    {
+        // Allocate a new chunk and add all its blocks to the free list
+        const size_t count = std::max((size_t)4, 16384 / block_size);
+        char *chunk = (char*)malloc(count * block_size);
+        if (!chunk)
+            throw std::bad_alloc();
+        m_chunks.push_back(chunk);
+        m_heap_allocations++;
+        m_heap_size += count * block_size;
+        for (size_t i = 0; i < count; i++)
+        {
+            void *block = chunk + i * block_size;
+            *(void**)block = sc->m_free_list;
+            sc->m_free_list = block;
+        }
+    }
+    void *block = sc->m_free_list;
+    sc->m_free_list = *(void**)block;
+    m_blocks_in_use++;
+    return block;
+}   // allocate
+
+// ----------------------------------------------------------------------------
+/** Returns a block to the pool.
+ *  \param p The block (can be NULL).
+ *  \param size The size that was used when allocating the block.
+ */
+void MemoryPool::deallocate(void *p, size_t size)
+{
+    if (!p)
+        return;
+    const size_t block_size = getBlockSize(size);
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_blocks_in_use--;
+    if (block_size > MAX_BLOCK_SIZE)
+    {
+        ::operator delete(p);
+        return;
+    }
+    SizeClass *sc = getSizeClass(block_size);
+    *(void**)p = sc->m_free_list;
+    sc->m_free_list = p;
+}   // deallocate
+
+// ----------------------------------------------------------------------------
+/** Starts a new frame: the counters of the previous frame are stored to be
+ *  displayed, and the counters are reset. */
+void MemoryPool::startFrame()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_last_allocations      = m_allocations;
+    m_last_heap_allocations = m_heap_allocations;
+    m_allocations           = 0;
+    m_heap_allocations      = 0;
+}   // startFrame
+
+// ----------------------------------------------------------------------------
+/** Returns the counters of this pool for the last complete frame. */
+MemoryPool::Statistics MemoryPool::getStatistics()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    Statistics s;
+    s.m_name             = m_name;
+    s.m_allocations      = m_last_allocations;
+    s.m_heap_allocations = m_last_heap_allocations;
+    s.m_blocks_in_use    = m_blocks_in_use;
+    s.m_heap_size        = m_heap_size;
+    return s;
+}   // getStatistics
+
+// ----------------------------------------------------------------------------
+/** Called once per frame from the main loop to start a new frame for all
+ *  pools and the frame arena. */
+void MemoryPool::startAllFrames()
+{
+    std::lock_guard<std::mutex> lock(getAllPoolsMutex());
+    std::vector<MemoryPool*> &all_pools = getAllPools();
+    for (unsigned int i = 0; i < all_pools.size(); i++)
+        all_pools[i]->startFrame();
+    FrameArena::get()->reset();
+}   // startAllFrames
+
+// ----------------------------------------------------------------------------
+/** Returns the statistics of all pools, sorted by name. */
+void MemoryPool::getAllStatistics(std::vector<Statistics> *statistics)
+{
+    statistics->clear();
+    std::lock_guard<std::mutex> lock(getAllPoolsMutex());
+    std::vector<MemoryPool*> &all_pools = getAllPools();
+    for (unsigned int i = 0; i < all_pools.size(); i++)
+        statistics->push_back(all_pools[i]->getStatistics());
+    std::sort(statistics->begin(), statistics->end(),
+              [](const Statistics &a, const Statistics &b)
+              {
+                  return a.m_name < b.m_name;
+              });
+}   // getAllStatistics
+
+// ----------------------------------------------------------------------------
+/** Returns the pool used by PoolStlAllocator. It is never deleted, so that
+ *  containers in static objects can still free their memory. */
+MemoryPool *MemoryPool::getSmallObjectPool()
+{
+    static MemoryPool *pool = new MemoryPool("Small objects");
+    return pool;
+}   // getSmallObjectPool
+
+// ============================================================================
+FrameArena::FrameArena()
+{
+    m_current_block         = 0;
+    m_offset                = 0;
+    m_bytes_used            = 0;
+    m_heap_allocations      = 0;
+    m_last_bytes_used       = 0;
+    m_last_heap_allocations = 0;
+}   // FrameArena
+
+// ----------------------------------------------------------------------------
+FrameArena::~FrameArena()
+{
+    for (unsigned int i = 0; i < m_blocks.size(); i++)
+        free(m_blocks[i]);
+}   // ~FrameArena
+
+// ----------------------------------------------------------------------------
+/** Allocates memory that is valid until the next call to reset().
+ *  \param size Number of bytes.
+ *  \param alignment Alignment of the memory, must be a power of 2 and not
+ *         larger than 16.
+ */
+void *FrameArena::allocate(size_t size, size_t alignment)
+{
+    assert(alignment <= 16 && (alignment & (alignment - 1)) == 0);
+    m_bytes_used += size;
+    while (true)
+    {
+        if (m_current_block < m_blocks.size())
+        {
+            const size_t offset = (m_offset + alignment - 1)
+                                & ~(alignment - 1);
+            if (offset + size <= m_block_sizes[m_current_block])
+            {
+                m_offset = offset + size;
+                return m_blocks[m_current_block] + offset;
+            }
+            // Try the next block
+            if (m_current_block + 1 < m_blocks.size())
+            {
+                m_current_block++;
+                m_offset = 0;
+                continue;
+            }
+        }
+
+        // All blocks are full: add a new block after the current one.
+        const size_t block_size = std::max(size, (size_t)BLOCK_SIZE);
+        char *block = (char*)malloc(block_size);
+        if (!block)
+            throw std::bad_alloc();
+        m_heap_allocations++;
+        m_blocks.push_back(block);
+        m_block_sizes.push_back(block_size);
+        m_current_block = (unsigned int)m_blocks.size() - 1;
+        m_offset = 0;
+    }
+}   // allocate
+
+// ----------------------------------------------------------------------------
+/** Makes all memory available again. All pointers returned by allocate()
+ *  become invalid. */
+void FrameArena::reset()
+{
+    m_last_bytes_used       = m_bytes_used;
+    m_last_heap_allocations = m_heap_allocations;
+    m_current_block         = 0;
+    m_offset                = 0;
+    m_bytes_used            = 0;
+    m_heap_allocations      = 0;
+}   // reset
@@ -0,0 +1,299 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_MEMORY_POOL_HPP
+#define HEADER_MEMORY_POOL_HPP
+
+#include "utils/no_copy.hpp"
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+  * \brief A thread-safe pool of fixed size memory blocks.
+  *  Blocks are carved out of larger chunks which are allocated from the
+  *  heap, and freed blocks are kept in a free list (one for each block
+  *  size) to be reused. Memory is never returned to the heap. This is used
+  *  for small objects which are frequently created and deleted (often by
+  *  different threads), e.g. network events or sfx commands.
+  *  Each pool registers itself, so that the profiler can display the
+  *  allocation counters of all pools.
+  * \ingroup utils
+  */
+class MemoryPool : public NoCopy
+{
+public:
+    /** Allocation counters of a pool. */
+    struct Statistics
+    {
+        std::string m_name;
+        /** Number of allocations in the current (or last) frame. */
+        int         m_allocations;
+        /** Number of these allocations that needed the heap. */
+        int         m_heap_allocations;
+        /** Number of blocks currently in use. */
+        int         m_blocks_in_use;
+        /** Total memory (in bytes) allocated from the heap. */
+        size_t      m_heap_size;
+    };
+
+    /** Larger blocks are allocated directly from the heap. */
+    static const size_t MAX_BLOCK_SIZE = 4096;
+
+private:
+    /** A free list for one block size. */
+    struct SizeClass
+    {
+        size_t m_block_size;
+        void  *m_free_list;
+    };
+
+    /** Name of this pool, used in the profiler. */
+    std::string            m_name;
+
+    /** The free lists for all block sizes used so far. */
+    std::vector<SizeClass> m_size_classes;
+
+    /** All chunks allocated from the heap. */
+    std::vector<void*>     m_chunks;
+
+    /** Protects all data of this pool. */
+    std::mutex             m_mutex;
+
+    /** Counters, see Statistics. */
+    int                    m_allocations;
+    int                    m_heap_allocations;
+    int                    m_last_allocations;
+    int                    m_last_heap_allocations;
+    int                    m_blocks_in_use;
+    size_t                 m_heap_size;
+
+    SizeClass *getSizeClass(size_t block_size);
+
+public:
+             MemoryPool(const std::string &name);
+            ~MemoryPool();
+    void    *allocate(size_t size);
+    void     deallocate(void *p, size_t size);
+    void     startFrame();
+    Statistics getStatistics();
+
+    static void startAllFrames();
+    static void getAllStatistics(std::vector<Statistics> *statistics);
+    static MemoryPool *getSmallObjectPool();
+    // ------------------------------------------------------------------------
+    /** Rounds a size up to the block size used for it. */
+    static size_t getBlockSize(size_t size)
+    {
+        return size == 0 ? 16 : (size + 15) & ~(size_t)15;
+    }   // getBlockSize
+};   // MemoryPool
+
+// ============================================================================
+/**
+  * \brief A linear allocator for temporary data of the main thread which
+  *  only needs to live until the end of the current frame.
+  *  Allocation just advances a pointer, deallocation does nothing. All
+  *  memory is made available again when reset() is called at the start of
+  *  each frame in MainLoop::run(). The memory blocks are kept, so after
+  *  the first few frames no heap allocations are necessary anymore.
+  *  This must only be used from the main thread.
+  * \ingroup utils
+  */
+class FrameArena : public NoCopy
+{
+private:
+    /** Size of a normal memory block. */
+    static const size_t BLOCK_SIZE = 64 * 1024;
+
+    /** All memory blocks. */
+    std::vector<char*>  m_blocks;
+
+    /** Size of each memory block (larger requests get their own block). */
+    std::vector<size_t> m_block_sizes;
+
+    /** Index of the block from which memory is allocated. */
+    unsigned int        m_current_block;
+
+    /** Offset of the first free byte in the current block. */
+    size_t              m_offset;
+
+    /** Statistics: bytes allocated and number of heap allocations in this
+     *  and in the previous frame. */
+    size_t              m_bytes_used;
+    int                 m_heap_allocations;
+    size_t              m_last_bytes_used;
+    int                 m_last_heap_allocations;
+
+    static FrameArena  *m_frame_arena;
+
+public:
+             FrameArena();
+            ~FrameArena();
+    void    *allocate(size_t size, size_t alignment = 16);
+    void     reset();
+    // ------------------------------------------------------------------------
+    /** Returns the number of bytes allocated in the last frame. */
+    size_t   getBytesUsed() const       { return m_last_bytes_used;       }
+    // ------------------------------------------------------------------------
+    /** Returns the number of heap allocations in the last frame. */
+    int      getHeapAllocations() const { return m_last_heap_allocations; }
+    // ------------------------------------------------------------------------
+    /** Returns the arena of the main thread. */
+    static FrameArena *get()
+    {
+        if (!m_frame_arena)
+            m_frame_arena = new FrameArena();
+        return m_frame_arena;
+    }   // get
+};   // FrameArena
+
+// ============================================================================
+/** An STL allocator using the small object pool. Used for containers of
+ *  pooled objects, so that their (usually small) buffers do not need the
+ *  heap either. Sizes are rounded up to the next power of two to reduce the
+ *  number of different block sizes in the pool. */
+template<typename T>
+class PoolStlAllocator
+{
+public:
+    typedef T              value_type;
+    typedef T*             pointer;
+    typedef const T*       const_pointer;
+    typedef T&             reference;
+    typedef const T&       const_reference;
+    typedef std::size_t    size_type;
+    typedef std::ptrdiff_t difference_type;
+    template<typename U> struct rebind { typedef PoolStlAllocator<U> other; };
+
+    PoolStlAllocator() {}
+    template<typename U> PoolStlAllocator(const PoolStlAllocator<U> &) {}
+    // ------------------------------------------------------------------------
+    static size_t getSize(size_type n)
+    {
+        size_t size = 16;
+        while (size < n * sizeof(T))
+            size *= 2;
+        return size;
+    }   // getSize
+    // ------------------------------------------------------------------------
+    T *allocate(size_type n)
+    {
+        return (T*)MemoryPool::getSmallObjectPool()->allocate(getSize(n));
+    }   // allocate
+    // ------------------------------------------------------------------------
+    void deallocate(T *p, size_type n)
+    {
+        MemoryPool::getSmallObjectPool()->deallocate(p, getSize(n));
+    }   // deallocate
+    // ------------------------------------------------------------------------
+    size_type max_size() const { return size_type(-1) / sizeof(T); }
+    // ------------------------------------------------------------------------
+    template<typename U, typename... Args>
+    void construct(U *p, Args&&... args)
+    {
+        ::new((void*)p) U(std::forward<Args>(args)...);
+    }   // construct
+    // ------------------------------------------------------------------------
+    template<typename U> void destroy(U *p) { p->~U(); }
+};   // PoolStlAllocator
+
+template<typename T, typename U>
+bool operator==(const PoolStlAllocator<T>&, const PoolStlAllocator<U>&)
+{
+    return true;
+}
+template<typename T, typename U>
+bool operator!=(const PoolStlAllocator<T>&, const PoolStlAllocator<U>&)
+{
+    return false;
+}
+
+// ============================================================================
+/** An STL allocator using the FrameArena of the main thread, for temporary
+ *  containers that do not live longer than the current frame. */
+template<typename T>
+class FrameStlAllocator
+{
+public:
+    typedef T              value_type;
+    typedef T*             pointer;
+    typedef const T*       const_pointer;
+    typedef T&             reference;
+    typedef const T&       const_reference;
+    typedef std::size_t    size_type;
+    typedef std::ptrdiff_t difference_type;
+    template<typename U> struct rebind { typedef FrameStlAllocator<U> other; };
+
+    FrameStlAllocator() {}
+    template<typename U> FrameStlAllocator(const FrameStlAllocator<U> &) {}
+    // ------------------------------------------------------------------------
+    T *allocate(size_type n)
+    {
+        return (T*)FrameArena::get()->allocate(n * sizeof(T));
+    }   // allocate
+    // ------------------------------------------------------------------------
+    void deallocate(T *, size_type) {}
+    // ------------------------------------------------------------------------
+    size_type max_size() const { return size_type(-1) / sizeof(T); }
+    // ------------------------------------------------------------------------
+    template<typename U, typename... Args>
+    void construct(U *p, Args&&... args)
+    {
+        ::new((void*)p) U(std::forward<Args>(args)...);
+    }   // construct
+    // ------------------------------------------------------------------------
+    template<typename U> void destroy(U *p) { p->~U(); }
+};   // FrameStlAllocator
+
+template<typename T, typename U>
+bool operator==(const FrameStlAllocator<T>&, const FrameStlAllocator<U>&)
+{
+    return true;
+}
+template<typename T, typename U>
+bool operator!=(const FrameStlAllocator<T>&, const FrameStlAllocator<U>&)
+{
+    return false;
+}
+
+// ============================================================================
+/** Use this macro in the public section of a class to allocate all objects
+ *  of this class (and all derived classes) from a MemoryPool with the given
+ *  name. The pool is never deleted, so objects can still be freed while
+ *  static objects are destroyed. */
+#define POOL_ALLOCATED(NAME)                                         \
+    static MemoryPool *getMemoryPool()                               \
+    {                                                                \
+        static MemoryPool *pool = new MemoryPool(NAME);              \
+        return pool;                                                 \
+    }                                                                \
+    static void *operator new(size_t size)                           \
+    {                                                                \
+        return getMemoryPool()->allocate(size);                      \
+    }                                                                \
+    static void operator delete(void *p, size_t size)                \
+    {                                                                \
+        getMemoryPool()->deallocate(p, size);                        \
+    }
+
+#endif
@@ -21,11 +21,14 @@
 #include "graphics/glwrap.hpp"
 #include "graphics/irr_driver.hpp"
 #include "graphics/2dutils.hpp"
+#include "graphics/stk_tex_manager.hpp"
+#include "graphics/texture_residency.hpp"
 #include "guiengine/event_handler.hpp"
 #include "guiengine/engine.hpp"
 #include "graphics/irr_driver.hpp"
 #include "guiengine/scalable_font.hpp"
 #include "io/file_manager.hpp"
+#include "utils/memory_pool.hpp"
 #include "utils/string_utils.hpp"
 #include "utils/vs.hpp"
 
@@ -76,6 +79,7 @@ Profiler profiler;
 
 #define MARKERS_NAMES_POS      core::rect<s32>(50,100,150,200)
 #define GPU_MARKERS_NAMES_POS      core::rect<s32>(50,165,150,250)
+#define MEMORY_POOLS_POS           core::rect<s32>(50,250,150,450)
 
 // The width of the profiler corresponds to TIME_DRAWN_MS milliseconds
 #define TIME_DRAWN_MS 30.0f 
@@ -495,6 +499,37 @@ void Profiler::draw()
             font->draw(oss.str().c_str(), GPU_MARKERS_NAMES_POS,
                        video::SColor(0xFF, 0xFF, 0x00, 0x00));
         }
+
+        // Allocation counters of the last frame
+        std::vector<MemoryPool::Statistics> pools;
+        MemoryPool::getAllStatistics(&pools);
+        std::ostringstream oss;
+        for (unsigned int i = 0; i < pools.size(); i++)
+        {
+            const MemoryPool::Statistics &s = pools[i];
+            oss << s.m_name << ": " << s.m_allocations << " allocs, "
+                << s.m_heap_allocations << " from heap, "
+                << s.m_blocks_in_use << " in use, "
+                << s.m_heap_size / 1024 << " KB" << std::endl;
+        }
+        oss << "Frame arena: " << FrameArena::get()->getBytesUsed() / 1024
+            << " KB, " << FrameArena::get()->getHeapAllocations()
+            << " from heap" << std::endl;
+
+        // Streamed textures
+        TextureResidency *residency =
+            STKTexManager::getInstance()->getTextureResidency();
+        if (residency)
+        {
+            oss << "Textures: " << residency->getResidentBytes() / 1024 / 1024
+                << " of " << residency->getBudget() / 1024 / 1024
+                << " MB resident, " << residency->getNumPending()
+                << " streaming, stream-in latency "
+                << (int)(residency->getStreamInLatency() * 1000.0f) << " ms"
+                << std::endl;
+        }
+        font->draw(oss.str().c_str(), MEMORY_POOLS_POS,
+                   video::SColor(0xFF, 0xFF, 0x00, 0x00));
     }
 
     PROFILER_POP_CPU_MARKER();
@@ -0,0 +1,255 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/spatial_grid.hpp"
+
+#include "utils/log.hpp"
+#include "utils/time.hpp"
+
+#include <limits>
+
+// ----------------------------------------------------------------------------
+/** Constructor.
+ *  \param cell_size Side length of a grid cell. It should be about the
+ *         size of a typical query radius.
+ */
+SpatialGrid::SpatialGrid(float cell_size)
+{
+    assert(cell_size > 0);
+    m_cell_size     = cell_size;
+    m_inv_cell_size = 1.0f / cell_size;
+    clear();
+}   // SpatialGrid
+
+// ----------------------------------------------------------------------------
+/** Removes all points. */
+void SpatialGrid::clear()
+{
+    m_entries.clear();
+    m_bucket_start.assign(2, 0);
+    m_bucket_mask = 0;
+    m_min_cell_x  = m_min_cell_z = 0;
+    m_max_cell_x  = m_max_cell_z = -1;
+}   // clear
+
+// ----------------------------------------------------------------------------
+/** Replaces all points in the grid.
+ *  \param points The new points.
+ */
+void SpatialGrid::build(const std::vector<Vec3> &points)
+{
+    if (points.empty())
+    {
+        clear();
+        return;
+    }
+
+    // Use at least twice as many buckets as points to keep the number
+    // of cells sharing a bucket small.
+    uint32_t num_buckets = 16;
+    while (num_buckets < 2 * points.size())
+        num_buckets *= 2;
+    m_bucket_mask = num_buckets - 1;
+    m_bucket_start.assign(num_buckets + 1, 0);
+    m_entries.resize(points.size());
+
+    m_min_cell_x = m_min_cell_z = std::numeric_limits<int>::max();
+    m_max_cell_x = m_max_cell_z = std::numeric_limits<int>::min();
+    for (const Vec3 &p : points)
+    {
+        const int cell_x = getCell(p.getX());
+        const int cell_z = getCell(p.getZ());
+        m_min_cell_x = std::min(m_min_cell_x, cell_x);
+        m_max_cell_x = std::max(m_max_cell_x, cell_x);
+        m_min_cell_z = std::min(m_min_cell_z, cell_z);
+        m_max_cell_z = std::max(m_max_cell_z, cell_z);
+        m_bucket_start[getBucket(cell_x, cell_z) + 1]++;
+    }
+    for (uint32_t i = 0; i < num_buckets; i++)
+        m_bucket_start[i + 1] += m_bucket_start[i];
+
+    // Use the start of the next bucket as insertion position, so that
+    // after inserting it is the start of the bucket again
+    for (unsigned int i = 0; i < points.size(); i++)
+    {
+        const Vec3 &p = points[i];
+        const int cell_x = getCell(p.getX());
+        const int cell_z = getCell(p.getZ());
+        const uint32_t bucket = getBucket(cell_x, cell_z);
+        Entry &e   = m_entries[m_bucket_start[bucket]++];
+        e.m_x      = p.getX();
+        e.m_y      = p.getY();
+        e.m_z      = p.getZ();
+        e.m_cell_x = cell_x;
+        e.m_cell_z = cell_z;
+        e.m_index  = i;
+    }
+    for (uint32_t i = num_buckets; i > 0; i--)
+        m_bucket_start[i] = m_bucket_start[i - 1];
+    m_bucket_start[0] = 0;
+}   // build
+
+// ----------------------------------------------------------------------------
+/** Compares radius and nearest queries with a linear search, for a
+ *  typical race with 100 karts and 200 flyables, and prints the time
+ *  used by both.
+ */
+void SpatialGrid::unitTesting()
+{
+    uint32_t seed = 1234;
+    // Returns a random number in [0,1)
+    auto random = [&seed]()
+    {
+        seed = seed * 1103515245 + 12345;
+        return ((seed >> 8) & 0xffff) / 65536.0f;
+    };
+
+    // Karts are spread along a circular track of 500m radius, flyables
+    // are close to the karts.
+    std::vector<Vec3> karts, flyables;
+    for (unsigned int i = 0; i < 100; i++)
+    {
+        const float angle = random() * 6.2831853f;
+        karts.push_back(Vec3(500.0f * cosf(angle) + 10.0f * random(),
+                             5.0f * random(),
+                             500.0f * sinf(angle) + 10.0f * random()));
+    }
+    for (unsigned int i = 0; i < 200; i++)
+    {
+        const Vec3 &kart = karts[i % karts.size()];
+        flyables.push_back(kart + Vec3(40.0f * random() - 20.0f,
+                                       random(),
+                                       40.0f * random() - 20.0f));
+    }
+    // Some duplicated points to test the sorting of equal costs
+    karts[7] = karts[3];
+
+    SpatialGrid kart_grid(16.0f), flyable_grid(16.0f);
+    kart_grid.build(karts);
+    flyable_grid.build(flyables);
+    assert(kart_grid.getNumPoints() == 100);
+
+    // Each kart tests for flyables within 15m, and searches the closest
+    // other kart.
+    const float RADIUS = 15.0f;
+    unsigned int grid_hits = 0, linear_hits = 0;
+    unsigned int grid_sum = 0, linear_sum = 0;
+    unsigned int nearest[4];
+
+    // One frame rebuilds the grids and does all queries
+    const double start_grid = StkTime::getRealTime();
+    for (unsigned int n = 0; n < 100; n++)
+    {
+        kart_grid.build(karts);
+        flyable_grid.build(flyables);
+        for (unsigned int i = 0; i < karts.size(); i++)
+        {
+            const Vec3 &xyz = karts[i];
+            flyable_grid.forEachInRadius(xyz, RADIUS,
+                [&grid_hits](unsigned int index, float d2) { grid_hits++; });
+            auto cost = [&karts, &xyz, i](unsigned int index)
+            {
+                return index == i ? -1.0f : (karts[index] - xyz).length2();
+            };
+            kart_grid.findNearest(xyz, 1, 1e30f, cost, nearest);
+            grid_sum += nearest[0];
+        }
+    }
+    const double end_grid = StkTime::getRealTime();
+
+    for (unsigned int n = 0; n < 100; n++)
+    {
+        for (unsigned int i = 0; i < karts.size(); i++)
+        {
+            const Vec3 &xyz = karts[i];
+            for (const Vec3 &f : flyables)
+            {
+                if ((f - xyz).length2() < RADIUS * RADIUS)
+                    linear_hits++;
+            }
+            float best = 1e30f;
+            unsigned int linear_nearest = 0;
+            for (unsigned int j = 0; j < karts.size(); j++)
+            {
+                const float d2 = (karts[j] - xyz).length2();
+                if (j != i && d2 < best)
+                {
+                    best = d2;
+                    linear_nearest = j;
+                }
+            }
+            linear_sum += linear_nearest;
+        }
+    }
+    const double end_linear = StkTime::getRealTime();
+    // Karts have a closest kart, so comparing the sum of the indices
+    // is a cheap test for the nearest search
+    assert(grid_hits == linear_hits && grid_sum == linear_sum);
+
+    Log::info("SpatialGrid", "100 karts, 200 flyables: grid %.3f ms, "
+              "linear search %.3f ms per frame.",
+              (end_grid - start_grid) * 10.0, (end_linear - end_grid) * 10.0);
+
+    // Compare the results of single queries
+    for (unsigned int i = 0; i < karts.size(); i++)
+    {
+        const Vec3 &xyz = karts[i];
+        auto cost = [&karts, &xyz, i](unsigned int index)
+        {
+            return index == i ? -1.0f : (karts[index] - xyz).length2();
+        };
+        unsigned int found = kart_grid.findNearest(xyz, 4, 1e30f, cost,
+                                                   nearest);
+        assert(found == 4);
+        for (unsigned int m = 0; m < found; m++)
+        {
+            float d2 = (karts[nearest[m]] - xyz).length2();
+            unsigned int smaller = 0;
+            for (unsigned int j = 0; j < karts.size(); j++)
+            {
+                const float dj = (karts[j] - xyz).length2();
+                if (j != i && (dj < d2 || (dj == d2 && j < nearest[m])))
+                    smaller++;
+            }
+            assert(smaller == m);
+            (void)smaller;
+        }
+
+        // Limited search distance
+        auto limited = [&karts, &xyz, i](unsigned int index)
+        {
+            const float d2 = (karts[index] - xyz).length2();
+            return index == i || d2 > 50.0f * 50.0f ? -1.0f : d2;
+        };
+        found = kart_grid.findNearest(xyz, 1, 50.0f, limited, nearest);
+        unsigned int expected = 0;
+        for (unsigned int j = 0; j < karts.size(); j++)
+        {
+            if (limited(j) >= 0)
+                expected++;
+        }
+        assert(found == std::min(expected, 1u));
+        (void)found; (void)expected;
+    }
+
+    kart_grid.clear();
+    assert(kart_grid.getNumPoints() == 0);
+    assert(kart_grid.findNearest(Vec3(0, 0, 0), 1, 1e30f,
+                                 [](unsigned int i) { return 0.0f; },
+                                 nearest) == 0);
+}   // unitTesting
@@ -0,0 +1,256 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_SPATIAL_GRID_HPP
+#define HEADER_SPATIAL_GRID_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+#include "utils/vec3.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <cmath>
+#include <vector>
+
+/**
+  * \brief A hashed uniform grid (in the x/z plane) over a set of points,
+  *  which is rebuilt from scratch whenever the points move (e.g. once per
+  *  frame). Building sorts the points by cell with a counting sort, so it
+  *  does not allocate memory once the internal arrays are big enough.
+  *  Cells are hashed into a number of buckets proportional to the number
+  *  of points, so the grid has no bounds and the memory does not depend on
+  *  the size of the track. Points are identified by their index in the
+  *  array passed to build().
+  * \ingroup utils
+  */
+class SpatialGrid : public NoCopy
+{
+public:
+    /** Maximum number of points returned by findNearest. */
+    static const unsigned int MAX_NEAREST = 16;
+
+private:
+    /** A point, stored in the order of the buckets. */
+    struct Entry
+    {
+        float    m_x, m_y, m_z;
+        int      m_cell_x, m_cell_z;
+        uint32_t m_index;
+    };   // Entry
+
+    /** Side length of a cell and its inverse. */
+    float m_cell_size, m_inv_cell_size;
+
+    /** All points, sorted by bucket. */
+    std::vector<Entry>    m_entries;
+
+    /** Index of the first entry of each bucket, with one additional
+     *  element (the number of entries) at the end. */
+    std::vector<uint32_t> m_bucket_start;
+
+    /** Number of buckets minus one, the number of buckets is a power of 2. */
+    uint32_t m_bucket_mask;
+
+    /** Range of cells which contain at least one point. */
+    int m_min_cell_x, m_max_cell_x, m_min_cell_z, m_max_cell_z;
+
+    // ------------------------------------------------------------------------
+    int getCell(float v) const { return (int)floorf(v * m_inv_cell_size); }
+    // ------------------------------------------------------------------------
+    uint32_t getBucket(int cell_x, int cell_z) const
+    {
+        return ((uint32_t)cell_x * 73856093u ^ (uint32_t)cell_z * 19349663u)
+               & m_bucket_mask;
+    }   // getBucket
+    // ------------------------------------------------------------------------
+    /** Calls f(entry) for all entries in the given cell. */
+    template<typename F>
+    void forEachInCell(int cell_x, int cell_z, F &f) const
+    {
+        const uint32_t bucket = getBucket(cell_x, cell_z);
+        const Entry *e   = m_entries.data() + m_bucket_start[bucket];
+        const Entry *end = m_entries.data() + m_bucket_start[bucket + 1];
+        for (; e != end; e++)
+        {
+            // Different cells can be hashed to the same bucket
+            if (e->m_cell_x == cell_x && e->m_cell_z == cell_z)
+                f(*e);
+        }
+    }   // forEachInCell
+
+public:
+         SpatialGrid(float cell_size);
+    void build(const std::vector<Vec3> &points);
+    void clear();
+    static void unitTesting();
+    // ------------------------------------------------------------------------
+    /** Returns the number of points in the grid. */
+    unsigned int getNumPoints() const
+    {
+        return (unsigned int)m_entries.size();
+    }   // getNumPoints
+    // ------------------------------------------------------------------------
+    /** Calls f(index, distance2) for each point whose squared distance to
+     *  center is less than radius*radius. The order of the calls is not
+     *  specified.
+     *  \param center Center of the query sphere.
+     *  \param radius Radius of the query sphere.
+     *  \param f The function to call.
+     */
+    template<typename F>
+    void forEachInRadius(const Vec3 &center, float radius, F f) const
+    {
+        if (m_entries.empty() || radius <= 0)
+            return;
+        const float r2 = radius * radius;
+        auto test = [&center, r2, &f](const Entry &e)
+        {
+            const float dx = e.m_x - center.getX();
+            const float dy = e.m_y - center.getY();
+            const float dz = e.m_z - center.getZ();
+            const float d2 = dx * dx + dy * dy + dz * dz;
+            if (d2 < r2)
+                f(e.m_index, d2);
+        };
+
+        const int x0 = std::max(getCell(center.getX() - radius), m_min_cell_x);
+        const int x1 = std::min(getCell(center.getX() + radius), m_max_cell_x);
+        const int z0 = std::max(getCell(center.getZ() - radius), m_min_cell_z);
+        const int z1 = std::min(getCell(center.getZ() + radius), m_max_cell_z);
+        if (x0 > x1 || z0 > z1)
+            return;
+        // If there are more cells to test than buckets, testing all
+        // points is faster.
+        if ((float)(x1 - x0 + 1) * (float)(z1 - z0 + 1) > m_bucket_mask)
+        {
+            for (const Entry &e : m_entries)
+                test(e);
+            return;
+        }
+        for (int x = x0; x <= x1; x++)
+        {
+            for (int z = z0; z <= z1; z++)
+                forEachInCell(x, z, test);
+        }
+    }   // forEachInRadius
+
+    // ------------------------------------------------------------------------
+    /** Finds the (up to) k points with the smallest cost. The cost of a
+     *  point is computed by the caller, and must not be smaller than the
+     *  squared x/z distance of the point to center. This allows callers to
+     *  add penalties or to reject points (by returning a negative cost).
+     *  Points are sorted by cost, points with the same cost by index, so
+     *  the result is the same as testing all points in order.
+     *  \param center Center of the search.
+     *  \param k Maximum number of points to return (at most MAX_NEAREST).
+     *  \param max_distance Only points with an x/z distance to center of
+     *         at most max_distance are guaranteed to be considered, the
+     *         cost function must reject any points further away.
+     *  \param cost The cost function, called as cost(index).
+     *  \param result Array of at least k elements for the indices found.
+     *  \return The number of points found.
+     */
+    template<typename F>
+    unsigned int findNearest(const Vec3 &center, unsigned int k,
+                             float max_distance, F cost,
+                             unsigned int *result) const
+    {
+        assert(k > 0 && k <= MAX_NEAREST);
+        float best_cost[MAX_NEAREST];
+        unsigned int count = 0;
+        auto test = [k, &cost, &count, &best_cost, result](const Entry &e)
+        {
+            const float c = cost((unsigned int)e.m_index);
+            if (c < 0)
+                return;
+            // Insert sorted by cost and index
+            unsigned int i = count < k ? count : k;
+            while (i > 0 && (best_cost[i - 1] > c ||
+                   (best_cost[i - 1] == c && result[i - 1] > e.m_index)))
+            {
+                if (i < k)
+                {
+                    best_cost[i] = best_cost[i - 1];
+                    result[i]    = result[i - 1];
+                }
+                i--;
+            }
+            if (i < k)
+            {
+                best_cost[i] = c;
+                result[i]    = e.m_index;
+                if (count < k) count++;
+            }
+        };
+
+        if (m_entries.empty())
+            return 0;
+        const int cx = getCell(center.getX());
+        const int cz = getCell(center.getZ());
+        // Search rings of cells around the cell of center. A point which
+        // is not in the rings 0 to r-1 is more than (r-1) cell sizes away
+        // from center (which can be anywhere in its cell).
+        uint32_t tested_cells = 0;
+        for (int r = 0; ; r++)
+        {
+            if (r > 0)
+            {
+                const int   done     = r - 1;
+                const float searched = done * m_cell_size;
+                if (count == k && best_cost[k - 1] < searched * searched)
+                    break;
+                if (searched > max_distance)
+                    break;
+                if (cx - done <= m_min_cell_x && cx + done >= m_max_cell_x &&
+                    cz - done <= m_min_cell_z && cz + done >= m_max_cell_z)
+                    break;
+            }
+            tested_cells += r == 0 ? 1 : 8 * r;
+            if (tested_cells > m_entries.size())
+            {
+                // The points are too far apart, testing all of them is
+                // cheaper than testing more cells
+                count = 0;
+                for (const Entry &e : m_entries)
+                    test(e);
+                break;
+            }
+            if (r == 0)
+            {
+                forEachInCell(cx, cz, test);
+                continue;
+            }
+            for (int x = cx - r; x <= cx + r; x++)
+            {
+                if (x < m_min_cell_x || x > m_max_cell_x) continue;
+                if (cz - r >= m_min_cell_z) forEachInCell(x, cz - r, test);
+                if (cz + r <= m_max_cell_z) forEachInCell(x, cz + r, test);
+            }
+            for (int z = cz - r + 1; z <= cz + r - 1; z++)
+            {
+                if (z < m_min_cell_z || z > m_max_cell_z) continue;
+                if (cx - r >= m_min_cell_x) forEachInCell(cx - r, z, test);
+                if (cx + r <= m_max_cell_x) forEachInCell(cx + r, z, test);
+            }
+        }   // for r
+        return count;
+    }   // findNearest
+};   // SpatialGrid
+
+#endif
@@ -33,7 +33,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <cwchar>
+#include <fstream>
 #include <iostream>
+#include <iterator>
 #include <vector>
 
 #if ENABLE_BIDI
@@ -54,7 +56,6 @@
 using namespace tinygettext;
 
 Translations* translations = NULL;
-const bool REMOVE_BOM = false;
 
 #ifdef LINUX // m_debug
 #define PACKAGE "supertuxkart"
@@ -174,6 +175,7 @@ wchar_t* fromFribidiChar(const FriBidiChar* str)
 // ----------------------------------------------------------------------------
 Translations::Translations() //: m_dictionary_manager("UTF-16")
 {
+    m_table = NULL;
     m_dictionary_manager.add_directory(
                         file_manager->getAsset(FileManager::TRANSLATION,""));
 
@@ -323,7 +325,6 @@ Translations::Translations() //: m_dictionary_manager("UTF-16")
                 {
                     Log::verbose("translation", "Language '%s'.",
                                  l.get_name().c_str());
-                    m_dictionary = m_dictionary_manager.get_dictionary(l);
                     break;
                 }
             }
@@ -331,10 +332,8 @@ Translations::Translations() //: m_dictionary_manager("UTF-16")
             m_current_language_name = l.get_name();
             m_current_language_name_code = l.get_language();
 
-            if (!l)
-            {
-                m_dictionary = m_dictionary_manager.get_dictionary();
-            }
+            // Loads the default dictionary if no language was found
+            loadLanguage(l);
         }
         else
         {
@@ -345,14 +344,14 @@ Translations::Translations() //: m_dictionary_manager("UTF-16")
                 UserConfigParams::m_language = "system";
                 m_current_language_name = "Default language";
                 m_current_language_name_code = "en";
-                m_dictionary = m_dictionary_manager.get_dictionary();
+                loadLanguage(Language());
             }
             else
             {
                 m_current_language_name = tgtLang.get_name();
                 m_current_language_name_code = tgtLang.get_language();
                 Log::verbose("translation", "Language '%s'.", m_current_language_name.c_str());
-                m_dictionary = m_dictionary_manager.get_dictionary(tgtLang);
+                loadLanguage(tgtLang);
             }
         }
     }
@@ -360,7 +359,7 @@ Translations::Translations() //: m_dictionary_manager("UTF-16")
     {
         m_current_language_name = "Default language";
         m_current_language_name_code = "en";
-        m_dictionary = m_dictionary_manager.get_dictionary();
+        loadLanguage(Language());
     }
 
     // This is a silly but working hack I added to determine whether the
@@ -375,19 +374,11 @@ Translations::Translations() //: m_dictionary_manager("UTF-16")
     //      N (or nothing) otherwise
     ignore(_("   Is this a RTL language?"));
 
-    const std::string isRtl =
-        m_dictionary.translate("   Is this a RTL language?");
-
-    m_rtl = false;
+    const TranslationTable::Message *is_rtl =
+        m_table->find(NULL, "   Is this a RTL language?", false);
 
-    for (unsigned int n=0; n < isRtl.size(); n++)
-    {
-        if (isRtl[n] == 'Y')
-        {
-            m_rtl = true;
-            break;
-        }
-    }
+    m_rtl = is_rtl && is_rtl->m_forms.size() > 0 &&
+            is_rtl->m_forms[0]->m_text.findFirst(L'Y') >= 0;
 #ifdef TEST_BIDI
     m_rtl = true;
 #endif
@@ -397,12 +388,229 @@ Translations::Translations() //: m_dictionary_manager("UTF-16")
 
 Translations::~Translations()
 {
+    delete m_table;
 }   // ~Translations
 
+// ----------------------------------------------------------------------------
+/** Creates the translations of a dictionary without using any files or
+ *  the cache, used for unit testing.
+ */
+Translations::Translations(Dictionary& dictionary)
+{
+    m_table = NULL;
+    m_rtl   = false;
+    buildTable(dictionary, /*extra_capacity*/16);
+}   // Translations
+
+// ----------------------------------------------------------------------------
+/** Unit testing function: checks that plural and context messages which
+ *  only exist in the fallback dictionary (e.g. 'pt' for 'pt_BR') are
+ *  translated, and that the plural rule of the fallback language is used.
+ */
+void Translations::unitTesting()
+{
+    Dictionary base;
+    base.set_plural_forms(
+        PluralForms::from_string("Plural-Forms: nplurals=2; plural=(n != 1);"));
+    std::vector<std::string> laps;
+    laps.push_back("%d volta");
+    laps.push_back("%d voltas");
+    base.add_translation("%d lap", "%d laps", laps);
+    base.add_translation("menu", "Back", "Voltar");
+    base.add_translation("Start", "Iniciar");
+
+    // The regional language has a different plural rule, which would
+    // always select the first form.
+    Dictionary regional;
+    regional.set_plural_forms(
+        PluralForms::from_string("Plural-Forms: nplurals=1; plural=0;"));
+    regional.add_translation("Start", "Comecar");
+    regional.addFallback(&base);
+
+    Translations t(regional);
+    assert(wcscmp(t.w_ngettext("%d lap", "%d laps", 1), L"%d volta") == 0);
+    assert(wcscmp(t.w_ngettext("%d lap", "%d laps", 5), L"%d voltas") == 0);
+    assert(wcscmp(t.w_gettext("Back", "menu"), L"Voltar") == 0);
+    assert(wcscmp(t.w_gettext("Back"), L"Back") == 0);
+    // The regional translation has priority
+    assert(wcscmp(t.w_gettext("Start"), L"Comecar") == 0);
+    assert(wcscmp(t.w_ngettext("%d kart", "%d karts", 5), L"%d karts") == 0);
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Creates the translation table for a language. The table is read from a
+ *  cache if the .po files did not change since it was written, otherwise
+ *  the .po files are parsed and a new cache is written.
+ *  \param language The language, if it is invalid the default dictionary
+ *         of the dictionary manager (usually empty) is used.
+ */
+void Translations::loadLanguage(const Language& language)
+{
+    // Number of untranslated messages that can be added at runtime
+    const unsigned int untranslated_capacity = 8192;
+
+    // The cache key is a hash of the names and content of all .po files
+    std::vector<std::string> po_files;
+    if (language)
+        m_dictionary_manager.get_po_files(language, &po_files);
+    uint64_t key = 14695981039346656037ULL;
+    for (unsigned int i = 0; i < po_files.size(); i++)
+    {
+        std::string content = po_files[i];
+        std::ifstream in(po_files[i].c_str(), std::ios::in | std::ios::binary);
+        content.append(std::istreambuf_iterator<char>(in),
+                       std::istreambuf_iterator<char>());
+        for (unsigned int j = 0; j < content.size(); j++)
+            key = (key ^ (uint8_t)content[j]) * 1099511628211ULL;
+    }
+#if ENABLE_BIDI
+    // Fribidized strings are cached too
+    key = (key ^ 1) * 1099511628211ULL;
+#endif
+
+    const std::string cache_dir = file_manager->getCachedTexturesDir()
+                                + "translations/";
+    const std::string cache_file = language
+                                 ? cache_dir + language.str() + ".stktr" : "";
+    if (!po_files.empty())
+    {
+        std::string plural_forms, fallback_plural_forms;
+        m_table = TranslationTable::load(cache_file, key,
+                                         untranslated_capacity,
+                                         &plural_forms,
+                                         &fallback_plural_forms);
+        if (m_table)
+        {
+            m_plural_forms = PluralForms::from_string(plural_forms);
+            m_fallback_plural_forms =
+                PluralForms::from_string(fallback_plural_forms);
+            Log::info("translation", "Loaded %d messages from '%s'.",
+                      m_table->getNumMessages(), cache_file.c_str());
+            return;
+        }
+    }
+
+    Dictionary& dictionary = language
+                           ? m_dictionary_manager.get_dictionary(language)
+                           : m_dictionary_manager.get_dictionary();
+    buildTable(dictionary, untranslated_capacity);
+
+    if (!po_files.empty())
+    {
+        file_manager->checkAndCreateDirectoryP(cache_dir);
+        if (!m_table->save(cache_file, key,
+                           m_plural_forms.get_expression(),
+                           m_fallback_plural_forms.get_expression()))
+        {
+            Log::warn("translation", "Can not write cache '%s'.",
+                      cache_file.c_str());
+        }
+    }
+}   // loadLanguage
+
+// ----------------------------------------------------------------------------
+/** Creates the translation table from a dictionary and its fallback
+ *  dictionary.
+ *  \param dictionary The dictionary of the language.
+ *  \param extra_capacity Number of untranslated messages that can be added
+ *         at runtime.
+ */
+void Translations::buildTable(Dictionary& dictionary,
+                              unsigned int extra_capacity)
+{
+    m_plural_forms = dictionary.get_plural_forms();
+    Dictionary *fallback = dictionary.get_fallback();
+    m_fallback_plural_forms = fallback ? fallback->get_plural_forms()
+                                       : PluralForms();
+
+    // Count the messages to size the table
+    unsigned int num_messages = 0;
+    auto count = [&num_messages](const std::string&,
+                                 const std::vector<std::string>& msgstrs)
+    {
+        num_messages += (unsigned int)msgstrs.size();
+    };
+    auto count_ctxt = [&count](const std::string&, const std::string& msgid,
+                               const std::vector<std::string>& msgstrs)
+    {
+        count(msgid, msgstrs);
+    };
+    for (Dictionary *d = &dictionary; d; d = d->get_fallback())
+    {
+        d->foreach(count);
+        d->foreach_ctxt(count_ctxt);
+    }
+    delete m_table;
+    m_table = new TranslationTable(num_messages + extra_capacity);
+
+    // Messages of the language itself are added first, so that they have
+    // priority over the fallback dictionary.
+    for (Dictionary *d = &dictionary; d; d = d->get_fallback())
+    {
+        const TranslationTable::MessageType type = d == &dictionary
+                                         ? TranslationTable::MT_TRANSLATED
+                                         : TranslationTable::MT_FALLBACK;
+        d->foreach([this, type](const std::string& msgid,
+                                const std::vector<std::string>& msgstrs)
+        {
+            addMessage(NULL, msgid, msgstrs, type);
+        });
+        d->foreach_ctxt([this, type](const std::string& ctxt,
+                                     const std::string& msgid,
+                                     const std::vector<std::string>& msgstrs)
+        {
+            addMessage(&ctxt, msgid, msgstrs, type);
+        });
+    }
+}   // buildTable
+
+// ----------------------------------------------------------------------------
+/** Adds a message of a dictionary to the translation table. Messages
+ *  without translation are ignored.
+ *  \param context The context or NULL.
+ *  \param msgid The message.
+ *  \param msgstrs The translations in UTF-8.
+ *  \param type MT_TRANSLATED or MT_FALLBACK.
+ */
+void Translations::addMessage(const std::string* context,
+                              const std::string& msgid,
+                              const std::vector<std::string>& msgstrs,
+                              TranslationTable::MessageType type)
+{
+    if (msgstrs.empty())
+        return;
+    std::vector<TranslationTable::Text> forms;
+    for (unsigned int i = 0; i < msgstrs.size(); i++)
+        forms.push_back(makeText(msgstrs[i]));
+    m_table->add(context ? context->c_str() : NULL, msgid.c_str(), type,
+                 forms);
+}   // addMessage
+
+// ----------------------------------------------------------------------------
+/** Converts a UTF-8 string to a text of the translation table, i.e. to a
+ *  wide string and its fribidized version. */
+TranslationTable::Text Translations::makeText(const std::string& text)
+{
+    TranslationTable::Text t;
+    t.m_text = StringUtils::utf8ToWide(text);
+    t.m_rtl  = isRTLText(t.m_text.c_str());
+    if (t.m_rtl)
+        t.m_fribidized = fribidizeText(t.m_text.c_str());
+    return t;
+}   // makeText
+
 // ----------------------------------------------------------------------------
 
+/** Returns the string in visual order if it contains right-to-left text,
+ *  otherwise the string itself. Translated strings are fribidized when the
+ *  language is loaded, so for them this is only a lookup.
+ */
 const wchar_t* Translations::fribidize(const wchar_t* in_ptr)
 {
+    const TranslationTable::Text *text = m_table->findText(in_ptr);
+    if (text)
+        return text->m_rtl ? text->m_fribidized.c_str() : in_ptr;
+
     if (isRTLText(in_ptr))
     {
         // Test if this string was already fribidized
@@ -411,31 +619,9 @@ const wchar_t* Translations::fribidize(const wchar_t* in_ptr)
         if (found != m_fribidized_strings.cend())
             return found->second.c_str();
 
-        // Use fribidi to fribidize the string
-        // Split text into lines
-        std::vector<core::stringw> input_lines = StringUtils::split(in_ptr, '\n');
-        // Reverse lines for RTL strings, irrlicht will reverse them back
-        // This is needed because irrlicht inserts line breaks itself if a text
-        // is too long for one line and then reverses the lines again.
-        std::reverse(input_lines.begin(), input_lines.end());
-
-        // Fribidize and concat lines
-        core::stringw converted_string;
-        for (std::vector<core::stringw>::iterator it = input_lines.begin();
-             it != input_lines.end(); it++)
-        {
-            if (it == input_lines.begin())
-                converted_string = fribidizeLine(*it);
-            else
-            {
-                converted_string += "\n";
-                converted_string += fribidizeLine(*it);
-            }
-        }
-
         // Save it in the map
         m_fribidized_strings.insert(std::pair<const irr::core::stringw, const irr::core::stringw>(
-            in_ptr, converted_string));
+            in_ptr, fribidizeText(in_ptr)));
         found = m_fribidized_strings.find(in_ptr);
 
         return found->second.c_str();
@@ -444,6 +630,33 @@ const wchar_t* Translations::fribidize(const wchar_t* in_ptr)
         return in_ptr;
 }
 
+// ----------------------------------------------------------------------------
+/** Converts a (possibly multi-line) right-to-left string to visual order. */
+core::stringw Translations::fribidizeText(const wchar_t* in_ptr)
+{
+    // Split text into lines
+    std::vector<core::stringw> input_lines = StringUtils::split(in_ptr, '\n');
+    // Reverse lines for RTL strings, irrlicht will reverse them back
+    // This is needed because irrlicht inserts line breaks itself if a text
+    // is too long for one line and then reverses the lines again.
+    std::reverse(input_lines.begin(), input_lines.end());
+
+    // Fribidize and concat lines
+    core::stringw converted_string;
+    for (std::vector<core::stringw>::iterator it = input_lines.begin();
+         it != input_lines.end(); it++)
+    {
+        if (it == input_lines.begin())
+            converted_string = fribidizeLine(*it);
+        else
+        {
+            converted_string += "\n";
+            converted_string += fribidizeLine(*it);
+        }
+    }
+    return converted_string;
+}   // fribidizeText
+
 bool Translations::isRTLText(const wchar_t *in_ptr)
 {
 #if ENABLE_BIDI
@@ -485,6 +698,7 @@ const wchar_t* Translations::w_gettext(const wchar_t* original, const char* cont
  * \param original Message to translate
  * \param context  Optional, can be set to differentiate 2 strings that are identical
  *                 in English but could be different in other languages
+ * \return The translation, which stays valid until the language changes.
  */
 const wchar_t* Translations::w_gettext(const char* original, const char* context)
 {
@@ -494,37 +708,38 @@ const wchar_t* Translations::w_gettext(const char* original, const char* context
     Log::info("Translations", "Translating %s", original);
 #endif
 
-    const std::string& original_t = (context == NULL ?
-                                     m_dictionary.translate(original) :
-                                     m_dictionary.translate_ctxt(context, original));
-
-    if (original_t == original)
-    {
-        static irr::core::stringw converted_string;
-        converted_string = StringUtils::utf8ToWide(original);
-
-#if TRANSLATE_VERBOSE
-        std::wcout << L"  translation : " << converted_string << std::endl;
-#endif
-        return converted_string.c_str();
-    }
-
-    // print
-    //for (int n=0;; n+=4)
-
-    static core::stringw original_tw;
-    original_tw = StringUtils::utf8ToWide(original_t);
+    const TranslationTable::Message *message =
+        m_table->find(context, original, /*untranslated*/false);
+    if (message && message->m_forms.size() > 0)
+        return message->m_forms[0]->m_text.c_str();
 
-    const wchar_t* out_ptr = original_tw.c_str();
-    if (REMOVE_BOM) out_ptr++;
-
-#if TRANSLATE_VERBOSE
-    std::wcout << L"  translation : " << out_ptr << std::endl;
-#endif
-
-    return out_ptr;
+    return getUntranslated(original);
 }
 
+// ----------------------------------------------------------------------------
+/** Returns the wide string version of an untranslated message. It is added
+ *  to the table when it is used the first time, so that the next call does
+ *  not need to convert it again.
+ */
+const wchar_t* Translations::getUntranslated(const char* msgid)
+{
+    const TranslationTable::Message *message =
+        m_table->find(NULL, msgid, /*untranslated*/true);
+    if (message)
+        return message->m_forms[0]->m_text.c_str();
+
+    std::vector<TranslationTable::Text> forms(1, makeText(msgid));
+    message = m_table->add(NULL, msgid, TranslationTable::MT_UNTRANSLATED,
+                           forms);
+    if (message)
+        return message->m_forms[0]->m_text.c_str();
+
+    // The table is full
+    static irr::core::stringw converted_string;
+    converted_string = StringUtils::utf8ToWide(msgid);
+    return converted_string.c_str();
+}   // getUntranslated
+
 /**
  * \param singular Message to translate in singular form
  * \param plural   Message to translate in plural form (can be the same as the singular form)
@@ -548,20 +763,21 @@ const wchar_t* Translations::w_ngettext(const wchar_t* singular, const wchar_t*
  */
 const wchar_t* Translations::w_ngettext(const char* singular, const char* plural, int num, const char* context)
 {
-    const std::string& res = (context == NULL ?
-                              m_dictionary.translate_plural(singular, plural, num) :
-                              m_dictionary.translate_ctxt_plural(context, singular, plural, num));
-
-    static core::stringw str_buffer;
-    str_buffer = StringUtils::utf8ToWide(res);
-    const wchar_t* out_ptr = str_buffer.c_str();
-    if (REMOVE_BOM) out_ptr++;
-
-#if TRANSLATE_VERBOSE
-    std::wcout << L"  translation : " << out_ptr << std::endl;
-#endif
+    // Messages of the fallback dictionary use its plural rule
+    const TranslationTable::Message *message =
+        m_table->find(context, singular, /*untranslated*/false);
+    if (message)
+    {
+        const unsigned int n =
+            message->m_type == TranslationTable::MT_FALLBACK
+            ? m_fallback_plural_forms.get_plural(num)
+            : m_plural_forms.get_plural(num);
+        if (n < message->m_forms.size() &&
+            message->m_forms[n]->m_text.size() > 0)
+            return message->m_forms[n]->m_text.c_str();
+    }
 
-    return out_ptr;
+    return getUntranslated(num == 1 ? singular : plural);
 }
 
 
@@ -572,7 +788,9 @@ bool Translations::isRTLLanguage() const
 
 std::set<wchar_t> Translations::getCurrentAllChar()
 {
-    return m_dictionary.get_all_used_chars();
+    std::set<wchar_t> used_chars;
+    m_table->getAllChars(&used_chars);
+    return used_chars;
 }
 
 std::string Translations::getCurrentLanguageName()
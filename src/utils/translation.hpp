@@ -26,6 +26,7 @@
 #include <vector>
 
 #include "utils/string_utils.hpp"
+#include "utils/translation_table.hpp"
 
 #include "tinygettext/tinygettext.hpp"
 
@@ -47,7 +48,17 @@ class Translations
 {
 private:
     tinygettext::DictionaryManager m_dictionary_manager;
-    tinygettext::Dictionary        m_dictionary;
+
+    /** All translations of the current language, precompiled to wide
+     *  and fribidized strings. */
+    TranslationTable              *m_table;
+
+    /** The plural forms of the current language. */
+    tinygettext::PluralForms       m_plural_forms;
+
+    /** The plural forms of the fallback language (e.g. 'pt' for 'pt_BR'),
+     *  used for plural messages only found in the fallback dictionary. */
+    tinygettext::PluralForms       m_fallback_plural_forms;
 
     /** A map that saves all fribidized strings: Original string, fribidized string */
     std::map<const irr::core::stringw, const irr::core::stringw> m_fribidized_strings;
@@ -85,7 +96,20 @@ public:
 
     const std::string&       getLocalizedName(const std::string& str) const;
 
+    static void              unitTesting();
+
 private:
+                       Translations(tinygettext::Dictionary &dictionary);
+    void               loadLanguage(const tinygettext::Language &language);
+    void               buildTable(tinygettext::Dictionary &dictionary,
+                                  unsigned int extra_capacity);
+    void               addMessage(const std::string *context,
+                                  const std::string &msgid,
+                                  const std::vector<std::string> &msgstrs,
+                                  TranslationTable::MessageType type);
+    TranslationTable::Text makeText(const std::string &text);
+    const wchar_t*     getUntranslated(const char *msgid);
+    irr::core::stringw fribidizeText(const wchar_t *in_ptr);
     irr::core::stringw fribidizeLine(const irr::core::stringw &str);
 };   // Translations
 
@@ -0,0 +1,501 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#include "utils/translation_table.hpp"
+
+#include <algorithm>
+#include <assert.h>
+#include <fstream>
+#include <map>
+#include <string.h>
+
+/** Version of the cache format, increase if the format changes. */
+static const uint32_t TRANSLATION_CACHE_VERSION = 2;
+
+/** Upper limit for the length of a string and the number of elements in
+ *  a cache, to detect corrupted files. */
+static const uint32_t MAX_CACHED_SIZE = 1 << 20;
+
+namespace
+{
+    // ------------------------------------------------------------------------
+    template<typename T>
+    void writeValue(std::ofstream &ofs, T value)
+    {
+        ofs.write((const char*)&value, sizeof(T));
+    }   // writeValue
+
+    // ------------------------------------------------------------------------
+    template<typename T>
+    void readValue(std::ifstream &ifs, T *value)
+    {
+        ifs.read((char*)value, sizeof(T));
+    }   // readValue
+
+    // ------------------------------------------------------------------------
+    template<typename C>
+    void writeString(std::ofstream &ofs, const C *s, uint32_t length)
+    {
+        writeValue(ofs, length);
+        ofs.write((const char*)s, length * sizeof(C));
+    }   // writeString
+
+    // ------------------------------------------------------------------------
+    /** Reads a string written by writeString.
+     *  \return False if the file is corrupted. */
+    template<typename C>
+    bool readString(std::ifstream &ifs, std::vector<C> *s)
+    {
+        uint32_t length = 0;
+        readValue(ifs, &length);
+        if (ifs.fail() || length > MAX_CACHED_SIZE)
+            return false;
+        s->resize(length + 1);
+        ifs.read((char*)s->data(), length * sizeof(C));
+        (*s)[length] = 0;
+        return !ifs.fail();
+    }   // readString
+}   // namespace
+
+// ----------------------------------------------------------------------------
+/** Unit testing function: adds messages, and checks the lookups and that
+ *  the capacity is respected.
+ */
+void TranslationTable::unitTesting()
+{
+    TranslationTable table(8);
+
+    std::vector<Text> forms(2);
+    forms[0].m_text = L"Runde";
+    forms[0].m_rtl  = false;
+    forms[1].m_text = L"Runden";
+    forms[1].m_rtl  = false;
+    const Message *lap = table.add(NULL, "Lap", MT_TRANSLATED, forms);
+    assert(lap && lap->m_forms.size() == 2);
+    assert(table.find(NULL, "Lap", false) == lap);
+    assert(table.find(NULL, "Lap", true) == NULL);
+    assert(table.find("ctx", "Lap", false) == NULL);
+    assert(table.find(NULL, "Lap2", false) == NULL);
+    assert(lap->m_forms[1]->m_text == L"Runden");
+
+    // Adding a message again returns the existing message
+    forms.resize(1);
+    assert(table.add(NULL, "Lap", MT_FALLBACK, forms) == lap);
+
+    // Same msgid with a context and untranslated are different messages,
+    // texts are shared.
+    const Message *ctx = table.add("ctx", "Lap", MT_TRANSLATED, forms);
+    assert(ctx && ctx != lap && table.find("ctx", "Lap", false) == ctx);
+    assert(ctx->m_forms[0] == lap->m_forms[0]);
+    forms[0].m_text = L"Lap";
+    const Message *untranslated = table.add(NULL, "Lap", MT_UNTRANSLATED,
+                                            forms);
+    assert(untranslated && table.find(NULL, "Lap", true) == untranslated);
+    assert(table.find(NULL, "Lap", false) == lap);
+
+    const Text *text = table.findText(L"Runde");
+    assert(text == lap->m_forms[0]);
+    assert(table.findText(L"Rund") == NULL);
+    assert(table.findText(L"") == NULL);
+
+    std::set<wchar_t> chars;
+    table.getAllChars(&chars);
+    // Untranslated texts are not included
+    assert(chars.size() == 5 && chars.count(L'L') == 0);
+
+    // Fill the table up to its capacity
+    unsigned int n = table.getNumMessages();
+    assert(n == 3);
+    for (; n < 8; n++)
+    {
+        std::string msgid = "Message" + std::string(1, (char)('0' + n));
+        assert(table.add(NULL, msgid.c_str(), MT_TRANSLATED, forms));
+    }
+    assert(table.add(NULL, "Too many", MT_TRANSLATED, forms) == NULL);
+    assert(table.find(NULL, "Message7", false) != NULL);
+    assert(lap->m_forms[1]->m_text == L"Runden");
+    // Avoid warnings if asserts are disabled
+    (void)lap; (void)ctx; (void)untranslated; (void)text;
+}   // unitTesting
+
+// ----------------------------------------------------------------------------
+/** Creates an empty table.
+ *  \param capacity The maximum number of messages, and of texts.
+ */
+TranslationTable::TranslationTable(unsigned int capacity)
+{
+    m_capacity = capacity;
+    uint64_t num_slots = 16;
+    while (num_slots < 2 * (uint64_t)capacity)
+        num_slots *= 2;
+    m_mask = num_slots - 1;
+    m_message_slots.reset(new std::atomic<const Message*>[num_slots]);
+    m_text_slots.reset(new std::atomic<const Text*>[num_slots]);
+    for (uint64_t i = 0; i < num_slots; i++)
+    {
+        m_message_slots[i].store(NULL, std::memory_order_relaxed);
+        m_text_slots[i].store(NULL, std::memory_order_relaxed);
+    }
+}   // TranslationTable
+
+// ----------------------------------------------------------------------------
+/** Returns a 64-bit FNV-1a hash of a message key. */
+uint64_t TranslationTable::hashMessage(const char *context, const char *msgid,
+                                       bool untranslated)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    hash = (hash ^ (untranslated ? 1 : 0)) * 1099511628211ULL;
+    if (context)
+    {
+        for (const char *c = context; *c; c++)
+            hash = (hash ^ (uint8_t)*c) * 1099511628211ULL;
+        // Separator as used in .mo files
+        hash = (hash ^ 4) * 1099511628211ULL;
+    }
+    for (const char *c = msgid; *c; c++)
+        hash = (hash ^ (uint8_t)*c) * 1099511628211ULL;
+    return hash;
+}   // hashMessage
+
+// ----------------------------------------------------------------------------
+/** Returns a 64-bit FNV-1a hash of a wide string. */
+uint64_t TranslationTable::hashText(const wchar_t *text)
+{
+    uint64_t hash = 14695981039346656037ULL;
+    for (const wchar_t *c = text; *c; c++)
+        hash = (hash ^ (uint32_t)*c) * 1099511628211ULL;
+    return hash;
+}   // hashText
+
+// ----------------------------------------------------------------------------
+/** Looks up a message. Lock free, can be called from any thread.
+ *  \param context The context of the message or NULL.
+ *  \param msgid The message.
+ *  \param untranslated If true an untranslated message is searched,
+ *         otherwise a translated (or fallback) one.
+ *  \return The message or NULL if it is not in the table.
+ */
+const TranslationTable::Message*
+    TranslationTable::find(const char *context, const char *msgid,
+                           bool untranslated) const
+{
+    const uint64_t hash = hashMessage(context, msgid, untranslated);
+    for (uint64_t i = hash & m_mask; ; i = (i + 1) & m_mask)
+    {
+        const Message *m = m_message_slots[i].load(std::memory_order_acquire);
+        if (!m)
+            return NULL;
+        if (m->m_hash == hash &&
+            (m->m_type == MT_UNTRANSLATED) == untranslated &&
+            m->m_has_context == (context != NULL) &&
+            (!context || m->m_context == context) && m->m_msgid == msgid)
+            return m;
+    }
+}   // find
+
+// ----------------------------------------------------------------------------
+/** Looks up the form of a message with the given text. Lock free, can be
+ *  called from any thread.
+ *  \return The text or NULL if no message has this text.
+ */
+const TranslationTable::Text*
+    TranslationTable::findText(const wchar_t *text) const
+{
+    const uint64_t hash = hashText(text);
+    for (uint64_t i = hash & m_mask; ; i = (i + 1) & m_mask)
+    {
+        const Text *t = m_text_slots[i].load(std::memory_order_acquire);
+        if (!t)
+            return NULL;
+        if (t->m_hash == hash && t->m_text == text)
+            return t;
+    }
+}   // findText
+
+// ----------------------------------------------------------------------------
+/** Adds a text, or returns an identical existing text. Must be called with
+ *  the mutex locked.
+ *  \return The text, or NULL if the table is full.
+ */
+const TranslationTable::Text* TranslationTable::addText(const Text &text)
+{
+    // Empty texts are not indexed, since fribidize() does not need them
+    if (text.m_text.size() > 0)
+    {
+        const Text *existing = findText(text.m_text.c_str());
+        if (existing)
+            return existing;
+    }
+    if (m_texts.size() >= m_capacity)
+        return NULL;
+
+    m_texts.push_back(text);
+    Text &t = m_texts.back();
+    t.m_hash = hashText(t.m_text.c_str());
+    if (t.m_text.size() > 0)
+    {
+        uint64_t i = t.m_hash & m_mask;
+        while (m_text_slots[i].load(std::memory_order_relaxed))
+            i = (i + 1) & m_mask;
+        m_text_slots[i].store(&t, std::memory_order_release);
+    }
+    return &t;
+}   // addText
+
+// ----------------------------------------------------------------------------
+/** Adds a message. Can be called while other threads look up messages.
+ *  \param context The context of the message or NULL.
+ *  \param msgid The message.
+ *  \param type The type of the message.
+ *  \param forms The translated forms. m_hash is computed.
+ *  \return The new message or an existing message with the same key, or
+ *          NULL if the table is full.
+ */
+const TranslationTable::Message*
+    TranslationTable::add(const char *context, const char *msgid,
+                          MessageType type, const std::vector<Text> &forms)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    const Message *existing = find(context, msgid, type == MT_UNTRANSLATED);
+    if (existing)
+        return existing;
+    if (m_messages.size() >= m_capacity ||
+        m_texts.size() + forms.size() > m_capacity)
+        return NULL;
+
+    Message message;
+    message.m_hash        = hashMessage(context, msgid,
+                                        type == MT_UNTRANSLATED);
+    message.m_has_context = context != NULL;
+    message.m_context     = context ? context : "";
+    message.m_msgid       = msgid;
+    message.m_type        = type;
+    for (unsigned int i = 0; i < forms.size(); i++)
+        message.m_forms.push_back(addText(forms[i]));
+    m_messages.push_back(message);
+
+    // Publish the message only when it is completely initialised
+    const Message *m = &m_messages.back();
+    uint64_t i = m->m_hash & m_mask;
+    while (m_message_slots[i].load(std::memory_order_relaxed))
+        i = (i + 1) & m_mask;
+    m_message_slots[i].store(m, std::memory_order_release);
+    return m;
+}   // add
+
+// ----------------------------------------------------------------------------
+/** Inserts all characters of the (fribidized) translations into a set, e.g.
+ *  to preload the glyphs of a font. */
+void TranslationTable::getAllChars(std::set<wchar_t> *chars) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (unsigned int i = 0; i < m_messages.size(); i++)
+    {
+        const Message &m = m_messages[i];
+        if (m.m_type != MT_TRANSLATED)
+            continue;
+        for (unsigned int j = 0; j < m.m_forms.size(); j++)
+        {
+            const irr::core::stringw &s = m.m_forms[j]->m_rtl
+                                        ? m.m_forms[j]->m_fribidized
+                                        : m.m_forms[j]->m_text;
+            for (unsigned int k = 0; k < s.size(); k++)
+                chars->insert(s[k]);
+        }
+    }
+}   // getAllChars
+
+// ----------------------------------------------------------------------------
+unsigned int TranslationTable::getNumMessages() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return (unsigned int)m_messages.size();
+}   // getNumMessages
+
+// ----------------------------------------------------------------------------
+/** Writes all translated messages to a cache file:<br>
+ *  <version><sizeof(wchar_t)><key><plural-forms><fallback-plural-forms>
+ *  <num-texts>
+ *  {<text><rtl>[<fribidized>]}<num-messages>{<type><has-context><context>
+ *  <msgid><num-forms>{<text-index>}}<br>
+ *  Strings are stored as length followed by the characters.
+ *  \param filename Name of the cache file.
+ *  \param key Identifies the .po files the table was created from.
+ *  \param plural_forms The plural forms expression of the language.
+ *  \param fallback_plural_forms The plural forms expression of the
+ *         fallback language, used for MT_FALLBACK messages.
+ *  \return True if the file was written.
+ */
+bool TranslationTable::save(const std::string &filename, uint64_t key,
+                            const std::string &plural_forms,
+                            const std::string &fallback_plural_forms) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Collect the texts used by translated messages
+    std::map<const Text*, uint32_t> text_index;
+    std::vector<const Text*> texts;
+    std::vector<const Message*> messages;
+    for (unsigned int i = 0; i < m_messages.size(); i++)
+    {
+        const Message &m = m_messages[i];
+        if (m.m_type == MT_UNTRANSLATED)
+            continue;
+        messages.push_back(&m);
+        for (unsigned int j = 0; j < m.m_forms.size(); j++)
+        {
+            if (text_index.find(m.m_forms[j]) != text_index.end())
+                continue;
+            text_index[m.m_forms[j]] = (uint32_t)texts.size();
+            texts.push_back(m.m_forms[j]);
+        }
+    }
+
+    std::ofstream ofs(filename.c_str(), std::ios::out | std::ios::binary);
+    if (!ofs.is_open())
+        return false;
+
+    writeValue(ofs, TRANSLATION_CACHE_VERSION);
+    writeValue(ofs, (uint8_t)sizeof(wchar_t));
+    writeValue(ofs, key);
+    writeString(ofs, plural_forms.c_str(), (uint32_t)plural_forms.size());
+    writeString(ofs, fallback_plural_forms.c_str(),
+                (uint32_t)fallback_plural_forms.size());
+    writeValue(ofs, (uint32_t)texts.size());
+    for (unsigned int i = 0; i < texts.size(); i++)
+    {
+        const Text *t = texts[i];
+        writeString(ofs, t->m_text.c_str(), t->m_text.size());
+        writeValue(ofs, (uint8_t)(t->m_rtl ? 1 : 0));
+        if (t->m_rtl)
+            writeString(ofs, t->m_fribidized.c_str(), t->m_fribidized.size());
+    }
+    writeValue(ofs, (uint32_t)messages.size());
+    for (unsigned int i = 0; i < messages.size(); i++)
+    {
+        const Message *m = messages[i];
+        writeValue(ofs, (uint8_t)m->m_type);
+        writeValue(ofs, (uint8_t)(m->m_has_context ? 1 : 0));
+        writeString(ofs, m->m_context.c_str(), (uint32_t)m->m_context.size());
+        writeString(ofs, m->m_msgid.c_str(), (uint32_t)m->m_msgid.size());
+        writeValue(ofs, (uint32_t)m->m_forms.size());
+        for (unsigned int j = 0; j < m->m_forms.size(); j++)
+            writeValue(ofs, text_index[m->m_forms[j]]);
+    }
+    return !ofs.fail();
+}   // save
+
+// ----------------------------------------------------------------------------
+/** Creates a table from a cache file written by save().
+ *  \param filename Name of the cache file.
+ *  \param key The cache is only used if it was saved with the same key.
+ *  \param extra_capacity Number of messages that can be added in addition
+ *         to the cached messages.
+ *  \param plural_forms Returns the plural forms expression.
+ *  \param fallback_plural_forms Returns the plural forms expression of the
+ *         fallback language.
+ *  \return The table, or NULL if the cache does not exist, is invalid or
+ *          has a different key.
+ */
+TranslationTable* TranslationTable::load(const std::string &filename,
+                                         uint64_t key,
+                                         unsigned int extra_capacity,
+                                         std::string *plural_forms,
+                                         std::string *fallback_plural_forms)
+{
+    std::ifstream ifs(filename.c_str(), std::ios::in | std::ios::binary);
+    if (!ifs.is_open())
+        return NULL;
+
+    uint32_t version = 0;
+    uint8_t wchar_size = 0;
+    uint64_t cached_key = 0;
+    readValue(ifs, &version);
+    readValue(ifs, &wchar_size);
+    readValue(ifs, &cached_key);
+    if (ifs.fail() || version != TRANSLATION_CACHE_VERSION ||
+        wchar_size != sizeof(wchar_t) || cached_key != key)
+        return NULL;
+
+    std::vector<char> s;
+    if (!readString(ifs, &s))
+        return NULL;
+    *plural_forms = s.data();
+    if (!readString(ifs, &s))
+        return NULL;
+    *fallback_plural_forms = s.data();
+
+    uint32_t num_texts = 0;
+    readValue(ifs, &num_texts);
+    if (ifs.fail() || num_texts > MAX_CACHED_SIZE)
+        return NULL;
+    std::vector<Text> texts(num_texts);
+    std::vector<wchar_t> w;
+    for (unsigned int i = 0; i < num_texts; i++)
+    {
+        if (!readString(ifs, &w))
+            return NULL;
+        texts[i].m_text = w.data();
+        uint8_t rtl = 0;
+        readValue(ifs, &rtl);
+        texts[i].m_rtl = rtl != 0;
+        if (texts[i].m_rtl)
+        {
+            if (!readString(ifs, &w))
+                return NULL;
+            texts[i].m_fribidized = w.data();
+        }
+    }
+
+    uint32_t num_messages = 0;
+    readValue(ifs, &num_messages);
+    if (ifs.fail() || num_messages > MAX_CACHED_SIZE)
+        return NULL;
+    TranslationTable *table =
+        new TranslationTable(std::max(num_messages, num_texts)
+                             + extra_capacity);
+    std::vector<char> context;
+    std::vector<Text> forms;
+    for (unsigned int i = 0; i < num_messages; i++)
+    {
+        uint8_t type = 0, has_context = 0;
+        uint32_t num_forms = 0;
+        readValue(ifs, &type);
+        readValue(ifs, &has_context);
+        bool valid = readString(ifs, &context) && readString(ifs, &s);
+        readValue(ifs, &num_forms);
+        valid = valid && !ifs.fail() && type != MT_UNTRANSLATED &&
+                type <= MT_UNTRANSLATED && num_forms <= num_texts;
+        forms.resize(num_forms);
+        for (unsigned int j = 0; valid && j < num_forms; j++)
+        {
+            uint32_t index = 0;
+            readValue(ifs, &index);
+            valid = !ifs.fail() && index < num_texts;
+            if (valid)
+                forms[j] = texts[index];
+        }
+        if (!valid || !table->add(has_context ? context.data() : NULL,
+                                  s.data(), (MessageType)type, forms))
+        {
+            delete table;
+            return NULL;
+        }
+    }
+    return table;
+}   // load
@@ -0,0 +1,132 @@
+//
+//  SuperTuxKart - a fun racing game with go-kart
+//  Copyright (C) 2018 SuperTuxKart-Team
+//
+//  This program is free software; you can redistribute it and/or
+//  modify it under the terms of the GNU General Public License
+//  as published by the Free Software Foundation; either version 3
+//  of the License, or (at your option) any later version.
+//
+//  This program is distributed in the hope that it will be useful,
+//  but WITHOUT ANY WARRANTY; without even the implied warranty of
+//  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+//  GNU General Public License for more details.
+//
+//  You should have received a copy of the GNU General Public License
+//  along with this program; if not, write to the Free Software
+//  Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
+
+#ifndef HEADER_TRANSLATION_TABLE_HPP
+#define HEADER_TRANSLATION_TABLE_HPP
+
+#include "utils/no_copy.hpp"
+#include "utils/types.hpp"
+
+#include <irrString.h>
+
+#include <atomic>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+/**
+  * \brief A hash table with the translations of the current language, in
+  *  which messages can be looked up without locks or memory allocations.
+  *  Each message (identified by its context and msgid) maps to its
+  *  translated forms, which are stored as wide strings together with their
+  *  fribidized version. A second index maps the text of each form to the
+  *  form, so that fribidizing a translated string is a lookup as well.
+  *  Messages are never removed or modified, and are published with atomic
+  *  stores, so they can be added (e.g. untranslated strings when they are
+  *  first used) while other threads read the table. All returned pointers
+  *  stay valid until the table is deleted. The number of messages and
+  *  texts is limited by the capacity set in the constructor, since the
+  *  slot arrays can not grow without invalidating concurrent lookups.
+  *  The table can be written to a binary cache, which is much faster to
+  *  load than parsing the .po files again.
+  * \ingroup utils
+  */
+class TranslationTable : public NoCopy
+{
+public:
+    /** One translated form of a message. */
+    struct Text
+    {
+        /** Hash of m_text. */
+        uint64_t           m_hash;
+        irr::core::stringw m_text;
+        /** The fribidized text, only set if m_rtl is true. */
+        irr::core::stringw m_fribidized;
+        bool               m_rtl;
+    };   // Text
+
+    enum MessageType
+    {
+        /** Translated by the dictionary of the language. */
+        MT_TRANSLATED = 0,
+        /** Translated by the fallback dictionary (e.g. 'pt' for 'pt_BR'),
+         *  plural forms use the plural rule of the fallback language. */
+        MT_FALLBACK   = 1,
+        /** Not translated, the only form is the widened msgid. */
+        MT_UNTRANSLATED = 2
+    };
+
+    /** A message with its translations. */
+    struct Message
+    {
+        uint64_t                 m_hash;
+        bool                     m_has_context;
+        std::string              m_context;
+        std::string              m_msgid;
+        MessageType              m_type;
+        std::vector<const Text*> m_forms;
+    };   // Message
+
+private:
+    /** Messages and texts, deques keep the addresses of their elements
+     *  stable when elements are added. */
+    std::deque<Message> m_messages;
+    std::deque<Text>    m_texts;
+
+    /** Open addressing hash tables with linear probing. */
+    std::unique_ptr<std::atomic<const Message*>[]> m_message_slots;
+    std::unique_ptr<std::atomic<const Text*>[]>    m_text_slots;
+
+    /** Number of slots minus 1, the number of slots is a power of 2. */
+    uint64_t            m_mask;
+
+    /** Maximum number of messages and of texts, so that at most half of
+     *  the slots are used. */
+    unsigned int        m_capacity;
+
+    /** Serialises adding of messages and iterating over all messages. */
+    mutable std::mutex  m_mutex;
+
+    static uint64_t hashMessage(const char *context, const char *msgid,
+                                bool untranslated);
+    static uint64_t hashText(const wchar_t *text);
+    const Text *addText(const Text &text);
+
+public:
+                   TranslationTable(unsigned int capacity);
+    const Message *find(const char *context, const char *msgid,
+                        bool untranslated) const;
+    const Text    *findText(const wchar_t *text) const;
+    const Message *add(const char *context, const char *msgid,
+                       MessageType type, const std::vector<Text> &forms);
+    void           getAllChars(std::set<wchar_t> *chars) const;
+    unsigned int   getNumMessages() const;
+    bool           save(const std::string &filename, uint64_t key,
+                        const std::string &plural_forms,
+                        const std::string &fallback_plural_forms) const;
+    static TranslationTable *load(const std::string &filename, uint64_t key,
+                                  unsigned int extra_capacity,
+                                  std::string *plural_forms,
+                                  std::string *fallback_plural_forms);
+    static void    unitTesting();
+};   // TranslationTable
+
+#endif